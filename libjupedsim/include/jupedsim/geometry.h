@@ -60,6 +60,13 @@ JPS_Geometry_GetHoleSize(JPS_Geometry handle, size_t hole_index, JPS_ErrorMessag
 JUPEDSIM_API const JPS_Point*
 JPS_Geometry_GetHoleData(JPS_Geometry handle, size_t hole_index, JPS_ErrorMessage* errorMessage);
 
+/**
+ * Returns the number of doors in the geometry, see JPS_GeometryBuilder_AddDoor.
+ * @param handle to the JPS_Geometry to operate on
+ * @return Number of doors
+ */
+JUPEDSIM_API size_t JPS_Geometry_GetDoorCount(JPS_Geometry handle);
+
 /**
  * Frees a JPS_Geometry
  * @param handle to the JPS_Geometry to free.
@@ -108,6 +115,18 @@ JUPEDSIM_API void JPS_GeometryBuilder_ExcludeFromAccessibleArea(
     const JPS_Point* polygon,
     size_t lenPolygon);
 
+/**
+ * Adds a door to the geometry. A door is a line segment inside the accessible area that can be
+ * opened and closed during the simulation with JPS_Simulation_SetDoorClosed, a closed door acts as
+ * a wall. Doors are numbered in the order they are added, starting with 0, and are open initially.
+ * A door must not cross walls, typically it spans a passage from wall to wall.
+ * @param handle to operate on.
+ * @param from first end of the door.
+ * @param to second end of the door.
+ */
+JUPEDSIM_API void
+JPS_GeometryBuilder_AddDoor(JPS_GeometryBuilder handle, JPS_Point from, JPS_Point to);
+
 /**
  * Creates a JPS_Geometry from a JPS_GeometryBuilder. After this call the builder still has to be
  * freed with JPS_GeometryBuilder_Free.
@@ -124,6 +143,15 @@ JPS_GeometryBuilder_Build(JPS_GeometryBuilder handle, JPS_ErrorMessage* errorMes
  */
 JUPEDSIM_API void JPS_GeometryBuilder_Free(JPS_GeometryBuilder handle);
 
+/**
+ * Sets the directory geometries and routing engines are stored in once they are built.
+ * Later builds of the same geometry, also by other processes, load them from there instead of
+ * building them again. Files that were written by another version of the library are ignored.
+ * The directory is created if it does not exist. The cache is disabled by default.
+ * @param directory to store built geometries in, NULL or an empty string disables the cache.
+ */
+JUPEDSIM_API void JPS_GeometryCache_SetDirectory(const char* directory);
+
 #ifdef __cplusplus
 }
 #endif
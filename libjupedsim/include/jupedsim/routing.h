@@ -2,6 +2,7 @@
 /* SPDX-License-Identifier: LGPL-3.0-or-later */
 #pragma once
 
+#include "error.h"
 #include "export.h"
 #include "geometry.h"
 #include "types.h"
@@ -33,6 +34,33 @@ typedef struct JPS_Path {
  */
 JUPEDSIM_API void JPS_Path_Free(JPS_Path path);
 
+/**
+ * Multiple paths inside the walkable area stored back to back in one buffer.
+ * The points of path i are points[offsets[i]] to points[offsets[i + 1] - 1].
+ */
+typedef struct JPS_PathBatch {
+    /**
+     * Number of paths in this batch
+     */
+    size_t len;
+    /**
+     * Offsets of each path into 'points', has len + 1 entries. The last entry is the total number
+     * of points.
+     */
+    const size_t* offsets;
+    /**
+     * JPS_Points of all paths.
+     */
+    const JPS_Point* points;
+} JPS_PathBatch;
+
+/**
+ * Frees memory held by JPS_PathBatch
+ *
+ * @param batch to free its memory.
+ */
+JUPEDSIM_API void JPS_PathBatch_Free(JPS_PathBatch batch);
+
 /**
  * Describes a polygon in terms of indices of vertices belonging to a JPS_Mesh.
  */
@@ -93,6 +121,28 @@ JUPEDSIM_API JPS_RoutingEngine JPS_RoutingEngine_Create(JPS_Geometry geometry);
 JUPEDSIM_API JPS_Path
 JPS_RoutingEngine_ComputeWaypoint(JPS_RoutingEngine handle, JPS_Point from, JPS_Point to);
 
+/**
+ * Computes the shortest paths for many pairs of points at once.
+ * The pairs are distributed on multiple threads, each path is the same as returned by
+ * JPS_RoutingEngine_ComputeWaypoint for this pair.
+ *
+ * @param handle of the routing engine to use.
+ * @param from array of 'len' start points.
+ * @param to array of 'len' destination points, path i leads from from[i] to to[i].
+ * @param len number of pairs.
+ * @param threadCount number of threads to use, 0 selects the number of hardware threads.
+ * @param[out] errorMessage if not NULL: will be set to a JPS_ErrorMessage in case of an error.
+ * @return all paths, empty if any point is outside of the walkable area. A pair without a path
+ * between its points is not an error, its path has no points, i.e. offsets[i] == offsets[i + 1].
+ */
+JUPEDSIM_API JPS_PathBatch JPS_RoutingEngine_ComputeWaypointBatch(
+    JPS_RoutingEngine handle,
+    const JPS_Point* from,
+    const JPS_Point* to,
+    size_t len,
+    size_t threadCount,
+    JPS_ErrorMessage* errorMessage);
+
 JUPEDSIM_API bool JPS_RoutingEngine_IsRoutable(JPS_RoutingEngine handle, JPS_Point p);
 
 JUPEDSIM_API JPS_Mesh JPS_RoutingEngine_Mesh(JPS_RoutingEngine handle);
@@ -24,6 +24,129 @@ extern "C" {
  */
 typedef struct JPS_Simulation_t* JPS_Simulation;
 
+/**
+ * Opaque type for options controlling how a simulation is computed.
+ * Options do not change what is simulated.
+ */
+typedef struct JPS_SimulationOptions_t* JPS_SimulationOptions;
+
+/**
+ * Creates simulation options with default values.
+ * @return the options
+ */
+JUPEDSIM_API JPS_SimulationOptions JPS_SimulationOptions_Create(void);
+
+/**
+ * Sets the number of threads used to compute an iteration. Defaults to 1.
+ * Results of the simulation do not depend on the number of threads used.
+ * @param handle of the options to modify
+ * @param threadCount number of threads, 0 selects the number of hardware threads.
+ */
+JUPEDSIM_API void
+JPS_SimulationOptions_SetThreadCount(JPS_SimulationOptions handle, size_t threadCount);
+
+/**
+ * Data structures available to find neighboring agents.
+ */
+enum JPS_NeighborhoodSearchBackend {
+    /**
+     * Unbounded sparse grid, cells are stored in a hash map. This is the default.
+     */
+    JPS_NeighborhoodSearchBackend_HashGrid,
+    /**
+     * Dense grid covering the bounding box of the geometry, rebuilt in one contiguous array in
+     * every iteration. Agents are reordered in memory by grid cell, hence the order in which
+     * agents are iterated is unspecified and JPS_Agent handles are invalidated by every iteration.
+     */
+    JPS_NeighborhoodSearchBackend_DenseGrid
+};
+
+/**
+ * Sets the data structure used to find neighboring agents.
+ * @param handle of the options to modify
+ * @param backend to use
+ */
+JUPEDSIM_API void JPS_SimulationOptions_SetNeighborhoodSearchBackend(
+    JPS_SimulationOptions handle,
+    JPS_NeighborhoodSearchBackend backend);
+
+/**
+ * Enables Verlet neighbor lists. Each agent keeps a list of all agents within the interaction
+ * radius of the operational model plus 'skin'. The lists, including the line of sight checks
+ * against the geometry, are reused until any agent moved more than half the skin. Larger skins
+ * rebuild less often but list more agents. Defaults to 0, which disables neighbor lists.
+ * @param handle of the options to modify
+ * @param skin in meters, needs to be >= 0.
+ */
+JUPEDSIM_API void
+JPS_SimulationOptions_SetNeighborListSkin(JPS_SimulationOptions handle, double skin);
+
+/**
+ * Enables the wall distance field. Distance and direction to the closest wall are precomputed on
+ * a raster with the given resolution. Agents far away from all walls are then only repelled by
+ * the closest wall read from the raster, agents close to walls still interact with each wall
+ * exactly. Defaults to 0, which disables the field. Has no effect on the Generalized Centrifugal
+ * Force Model.
+ * @param handle of the options to modify
+ * @param resolution in meters, needs to be >= 0.
+ */
+JUPEDSIM_API void JPS_SimulationOptions_SetWallDistanceFieldResolution(
+    JPS_SimulationOptions handle,
+    double resolution);
+
+/**
+ * Path searches available to route agents to their targets.
+ */
+enum JPS_RoutingBackend {
+    /**
+     * Shortest path in the channel of triangles found by an A* search over the triangulation of
+     * the accessible area. This is the default.
+     */
+    JPS_RoutingBackend_Triangulation,
+    /**
+     * Any-angle search (Polyanya) over the triangulation merged into larger convex polygons.
+     * Always finds the shortest path.
+     */
+    JPS_RoutingBackend_Polyanya
+};
+
+/**
+ * Sets the path search used to route agents to their targets.
+ * @param handle of the options to modify
+ * @param backend to use
+ */
+JUPEDSIM_API void
+JPS_SimulationOptions_SetRoutingBackend(JPS_SimulationOptions handle, JPS_RoutingBackend backend);
+
+/**
+ * Lets agents follow their path to the next target lazily. Each agent caches its whole path and
+ * only computes it again when it enters another face of the navigation mesh, gets a new target
+ * or after 'iterations' iterations. Otherwise the next waypoint is taken from the cached path.
+ * Defaults to 0, which computes the next waypoint of every agent in every iteration.
+ * @param handle of the options to modify
+ * @param iterations maximum age of a cached path
+ */
+JUPEDSIM_API void
+JPS_SimulationOptions_SetRoutingRefreshInterval(JPS_SimulationOptions handle, size_t iterations);
+
+/**
+ * Builds the routing data towards all targets of the stages of a journey in parallel when the
+ * journey is added to the simulation, so that iterations only look up paths. The data is built
+ * again after doors are opened or closed and after the geometry is switched. Has no effect with
+ * JPS_RoutingBackend_Polyanya, which searches every path anew.
+ * Defaults to false, which builds the routing data on first use during the iterations.
+ * @param handle of the options to modify
+ * @param precompute true to build the routing data ahead of time
+ */
+JUPEDSIM_API void
+JPS_SimulationOptions_SetPrecomputeRoutingTables(JPS_SimulationOptions handle, bool precompute);
+
+/**
+ * Frees a JPS_SimulationOptions.
+ * @param handle to the JPS_SimulationOptions to free.
+ */
+JUPEDSIM_API void JPS_SimulationOptions_Free(JPS_SimulationOptions handle);
+
 /*
  * Creates a new JPS_Simulation object.
  * NOTE: JPS_Simulation_Create will take ownership of all indicated parameters even in case an error
@@ -31,8 +154,12 @@ typedef struct JPS_Simulation_t* JPS_Simulation;
  * @param model to use. Will copy 'model', 'model' can be freed after this call or reused for
  * another simulation.
  * @param geometry to use. Will copy 'geometry', 'geometry' can be freed after this call or reused
- * for another simulation.
+ * for another simulation. Simulations of geometries with the same accessible area and the same
+ * routing options share one immutable copy of the geometry and its navigation mesh, which is
+ * only built for the first of them.
  * @param dT simulation timestep in seconds
+ * @param options to use, may be NULL to use default options. Will copy 'options', 'options' can
+ * be freed after this call or reused for another simulation.
  * @param[out] errorMessage if not NULL: will be set to a JPS_ErrorMessage in case of an error.
  * @return the Simulation
  */
@@ -40,6 +167,7 @@ JUPEDSIM_API JPS_Simulation JPS_Simulation_Create(
     JPS_OperationalModel model,
     JPS_Geometry geometry,
     double dT,
+    JPS_SimulationOptions options,
     JPS_ErrorMessage* errorMessage);
 
 /**
@@ -218,6 +346,21 @@ JUPEDSIM_API bool JPS_Simulation_MarkAgentForRemoval(
     JPS_AgentId agentId,
     JPS_ErrorMessage* errorMessage);
 
+/**
+ * Marks several agents from the simulation for removal, see JPS_Simulation_MarkAgentForRemoval.
+ * If any of the agents does not exist none of them is marked.
+ * @param handle to the simulation to act on
+ * @param agentIds ids of the agents to remove
+ * @param count number of ids in agentIds
+ * @param[out] errorMessage if not NULL: will be set to a JPS_ErrorMessage in case of an error.
+ * @return bool true if all agents existed and were marked for removal otherwise false
+ */
+JUPEDSIM_API bool JPS_Simulation_MarkAgentsForRemoval(
+    JPS_Simulation handle,
+    const JPS_AgentId* agentIds,
+    size_t count,
+    JPS_ErrorMessage* errorMessage);
+
 /*
  * Returns the ids of all agents that exited the simulation in the last iteration.
  * @param handle of the Simulation
@@ -281,6 +424,30 @@ JUPEDSIM_API JPS_AgentIterator JPS_Simulation_AgentIterator(JPS_Simulation handl
 JUPEDSIM_API JPS_Agent
 JPS_Simulation_GetAgent(JPS_Simulation handle, JPS_AgentId agentId, JPS_ErrorMessage* errorMessage);
 
+/**
+ * Returns the handle of a specific agent of the simulation.
+ * @param handle of the simulation
+ * @param agentId Id of the agent
+ * @param[out] errorMessage if not NULL: will be set to a JPS_ErrorMessage in case of an error.
+ * @return handle of the agent, zero if the agent is unknown
+ */
+JUPEDSIM_API JPS_AgentHandle JPS_Simulation_GetAgentHandle(
+    JPS_Simulation handle,
+    JPS_AgentId agentId,
+    JPS_ErrorMessage* errorMessage);
+
+/**
+ * Returns the agent referred to by a handle obtained from JPS_Simulation_GetAgentHandle.
+ * @param handle of the simulation
+ * @param agentHandle handle of the agent to get
+ * @param[out] errorMessage if not NULL: will be set to a JPS_ErrorMessage in case of an error.
+ * @return Agent with given handle, NULL if the handle is invalid or the agent has been removed
+ */
+JUPEDSIM_API JPS_Agent JPS_Simulation_GetAgentByHandle(
+    JPS_Simulation handle,
+    JPS_AgentHandle agentHandle,
+    JPS_ErrorMessage* errorMessage);
+
 /**
  * Switches the journey and currently selected stage of this agent
  * @param handle of the Simulation to operate on
@@ -378,6 +545,30 @@ JUPEDSIM_API bool JPS_Simulation_SwitchGeometry(
     JPS_AgentIdIterator* faultyAgents,
     JPS_ErrorMessage* errorMessage);
 
+/**
+ * Opens or closes a door of the geometry used by this simulation. A closed door acts as a wall,
+ * agents are routed around it. Agents that can only reach their target through closed doors walk
+ * up to them and wait until they are opened. Switching the geometry opens all doors.
+ * @param handle of the Simulation to operate on
+ * @param door index of the door, see JPS_GeometryBuilder_AddDoor
+ * @param closed true to close the door, false to open it
+ * @param[out] errorMessage if not NULL: will be set to a JPS_ErrorMessage in case of an error.
+ * @return true on success, false on any error, e.g. an unknown door.
+ */
+JUPEDSIM_API bool JPS_Simulation_SetDoorClosed(
+    JPS_Simulation handle,
+    size_t door,
+    bool closed,
+    JPS_ErrorMessage* errorMessage);
+
+/**
+ * Returns whether a door of the geometry used by this simulation is closed.
+ * @param handle of the Simulation to operate on
+ * @param door index of the door, see JPS_GeometryBuilder_AddDoor
+ * @return true if the door is closed, false if it is open or unknown.
+ */
+JUPEDSIM_API bool JPS_Simulation_IsDoorClosed(JPS_Simulation handle, size_t door);
+
 /**
  * Frees a JPS_Simulation.
  * @param handle to the JPS_Simulation to free.
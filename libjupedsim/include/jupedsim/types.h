@@ -88,6 +88,14 @@ typedef size_t JPS_StageIndex;
  */
 typedef uint64_t JPS_AgentId;
 
+/**
+ * Handle of an agent within one simulation.
+ * Handles are resolved in constant time and become invalid when the agent is removed, they are
+ * never reused for other agents.
+ * Zero represents an invalid handle.
+ */
+typedef uint64_t JPS_AgentHandle;
+
 #ifdef __cplusplus
 }
 #endif
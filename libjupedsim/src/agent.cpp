@@ -6,6 +6,7 @@
 #include "Conversion.hpp"
 #include "ErrorMessage.hpp"
 
+#include <AgentStore.hpp>
 #include <GenericAgent.hpp>
 #include <Unreachable.hpp>
 
@@ -102,7 +103,7 @@ JPS_Agent_GetGeneralizedCentrifugalForceModelState(JPS_Agent handle, JPS_ErrorMe
     assert(handle);
     const auto agent = reinterpret_cast<GenericAgent*>(handle);
     try {
-        auto& model = std::get<GeneralizedCentrifugalForceModelData>(agent->model);
+        auto& model = AgentStore::ModelOf<GeneralizedCentrifugalForceModelData>(*agent);
         return reinterpret_cast<JPS_GeneralizedCentrifugalForceModelState>(&model);
     } catch(const std::exception& ex) {
         if(errorMessage) {
@@ -123,7 +124,7 @@ JPS_Agent_GetCollisionFreeSpeedModelState(JPS_Agent handle, JPS_ErrorMessage* er
     assert(handle);
     const auto agent = reinterpret_cast<GenericAgent*>(handle);
     try {
-        auto& model = std::get<CollisionFreeSpeedModelData>(agent->model);
+        auto& model = AgentStore::ModelOf<CollisionFreeSpeedModelData>(*agent);
         return reinterpret_cast<JPS_CollisionFreeSpeedModelState>(&model);
     } catch(const std::exception& ex) {
         if(errorMessage) {
@@ -144,7 +145,7 @@ JPS_Agent_GetCollisionFreeSpeedModelV2State(JPS_Agent handle, JPS_ErrorMessage*
     assert(handle);
     const auto agent = reinterpret_cast<GenericAgent*>(handle);
     try {
-        auto& model = std::get<CollisionFreeSpeedModelV2Data>(agent->model);
+        auto& model = AgentStore::ModelOf<CollisionFreeSpeedModelV2Data>(*agent);
         return reinterpret_cast<JPS_CollisionFreeSpeedModelV2State>(&model);
     } catch(const std::exception& ex) {
         if(errorMessage) {
@@ -165,7 +166,7 @@ JPS_Agent_GetSocialForceModelState(JPS_Agent handle, JPS_ErrorMessage* errorMess
     assert(handle);
     const auto agent = reinterpret_cast<GenericAgent*>(handle);
     try {
-        auto& model = std::get<SocialForceModelData>(agent->model);
+        auto& model = AgentStore::ModelOf<SocialForceModelData>(*agent);
         return reinterpret_cast<JPS_SocialForceModelState>(&model);
     } catch(const std::exception& ex) {
         if(errorMessage) {
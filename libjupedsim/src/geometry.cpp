@@ -9,6 +9,7 @@
 
 #include <CollisionGeometry.hpp>
 #include <GeometryBuilder.hpp>
+#include <GeometryCache.hpp>
 
 using jupedsim::detail::intoJPS_Point;
 using jupedsim::detail::intoPoint;
@@ -49,6 +50,13 @@ void JPS_GeometryBuilder_ExcludeFromAccessibleArea(
     builder->ExcludeFromAccessibleArea(loop);
 }
 
+void JPS_GeometryBuilder_AddDoor(JPS_GeometryBuilder handle, JPS_Point from, JPS_Point to)
+{
+    assert(handle != nullptr);
+    auto builder = reinterpret_cast<GeometryBuilder*>(handle);
+    builder->AddDoor(intoPoint(from), intoPoint(to));
+}
+
 JPS_Geometry JPS_GeometryBuilder_Build(JPS_GeometryBuilder handle, JPS_ErrorMessage* errorMessage)
 {
     assert(handle != nullptr);
@@ -74,6 +82,11 @@ void JPS_GeometryBuilder_Free(JPS_GeometryBuilder handle)
     delete reinterpret_cast<GeometryBuilder*>(handle);
 }
 
+void JPS_GeometryCache_SetDirectory(const char* directory)
+{
+    GeometryCache::Instance().SetDirectory(directory ? directory : "");
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// Geometry
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -98,6 +111,13 @@ size_t JPS_Geometry_GetHoleCount(JPS_Geometry handle)
     return std::get<1>(geo->AccessibleArea()).size();
 }
 
+size_t JPS_Geometry_GetDoorCount(JPS_Geometry handle)
+{
+    assert(handle);
+    const auto geo = reinterpret_cast<CollisionGeometry const*>(handle);
+    return geo->Doors().size();
+}
+
 size_t
 JPS_Geometry_GetHoleSize(JPS_Geometry handle, size_t hole_index, JPS_ErrorMessage* errorMessage)
 {
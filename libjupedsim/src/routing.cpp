@@ -3,11 +3,17 @@
 #include "jupedsim/routing.h"
 
 #include "Conversion.hpp"
+#include "ErrorMessage.hpp"
 
 #include <CollisionGeometry.hpp>
 #include <RoutingEngine.hpp>
+#include <ThreadPool.hpp>
 
 #include <algorithm>
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <vector>
 
 using jupedsim::detail::intoJPS_Point;
 using jupedsim::detail::intoPoint;
@@ -23,6 +29,18 @@ JUPEDSIM_API void JPS_Path_Free(JPS_Path path)
     path.len = 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// JPS_PathBatch
+////////////////////////////////////////////////////////////////////////////////
+JUPEDSIM_API void JPS_PathBatch_Free(JPS_PathBatch batch)
+{
+    delete[] batch.offsets;
+    delete[] batch.points;
+    batch.offsets = nullptr;
+    batch.points = nullptr;
+    batch.len = 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// JPS_Mesh
 ////////////////////////////////////////////////////////////////////////////////
@@ -54,6 +72,57 @@ JPS_RoutingEngine_ComputeWaypoint(JPS_RoutingEngine handle, JPS_Point from, JPS_
     return p;
 }
 
+JUPEDSIM_API JPS_PathBatch JPS_RoutingEngine_ComputeWaypointBatch(
+    JPS_RoutingEngine handle,
+    const JPS_Point* from,
+    const JPS_Point* to,
+    size_t len,
+    size_t threadCount,
+    JPS_ErrorMessage* errorMessage)
+{
+    assert(handle);
+    const auto* engine = reinterpret_cast<const RoutingEngine*>(handle);
+    JPS_PathBatch result{};
+    try {
+        std::vector<std::vector<Point>> paths(len);
+        // Do not start more threads than there are pairs to route
+        const size_t hardwareThreads = std::thread::hardware_concurrency();
+        const auto threads = std::min(threadCount == 0 ? hardwareThreads : threadCount, len);
+        ThreadPool threadPool(std::max(threads, size_t{1}));
+        threadPool.ParallelFor(len, [&](size_t begin, size_t end) {
+            for(size_t index = begin; index < end; ++index) {
+                paths[index] =
+                    engine->ComputeAllWaypoints(intoPoint(from[index]), intoPoint(to[index]));
+            }
+        });
+
+        auto offsets = std::make_unique<size_t[]>(len + 1);
+        offsets[0] = 0;
+        for(size_t index = 0; index < len; ++index) {
+            offsets[index + 1] = offsets[index] + paths[index].size();
+        }
+        auto points = std::make_unique<JPS_Point[]>(offsets[len]);
+        for(size_t index = 0; index < len; ++index) {
+            std::transform(
+                std::begin(paths[index]),
+                std::end(paths[index]),
+                points.get() + offsets[index],
+                [](const auto& p) { return intoJPS_Point(p); });
+        }
+        result = JPS_PathBatch{len, offsets.release(), points.release()};
+    } catch(const std::exception& ex) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(new JPS_ErrorMessage_t{ex.what()});
+        }
+    } catch(...) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(
+                new JPS_ErrorMessage_t{"Unknown internal error."});
+        }
+    }
+    return result;
+}
+
 JUPEDSIM_API bool JPS_RoutingEngine_IsRoutable(JPS_RoutingEngine handle, JPS_Point p)
 {
     const auto* engine = reinterpret_cast<RoutingEngine*>(handle);
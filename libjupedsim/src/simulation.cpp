@@ -13,6 +13,7 @@
 #include <CollisionGeometry.hpp>
 #include <GeometrySwitchError.hpp>
 #include <Simulation.hpp>
+#include <SimulationOptions.hpp>
 #include <Unreachable.hpp>
 
 #include <cassert>
@@ -21,6 +22,92 @@ using jupedsim::detail::intoJPS_Point;
 using jupedsim::detail::intoPoint;
 using jupedsim::detail::intoTuple;
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// SimulationOptions
+////////////////////////////////////////////////////////////////////////////////////////////////////
+JPS_SimulationOptions JPS_SimulationOptions_Create()
+{
+    return reinterpret_cast<JPS_SimulationOptions>(new SimulationOptions{});
+}
+
+void JPS_SimulationOptions_SetThreadCount(JPS_SimulationOptions handle, size_t threadCount)
+{
+    assert(handle);
+    auto options = reinterpret_cast<SimulationOptions*>(handle);
+    options->threadCount = threadCount;
+}
+
+void JPS_SimulationOptions_SetNeighborhoodSearchBackend(
+    JPS_SimulationOptions handle,
+    JPS_NeighborhoodSearchBackend backend)
+{
+    assert(handle);
+    auto options = reinterpret_cast<SimulationOptions*>(handle);
+    switch(backend) {
+        case JPS_NeighborhoodSearchBackend_HashGrid:
+            options->neighborhoodSearchBackend = NeighborhoodSearchBackend::HashGrid;
+            break;
+        case JPS_NeighborhoodSearchBackend_DenseGrid:
+            options->neighborhoodSearchBackend = NeighborhoodSearchBackend::DenseGrid;
+            break;
+    }
+}
+
+void JPS_SimulationOptions_SetNeighborListSkin(JPS_SimulationOptions handle, double skin)
+{
+    assert(handle);
+    auto options = reinterpret_cast<SimulationOptions*>(handle);
+    options->neighborListSkin = skin;
+}
+
+void JPS_SimulationOptions_SetWallDistanceFieldResolution(
+    JPS_SimulationOptions handle,
+    double resolution)
+{
+    assert(handle);
+    auto options = reinterpret_cast<SimulationOptions*>(handle);
+    options->wallDistanceFieldResolution = resolution;
+}
+
+void JPS_SimulationOptions_SetRoutingBackend(
+    JPS_SimulationOptions handle,
+    JPS_RoutingBackend backend)
+{
+    assert(handle);
+    auto options = reinterpret_cast<SimulationOptions*>(handle);
+    switch(backend) {
+        case JPS_RoutingBackend_Triangulation:
+            options->routingBackend = RoutingBackend::Triangulation;
+            break;
+        case JPS_RoutingBackend_Polyanya:
+            options->routingBackend = RoutingBackend::Polyanya;
+            break;
+    }
+}
+
+void JPS_SimulationOptions_SetRoutingRefreshInterval(
+    JPS_SimulationOptions handle,
+    size_t iterations)
+{
+    assert(handle);
+    auto options = reinterpret_cast<SimulationOptions*>(handle);
+    options->routingRefreshInterval = iterations;
+}
+
+void JPS_SimulationOptions_SetPrecomputeRoutingTables(
+    JPS_SimulationOptions handle,
+    bool precompute)
+{
+    assert(handle);
+    auto options = reinterpret_cast<SimulationOptions*>(handle);
+    options->precomputeRoutingTables = precompute;
+}
+
+void JPS_SimulationOptions_Free(JPS_SimulationOptions handle)
+{
+    delete reinterpret_cast<SimulationOptions*>(handle);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// Simulation
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -28,6 +115,7 @@ JPS_Simulation JPS_Simulation_Create(
     JPS_OperationalModel model,
     JPS_Geometry geometry,
     double dT,
+    JPS_SimulationOptions options,
     JPS_ErrorMessage* errorMessage)
 {
     assert(model);
@@ -37,8 +125,13 @@ JPS_Simulation JPS_Simulation_Create(
         auto collisionGeometry = reinterpret_cast<const CollisionGeometry*>(geometry);
         auto modelInternal = reinterpret_cast<OperationalModel*>(model);
         auto model = modelInternal->Clone();
+        const auto simulationOptions =
+            options ? *reinterpret_cast<const SimulationOptions*>(options) : SimulationOptions{};
         result = reinterpret_cast<JPS_Simulation>(new Simulation(
-            std::move(model), std::make_unique<CollisionGeometry>(*collisionGeometry), dT));
+            std::move(model),
+            std::make_unique<CollisionGeometry>(*collisionGeometry),
+            dT,
+            simulationOptions));
     } catch(const std::exception& ex) {
         if(errorMessage) {
             *errorMessage = reinterpret_cast<JPS_ErrorMessage>(new JPS_ErrorMessage_t{ex.what()});
@@ -346,6 +439,33 @@ bool JPS_Simulation_MarkAgentForRemoval(
     return result;
 }
 
+bool JPS_Simulation_MarkAgentsForRemoval(
+    JPS_Simulation handle,
+    const JPS_AgentId* agentIds,
+    size_t count,
+    JPS_ErrorMessage* errorMessage)
+{
+    assert(handle);
+    assert(agentIds || count == 0);
+    auto simulation = reinterpret_cast<Simulation*>(handle);
+    bool result{false};
+    try {
+        simulation->MarkAgentsForRemoval(
+            std::vector<GenericAgent::ID>(agentIds, agentIds + count));
+        result = true;
+    } catch(const std::exception& ex) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(new JPS_ErrorMessage_t{ex.what()});
+        }
+    } catch(...) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(
+                new JPS_ErrorMessage_t{"Unknown internal error."});
+        }
+    }
+    return result;
+}
+
 size_t JPS_Simulation_RemovedAgents(JPS_Simulation handle, const JPS_AgentId** data)
 {
     assert(handle);
@@ -437,6 +557,53 @@ JPS_Simulation_GetAgent(JPS_Simulation handle, JPS_AgentId agentId, JPS_ErrorMes
     return nullptr;
 }
 
+JPS_AgentHandle JPS_Simulation_GetAgentHandle(
+    JPS_Simulation handle,
+    JPS_AgentId agentId,
+    JPS_ErrorMessage* errorMessage)
+{
+    assert(handle);
+    const auto simulation = reinterpret_cast<Simulation*>(handle);
+
+    try {
+        return simulation->AgentHandle(agentId);
+    } catch(const std::exception& ex) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(new JPS_ErrorMessage_t{ex.what()});
+        }
+    } catch(...) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(
+                new JPS_ErrorMessage_t{"Unknown internal error."});
+        }
+    }
+    return AgentSlotMap::INVALID_HANDLE;
+}
+
+JPS_Agent JPS_Simulation_GetAgentByHandle(
+    JPS_Simulation handle,
+    JPS_AgentHandle agentHandle,
+    JPS_ErrorMessage* errorMessage)
+{
+    assert(handle);
+    const auto simulation = reinterpret_cast<Simulation*>(handle);
+
+    try {
+        const auto agent = &simulation->AgentByHandle(agentHandle);
+        return reinterpret_cast<JPS_Agent>(agent);
+    } catch(const std::exception& ex) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(new JPS_ErrorMessage_t{ex.what()});
+        }
+    } catch(...) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(
+                new JPS_ErrorMessage_t{"Unknown internal error."});
+        }
+    }
+    return nullptr;
+}
+
 bool JPS_Simulation_SwitchAgentJourney(
     JPS_Simulation handle,
     JPS_AgentId agentId,
@@ -668,6 +835,42 @@ bool JPS_Simulation_SwitchGeometry(
     return result;
 }
 
+bool JPS_Simulation_SetDoorClosed(
+    JPS_Simulation handle,
+    size_t door,
+    bool closed,
+    JPS_ErrorMessage* errorMessage)
+{
+    assert(handle);
+    auto simulation = reinterpret_cast<Simulation*>(handle);
+    bool result = false;
+    try {
+        simulation->SetDoorClosed(door, closed);
+        result = true;
+    } catch(const std::exception& ex) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(new JPS_ErrorMessage_t{ex.what()});
+        }
+    } catch(...) {
+        if(errorMessage) {
+            *errorMessage = reinterpret_cast<JPS_ErrorMessage>(
+                new JPS_ErrorMessage_t{"Unknown internal error."});
+        }
+    }
+    return result;
+}
+
+bool JPS_Simulation_IsDoorClosed(JPS_Simulation handle, size_t door)
+{
+    assert(handle);
+    const auto simulation = reinterpret_cast<const Simulation*>(handle);
+    try {
+        return simulation->IsDoorClosed(door);
+    } catch(...) {
+        return false;
+    }
+}
+
 void JPS_Simulation_Free(JPS_Simulation handle)
 {
     delete reinterpret_cast<Simulation*>(handle);
@@ -7,6 +7,9 @@
 #include <jupedsim/jupedsim.h>
 
 #include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -120,7 +123,7 @@ TEST(Simulation, CanSimulate)
     auto model = JPS_CollisionFreeSpeedModelBuilder_Build(modelBuilder, nullptr);
     ASSERT_NE(model, nullptr);
 
-    auto simulation = JPS_Simulation_Create(model, geometry, 0.01, nullptr);
+    auto simulation = JPS_Simulation_Create(model, geometry, 0.01, nullptr, nullptr);
     ASSERT_NE(simulation, nullptr);
 
     std::vector<JPS_Point> box{{18, 4}, {20, 4}, {20, 6}, {18, 6}};
@@ -148,6 +151,325 @@ TEST(Simulation, CanSimulate)
     ASSERT_LT(JPS_Simulation_IterationCount(simulation), 2000);
 }
 
+TEST(Simulation, ResultsDoNotDependOnThreadCount)
+{
+    auto geo_builder = JPS_GeometryBuilder_Create();
+    std::vector<JPS_Point> box{{0, 0}, {10, 0}, {10, 10}, {0, 10}};
+    JPS_GeometryBuilder_AddAccessibleArea(geo_builder, box.data(), box.size());
+    auto geometry = JPS_GeometryBuilder_Build(geo_builder, nullptr);
+    ASSERT_NE(geometry, nullptr);
+    JPS_GeometryBuilder_Free(geo_builder);
+
+    auto modelBuilder = JPS_CollisionFreeSpeedModelBuilder_Create(8, 0.1, 5, 0.02);
+    auto model = JPS_CollisionFreeSpeedModelBuilder_Build(modelBuilder, nullptr);
+    ASSERT_NE(model, nullptr);
+    JPS_CollisionFreeSpeedModelBuilder_Free(modelBuilder);
+
+    const auto simulate = [&](size_t threads, JPS_NeighborhoodSearchBackend backend, double skin) {
+        auto options = JPS_SimulationOptions_Create();
+        JPS_SimulationOptions_SetThreadCount(options, threads);
+        JPS_SimulationOptions_SetNeighborhoodSearchBackend(options, backend);
+        JPS_SimulationOptions_SetNeighborListSkin(options, skin);
+        auto simulation = JPS_Simulation_Create(model, geometry, 0.01, options, nullptr);
+        JPS_SimulationOptions_Free(options);
+        EXPECT_NE(simulation, nullptr);
+
+        const auto stage = JPS_Simulation_AddStageWaypoint(simulation, {9, 9}, 0.5, nullptr);
+        auto journey = JPS_JourneyDescription_Create();
+        JPS_JourneyDescription_AddStage(journey, stage);
+        const auto journeyId = JPS_Simulation_AddJourney(simulation, journey, nullptr);
+        JPS_JourneyDescription_Free(journey);
+
+        JPS_CollisionFreeSpeedModelAgentParameters agent_parameters{};
+        agent_parameters.journeyId = journeyId;
+        agent_parameters.stageId = stage;
+        agent_parameters.time_gap = 1;
+        agent_parameters.v0 = 1.2;
+        agent_parameters.radius = 0.2;
+        for(double x = 1; x < 6; x += 0.5) {
+            for(double y = 1; y < 6; y += 0.5) {
+                agent_parameters.position = JPS_Point{x, y};
+                JPS_Simulation_AddCollisionFreeSpeedModelAgent(
+                    simulation, agent_parameters, nullptr);
+            }
+        }
+        for(size_t iteration = 0; iteration < 200; ++iteration) {
+            EXPECT_TRUE(JPS_Simulation_Iterate(simulation, nullptr));
+        }
+
+        std::vector<JPS_Point> positions{};
+        auto iter = JPS_Simulation_AgentIterator(simulation);
+        while(auto agent = JPS_AgentIterator_Next(iter)) {
+            positions.push_back(JPS_Agent_GetPosition(agent));
+        }
+        JPS_AgentIterator_Free(iter);
+        JPS_Simulation_Free(simulation);
+        return positions;
+    };
+
+    for(const auto backend :
+        {JPS_NeighborhoodSearchBackend_HashGrid, JPS_NeighborhoodSearchBackend_DenseGrid}) {
+        for(const double neighborListSkin : {0.0, 0.5}) {
+            const auto serial = simulate(1, backend, neighborListSkin);
+            const auto parallel = simulate(4, backend, neighborListSkin);
+            ASSERT_EQ(serial.size(), parallel.size());
+            for(size_t index = 0; index < serial.size(); ++index) {
+                ASSERT_EQ(serial[index].x, parallel[index].x);
+                ASSERT_EQ(serial[index].y, parallel[index].y);
+            }
+        }
+    }
+
+    JPS_OperationalModel_Free(model);
+    JPS_Geometry_Free(geometry);
+}
+
+namespace
+{
+// Number of calls to the global operator new, counted to check that iterations do not allocate
+std::atomic<size_t> allocationCount{0};
+} // namespace
+
+void* operator new(size_t size)
+{
+    ++allocationCount;
+    if(void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+TEST(Simulation, SteadyStateIterationsDoNotAllocate)
+{
+    auto geo_builder = JPS_GeometryBuilder_Create();
+    std::vector<JPS_Point> box{{0, 0}, {30, 0}, {30, 30}, {0, 30}};
+    JPS_GeometryBuilder_AddAccessibleArea(geo_builder, box.data(), box.size());
+    std::vector<JPS_Point> obstacle{{10, 10}, {20, 10}, {20, 20}, {10, 20}};
+    JPS_GeometryBuilder_ExcludeFromAccessibleArea(geo_builder, obstacle.data(), obstacle.size());
+    auto geometry = JPS_GeometryBuilder_Build(geo_builder, nullptr);
+    ASSERT_NE(geometry, nullptr);
+    JPS_GeometryBuilder_Free(geo_builder);
+
+    auto cfsmBuilder = JPS_CollisionFreeSpeedModelBuilder_Create(8, 0.1, 5, 0.02);
+    auto cfsm = JPS_CollisionFreeSpeedModelBuilder_Build(cfsmBuilder, nullptr);
+    ASSERT_NE(cfsm, nullptr);
+    JPS_CollisionFreeSpeedModelBuilder_Free(cfsmBuilder);
+    auto gcfmBuilder =
+        JPS_GeneralizedCentrifugalForceModelBuilder_Create(0.3, 0.2, 2, 2, 0.1, 0.1, 3, 3);
+    auto gcfm = JPS_GeneralizedCentrifugalForceModelBuilder_Build(gcfmBuilder, nullptr);
+    ASSERT_NE(gcfm, nullptr);
+    JPS_GeneralizedCentrifugalForceModelBuilder_Free(gcfmBuilder);
+
+    const auto allocationsPerIteration =
+        [&](JPS_OperationalModel model, size_t threads, JPS_NeighborhoodSearchBackend backend) {
+            auto options = JPS_SimulationOptions_Create();
+            JPS_SimulationOptions_SetThreadCount(options, threads);
+            JPS_SimulationOptions_SetNeighborhoodSearchBackend(options, backend);
+            auto simulation = JPS_Simulation_Create(model, geometry, 0.01, options, nullptr);
+            JPS_SimulationOptions_Free(options);
+            EXPECT_NE(simulation, nullptr);
+
+            // Agents are routed around the obstacle and do not reach the waypoint during the test
+            const auto stage = JPS_Simulation_AddStageWaypoint(simulation, {28, 28}, 0.5, nullptr);
+            auto journey = JPS_JourneyDescription_Create();
+            JPS_JourneyDescription_AddStage(journey, stage);
+            const auto journeyId = JPS_Simulation_AddJourney(simulation, journey, nullptr);
+            JPS_JourneyDescription_Free(journey);
+
+            for(size_t column = 0; column < 10; ++column) {
+                for(size_t row = 0; row < 10; ++row) {
+                    const JPS_Point position{1 + 0.8 * column, 1 + 0.8 * row};
+                    if(model == cfsm) {
+                        JPS_CollisionFreeSpeedModelAgentParameters agent_parameters{};
+                        agent_parameters.journeyId = journeyId;
+                        agent_parameters.stageId = stage;
+                        agent_parameters.position = position;
+                        JPS_Simulation_AddCollisionFreeSpeedModelAgent(
+                            simulation, agent_parameters, nullptr);
+                    } else {
+                        JPS_GeneralizedCentrifugalForceModelAgentParameters agent_parameters{};
+                        agent_parameters.journeyId = journeyId;
+                        agent_parameters.stageId = stage;
+                        agent_parameters.position = position;
+                        agent_parameters.orientation = JPS_Point{1, 0};
+                        JPS_Simulation_AddGeneralizedCentrifugalForceModelAgent(
+                            simulation, agent_parameters, nullptr);
+                    }
+                }
+            }
+            // The first iterations size the buffers the simulation reuses afterwards
+            for(size_t iteration = 0; iteration < 20; ++iteration) {
+                EXPECT_TRUE(JPS_Simulation_Iterate(simulation, nullptr));
+            }
+            const size_t before = allocationCount;
+            for(size_t iteration = 0; iteration < 20; ++iteration) {
+                EXPECT_TRUE(JPS_Simulation_Iterate(simulation, nullptr));
+            }
+            const size_t allocations = allocationCount - before;
+            EXPECT_EQ(JPS_Simulation_AgentCount(simulation), 100);
+            JPS_Simulation_Free(simulation);
+            return allocations;
+        };
+
+    for(const auto model : {cfsm, gcfm}) {
+        for(const size_t threads : {1, 4}) {
+            for(const auto backend :
+                {JPS_NeighborhoodSearchBackend_HashGrid, JPS_NeighborhoodSearchBackend_DenseGrid}) {
+                EXPECT_EQ(allocationsPerIteration(model, threads, backend), 0);
+            }
+        }
+    }
+
+    JPS_OperationalModel_Free(gcfm);
+    JPS_OperationalModel_Free(cfsm);
+    JPS_Geometry_Free(geometry);
+}
+
+TEST(Simulation, AgentsAreRoutedAroundObstacles)
+{
+    auto geo_builder = JPS_GeometryBuilder_Create();
+    std::vector<JPS_Point> uShape{{0, 0}, {30, 0}, {30, 20}, {20, 20}, {20, 5}, {10, 5}, {10, 20},
+                                  {0, 20}};
+    JPS_GeometryBuilder_AddAccessibleArea(geo_builder, uShape.data(), uShape.size());
+    auto geometry = JPS_GeometryBuilder_Build(geo_builder, nullptr);
+    ASSERT_NE(geometry, nullptr);
+    JPS_GeometryBuilder_Free(geo_builder);
+
+    auto modelBuilder = JPS_CollisionFreeSpeedModelBuilder_Create(8, 0.1, 5, 0.02);
+    auto model = JPS_CollisionFreeSpeedModelBuilder_Build(modelBuilder, nullptr);
+    ASSERT_NE(model, nullptr);
+    JPS_CollisionFreeSpeedModelBuilder_Free(modelBuilder);
+
+    const auto simulate = [&](JPS_RoutingBackend backend, size_t refreshInterval, bool precompute) {
+        auto options = JPS_SimulationOptions_Create();
+        JPS_SimulationOptions_SetRoutingBackend(options, backend);
+        JPS_SimulationOptions_SetRoutingRefreshInterval(options, refreshInterval);
+        JPS_SimulationOptions_SetPrecomputeRoutingTables(options, precompute);
+        auto simulation = JPS_Simulation_Create(model, geometry, 0.01, options, nullptr);
+        JPS_SimulationOptions_Free(options);
+        ASSERT_NE(simulation, nullptr);
+
+        std::vector<JPS_Point> exit{{24, 17}, {26, 17}, {26, 19}, {24, 19}};
+        const auto stage =
+            JPS_Simulation_AddStageExit(simulation, exit.data(), exit.size(), nullptr);
+        auto journey = JPS_JourneyDescription_Create();
+        JPS_JourneyDescription_AddStage(journey, stage);
+        const auto journeyId = JPS_Simulation_AddJourney(simulation, journey, nullptr);
+        JPS_JourneyDescription_Free(journey);
+
+        JPS_CollisionFreeSpeedModelAgentParameters agent_parameters{};
+        agent_parameters.journeyId = journeyId;
+        agent_parameters.stageId = stage;
+        agent_parameters.time_gap = 1;
+        agent_parameters.v0 = 1.2;
+        agent_parameters.radius = 0.2;
+        for(const auto position : {JPS_Point{5, 18}, JPS_Point{2, 2}, JPS_Point{15, 2}}) {
+            agent_parameters.position = position;
+            ASSERT_NE(
+                JPS_Simulation_AddCollisionFreeSpeedModelAgent(
+                    simulation, agent_parameters, nullptr),
+                0);
+        }
+
+        // The longest shortest path around the inner wall is about 38m long
+        for(size_t iteration = 0; iteration < 6000 && JPS_Simulation_AgentCount(simulation) > 0;
+            ++iteration) {
+            ASSERT_TRUE(JPS_Simulation_Iterate(simulation, nullptr));
+        }
+        EXPECT_EQ(JPS_Simulation_AgentCount(simulation), 0);
+        JPS_Simulation_Free(simulation);
+    };
+
+    for(const auto backend : {JPS_RoutingBackend_Triangulation, JPS_RoutingBackend_Polyanya}) {
+        for(const size_t refreshInterval : {0, 50}) {
+            simulate(backend, refreshInterval, false);
+        }
+    }
+    simulate(JPS_RoutingBackend_Triangulation, 0, true);
+
+    JPS_OperationalModel_Free(model);
+    JPS_Geometry_Free(geometry);
+}
+
+TEST(Simulation, ClosedDoorsStopAgents)
+{
+    auto geo_builder = JPS_GeometryBuilder_Create();
+    std::vector<JPS_Point> outer{{0, 0}, {20, 0}, {20, 10}, {0, 10}};
+    std::vector<JPS_Point> obstacle{{8, 2}, {12, 2}, {12, 8}, {8, 8}};
+    JPS_GeometryBuilder_AddAccessibleArea(geo_builder, outer.data(), outer.size());
+    JPS_GeometryBuilder_ExcludeFromAccessibleArea(geo_builder, obstacle.data(), obstacle.size());
+    JPS_GeometryBuilder_AddDoor(geo_builder, {10, 0}, {10, 2});
+    JPS_GeometryBuilder_AddDoor(geo_builder, {10, 8}, {10, 10});
+    auto geometry = JPS_GeometryBuilder_Build(geo_builder, nullptr);
+    ASSERT_NE(geometry, nullptr);
+    JPS_GeometryBuilder_Free(geo_builder);
+    EXPECT_EQ(JPS_Geometry_GetDoorCount(geometry), 2);
+
+    auto modelBuilder = JPS_CollisionFreeSpeedModelBuilder_Create(8, 0.1, 5, 0.02);
+    auto model = JPS_CollisionFreeSpeedModelBuilder_Build(modelBuilder, nullptr);
+    ASSERT_NE(model, nullptr);
+    JPS_CollisionFreeSpeedModelBuilder_Free(modelBuilder);
+
+    auto options = JPS_SimulationOptions_Create();
+    JPS_SimulationOptions_SetRoutingRefreshInterval(options, 50);
+    auto simulation = JPS_Simulation_Create(model, geometry, 0.01, options, nullptr);
+    JPS_SimulationOptions_Free(options);
+    ASSERT_NE(simulation, nullptr);
+
+    std::vector<JPS_Point> exit{{17, 4}, {19, 4}, {19, 6}, {17, 6}};
+    const auto stage = JPS_Simulation_AddStageExit(simulation, exit.data(), exit.size(), nullptr);
+    auto journey = JPS_JourneyDescription_Create();
+    JPS_JourneyDescription_AddStage(journey, stage);
+    const auto journeyId = JPS_Simulation_AddJourney(simulation, journey, nullptr);
+    JPS_JourneyDescription_Free(journey);
+
+    JPS_CollisionFreeSpeedModelAgentParameters agent_parameters{};
+    agent_parameters.journeyId = journeyId;
+    agent_parameters.stageId = stage;
+    agent_parameters.time_gap = 1;
+    agent_parameters.v0 = 1.2;
+    agent_parameters.radius = 0.2;
+    agent_parameters.position = {2, 5};
+    ASSERT_NE(
+        JPS_Simulation_AddCollisionFreeSpeedModelAgent(simulation, agent_parameters, nullptr), 0);
+
+    JPS_ErrorMessage errorMessage{};
+    EXPECT_FALSE(JPS_Simulation_SetDoorClosed(simulation, 2, true, &errorMessage));
+    EXPECT_NE(errorMessage, nullptr);
+    JPS_ErrorMessage_Free(errorMessage);
+    ASSERT_TRUE(JPS_Simulation_SetDoorClosed(simulation, 0, true, nullptr));
+    ASSERT_TRUE(JPS_Simulation_SetDoorClosed(simulation, 1, true, nullptr));
+    EXPECT_TRUE(JPS_Simulation_IsDoorClosed(simulation, 0));
+
+    // The way through a door is about 18m long, the agent waits at the closed doors
+    for(size_t iteration = 0; iteration < 3000; ++iteration) {
+        ASSERT_TRUE(JPS_Simulation_Iterate(simulation, nullptr));
+    }
+    EXPECT_EQ(JPS_Simulation_AgentCount(simulation), 1);
+
+    ASSERT_TRUE(JPS_Simulation_SetDoorClosed(simulation, 1, false, nullptr));
+    EXPECT_FALSE(JPS_Simulation_IsDoorClosed(simulation, 1));
+    for(size_t iteration = 0; iteration < 4000 && JPS_Simulation_AgentCount(simulation) > 0;
+        ++iteration) {
+        ASSERT_TRUE(JPS_Simulation_Iterate(simulation, nullptr));
+    }
+    EXPECT_EQ(JPS_Simulation_AgentCount(simulation), 0);
+    JPS_Simulation_Free(simulation);
+
+    JPS_OperationalModel_Free(model);
+    JPS_Geometry_Free(geometry);
+}
+
 struct SimulationTest : public ::testing::Test {
     JPS_Simulation simulation{};
     JPS_JourneyId journey_id{};
@@ -171,7 +493,7 @@ struct SimulationTest : public ::testing::Test {
 
         ASSERT_NE(model, nullptr);
 
-        simulation = JPS_Simulation_Create(model, geometry, 0.01, nullptr);
+        simulation = JPS_Simulation_Create(model, geometry, 0.01, nullptr, nullptr);
         ASSERT_NE(simulation, nullptr);
 
         stage_id = JPS_Simulation_AddStageWaypoint(simulation, {1, 1}, 1, nullptr);
@@ -224,6 +546,101 @@ TEST_F(SimulationTest, AgentIteratorCanIterate)
     ASSERT_EQ(JPS_AgentIterator_Next(iter), nullptr);
 }
 
+TEST_F(SimulationTest, MarkedAgentsAreRemovedTogether)
+{
+    std::vector<JPS_AgentId> ids{};
+    for(const auto x : {2., 3., 4., 5.}) {
+        auto parameters = agent_templates[0];
+        parameters.position = {x, 5};
+        ids.push_back(
+            JPS_Simulation_AddCollisionFreeSpeedModelAgent(simulation, parameters, nullptr));
+        ASSERT_NE(ids.back(), 0);
+    }
+    const auto handle = JPS_Simulation_GetAgentHandle(simulation, ids[3], nullptr);
+    ASSERT_NE(handle, 0);
+
+    const std::vector<JPS_AgentId> unknown{ids[1], 0};
+    JPS_ErrorMessage errorMessage{};
+    EXPECT_FALSE(JPS_Simulation_MarkAgentsForRemoval(
+        simulation, unknown.data(), unknown.size(), &errorMessage));
+    EXPECT_NE(errorMessage, nullptr);
+    JPS_ErrorMessage_Free(errorMessage);
+
+    const std::vector<JPS_AgentId> removed{ids[2], ids[0], ids[2]};
+    ASSERT_TRUE(
+        JPS_Simulation_MarkAgentsForRemoval(simulation, removed.data(), removed.size(), nullptr));
+    ASSERT_TRUE(JPS_Simulation_Iterate(simulation, nullptr));
+    ASSERT_EQ(JPS_Simulation_AgentCount(simulation), 2);
+    EXPECT_EQ(JPS_Simulation_GetAgent(simulation, ids[0], nullptr), nullptr);
+    EXPECT_EQ(JPS_Simulation_GetAgent(simulation, ids[2], nullptr), nullptr);
+    EXPECT_EQ(JPS_Agent_GetId(JPS_Simulation_GetAgent(simulation, ids[1], nullptr)), ids[1]);
+    EXPECT_EQ(
+        JPS_Agent_GetId(JPS_Simulation_GetAgentByHandle(simulation, handle, nullptr)), ids[3]);
+}
+
+TEST(RoutingEngine, BatchMatchesSingleQueries)
+{
+    auto geo_builder = JPS_GeometryBuilder_Create();
+    std::vector<JPS_Point> uShape{{0, 0}, {30, 0}, {30, 20}, {20, 20}, {20, 5}, {10, 5}, {10, 20},
+                                  {0, 20}};
+    JPS_GeometryBuilder_AddAccessibleArea(geo_builder, uShape.data(), uShape.size());
+    auto geometry = JPS_GeometryBuilder_Build(geo_builder, nullptr);
+    ASSERT_NE(geometry, nullptr);
+    JPS_GeometryBuilder_Free(geo_builder);
+    auto engine = JPS_RoutingEngine_Create(geometry);
+
+    std::vector<JPS_Point> from{};
+    std::vector<JPS_Point> to{};
+    for(double x = 1; x < 30; x += 4) {
+        for(double y = 1; y < 20; y += 6) {
+            const JPS_Point p{x, y};
+            const JPS_Point q{30 - x, 20 - y};
+            if(!JPS_RoutingEngine_IsRoutable(engine, p) ||
+               !JPS_RoutingEngine_IsRoutable(engine, q)) {
+                continue;
+            }
+            from.push_back(p);
+            to.push_back(q);
+        }
+    }
+
+    ASSERT_FALSE(from.empty());
+
+    for(size_t threadCount : {1, 4}) {
+        JPS_ErrorMessage errorMsg{};
+        auto batch = JPS_RoutingEngine_ComputeWaypointBatch(
+            engine, from.data(), to.data(), from.size(), threadCount, &errorMsg);
+        ASSERT_EQ(errorMsg, nullptr);
+        ASSERT_EQ(batch.len, from.size());
+        ASSERT_EQ(batch.offsets[0], 0);
+        for(size_t index = 0; index < from.size(); ++index) {
+            auto path = JPS_RoutingEngine_ComputeWaypoint(engine, from[index], to[index]);
+            ASSERT_EQ(batch.offsets[index + 1] - batch.offsets[index], path.len);
+            for(size_t point = 0; point < path.len; ++point) {
+                const auto& p = batch.points[batch.offsets[index] + point];
+                EXPECT_DOUBLE_EQ(p.x, path.points[point].x);
+                EXPECT_DOUBLE_EQ(p.y, path.points[point].y);
+            }
+            JPS_Path_Free(path);
+        }
+        JPS_PathBatch_Free(batch);
+    }
+
+    from.push_back({15, 15});
+    to.push_back({1, 1});
+    JPS_ErrorMessage errorMsg{};
+    auto batch = JPS_RoutingEngine_ComputeWaypointBatch(
+        engine, from.data(), to.data(), from.size(), 4, &errorMsg);
+    EXPECT_NE(errorMsg, nullptr);
+    EXPECT_EQ(batch.len, 0);
+    EXPECT_EQ(batch.points, nullptr);
+    JPS_ErrorMessage_Free(errorMsg);
+    JPS_PathBatch_Free(batch);
+
+    JPS_RoutingEngine_Free(engine);
+    JPS_Geometry_Free(geometry);
+}
+
 TEST(Regression, Bug1028)
 {
 
@@ -75,7 +75,7 @@ int main(int argc, char** argv)
         return -1;
     }
 
-    JPS_Simulation simulation = JPS_Simulation_Create(model, geometry, 0.01, &error_msg);
+    JPS_Simulation simulation = JPS_Simulation_Create(model, geometry, 0.01, NULL, &error_msg);
 
     const size_t num_waypoints = 1;
     JPS_Waypoint waypoints[] = {{{19.95, 5}, 0.4}};
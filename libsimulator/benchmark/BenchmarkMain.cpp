@@ -4,5 +4,6 @@
 
 #include "benchmarkCollisionGeometry.hpp"
 #include "benchmarkLineSegment.hpp"
+#include "benchmarkRoutingEngine.hpp"
 
 BENCHMARK_MAIN();
@@ -3,9 +3,12 @@
 
 #include <benchmark/benchmark.h>
 
+#include "AABB.hpp"
 #include "CollisionGeometry.hpp"
 #include "buildGeometries.hpp"
 
+#include <vector>
+
 template <class... Args>
 void bmLineSegmentsInDistanceTo(benchmark::State& state, Args&&... args)
 {
@@ -18,6 +21,68 @@ void bmLineSegmentsInDistanceTo(benchmark::State& state, Args&&... args)
     }
 }
 
+/// Query positions on a regular lattice covering the geometry
+inline std::vector<Point> queryPositions(const CollisionGeometry& geometry)
+{
+    const AABB bounds(std::get<0>(geometry.AccessibleArea()));
+    constexpr int steps = 32;
+    std::vector<Point> positions{};
+    positions.reserve(steps * steps);
+    for(int x = 0; x < steps; ++x) {
+        for(int y = 0; y < steps; ++y) {
+            positions.emplace_back(
+                bounds.xmin + (bounds.xmax - bounds.xmin) * (x + 0.5) / steps,
+                bounds.ymin + (bounds.ymax - bounds.ymin) * (y + 0.5) / steps);
+        }
+    }
+    return positions;
+}
+
+/// Same query as in the agent constraint checks: segments closer than an agent radius
+template <class... Args>
+void bmLineSegmentsInDistanceToSpread(benchmark::State& state, Args&&... args)
+{
+    auto args_tuple = std::make_tuple(std::move(args)...);
+    auto geometry = std::move(std::get<CollisionGeometry>(args_tuple));
+    const auto positions = queryPositions(geometry);
+
+    size_t index = 0;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(
+            geometry.LineSegmentsInDistanceTo(0.3, positions[index++ % positions.size()]));
+        benchmark::ClobberMemory();
+    }
+}
+
+/// Line of sight checks as done by the operational models for neighbors 2m apart
+template <class... Args>
+void bmIntersectsAny(benchmark::State& state, Args&&... args)
+{
+    auto args_tuple = std::make_tuple(std::move(args)...);
+    auto geometry = std::move(std::get<CollisionGeometry>(args_tuple));
+    const auto positions = queryPositions(geometry);
+
+    size_t index = 0;
+    for(auto _ : state) {
+        const auto& from = positions[index++ % positions.size()];
+        benchmark::DoNotOptimize(geometry.IntersectsAny(LineSegment(from, from + Point{1.4, 1.4})));
+    }
+}
+
+/// Point location as done when adding agents and stages
+template <class... Args>
+void bmInsideGeometry(benchmark::State& state, Args&&... args)
+{
+    auto args_tuple = std::make_tuple(std::move(args)...);
+    auto geometry = std::move(std::get<CollisionGeometry>(args_tuple));
+    const auto positions = queryPositions(geometry);
+
+    size_t index = 0;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(geometry.InsideGeometry(positions[index++ % positions.size()]));
+    }
+}
+
 template <class... Args>
 void bmLineSegmentsInApproxDistanceTo(benchmark::State& state, Args&&... args)
 {
@@ -34,6 +99,21 @@ BENCHMARK_CAPTURE(bmLineSegmentsInDistanceTo, large_street_network, buildLargeSt
 
 BENCHMARK_CAPTURE(bmLineSegmentsInDistanceTo, grosser_stern, buildGrosserStern());
 
+BENCHMARK_CAPTURE(
+    bmLineSegmentsInDistanceToSpread,
+    large_street_network,
+    buildLargeStreetNetwork());
+
+BENCHMARK_CAPTURE(bmLineSegmentsInDistanceToSpread, grosser_stern, buildGrosserStern());
+
+BENCHMARK_CAPTURE(bmIntersectsAny, large_street_network, buildLargeStreetNetwork());
+
+BENCHMARK_CAPTURE(bmIntersectsAny, grosser_stern, buildGrosserStern());
+
+BENCHMARK_CAPTURE(bmInsideGeometry, large_street_network, buildLargeStreetNetwork());
+
+BENCHMARK_CAPTURE(bmInsideGeometry, grosser_stern, buildGrosserStern());
+
 BENCHMARK_CAPTURE(
     bmLineSegmentsInApproxDistanceTo,
     large_street_network,
@@ -0,0 +1,100 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include "AABB.hpp"
+#include "CollisionGeometry.hpp"
+#include "RoutingEngine.hpp"
+#include "buildGeometries.hpp"
+
+#include <utility>
+#include <vector>
+
+/// Pairs of routable positions spread over the geometry, most of them far apart
+inline std::vector<std::pair<Point, Point>>
+routingQueries(const CollisionGeometry& geometry, const RoutingEngine& engine)
+{
+    const AABB bounds(std::get<0>(geometry.AccessibleArea()));
+    constexpr int steps = 32;
+    std::vector<Point> positions{};
+    for(int x = 0; x < steps; ++x) {
+        for(int y = 0; y < steps; ++y) {
+            const Point p{
+                bounds.xmin + (bounds.xmax - bounds.xmin) * (x + 0.5) / steps,
+                bounds.ymin + (bounds.ymax - bounds.ymin) * (y + 0.5) / steps};
+            if(engine.IsRoutable(p)) {
+                positions.emplace_back(p);
+            }
+        }
+    }
+    std::vector<std::pair<Point, Point>> queries{};
+    queries.reserve(positions.size());
+    for(size_t index = 0; index < positions.size(); ++index) {
+        queries.emplace_back(positions[index], positions[positions.size() - 1 - index]);
+    }
+    return queries;
+}
+
+/// Latency of a single search as issued by the routing C API
+template <class... Args>
+void bmComputeAllWaypoints(benchmark::State& state, Args&&... args)
+{
+    auto args_tuple = std::make_tuple(std::move(args)...);
+    const auto geometry = std::move(std::get<CollisionGeometry>(args_tuple));
+    const auto backend = std::get<RoutingBackend>(args_tuple);
+    const RoutingEngine engine(geometry.Polygon(), backend);
+    const auto queries = routingQueries(geometry, engine);
+
+    size_t index = 0;
+    for(auto _ : state) {
+        const auto& [from, to] = queries[index++ % queries.size()];
+        benchmark::DoNotOptimize(engine.ComputeAllWaypoints(from, to));
+    }
+}
+
+BENCHMARK_CAPTURE(
+    bmComputeAllWaypoints,
+    large_street_network,
+    buildLargeStreetNetwork(),
+    RoutingBackend::Triangulation);
+
+BENCHMARK_CAPTURE(
+    bmComputeAllWaypoints,
+    grosser_stern,
+    buildGrosserStern(),
+    RoutingBackend::Triangulation);
+
+BENCHMARK_CAPTURE(
+    bmComputeAllWaypoints,
+    large_street_network_polyanya,
+    buildLargeStreetNetwork(),
+    RoutingBackend::Polyanya);
+
+BENCHMARK_CAPTURE(
+    bmComputeAllWaypoints,
+    grosser_stern_polyanya,
+    buildGrosserStern(),
+    RoutingBackend::Polyanya);
+
+/// Point location of all routing queries without a hint
+template <class... Args>
+void bmIsRoutable(benchmark::State& state, Args&&... args)
+{
+    auto args_tuple = std::make_tuple(std::move(args)...);
+    const auto geometry = std::move(std::get<CollisionGeometry>(args_tuple));
+    const RoutingEngine engine(geometry.Polygon());
+    const auto queries = routingQueries(geometry, engine);
+
+    size_t index = 0;
+    for(auto _ : state) {
+        const auto& [from, to] = queries[index++ % queries.size()];
+        benchmark::DoNotOptimize(engine.IsRoutable(from));
+    }
+}
+
+BENCHMARK_CAPTURE(bmIsRoutable, large_street_network, buildLargeStreetNetwork());
+
+BENCHMARK_CAPTURE(bmIsRoutable, grosser_stern, buildGrosserStern());
@@ -2,16 +2,22 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #pragma once
 
+#include "AgentSlotMap.hpp"
+#include "AgentStore.hpp"
 #include "GenericAgent.hpp"
 #include "IteratorPair.hpp"
 #include "StageManager.hpp"
 
+#include <algorithm>
 #include <map>
 #include <vector>
 
 template <typename Agent>
 class AgentRemovalSystem
 {
+    // Per agent index, true if the agent is removed. Kept to reuse its memory.
+    std::vector<bool> _removed{};
+
 public:
     AgentRemovalSystem() = default;
     ~AgentRemovalSystem() = default;
@@ -20,32 +26,51 @@ public:
     AgentRemovalSystem(AgentRemovalSystem&& other) = delete;
     AgentRemovalSystem& operator=(AgentRemovalSystem&& other) = delete;
 
+    /// Removes the agents in 'removedAgentIds' and updates 'slots' to the compacted 'agents'.
+    /// Removed agents are marked by their index in 'slots', 'agents' and the rows of 'store' are
+    /// compacted in one pass. Unknown and duplicate IDs are ignored.
     void
     Run(std::vector<Agent>& agents,
+        AgentStore& store,
         std::vector<GenericAgent::ID>& removedAgentIds,
-        StageManager& stageManager) const;
+        StageManager& stageManager,
+        AgentSlotMap& slots);
 };
 
 template <typename Agent>
 void AgentRemovalSystem<Agent>::Run(
     std::vector<Agent>& agents,
+    AgentStore& store,
     std::vector<GenericAgent::ID>& removedAgentIds,
-    StageManager& stageManager) const
+    StageManager& stageManager,
+    AgentSlotMap& slots)
 {
+    if(removedAgentIds.empty()) {
+        return;
+    }
+
+    _removed.assign(agents.size(), false);
+    size_t first = agents.size();
+    for(const auto& id : removedAgentIds) {
+        const auto index = slots.IndexOf(id);
+        if(index == AgentSlotMap::NO_INDEX || _removed[index]) {
+            continue;
+        }
+        _removed[index] = true;
+        first = std::min(first, index);
+        stageManager.HandleRemoveAgent(agents[index].stageId);
+        slots.Erase(id);
+    }
 
-    auto iter = std::remove_if(
-        std::begin(agents),
-        std::end(agents),
-        [&removedAgentIds, &stageManager](const GenericAgent& agent) {
-            auto found =
-                std::find(std::begin(removedAgentIds), std::end(removedAgentIds), agent.id) !=
-                std::end(removedAgentIds);
-            if(found) {
-                stageManager.HandleRemoveAgent(agent.stageId);
-            }
-            return found;
-        });
-    agents.erase(iter, std::end(agents));
+    size_t kept = first;
+    for(size_t index = first; index < agents.size(); ++index) {
+        if(!_removed[index]) {
+            agents[kept++] = std::move(agents[index]);
+        }
+    }
+    agents.erase(std::begin(agents) + kept, std::end(agents));
+    store.Erase(_removed, first);
+    slots.Reindex(agents, first);
 
     removedAgentIds.clear();
 }
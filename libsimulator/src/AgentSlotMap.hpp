@@ -0,0 +1,111 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "GenericAgent.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+/// Maps agent IDs and handles to the index of the agent in the agent storage of a simulation.
+///
+/// The storage is compacted when agents are removed and reordered by the neighborhood search, so
+/// indices change between iterations. Every agent owns a slot holding its current index, slots are
+/// found by ID through a hash map or directly by handle. A handle combines the slot with the
+/// generation of the slot, which is incremented whenever the slot is released. Handles of removed
+/// agents therefore never refer to agents added later that reuse the slot.
+class AgentSlotMap
+{
+public:
+    using Handle = uint64_t;
+    static constexpr Handle INVALID_HANDLE = 0;
+    static constexpr size_t NO_INDEX = std::numeric_limits<size_t>::max();
+
+private:
+    struct Slot {
+        size_t index{NO_INDEX};
+        // Starts at 1 so that no valid handle equals INVALID_HANDLE
+        uint32_t generation{1};
+    };
+
+    std::vector<Slot> _slots{};
+    std::vector<uint32_t> _freeSlots{};
+    std::unordered_map<GenericAgent::ID, uint32_t> _slotOfId{};
+
+public:
+    /// Assigns a slot to the agent 'id' stored at 'index'.
+    Handle Insert(GenericAgent::ID id, size_t index)
+    {
+        uint32_t slot{};
+        if(_freeSlots.empty()) {
+            slot = static_cast<uint32_t>(_slots.size());
+            _slots.emplace_back();
+        } else {
+            slot = _freeSlots.back();
+            _freeSlots.pop_back();
+        }
+        _slots[slot].index = index;
+        _slotOfId.emplace(id, slot);
+        return handleOf(slot);
+    }
+
+    /// Releases the slot of 'id', unknown IDs are ignored.
+    void Erase(GenericAgent::ID id)
+    {
+        const auto iter = _slotOfId.find(id);
+        if(iter == std::end(_slotOfId)) {
+            return;
+        }
+        auto& slot = _slots[iter->second];
+        slot.index = NO_INDEX;
+        ++slot.generation;
+        _freeSlots.push_back(iter->second);
+        _slotOfId.erase(iter);
+    }
+
+    /// Updates the index of every agent from 'first' on after 'agents' has been compacted or
+    /// reordered.
+    void Reindex(const std::vector<GenericAgent>& agents, size_t first = 0)
+    {
+        for(size_t index = first; index < agents.size(); ++index) {
+            _slots[_slotOfId.at(agents[index].id)].index = index;
+        }
+    }
+
+    /// Index of the agent 'id' or NO_INDEX if it is unknown.
+    size_t IndexOf(GenericAgent::ID id) const
+    {
+        const auto iter = _slotOfId.find(id);
+        return iter == std::end(_slotOfId) ? NO_INDEX : _slots[iter->second].index;
+    }
+
+    /// Index of the agent 'handle' refers to or NO_INDEX if the handle is invalid or the agent
+    /// has been removed.
+    size_t IndexOfHandle(Handle handle) const
+    {
+        const auto slot = static_cast<size_t>(handle & std::numeric_limits<uint32_t>::max());
+        const auto generation = static_cast<uint32_t>(handle >> 32);
+        if(slot >= _slots.size() || _slots[slot].generation != generation) {
+            return NO_INDEX;
+        }
+        return _slots[slot].index;
+    }
+
+    /// Handle of the agent 'id' or INVALID_HANDLE if it is unknown.
+    Handle HandleOf(GenericAgent::ID id) const
+    {
+        const auto iter = _slotOfId.find(id);
+        return iter == std::end(_slotOfId) ? INVALID_HANDLE : handleOf(iter->second);
+    }
+
+    size_t Size() const { return _slotOfId.size(); }
+
+private:
+    Handle handleOf(uint32_t slot) const
+    {
+        return (static_cast<Handle>(_slots[slot].generation) << 32) | slot;
+    }
+};
@@ -0,0 +1,189 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "CollisionFreeSpeedModelData.hpp"
+#include "CollisionFreeSpeedModelV2Data.hpp"
+#include "GeneralizedCentrifugalForceModelData.hpp"
+#include "GenericAgent.hpp"
+#include "Point.hpp"
+#include "SocialForceModelData.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/// Structure of arrays storage of the agent state read by the operational models.
+///
+/// 'GenericAgent' records hold IDs, routing state and a variant sized for the largest model, the
+/// operational models only need a few fields of each neighbor. The store keeps positions,
+/// orientations, destinations and the model data in contiguous columns with one row per record
+/// of the agent storage it is created for. Only the column of the model the agents use is filled.
+///
+/// Destinations and model state are only held by the store, records refer to it through
+/// 'GenericAgent::store'. The stages and the C API read position and orientation from the
+/// records, so these are written to both by 'SetPosition' and 'SetOrientation'. Rows are not
+/// rebuilt from the records, they are appended, erased and reordered along with them.
+class AgentStore
+{
+    using ModelColumns = std::tuple<
+        std::vector<GeneralizedCentrifugalForceModelData>,
+        std::vector<CollisionFreeSpeedModelData>,
+        std::vector<CollisionFreeSpeedModelV2Data>,
+        std::vector<SocialForceModelData>>;
+
+    std::vector<GenericAgent>& _agents;
+    std::vector<Point> _positions{};
+    std::vector<Point> _orientations{};
+    std::vector<Point> _destinations{};
+    ModelColumns _models{};
+    // Scratch space of 'Reorder'
+    std::vector<Point> _pointBuffer{};
+    ModelColumns _modelBuffers{};
+
+public:
+    /// @param agents records the rows belong to, has to outlive the store
+    explicit AgentStore(std::vector<GenericAgent>& agents) : _agents(agents) {}
+    ~AgentStore() = default;
+    AgentStore(const AgentStore& other) = delete;
+    AgentStore& operator=(const AgentStore& other) = delete;
+    AgentStore(AgentStore&& other) = delete;
+    AgentStore& operator=(AgentStore&& other) = delete;
+
+    /// Appends the row of the last record and moves its model data into the store. The
+    /// destination is the target of the agent until the tactical level computed one.
+    void PushBack()
+    {
+        auto& agent = _agents.back();
+        agent.store = this;
+        _positions.push_back(agent.pos);
+        _orientations.push_back(agent.orientation);
+        _destinations.push_back(agent.target);
+        std::visit(
+            [this](auto& data) {
+                using Data = std::decay_t<decltype(data)>;
+                std::get<std::vector<Data>>(_models).push_back(std::move(data));
+            },
+            agent.model);
+    }
+
+    /// Removes the rows marked in 'removed' in the same way the records are compacted, rows
+    /// before 'first' are not marked.
+    void Erase(const std::vector<bool>& removed, size_t first)
+    {
+        erase(_positions, removed, first);
+        erase(_orientations, removed, first);
+        erase(_destinations, removed, first);
+        std::apply(
+            [&removed, first](auto&... columns) { (erase(columns, removed, first), ...); },
+            _models);
+    }
+
+    /// Moves each row to the index the records have been moved to.
+    /// @param newIndices new index of each row by its current index
+    void Reorder(const std::vector<size_t>& newIndices)
+    {
+        permute(_positions, newIndices, _pointBuffer);
+        permute(_orientations, newIndices, _pointBuffer);
+        permute(_destinations, newIndices, _pointBuffer);
+        std::apply(
+            [this, &newIndices](auto&... columns) {
+                (permute(
+                     columns,
+                     newIndices,
+                     std::get<std::decay_t<decltype(columns)>>(_modelBuffers)),
+                 ...);
+            },
+            _models);
+    }
+
+    size_t Size() const { return _positions.size(); }
+
+    const std::vector<Point>& Positions() const { return _positions; }
+    const std::vector<Point>& Orientations() const { return _orientations; }
+    const std::vector<Point>& Destinations() const { return _destinations; }
+    std::vector<Point>& Destinations() { return _destinations; }
+
+    void SetPosition(size_t index, Point position)
+    {
+        _positions[index] = position;
+        _agents[index].pos = position;
+    }
+
+    void SetOrientation(size_t index, Point orientation)
+    {
+        _orientations[index] = orientation;
+        _agents[index].orientation = orientation;
+    }
+
+    /// Column of the model data of all agents, requires all agents to use 'Data'.
+    template <typename Data>
+    const std::vector<Data>& Models() const
+    {
+        const auto& column = std::get<std::vector<Data>>(_models);
+        assert(column.size() == _positions.size());
+        return column;
+    }
+
+    template <typename Data>
+    std::vector<Data>& Models()
+    {
+        auto& column = std::get<std::vector<Data>>(_models);
+        assert(column.size() == _positions.size());
+        return column;
+    }
+
+    /// Index of the row of 'agent', which has to be one of the records of this store.
+    size_t IndexOf(const GenericAgent& agent) const
+    {
+        assert(&agent >= _agents.data() && &agent < _agents.data() + _agents.size());
+        return static_cast<size_t>(&agent - _agents.data());
+    }
+
+    /// Model state of 'agent', read from its store once it has been added to one.
+    /// Throws std::bad_variant_access if 'agent' does not use 'Data'.
+    template <typename Data>
+    static Data& ModelOf(GenericAgent& agent)
+    {
+        auto& data = std::get<Data>(agent.model);
+        return agent.store ? agent.store->Models<Data>()[agent.store->IndexOf(agent)] : data;
+    }
+
+    template <typename Data>
+    static const Data& ModelOf(const GenericAgent& agent)
+    {
+        const auto& data = std::get<Data>(agent.model);
+        return agent.store ? agent.store->Models<Data>()[agent.store->IndexOf(agent)] : data;
+    }
+
+private:
+    template <typename T>
+    static void erase(std::vector<T>& column, const std::vector<bool>& removed, size_t first)
+    {
+        if(column.empty()) {
+            return;
+        }
+        size_t kept = first;
+        for(size_t index = first; index < column.size(); ++index) {
+            if(!removed[index]) {
+                column[kept++] = std::move(column[index]);
+            }
+        }
+        column.erase(std::begin(column) + kept, std::end(column));
+    }
+
+    template <typename T>
+    static void
+    permute(std::vector<T>& column, const std::vector<size_t>& newIndices, std::vector<T>& buffer)
+    {
+        buffer.resize(column.size());
+        for(size_t index = 0; index < column.size(); ++index) {
+            buffer[newIndices[index]] = std::move(column[index]);
+        }
+        column.swap(buffer);
+    }
+};
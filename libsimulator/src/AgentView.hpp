@@ -0,0 +1,39 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "AgentStore.hpp"
+#include "GenericAgent.hpp"
+#include "Point.hpp"
+
+#include <cstddef>
+#include <variant>
+
+/// The state of one agent the operational models read, field names follow 'GenericAgent'.
+/// References the row of the agent in the columns of an 'AgentStore'.
+template <typename Data>
+struct AgentView {
+    const Point& pos;
+    const Point& orientation;
+    const Point& destination;
+    const Data& model;
+
+    static AgentView Of(const AgentStore& agents, size_t index)
+    {
+        return {
+            agents.Positions()[index],
+            agents.Orientations()[index],
+            agents.Destinations()[index],
+            agents.Models<Data>()[index]};
+    }
+
+    /// View of a record, e.g. while validating an agent that is not part of a simulation yet.
+    /// Such an agent heads for its target.
+    static AgentView Of(const GenericAgent& agent)
+    {
+        if(agent.store) {
+            return Of(*agent.store, agent.store->IndexOf(agent));
+        }
+        return {agent.pos, agent.orientation, agent.target, std::get<Data>(agent.model)};
+    }
+};
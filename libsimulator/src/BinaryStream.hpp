@@ -0,0 +1,90 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "SimulationError.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+/// Writes values in their in-memory representation to a stream.
+///
+/// Used for caches of built data structures, files are only meant to be read back by the same
+/// build on the same platform. Only trivially copyable values and vectors of them are supported.
+class BinaryWriter
+{
+    std::ostream& _out;
+
+public:
+    explicit BinaryWriter(std::ostream& out) : _out(out) {}
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        _out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /// Writes the size followed by all elements.
+    template <typename T>
+    void Write(const std::vector<T>& values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Write(static_cast<uint64_t>(values.size()));
+        _out.write(
+            reinterpret_cast<const char*>(values.data()),
+            static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    std::ostream& Stream() { return _out; }
+};
+
+/// Reads values written by BinaryWriter. Throws a SimulationError if the stream ends early.
+class BinaryReader
+{
+    std::istream& _in;
+
+public:
+    explicit BinaryReader(std::istream& in) : _in(in) {}
+
+    template <typename T>
+    T Read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value{};
+        read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> ReadVector()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto size = Read<uint64_t>();
+        std::vector<T> values{};
+        // Grow with the data actually read, a corrupt size must not allocate huge amounts of memory
+        constexpr uint64_t chunkSize = (uint64_t{1} << 20) / sizeof(T) + 1;
+        for(uint64_t offset = 0; offset < size; offset += chunkSize) {
+            const auto count = std::min(chunkSize, size - offset);
+            values.resize(offset + count);
+            read(reinterpret_cast<char*>(values.data() + offset), count * sizeof(T));
+        }
+        return values;
+    }
+
+    std::istream& Stream() { return _in; }
+
+private:
+    void read(char* data, size_t size)
+    {
+        _in.read(data, static_cast<std::streamsize>(size));
+        if(static_cast<size_t>(_in.gcount()) != size) {
+            throw SimulationError("Unexpected end of binary data");
+        }
+    }
+};
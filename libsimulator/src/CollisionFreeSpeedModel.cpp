@@ -10,6 +10,7 @@
 #include "OperationalModel.hpp"
 #include "SimulationError.hpp"
 #include "Stage.hpp"
+#include "WorkerScratch.hpp"
 
 #include <algorithm>
 #include <limits>
@@ -34,54 +35,66 @@ OperationalModelType CollisionFreeSpeedModel::Type() const
     return OperationalModelType::COLLISION_FREE_SPEED;
 }
 
-OperationalModelUpdate CollisionFreeSpeedModel::ComputeNewPosition(
+double CollisionFreeSpeedModel::NeighborhoodRadius() const
+{
+    return _cutOffRadius;
+}
+
+CollisionFreeSpeedModel::Update CollisionFreeSpeedModel::ComputeUpdate(
     double dT,
-    const GenericAgent& ped,
+    size_t index,
+    const AgentStore& agents,
     const CollisionGeometry& geometry,
-    const NeighborhoodSearchType& neighborhoodSearch) const
+    const NeighborhoodSearchType& neighborhoodSearch,
+    WorkerScratch& scratch) const
 {
-    auto neighborhood = neighborhoodSearch.GetNeighboringAgents(ped.pos, _cutOffRadius);
-    const auto& boundary = geometry.LineSegmentsInApproxDistanceTo(ped.pos);
-
-    // Remove any agent from the neighborhood that is obstructed by geometry and the current
-    // agent
-    neighborhood.erase(
-        std::remove_if(
-            std::begin(neighborhood),
-            std::end(neighborhood),
-            [&ped, &boundary](const auto& neighbor) {
-                if(ped.id == neighbor.id) {
-                    return true;
-                }
-                const auto agent_to_neighbor = LineSegment(ped.pos, neighbor.pos);
-                if(std::find_if(
-                       boundary.cbegin(),
-                       boundary.cend(),
-                       [&agent_to_neighbor](const auto& boundary_segment) {
-                           return intersects(agent_to_neighbor, boundary_segment);
-                       }) != boundary.end()) {
-                    return true;
-                }
-
-                return false;
-            }),
-        std::end(neighborhood));
+    const auto ped = Agent::Of(agents, index);
+    // Reused by all agents computed on this worker to avoid allocating a neighborhood per agent
+    auto& neighborhood = scratch.neighbors;
+    neighborhood.clear();
+
+    // Skip the current agent and any agent that is obstructed by geometry, the line of sight
+    // only needs to be checked if the neighborhood search does not already know it is clear.
+    neighborhoodSearch.ForEachNeighborIndexOf(
+        index,
+        agents.Positions(),
+        _cutOffRadius,
+        [index, &ped, &agents, &geometry, &neighborhood](size_t neighbor, bool lineOfSight) {
+            if(neighbor == index) {
+                return;
+            }
+            if(!lineOfSight &&
+               geometry.IntersectsAny(LineSegment(ped.pos, agents.Positions()[neighbor]))) {
+                return;
+            }
+            neighborhood.push_back(neighbor);
+        });
 
     const auto neighborRepulsion = std::accumulate(
         std::begin(neighborhood),
         std::end(neighborhood),
         Point{},
-        [&ped, this](const auto& res, const auto& neighbor) {
-            return res + NeighborRepulsion(ped, neighbor);
+        [&ped, &agents, this](const auto& res, size_t neighbor) {
+            return res + NeighborRepulsion(ped, Agent::Of(agents, neighbor));
         });
 
-    const auto boundaryRepulsion = std::accumulate(
-        boundary.cbegin(),
-        boundary.cend(),
-        Point(0, 0),
-        [this, &ped](const auto& acc, const auto& element) {
-            return acc + BoundaryRepulsion(ped, element);
-        });
+    // Far away from all walls only the closest wall contributes noticeably to the repulsion.
+    Point boundaryRepulsion{};
+    if(const auto wall = geometry.ApproximateWallDistance(ped.pos); wall) {
+        if(wall->direction != Point{}) {
+            const auto closest = ped.pos + wall->direction * wall->distance;
+            boundaryRepulsion = BoundaryRepulsion(ped, LineSegment(closest, closest));
+        }
+    } else {
+        const auto& boundary = geometry.LineSegmentsInApproxDistanceTo(ped.pos);
+        boundaryRepulsion = std::accumulate(
+            boundary.cbegin(),
+            boundary.cend(),
+            Point(0, 0),
+            [this, &ped](const auto& acc, const auto& element) {
+                return acc + BoundaryRepulsion(ped, element);
+            });
+    }
 
     const auto desired_direction = (ped.destination - ped.pos).Normalized();
     auto direction = (desired_direction + neighborRepulsion + boundaryRepulsion).Normalized();
@@ -92,22 +105,20 @@ OperationalModelUpdate CollisionFreeSpeedModel::ComputeNewPosition(
         std::begin(neighborhood),
         std::end(neighborhood),
         std::numeric_limits<double>::max(),
-        [&ped, &direction, this](const auto& res, const auto& neighbor) {
-            return std::min(res, GetSpacing(ped, neighbor, direction));
+        [&ped, &agents, &direction, this](const auto& res, size_t neighbor) {
+            const auto other = Agent::Of(agents, neighbor);
+            return std::min(res, GetSpacing(ped, other, direction));
         });
 
-    const auto& model = std::get<CollisionFreeSpeedModelData>(ped.model);
-    const auto optimal_speed = OptimalSpeed(ped, spacing, model.timeGap);
+    const auto optimal_speed = OptimalSpeed(ped, spacing, ped.model.timeGap);
     const auto velocity = direction * optimal_speed;
     return CollisionFreeSpeedModelUpdate{ped.pos + velocity * dT, direction};
 };
 
-void CollisionFreeSpeedModel::ApplyUpdate(const OperationalModelUpdate& upd, GenericAgent& agent)
-    const
+void CollisionFreeSpeedModel::Apply(const Update& update, size_t index, AgentStore& agents) const
 {
-    const auto& update = std::get<CollisionFreeSpeedModelUpdate>(upd);
-    agent.pos = update.position;
-    agent.orientation = update.orientation;
+    agents.SetPosition(index, update.position);
+    agents.SetOrientation(index, update.orientation);
 }
 
 void CollisionFreeSpeedModel::CheckModelConstraint(
@@ -132,12 +143,11 @@ void CollisionFreeSpeedModel::CheckModelConstraint(
     constexpr double timeGapMax = 10.;
     validateConstraint(timeGap, timeGapMin, timeGapMax, "timeGap");
 
-    const auto neighbors = neighborhoodSearch.GetNeighboringAgents(agent.pos, 2);
-    for(const auto& neighbor : neighbors) {
+    neighborhoodSearch.ForEachNeighbor(agent.pos, 2, [&agent, r](const auto& neighbor) {
         if(agent.id == neighbor.id) {
-            continue;
+            return;
         }
-        const auto& neighbor_model = std::get<CollisionFreeSpeedModelData>(neighbor.model);
+        const auto& neighbor_model = AgentStore::ModelOf<CollisionFreeSpeedModelData>(neighbor);
         const auto contanctdDist = r + neighbor_model.radius;
         const auto distance = (agent.pos - neighbor.pos).Norm();
         if(contanctdDist >= distance) {
@@ -147,7 +157,7 @@ void CollisionFreeSpeedModel::CheckModelConstraint(
                 neighbor.pos,
                 distance);
         }
-    }
+    });
 
     const auto lineSegments = geometry.LineSegmentsInDistanceTo(r, agent.pos);
     if(std::begin(lineSegments) != std::end(lineSegments)) {
@@ -165,21 +175,21 @@ std::unique_ptr<OperationalModel> CollisionFreeSpeedModel::Clone() const
 }
 
 double CollisionFreeSpeedModel::OptimalSpeed(
-    const GenericAgent& ped,
+    const Agent& ped,
     double spacing,
     double time_gap) const
 {
-    const auto& model = std::get<CollisionFreeSpeedModelData>(ped.model);
+    const auto& model = ped.model;
     return std::min(std::max(spacing / time_gap, 0.0), model.v0);
 }
 
 double CollisionFreeSpeedModel::GetSpacing(
-    const GenericAgent& ped1,
-    const GenericAgent& ped2,
+    const Agent& ped1,
+    const Agent& ped2,
     const Point& direction) const
 {
-    const auto& model1 = std::get<CollisionFreeSpeedModelData>(ped1.model);
-    const auto& model2 = std::get<CollisionFreeSpeedModelData>(ped2.model);
+    const auto& model1 = ped1.model;
+    const auto& model2 = ped2.model;
     const auto distp12 = ped2.pos - ped1.pos;
     const auto inFront = direction.ScalarProduct(distp12) >= 0;
     if(!inFront) {
@@ -194,25 +204,25 @@ double CollisionFreeSpeedModel::GetSpacing(
     }
     return distp12.Norm() - l;
 }
-Point CollisionFreeSpeedModel::NeighborRepulsion(const GenericAgent& ped1, const GenericAgent& ped2)
+Point CollisionFreeSpeedModel::NeighborRepulsion(const Agent& ped1, const Agent& ped2)
     const
 {
     const auto distp12 = ped2.pos - ped1.pos;
     const auto [distance, direction] = distp12.NormAndNormalized();
-    const auto& model1 = std::get<CollisionFreeSpeedModelData>(ped1.model);
-    const auto& model2 = std::get<CollisionFreeSpeedModelData>(ped2.model);
+    const auto& model1 = ped1.model;
+    const auto& model2 = ped2.model;
     const auto l = model1.radius + model2.radius;
     return direction * -(strengthNeighborRepulsion * exp((l - distance) / rangeNeighborRepulsion));
 }
 
 Point CollisionFreeSpeedModel::BoundaryRepulsion(
-    const GenericAgent& ped,
+    const Agent& ped,
     const LineSegment& boundary_segment) const
 {
     const auto pt = boundary_segment.ShortestPoint(ped.pos);
     const auto dist_vec = pt - ped.pos;
     const auto [dist, e_iw] = dist_vec.NormAndNormalized();
-    const auto& model = std::get<CollisionFreeSpeedModelData>(ped.model);
+    const auto& model = ped.model;
     const auto l = model.radius;
     const auto R_iw = -strengthGeometryRepulsion * exp((l - dist) / rangeGeometryRepulsion);
     return e_iw * R_iw;
@@ -2,18 +2,23 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #pragma once
 
+#include "AgentView.hpp"
 #include "CollisionFreeSpeedModelData.hpp"
+#include "CollisionFreeSpeedModelUpdate.hpp"
 #include "CollisionGeometry.hpp"
 #include "NeighborhoodSearch.hpp"
 #include "OperationalModel.hpp"
 #include "UniqueID.hpp"
 
 struct GenericAgent;
+struct WorkerScratch;
 
-class CollisionFreeSpeedModel : public OperationalModel
+class CollisionFreeSpeedModel final : public OperationalModel
 {
 public:
     using NeighborhoodSearchType = NeighborhoodSearch<GenericAgent>;
+    using Agent = AgentView<CollisionFreeSpeedModelData>;
+    using Update = CollisionFreeSpeedModelUpdate;
 
 private:
     double _cutOffRadius{3};
@@ -30,22 +35,28 @@ public:
         double rangeGeometryRepulsion);
     ~CollisionFreeSpeedModel() override = default;
     OperationalModelType Type() const override;
-    OperationalModelUpdate ComputeNewPosition(
-        double dT,
-        const GenericAgent& ped,
-        const CollisionGeometry& geometry,
-        const NeighborhoodSearchType& neighborhoodSearch) const override;
-    void ApplyUpdate(const OperationalModelUpdate& update, GenericAgent& agent) const override;
+    double NeighborhoodRadius() const override;
     void CheckModelConstraint(
         const GenericAgent& agent,
         const NeighborhoodSearchType& neighborhoodSearch,
         const CollisionGeometry& geometry) const override;
     std::unique_ptr<OperationalModel> Clone() const override;
 
+    /// Computes the update of the agent at 'index', applied afterwards with 'Apply'. Called
+    /// without virtual dispatch by the kernel 'OperationalDecisionSystem' instantiates per model.
+    /// @param scratch memory of the worker computing the update, see 'WorkerScratch'
+    Update ComputeUpdate(
+        double dT,
+        size_t index,
+        const AgentStore& agents,
+        const CollisionGeometry& geometry,
+        const NeighborhoodSearchType& neighborhoodSearch,
+        WorkerScratch& scratch) const;
+    void Apply(const Update& update, size_t index, AgentStore& agents) const;
+
 private:
-    double OptimalSpeed(const GenericAgent& ped, double spacing, double time_gap) const;
-    double
-    GetSpacing(const GenericAgent& ped1, const GenericAgent& ped2, const Point& direction) const;
-    Point NeighborRepulsion(const GenericAgent& ped1, const GenericAgent& ped2) const;
-    Point BoundaryRepulsion(const GenericAgent& ped, const LineSegment& boundary_segment) const;
+    double OptimalSpeed(const Agent& ped, double spacing, double time_gap) const;
+    double GetSpacing(const Agent& ped1, const Agent& ped2, const Point& direction) const;
+    Point NeighborRepulsion(const Agent& ped1, const Agent& ped2) const;
+    Point BoundaryRepulsion(const Agent& ped, const LineSegment& boundary_segment) const;
 };
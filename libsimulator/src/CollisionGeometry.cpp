@@ -8,6 +8,7 @@
 #include "LineSegment.hpp"
 #include "Mathematics.hpp"
 #include "Point.hpp"
+#include "SimulationError.hpp"
 
 #include <CGAL/Boolean_set_operations_2.h>
 #include <CGAL/Point_2.h>
@@ -17,9 +18,13 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <iterator>
 #include <vector>
 
+// Edge length of the cells used to look up linesegments close to a query
+constexpr double SEGMENT_GRID_CELL_SIZE = 0.5;
+
 Cell makeCell(Point p)
 {
     return {floor(p.x / CELL_EXTEND) * CELL_EXTEND, floor(p.y / CELL_EXTEND) * CELL_EXTEND};
@@ -70,9 +75,34 @@ std::set<Cell> cellsFromLineSegment(LineSegment ls)
     return cells;
 }
 
-double dist(LineSegment l, Point p)
+/// Cells of the approximate grid that list 'ls', i.e. cells closer than 4m to it
+std::vector<Cell> approximateGridCells(const LineSegment& ls)
 {
-    return l.DistTo(p);
+    constexpr double searchRadius = 4.;
+
+    const auto searchExtend = Point(searchRadius, searchRadius);
+    const AABB lineSegmentBounds({ls.p1, ls.p2});
+    const AABB searchBounds(
+        lineSegmentBounds.BottomLeft() - searchExtend, lineSegmentBounds.TopRight() + searchExtend);
+
+    auto cellBottomLeft = makeCell(searchBounds.BottomLeft());
+    auto cellTopRight = makeCell(searchBounds.TopRight());
+
+    std::vector<Cell> cells{};
+    for(double x = cellBottomLeft.x; x <= cellTopRight.x; x += CELL_EXTEND) {
+        for(double y = cellBottomLeft.y; y <= cellTopRight.y; y += CELL_EXTEND) {
+            const auto cell = makeCell({x, y});
+
+            const AABB bbWithSearchRadius(
+                {cell.x - searchRadius, cell.y - searchRadius},
+                {cell.x + searchRadius + CELL_EXTEND, cell.y + searchRadius + CELL_EXTEND});
+
+            if(bbWithSearchRadius.Intersects(ls)) {
+                cells.push_back(cell);
+            }
+        }
+    }
+    return cells;
 }
 
 size_t CountLineSegments(const PolyWithHoles& poly)
@@ -98,8 +128,10 @@ void ExtractSegmentsFromPolygon(const Poly& p, std::vector<LineSegment>& segment
     segments.emplace_back(fromPoint_2(boundary.back()), fromPoint_2(boundary.front()));
 }
 
-CollisionGeometry::CollisionGeometry(PolyWithHoles accessibleArea)
+CollisionGeometry::CollisionGeometry(PolyWithHoles accessibleArea, std::vector<LineSegment> doors)
     : _accessibleAreaPolygon(accessibleArea)
+    , _doors(std::move(doors))
+    , _doorClosed(_doors.size(), 0)
 {
     _segments.reserve(CountLineSegments(accessibleArea));
     ExtractSegmentsFromPolygon(accessibleArea.outer_boundary(), _segments);
@@ -107,19 +139,88 @@ CollisionGeometry::CollisionGeometry(PolyWithHoles accessibleArea)
         ExtractSegmentsFromPolygon(hole, _segments);
     }
 
+    _segmentGrid = LineSegmentGrid(_segments, SEGMENT_GRID_CELL_SIZE);
     for(const auto& ls : _segments) {
-        const auto cells = cellsFromLineSegment(ls);
-        for(const auto& cell : cells) {
-            _grid[cell].insert(ls);
-        }
-
         insertIntoApproximateGrid(ls);
     }
 
     for(auto& [_, vec] : _approximateGrid) {
         vec.shrink_to_fit();
     }
+    extractAccessibleArea();
+}
+
+void CollisionGeometry::Write(BinaryWriter& writer) const
+{
+    const auto writeRing = [&writer](const Poly& ring) {
+        std::vector<Point> points{};
+        points.reserve(ring.size());
+        std::transform(
+            std::begin(ring.container()),
+            std::end(ring.container()),
+            std::back_inserter(points),
+            [](const auto& p) { return fromPoint_2(p); });
+        writer.Write(points);
+    };
+    writeRing(_accessibleAreaPolygon.outer_boundary());
+    writer.Write(static_cast<uint64_t>(_accessibleAreaPolygon.number_of_holes()));
+    for(const auto& hole : _accessibleAreaPolygon.holes()) {
+        writeRing(hole);
+    }
+    writer.Write(_segments);
+    _segmentGrid.Write(writer);
+    writer.Write(static_cast<uint64_t>(_approximateGrid.size()));
+    for(const auto& [cell, segments] : _approximateGrid) {
+        writer.Write(cell);
+        writer.Write(segments);
+    }
+    writer.Write(_doors);
+    writer.Write(_doorClosed);
+}
+
+CollisionGeometry CollisionGeometry::Read(BinaryReader& reader)
+{
+    const auto readRing = [&reader]() {
+        const auto points = reader.ReadVector<Point>();
+        Poly ring{};
+        for(const auto& p : points) {
+            ring.push_back(K::Point_2(p.x, p.y));
+        }
+        return ring;
+    };
+    CollisionGeometry geometry{};
+    geometry._accessibleAreaPolygon = PolyWithHoles(readRing());
+    const auto holeCount = reader.Read<uint64_t>();
+    for(uint64_t index = 0; index < holeCount; ++index) {
+        geometry._accessibleAreaPolygon.add_hole(readRing());
+    }
+    geometry._segments = reader.ReadVector<LineSegment>();
+    geometry._segmentGrid = LineSegmentGrid::Read(reader, geometry._segments);
+    const auto cellCount = reader.Read<uint64_t>();
+    for(uint64_t index = 0; index < cellCount; ++index) {
+        const auto cell = reader.Read<Cell>();
+        geometry._approximateGrid[cell] = reader.ReadVector<LineSegment>();
+    }
+    geometry._doors = reader.ReadVector<LineSegment>();
+    geometry._doorClosed = reader.ReadVector<uint8_t>();
+    if(geometry._doorClosed.size() != geometry._doors.size()) {
+        throw SimulationError("Inconsistent door data");
+    }
+    // Closed doors are already part of the stored approximate grid
+    for(size_t door = 0; door < geometry._doors.size(); ++door) {
+        if(geometry._doorClosed[door] != 0) {
+            ++geometry._closedDoorCount;
+            for(const auto& cell : cellsFromLineSegment(geometry._doors[door])) {
+                geometry._closedDoorCells[cell].push_back(door);
+            }
+        }
+    }
+    geometry.extractAccessibleArea();
+    return geometry;
+}
 
+void CollisionGeometry::extractAccessibleArea()
+{
     const auto cvt = [](const auto& c) {
         std::vector<Point> out{};
         out.reserve(c.size());
@@ -151,62 +252,225 @@ const std::vector<LineSegment>& CollisionGeometry::LineSegmentsInApproxDistanceT
 
 void CollisionGeometry::insertIntoApproximateGrid(const LineSegment& ls)
 {
-    constexpr double searchRadius = 4.;
-
-    const auto searchExtend = Point(searchRadius, searchRadius);
-    const AABB lineSegmentBounds({ls.p1, ls.p2});
-    const AABB searchBounds(
-        lineSegmentBounds.BottomLeft() - searchExtend, lineSegmentBounds.TopRight() + searchExtend);
+    for(const auto& cell : approximateGridCells(ls)) {
+        _approximateGrid[cell].push_back(ls);
+    }
+}
 
-    auto cellBottomLeft = makeCell(searchBounds.BottomLeft());
-    auto cellTopRight = makeCell(searchBounds.TopRight());
+void CollisionGeometry::removeFromApproximateGrid(const LineSegment& ls)
+{
+    for(const auto& cell : approximateGridCells(ls)) {
+        const auto iter = _approximateGrid.find(cell);
+        if(iter == std::end(_approximateGrid)) {
+            continue;
+        }
+        auto& segments = iter->second;
+        if(const auto found = std::find(std::begin(segments), std::end(segments), ls);
+           found != std::end(segments)) {
+            segments.erase(found);
+        }
+        if(segments.empty()) {
+            _approximateGrid.erase(iter);
+        }
+    }
+}
 
-    for(double x = cellBottomLeft.x; x <= cellTopRight.x; x += CELL_EXTEND) {
-        for(double y = cellBottomLeft.y; y <= cellTopRight.y; y += CELL_EXTEND) {
-            const auto cell = makeCell({x, y});
+void CollisionGeometry::SetDoorClosed(size_t door, bool closed)
+{
+    if(IsDoorClosed(door) == closed) {
+        return;
+    }
+    _doorClosed[door] = closed ? 1 : 0;
+    const auto& segment = _doors[door];
+    const auto cells = cellsFromLineSegment(segment);
+    if(closed) {
+        ++_closedDoorCount;
+        for(const auto& cell : cells) {
+            _closedDoorCells[cell].push_back(door);
+        }
+        insertIntoApproximateGrid(segment);
+        return;
+    }
+    --_closedDoorCount;
+    for(const auto& cell : cells) {
+        const auto iter = _closedDoorCells.find(cell);
+        auto& doors = iter->second;
+        doors.erase(std::find(std::begin(doors), std::end(doors), door));
+        if(doors.empty()) {
+            _closedDoorCells.erase(iter);
+        }
+    }
+    removeFromApproximateGrid(segment);
+}
 
-            const AABB bbWithSearchRadius(
-                {cell.x - searchRadius, cell.y - searchRadius},
-                {cell.x + searchRadius + CELL_EXTEND, cell.y + searchRadius + CELL_EXTEND});
+bool CollisionGeometry::IsDoorClosed(size_t door) const
+{
+    if(door >= _doors.size()) {
+        throw SimulationError("Unknown door {}, the geometry has {} doors", door, _doors.size());
+    }
+    return _doorClosed[door] != 0;
+}
 
-            if(bbWithSearchRadius.Intersects(ls)) {
-                auto& vec = _approximateGrid[cell];
-                vec.push_back(ls);
+template <typename Fn>
+bool CollisionGeometry::anyClosedDoor(const AABB& bounds, Fn&& fn) const
+{
+    if(_closedDoorCount == 0) {
+        return false;
+    }
+    const auto first = makeCell(bounds.BottomLeft());
+    const auto last = makeCell(bounds.TopRight());
+    const auto cellCount =
+        ((last.x - first.x) / CELL_EXTEND + 1) * ((last.y - first.y) / CELL_EXTEND + 1);
+    if(cellCount > static_cast<double>(_closedDoorCount)) {
+        // Cheaper to test all closed doors than to visit all cells
+        for(size_t door = 0; door < _doors.size(); ++door) {
+            if(_doorClosed[door] != 0 && bounds.Intersects(_doors[door]) && fn(_doors[door])) {
+                return true;
             }
         }
+        return false;
     }
+    // Visits the doors in place, this runs for every agent and must not allocate
+    for(double x = first.x; x <= last.x; x += CELL_EXTEND) {
+        for(double y = first.y; y <= last.y; y += CELL_EXTEND) {
+            const auto iter = _closedDoorCells.find(makeCell({x, y}));
+            if(iter == std::end(_closedDoorCells)) {
+                continue;
+            }
+            for(const auto door : iter->second) {
+                if(fn(_doors[door])) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
 }
 
-CollisionGeometry::LineSegmentRange
+std::vector<LineSegment>
 CollisionGeometry::LineSegmentsInDistanceTo(double distance, Point p) const
 {
-    return LineSegmentRange{
-        DistanceQueryIterator<LineSegment>{distance, p, _segments.cbegin(), _segments.cend()},
-        DistanceQueryIterator<LineSegment>{distance, p, _segments.cend(), _segments.cend()}};
+    const AABB bounds({p.x - distance, p.y - distance}, {p.x + distance, p.y + distance});
+    const auto distanceSquared = distance * distance;
+    const auto cellInRange = [p, distanceSquared](const AABB& cell) {
+        const auto dx = std::max({cell.xmin - p.x, 0.0, p.x - cell.xmax});
+        const auto dy = std::max({cell.ymin - p.y, 0.0, p.y - cell.ymax});
+        return dx * dx + dy * dy <= distanceSquared;
+    };
+
+    std::vector<size_t> indices{};
+    _segmentGrid.AnyOf(bounds, cellInRange, [this, &indices, distance, p](size_t index) {
+        if(_segments[index].DistTo(p) <= distance) {
+            indices.push_back(index);
+        }
+        return false;
+    });
+    // Linesegments passing through multiple cells are reported once per cell
+    std::sort(std::begin(indices), std::end(indices));
+    indices.erase(std::unique(std::begin(indices), std::end(indices)), std::end(indices));
+
+    std::vector<LineSegment> result{};
+    result.reserve(indices.size());
+    std::transform(
+        std::begin(indices),
+        std::end(indices),
+        std::back_inserter(result),
+        [this](size_t index) { return _segments[index]; });
+    // Doors passing multiple cells are reported once per cell as well
+    const auto firstDoor = static_cast<std::ptrdiff_t>(result.size());
+    anyClosedDoor(bounds, [&result, firstDoor, distance, p](const LineSegment& door) {
+        if(door.DistTo(p) <= distance &&
+           std::find(std::begin(result) + firstDoor, std::end(result), door) == std::end(result)) {
+            result.push_back(door);
+        }
+        return false;
+    });
+    return result;
 }
 
 bool CollisionGeometry::IntersectsAny(const LineSegment& linesegment) const
 {
-    const auto cellsToQuery = cellsFromLineSegment(linesegment);
-    for(const auto& cell : cellsToQuery) {
-        const auto iter = _grid.find(cell);
-        if(iter == std::end(_grid)) {
-            continue;
-        }
-        if(std::find_if(
-               iter->second.cbegin(), iter->second.cend(), [&linesegment](const auto candidate) {
-                   return intersects(linesegment, candidate);
-               }) != iter->second.end()) {
+    const AABB bounds(linesegment.p1, linesegment.p2);
+    return _segmentGrid.AnyOf(
+               bounds,
+               [&linesegment](const AABB& cell) { return cell.Intersects(linesegment); },
+               [this, &linesegment](size_t index) {
+                   return intersects(linesegment, _segments[index]);
+               }) ||
+           anyClosedDoor(bounds, [&linesegment](const LineSegment& door) {
+               return intersects(linesegment, door);
+           });
+}
+
+bool CollisionGeometry::HasClearance(const LineSegment& linesegment, double distance) const
+{
+    const AABB bounds(linesegment.p1, linesegment.p2);
+    const AABB searchBounds(
+        {bounds.xmin - distance, bounds.ymin - distance},
+        {bounds.xmax + distance, bounds.ymax + distance});
+
+    const auto tooClose = [&linesegment, distance](const LineSegment& candidate) {
+        if(intersects(linesegment, candidate)) {
             return true;
         }
-    }
-    return false;
+        const auto closest = std::min(
+            {candidate.DistTo(linesegment.p1),
+             candidate.DistTo(linesegment.p2),
+             linesegment.DistTo(candidate.p1),
+             linesegment.DistTo(candidate.p2)});
+        return closest <= distance;
+    };
+
+    // Any linesegment within 'distance' passes through the search bounds.
+    return !_segmentGrid.AnyOf(
+               searchBounds,
+               [](const AABB&) { return true; },
+               [this, &tooClose](size_t index) { return tooClose(_segments[index]); }) &&
+           !anyClosedDoor(searchBounds, tooClose);
 }
 
 bool CollisionGeometry::InsideGeometry(Point p) const
 {
-    return CGAL::oriented_side(K::Point_2(p.x, p.y), _accessibleAreaPolygon) !=
-           CGAL::ON_NEGATIVE_SIDE;
+    const K::Point_2 point(p.x, p.y);
+    const bool onBoundary = _segmentGrid.AnyOf(
+        AABB(p, p), [](const AABB&) { return true; }, [this, &point](size_t index) {
+            const auto& segment = _segments[index];
+            return K::Segment_2({segment.p1.x, segment.p1.y}, {segment.p2.x, segment.p2.y})
+                .has_on(point);
+        });
+    // The boundary consists of closed polylines, all other points are inside if a ray starting
+    // at them crosses the boundary an odd number of times.
+    return onBoundary || _segmentGrid.OddCrossingsLeftOf(p);
+}
+
+void CollisionGeometry::BuildWallDistanceField(double resolution)
+{
+    if(!_wallDistanceField) {
+        _wallDistanceField =
+            std::make_shared<const WallDistanceField>(_segments, resolution, MAX_WALL_DISTANCE);
+    }
+}
+
+std::optional<WallDistanceField::Sample> CollisionGeometry::ApproximateWallDistance(Point p) const
+{
+    if(!_wallDistanceField) {
+        return std::nullopt;
+    }
+    const auto sample = _wallDistanceField->Interpolate(p);
+    const auto maxError = _wallDistanceField->Resolution() * std::sqrt(2.0);
+    if(sample.distance - maxError <= EXACT_WALL_DISTANCE) {
+        return std::nullopt;
+    }
+    // The field only knows the walls, a closed door may be closer
+    const AABB bounds(
+        {p.x - sample.distance, p.y - sample.distance},
+        {p.x + sample.distance, p.y + sample.distance});
+    if(anyClosedDoor(bounds, [p, &sample](const LineSegment& door) {
+           return door.DistTo(p) < sample.distance;
+       })) {
+        return std::nullopt;
+    }
+    return sample;
 }
 
 const std::tuple<std::vector<Point>, std::vector<std::vector<Point>>>&
@@ -2,65 +2,25 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #pragma once
 
+#include "AABB.hpp"
+#include "BinaryStream.hpp"
 #include "CfgCgal.hpp"
 #include "HashCombine.hpp"
 #include "IteratorPair.hpp"
 #include "LineSegment.hpp"
+#include "LineSegmentGrid.hpp"
 #include "UniqueID.hpp"
+#include "WallDistanceField.hpp"
 
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <set>
 #include <unordered_map>
 #include <vector>
 
 class CollisionGeometry;
 
-double dist(LineSegment l, Point p);
-
-template <typename T>
-class DistanceQueryIterator
-{
-private:
-    using BackingIterator = typename std::vector<T>::const_iterator;
-    double _distance;
-    Point _p;
-    BackingIterator _current;
-    BackingIterator _end;
-
-public:
-    using iterator_category = std::input_iterator_tag;
-    using value_type = T;
-    using difference_type = std::ptrdiff_t;
-    using pointer = T*;
-    using reference = T&;
-    DistanceQueryIterator(double distance, Point p, BackingIterator current, BackingIterator end)
-        : _distance(distance)
-        , _p(p)
-        , _current(std::find_if(
-              current,
-              end,
-              [this](const auto& t) { return dist(t, _p) <= _distance; }))
-        , _end(end)
-    {
-    }
-    ~DistanceQueryIterator() = default;
-    DistanceQueryIterator(const DistanceQueryIterator& other) = default;
-    DistanceQueryIterator& operator=(const DistanceQueryIterator& other) = default;
-
-    bool operator==(const DistanceQueryIterator& other) const { return _current == other._current; }
-
-    bool operator!=(const DistanceQueryIterator& other) const { return !(*this == other); }
-
-    DistanceQueryIterator& operator++()
-    {
-        do {
-            ++_current;
-        } while(_current != _end && dist(*_current, _p) > _distance);
-        return *this;
-    }
-
-    const T& operator*() const { return *_current; }
-};
-
 /// Encodes a cell in the geometry grid.
 /// Cells are defined on the intervalls [min.x, min.x + extend), [min.y, min.y + extend)
 const int CELL_EXTEND = 4;
@@ -91,20 +51,32 @@ class CollisionGeometry
 {
 public:
     using ID = jps::UniqueID<CollisionGeometry>;
+    /// Distance to walls below which 'ApproximateWallDistance' defers to exact computations
+    static constexpr double EXACT_WALL_DISTANCE = 1.0;
+    /// Distance up to which the wall distance field tracks the closest wall
+    static constexpr double MAX_WALL_DISTANCE = 4.0;
 
 private:
     ID _id{};
     PolyWithHoles _accessibleAreaPolygon;
     std::vector<LineSegment> _segments;
-    std::unordered_map<Cell, std::set<LineSegment>> _grid{};
+    LineSegmentGrid _segmentGrid{};
+    // Shared between copies, the field is never modified after it was built
+    std::shared_ptr<const WallDistanceField> _wallDistanceField{};
     std::unordered_map<Cell, std::vector<LineSegment>> _approximateGrid{};
     std::tuple<std::vector<Point>, std::vector<std::vector<Point>>> _accessibleArea{};
+    // Line segments inside the accessible area that are walls while they are closed
+    std::vector<LineSegment> _doors{};
+    std::vector<uint8_t> _doorClosed{};
+    size_t _closedDoorCount{0};
+    // Indices of the closed doors passing each cell, see 'cellsFromLineSegment'
+    std::unordered_map<Cell, std::vector<size_t>> _closedDoorCells{};
 
 public:
-    using LineSegmentRange = IteratorPair<DistanceQueryIterator<LineSegment>>;
     /// Do not call constructor drectly use 'GeometryBuilder'
-    /// @param segments line segments constituting the geometry
-    explicit CollisionGeometry(PolyWithHoles accessibleArea);
+    /// @param accessibleArea polygon constituting the geometry
+    /// @param doors line segments inside of 'accessibleArea' that can be closed, all are open
+    explicit CollisionGeometry(PolyWithHoles accessibleArea, std::vector<LineSegment> doors = {});
     /// Default destructor
     ~CollisionGeometry() = default;
     /// Copyable
@@ -115,28 +87,80 @@ public:
     CollisionGeometry(CollisionGeometry&& other) = default;
     /// Moveable
     CollisionGeometry& operator=(CollisionGeometry&& other) = default;
-    /// Returns an iterator pair to all linesegments <= 'distance' away from 'p'
+    /// Returns all linesegments <= 'distance' away from 'p'
+    /// Only linesegments stored in grid cells close to 'p' are tested.
     /// @param distance from reference point
     /// @param p reference point
-    /// @return iterator_pair to all linesegments in range
-    LineSegmentRange LineSegmentsInDistanceTo(double distance, Point p) const;
+    /// @return linesegments in range, in the order they are stored in the geometry
+    std::vector<LineSegment> LineSegmentsInDistanceTo(double distance, Point p) const;
 
     const std::vector<LineSegment>& LineSegmentsInApproxDistanceTo(Point p) const;
 
     /// Will perfrom a linesegment intersection versus the whole geometry, i.e. walls and closed
-    /// doors.
+    /// doors. Only linesegments of the geometry close to 'linesegment' are tested exactly, if
+    /// there are none this is a constant time lookup.
     /// @param linesegment to test for intersection with geometry
     /// @return if any linesegment of the geometry was intersected.
     bool IntersectsAny(const LineSegment& linesegment) const;
 
+    /// Checks if no linesegment of the geometry comes closer than 'distance' to 'linesegment'.
+    /// @param linesegment to test
+    /// @param distance required clearance
+    /// @return true if all linesegments of the geometry are further away than 'distance'
+    bool HasClearance(const LineSegment& linesegment, double distance) const;
+
+    /// Checks if 'p' is inside of the accessible area, points on the boundary are inside.
+    /// Only linesegments close to 'p' are tested, see 'LineSegmentGrid::OddCrossingsLeftOf'.
+    /// @param p point to test
+    /// @return true if 'p' is inside of the accessible area or on its boundary
     bool InsideGeometry(Point p) const;
 
+    /// Precomputes distance and direction to the closest wall on a raster, see
+    /// 'ApproximateWallDistance'. Does nothing if the field has already been built.
+    /// @param resolution distance between raster nodes
+    void BuildWallDistanceField(double resolution);
+
+    /// Distance and direction to the closest wall read from the wall distance field.
+    /// Walls closer than EXACT_WALL_DISTANCE need to be handled exactly by the caller, hence
+    /// nothing is returned if 'p' may be that close to a wall or no field was built.
+    /// @param p reference point
+    /// @return distance and direction to the closest wall if 'p' is far from all walls
+    std::optional<WallDistanceField::Sample> ApproximateWallDistance(Point p) const;
+
     const std::tuple<std::vector<Point>, std::vector<std::vector<Point>>>& AccessibleArea() const;
 
     const PolyWithHoles& Polygon() const { return _accessibleAreaPolygon; }
 
+    /// Doors of the geometry, a door is identified by its index.
+    const std::vector<LineSegment>& Doors() const { return _doors; }
+
+    /// Opens or closes 'door'. A closed door is handled like a wall by all queries except
+    /// 'InsideGeometry', only the lookup grids around the door are updated.
+    /// Throws if there is no such door.
+    void SetDoorClosed(size_t door, bool closed);
+
+    /// Throws if there is no such door.
+    bool IsDoorClosed(size_t door) const;
+
     ID Id() const { return _id; }
 
+    /// Stores the accessible area, the doors and the lookup grids, see 'Read'. The wall distance
+    /// field is not stored.
+    void Write(BinaryWriter& writer) const;
+
+    /// Restores a geometry stored with 'Write' without recomputing the lookup grids. The restored
+    /// geometry has a new ID.
+    static CollisionGeometry Read(BinaryReader& reader);
+
 private:
+    CollisionGeometry() = default;
     void insertIntoApproximateGrid(const LineSegment& ls);
+    void removeFromApproximateGrid(const LineSegment& ls);
+    /// Calls 'fn(const LineSegment&)' for each closed door passing a cell overlapping 'bounds' and
+    /// stops as soon as 'fn' returns true. Like for walls, a door passing multiple cells may be
+    /// reported once per cell.
+    /// @return true if 'fn' returned true for any door
+    template <typename Fn>
+    bool anyClosedDoor(const AABB& bounds, Fn&& fn) const;
+    void extractAccessibleArea();
 };
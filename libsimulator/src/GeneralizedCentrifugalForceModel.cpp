@@ -11,6 +11,7 @@
 #include "OperationalModel.hpp"
 #include "OperationalModelType.hpp"
 #include "Simulation.hpp"
+#include "WorkerScratch.hpp"
 
 #include <Logger.hpp>
 #include <stdexcept>
@@ -40,31 +41,44 @@ OperationalModelType GeneralizedCentrifugalForceModel::Type() const
     return OperationalModelType::GENERALIZED_CENTRIFUGAL_FORCE;
 }
 
-OperationalModelUpdate GeneralizedCentrifugalForceModel::ComputeNewPosition(
+double GeneralizedCentrifugalForceModel::NeighborhoodRadius() const
+{
+    return 4.0; // TODO (MC) check this free parameter
+}
+
+GeneralizedCentrifugalForceModel::Update GeneralizedCentrifugalForceModel::ComputeUpdate(
     double dT,
-    const GenericAgent& agent,
+    size_t index,
+    const AgentStore& agents,
     const CollisionGeometry& geometry,
-    const NeighborhoodSearchType& neighborhoodSearch) const
+    const NeighborhoodSearchType& neighborhoodSearch,
+    WorkerScratch& /*scratch*/) const
 {
-    const double radius = 4.0; // TODO (MC) check this free parameter
-    const auto neighborhood = neighborhoodSearch.GetNeighboringAgents(agent.pos, radius);
+    const double radius = NeighborhoodRadius();
+    const auto agent = Agent::Of(agents, index);
     const auto p1 = agent.pos;
     Point F_rep;
-    for(const auto& neighbor : neighborhood) {
-        // TODO(schroedtert): Only use neighbors who have an unobstructed line of sight to the
-        // current agent
-        if(neighbor.id == agent.id) {
-            continue;
-        }
-        if(!geometry.IntersectsAny(LineSegment(p1, neighbor.pos))) {
-            F_rep += ForceRepPed(agent, neighbor);
-        }
-    }
+    neighborhoodSearch.ForEachNeighborIndexOf(
+        index,
+        agents.Positions(),
+        radius,
+        [this, index, &agents, &agent, &geometry, &p1, &F_rep](
+            size_t neighbor, bool lineOfSight) {
+            // TODO(schroedtert): Only use neighbors who have an unobstructed line of sight to the
+            // current agent
+            if(neighbor == index) {
+                return;
+            }
+            if(lineOfSight ||
+               !geometry.IntersectsAny(LineSegment(p1, agents.Positions()[neighbor]))) {
+                F_rep += ForceRepPed(agent, Agent::Of(agents, neighbor));
+            }
+        });
 
     GeneralizedCentrifugalForceModelUpdate update{};
     // repulsive forces to the walls and transitions that are not my target
     Point repwall = ForceRepRoom(agent, geometry);
-    const auto& model = std::get<GeneralizedCentrifugalForceModelData>(agent.model);
+    const auto& model = agent.model;
     Point fd = ForceDriv(agent, agent.destination, model.mass, model.tau, dT, update);
     Point acc = (fd + F_rep + repwall) / model.mass;
 
@@ -73,19 +87,19 @@ OperationalModelUpdate GeneralizedCentrifugalForceModel::ComputeNewPosition(
     return update;
 }
 
-void GeneralizedCentrifugalForceModel::ApplyUpdate(
-    const OperationalModelUpdate& upd,
-    GenericAgent& agent) const
+void GeneralizedCentrifugalForceModel::Apply(
+    const Update& update,
+    size_t index,
+    AgentStore& agents) const
 {
-    auto& model = std::get<GeneralizedCentrifugalForceModelData>(agent.model);
-    const auto& update = std::get<GeneralizedCentrifugalForceModelUpdate>(upd);
+    auto& model = agents.Models<GeneralizedCentrifugalForceModelData>()[index];
     model.e0 = update.e0;
     ++model.orientationDelay;
     if(update.position) {
-        agent.pos = *update.position;
+        agents.SetPosition(index, *update.position);
     }
     if(update.velocity) {
-        agent.orientation = (*update.velocity).Normalized();
+        agents.SetOrientation(index, (*update.velocity).Normalized());
         model.speed = (*update.velocity).Norm();
     }
 }
@@ -132,13 +146,12 @@ void GeneralizedCentrifugalForceModel::CheckModelConstraint(
     constexpr double BMaxMax = 2.;
     validateConstraint(BMax, BMaxMin, BMaxMax, "BMax");
 
-    const auto neighbors = neighborhoodSearch.GetNeighboringAgents(agent.pos, 2);
-    for(const auto& neighbor : neighbors) {
+    neighborhoodSearch.ForEachNeighbor(agent.pos, 2, [this, &agent](const auto& neighbor) {
         if(agent.id == neighbor.id) {
-            continue;
+            return;
         }
 
-        const auto contanctDist = AgentToAgentSpacing(agent, neighbor);
+        const auto contanctDist = AgentToAgentSpacing(Agent::Of(agent), Agent::Of(neighbor));
         const auto distance = (agent.pos - neighbor.pos).Norm();
         if(contanctDist >= distance) {
             throw SimulationError(
@@ -151,7 +164,7 @@ void GeneralizedCentrifugalForceModel::CheckModelConstraint(
                 contanctDist,
                 distance - contanctDist);
         }
-    }
+    });
 
     const auto maxRadius = std::max(AMin, BMax) / 2.;
     const auto lineSegments = geometry.LineSegmentsInDistanceTo(maxRadius, agent.pos);
@@ -169,7 +182,7 @@ std::unique_ptr<OperationalModel> GeneralizedCentrifugalForceModel::Clone() cons
 }
 
 Point GeneralizedCentrifugalForceModel::ForceDriv(
-    const GenericAgent& ped,
+    const Agent& ped,
     Point target,
     double mass,
     double tau,
@@ -180,7 +193,7 @@ Point GeneralizedCentrifugalForceModel::ForceDriv(
     const auto pos = ped.pos;
     const auto dest = ped.destination;
     const auto dist = (dest - pos).Norm();
-    const auto& model = std::get<GeneralizedCentrifugalForceModelData>(ped.model);
+    const auto& model = ped.model;
     if(dist > J_EPS_GOAL) {
 
         const Point e0 = mollify_e0(target, pos, deltaT, model.orientationDelay, model.e0);
@@ -194,11 +207,11 @@ Point GeneralizedCentrifugalForceModel::ForceDriv(
 }
 
 Point GeneralizedCentrifugalForceModel::ForceRepPed(
-    const GenericAgent& ped1,
-    const GenericAgent& ped2) const
+    const Agent& ped1,
+    const Agent& ped2) const
 {
-    const auto& model1 = std::get<GeneralizedCentrifugalForceModelData>(ped1.model);
-    const auto& model2 = std::get<GeneralizedCentrifugalForceModelData>(ped2.model);
+    const auto& model1 = ped1.model;
+    const auto& model2 = ped2.model;
     Point F_rep;
     // x- and y-coordinate of the distance between p1 and p2
     Point distp12 = ped2.pos - ped1.pos;
@@ -297,8 +310,8 @@ Point GeneralizedCentrifugalForceModel::ForceRepPed(
     if(F_rep.x != F_rep.x || F_rep.y != F_rep.y) {
         LOG_ERROR(
             "NAN return p1{} p2 {} Frepx={:f} Frepy={:f} K_ij={:f}",
-            ped1.id,
-            ped2.id,
+            ped1.pos,
+            ped2.pos,
             F_rep.x,
             F_rep.y,
             K_ij);
@@ -315,7 +328,7 @@ Point GeneralizedCentrifugalForceModel::ForceRepPed(
  * */
 
 inline Point GeneralizedCentrifugalForceModel::ForceRepRoom(
-    const GenericAgent& ped,
+    const Agent& ped,
     const CollisionGeometry& geometry) const
 {
     const auto& walls = geometry.LineSegmentsInApproxDistanceTo(ped.pos);
@@ -331,7 +344,7 @@ inline Point GeneralizedCentrifugalForceModel::ForceRepRoom(
 }
 
 inline Point
-GeneralizedCentrifugalForceModel::ForceRepWall(const GenericAgent& ped, const LineSegment& w) const
+GeneralizedCentrifugalForceModel::ForceRepWall(const Agent& ped, const LineSegment& w) const
 {
     Point F = Point(0.0, 0.0);
     Point pt = w.ShortestPoint(ped.pos);
@@ -346,7 +359,7 @@ GeneralizedCentrifugalForceModel::ForceRepWall(const GenericAgent& ped, const Li
         return F;
     }
     double mind = 0.5; // for performance reasons this distance is assumed to be constant
-    const auto& model = std::get<GeneralizedCentrifugalForceModelData>(ped.model);
+    const auto& model = ped.model;
     double vn =
         w.NormalComp(ped.orientation * model.speed); // normal component of the velocity on the wall
     F = ForceRepStatPoint(ped, pt, mind, vn);
@@ -365,7 +378,7 @@ GeneralizedCentrifugalForceModel::ForceRepWall(const GenericAgent& ped, const Li
  * */
 // TODO: use effective DistanceToEllipse and simplify this function.
 Point GeneralizedCentrifugalForceModel::ForceRepStatPoint(
-    const GenericAgent& ped,
+    const Agent& ped,
     const Point& p,
     double l,
     double vn) const
@@ -373,7 +386,7 @@ Point GeneralizedCentrifugalForceModel::ForceRepStatPoint(
     Point F_rep = Point(0.0, 0.0);
     // TODO(kkratz): this will fail for speed 0.
     // I think the code can be rewritten to account for orientation and speed separately
-    const auto& model = std::get<GeneralizedCentrifugalForceModelData>(ped.model);
+    const auto& model = ped.model;
     const Point v = ped.orientation * model.speed;
     Point dist = p - ped.pos; // x- and y-coordinate of the distance between ped and p
     double d = dist.Norm(); // distance between the centre of ped and point p
@@ -464,11 +477,11 @@ Point GeneralizedCentrifugalForceModel::ForceInterpolation(
     return F_rep;
 }
 double GeneralizedCentrifugalForceModel::AgentToAgentSpacing(
-    const GenericAgent& agent1,
-    const GenericAgent& agent2) const
+    const Agent& agent1,
+    const Agent& agent2) const
 {
-    const auto& model1 = std::get<GeneralizedCentrifugalForceModelData>(agent1.model);
-    const auto& model2 = std::get<GeneralizedCentrifugalForceModelData>(agent2.model);
+    const auto& model1 = agent1.model;
+    const auto& model2 = agent2.model;
     const Ellipse E1{model1.Av, model1.AMin, model1.BMax, model1.BMin};
     const Ellipse E2{model2.Av, model2.AMin, model2.BMax, model2.BMin};
     const auto v0_1 = model1.v0;
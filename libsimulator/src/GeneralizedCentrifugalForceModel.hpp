@@ -1,6 +1,9 @@
 // Copyright © 2012-2024 Forschungszentrum Jülich GmbH
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #pragma once
+#include "AgentView.hpp"
+#include "GeneralizedCentrifugalForceModelData.hpp"
+#include "GeneralizedCentrifugalForceModelUpdate.hpp"
 #include "NeighborhoodSearch.hpp"
 #include "OperationalModel.hpp"
 #include "UniqueID.hpp"
@@ -9,11 +12,14 @@
 #include <vector>
 
 struct GenericAgent;
+struct WorkerScratch;
 
-class GeneralizedCentrifugalForceModel : public OperationalModel
+class GeneralizedCentrifugalForceModel final : public OperationalModel
 {
 public:
     using NeighborhoodSearchType = NeighborhoodSearch<GenericAgent>;
+    using Agent = AgentView<GeneralizedCentrifugalForceModelData>;
+    using Update = GeneralizedCentrifugalForceModelUpdate;
 
 private:
     double strengthNeighborRepulsion;
@@ -38,18 +44,25 @@ public:
     ~GeneralizedCentrifugalForceModel() override = default;
 
     OperationalModelType Type() const override;
-    OperationalModelUpdate ComputeNewPosition(
-        double dT,
-        const GenericAgent& agent,
-        const CollisionGeometry& geometry,
-        const NeighborhoodSearchType& neighborhoodSearch) const override;
-    void ApplyUpdate(const OperationalModelUpdate& upate, GenericAgent& agent) const override;
+    double NeighborhoodRadius() const override;
     void CheckModelConstraint(
         const GenericAgent& agent,
         const NeighborhoodSearchType& neighborhoodSearch,
         const CollisionGeometry& geometry) const override;
     std::unique_ptr<OperationalModel> Clone() const override;
 
+    /// Computes the update of the agent at 'index', applied afterwards with 'Apply'. Called
+    /// without virtual dispatch by the kernel 'OperationalDecisionSystem' instantiates per model.
+    /// @param scratch memory of the worker computing the update, see 'WorkerScratch'
+    Update ComputeUpdate(
+        double dT,
+        size_t index,
+        const AgentStore& agents,
+        const CollisionGeometry& geometry,
+        const NeighborhoodSearchType& neighborhoodSearch,
+        WorkerScratch& scratch) const;
+    void Apply(const Update& update, size_t index, AgentStore& agents) const;
+
 private:
     /**
      * Driving force \f$ F_i =\frac{\mathbf{v_0}-\mathbf{v_i}}{\tau}\f$
@@ -60,7 +73,7 @@ private:
      * @return Point
      */
     Point ForceDriv(
-        const GenericAgent& ped,
+        const Agent& ped,
         Point target,
         double mass,
         double tau,
@@ -75,7 +88,7 @@ private:
      *
      * @return Point
      */
-    Point ForceRepPed(const GenericAgent& ped1, const GenericAgent& ped2) const;
+    Point ForceRepPed(const Agent& ped1, const Agent& ped2) const;
     /**
      * Repulsive force acting on pedestrian <ped> from the walls in
      * <subroom>. The sum of all repulsive forces of the walls in <subroom> is calculated
@@ -85,9 +98,9 @@ private:
      *
      * @return
      */
-    Point ForceRepRoom(const GenericAgent& ped, const CollisionGeometry& geometry) const;
-    Point ForceRepWall(const GenericAgent& ped, const LineSegment& l) const;
-    Point ForceRepStatPoint(const GenericAgent& ped, const Point& p, double l, double vn) const;
+    Point ForceRepRoom(const Agent& ped, const CollisionGeometry& geometry) const;
+    Point ForceRepWall(const Agent& ped, const LineSegment& l) const;
+    Point ForceRepStatPoint(const Agent& ped, const Point& p, double l, double vn) const;
     Point ForceInterpolation(
         double v0,
         double K_ij,
@@ -96,5 +109,5 @@ private:
         double d,
         double r,
         double l) const;
-    double AgentToAgentSpacing(const GenericAgent& agent, const GenericAgent& otherAgent) const;
+    double AgentToAgentSpacing(const Agent& agent, const Agent& otherAgent) const;
 };
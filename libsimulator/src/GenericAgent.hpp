@@ -10,7 +10,10 @@
 #include "UniqueID.hpp"
 #include "Visitor.hpp"
 
+#include <limits>
 #include <memory>
+#include <vector>
+class AgentStore;
 class Journey;
 class BaseStage;
 
@@ -21,9 +24,18 @@ struct GenericAgent {
     jps::UniqueID<Journey> journeyId{jps::UniqueID<Journey>::Invalid};
     jps::UniqueID<BaseStage> stageId{jps::UniqueID<BaseStage>::Invalid};
 
-    // This is evaluated by the "operational level"
-    Point destination{};
     Point target{};
+    // Face of the routing mesh 'pos' has been located in by the last routing query, a hint for the
+    // next query. max() if unknown.
+    size_t routingFace{std::numeric_limits<size_t>::max()};
+    // Path to 'target' cached by the tactical level if paths are refreshed lazily, see
+    // 'TacticalDecisionSystem'. The destination of the operational level is
+    // waypoints[nextWaypoint].
+    std::vector<Point> waypoints{};
+    size_t nextWaypoint{0};
+    Point waypointsTarget{};
+    // Iterations since 'waypoints' have been computed
+    size_t waypointsAge{0};
 
     // Agent fields common for all models
     Point pos{};
@@ -34,7 +46,10 @@ struct GenericAgent {
         CollisionFreeSpeedModelData,
         CollisionFreeSpeedModelV2Data,
         SocialForceModelData>;
+    // Model data the agent is created with. Once the agent has been added to a simulation its
+    // model state and destination are held by 'store', see 'AgentStore::ModelOf'.
     Model model{};
+    AgentStore* store{};
 
     GenericAgent(
         ID id_,
@@ -60,50 +75,14 @@ struct fmt::formatter<GenericAgent> {
     template <typename FormatContext>
     auto format(const GenericAgent& agent, FormatContext& ctx) const
     {
-        return std::visit(
-            overloaded{
-                [&ctx, &agent](const GeneralizedCentrifugalForceModelData& m) {
-                    return fmt::format_to(
-                        ctx.out(),
-                        "Agent[id={}, journey={}, stage={}, destination={}, waypoint={}, pos={}, "
-                        "orientation={}, model={})",
-                        agent.id,
-                        agent.journeyId,
-                        agent.stageId,
-                        agent.destination,
-                        agent.target,
-                        agent.pos,
-                        agent.orientation,
-                        m);
-                },
-                [&ctx, &agent](const CollisionFreeSpeedModelData& m) {
-                    return fmt::format_to(
-                        ctx.out(),
-                        "Agent[id={}, journey={}, stage={}, destination={}, waypoint={}, pos={}, "
-                        "orientation={}, model={})",
-                        agent.id,
-                        agent.journeyId,
-                        agent.stageId,
-                        agent.destination,
-                        agent.target,
-                        agent.pos,
-                        agent.orientation,
-                        m);
-                }},
-            [&ctx, &agent](const SocialForceModelData& m) {
-                return fmt::format_to(
-                    ctx.out(),
-                    "Agent[id={}, journey={}, stage={}, destination={}, waypoint={}, pos={}, "
-                    "orientation={}, model={})",
-                    agent.id,
-                    agent.journeyId,
-                    agent.stageId,
-                    agent.destination,
-                    agent.target,
-                    agent.pos,
-                    agent.orientation,
-                    m);
-            },
-            agent.model);
+        return fmt::format_to(
+            ctx.out(),
+            "Agent[id={}, journey={}, stage={}, waypoint={}, pos={}, orientation={})",
+            agent.id,
+            agent.journeyId,
+            agent.stageId,
+            agent.target,
+            agent.pos,
+            agent.orientation);
     }
 };
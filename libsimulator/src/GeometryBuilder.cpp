@@ -4,6 +4,7 @@
 
 #include "CfgCgal.hpp"
 #include "CollisionGeometry.hpp"
+#include "GeometryCache.hpp"
 #include "Point.hpp"
 #include "RoutingEngine.hpp"
 #include "SimulationError.hpp"
@@ -26,10 +27,31 @@ GeometryBuilder& GeometryBuilder::ExcludeFromAccessibleArea(const std::vector<Po
     return *this;
 }
 
+GeometryBuilder& GeometryBuilder::AddDoor(Point from, Point to)
+{
+    _doors.emplace_back(from, to);
+    return *this;
+}
+
 CollisionGeometry GeometryBuilder::Build()
 {
     const std::vector<Poly> accessibleListInput{
         std::begin(_accessibleAreas), std::end(_accessibleAreas)};
+    const std::vector<Poly> exclusionsListInput{std::begin(_exclusions), std::end(_exclusions)};
+    return GeometryCache::Instance().LoadGeometry(
+        accessibleListInput,
+        exclusionsListInput,
+        _doors,
+        [this, &accessibleListInput, &exclusionsListInput]() {
+            return build(accessibleListInput, exclusionsListInput, _doors);
+        });
+}
+
+CollisionGeometry GeometryBuilder::build(
+    const std::vector<Poly>& accessibleListInput,
+    const std::vector<Poly>& exclusionsListInput,
+    const std::vector<LineSegment>& doors)
+{
     PolyWithHolesList accessibleList{};
 
     CGAL::join(
@@ -43,7 +65,6 @@ CollisionGeometry GeometryBuilder::Build()
 
     auto accessibleArea = *accessibleList.begin();
 
-    const std::vector<Poly> exclusionsListInput{std::begin(_exclusions), std::end(_exclusions)};
     PolyWithHolesList exclusionsList{};
     CGAL::join(
         std::begin(exclusionsListInput),
@@ -59,5 +80,20 @@ CollisionGeometry GeometryBuilder::Build()
         accessibleArea = *res.begin();
     }
 
-    return CollisionGeometry(accessibleArea);
+    CollisionGeometry geometry(accessibleArea, doors);
+    for(const auto& door : doors) {
+        if(door.p1 == door.p2) {
+            throw SimulationError("Door {} has no extent", door);
+        }
+        if(!geometry.InsideGeometry(door.p1) || !geometry.InsideGeometry(door.p2) ||
+           !geometry.InsideGeometry((door.p1 + door.p2) / 2)) {
+            throw SimulationError("Door {} is not inside the accessible area", door);
+        }
+        // Doors usually end on walls, only the inner part must not cross any
+        const auto shrink = (door.p2 - door.p1).Normalized() * 1e-6;
+        if(geometry.IntersectsAny({door.p1 + shrink, door.p2 - shrink})) {
+            throw SimulationError("Door {} crosses a wall", door);
+        }
+    }
+    return geometry;
 }
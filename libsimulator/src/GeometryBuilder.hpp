@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CollisionGeometry.hpp"
+#include "LineSegment.hpp"
 #include "Polygon.hpp"
 
 #include <vector>
@@ -11,6 +12,7 @@ class GeometryBuilder
 {
     std::vector<Polygon> _accessibleAreas{};
     std::vector<Polygon> _exclusions{};
+    std::vector<LineSegment> _doors{};
 
 public:
     GeometryBuilder() = default;
@@ -22,5 +24,17 @@ public:
 
     GeometryBuilder& AddAccessibleArea(const std::vector<Point>& lineLoop);
     GeometryBuilder& ExcludeFromAccessibleArea(const std::vector<Point>& lineLoop);
+    /// Adds a door from 'from' to 'to'. Doors are numbered in the order they are added and are
+    /// open initially, a closed door acts as wall. A door has to lie inside the accessible area
+    /// and must not cross walls, typically it spans a passage between two walls.
+    GeometryBuilder& AddDoor(Point from, Point to);
+    /// Builds the accessible area as union of all accessible areas minus all exclusions. Loads
+    /// the result from the on-disk GeometryCache if it is enabled.
     CollisionGeometry Build();
+
+private:
+    static CollisionGeometry build(
+        const std::vector<Poly>& accessibleListInput,
+        const std::vector<Poly>& exclusionsListInput,
+        const std::vector<LineSegment>& doors);
 };
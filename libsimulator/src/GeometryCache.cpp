@@ -0,0 +1,367 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "GeometryCache.hpp"
+
+#include "BinaryStream.hpp"
+#include "HashCombine.hpp"
+#include "Logger.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+// "JPSC" in little endian
+constexpr uint32_t FILE_MAGIC = 0x4353504a;
+// Increment whenever the stored data changes
+constexpr uint32_t FILE_FORMAT_VERSION = 3;
+
+using Rings = std::vector<std::vector<Point>>;
+
+std::vector<Point> ringPoints(const Poly& ring)
+{
+    std::vector<Point> points{};
+    points.reserve(ring.size());
+    std::transform(
+        ring.vertices_begin(), ring.vertices_end(), std::back_inserter(points), [](const auto& p) {
+            return Point{CGAL::to_double(p.x()), CGAL::to_double(p.y())};
+        });
+    return points;
+}
+
+Rings rings(const std::vector<Poly>& polygons)
+{
+    Rings result{};
+    result.reserve(polygons.size());
+    std::transform(
+        std::begin(polygons), std::end(polygons), std::back_inserter(result), ringPoints);
+    return result;
+}
+
+Rings rings(const PolyWithHoles& polygon)
+{
+    Rings result{ringPoints(polygon.outer_boundary())};
+    for(const auto& hole : polygon.holes()) {
+        result.push_back(ringPoints(hole));
+    }
+    return result;
+}
+
+size_t hashRings(const Rings& rings, size_t seed)
+{
+    std::hash<double> hasher{};
+    for(const auto& ring : rings) {
+        seed = jps::hash_combine(seed, ring.size());
+        for(const auto& p : ring) {
+            seed = jps::hash_combine(seed, jps::hash_combine(hasher(p.x), hasher(p.y)));
+        }
+    }
+    return seed;
+}
+
+size_t hashDoors(const std::vector<LineSegment>& doors, size_t seed)
+{
+    std::hash<double> hasher{};
+    seed = jps::hash_combine(seed, doors.size());
+    for(const auto& door : doors) {
+        for(const auto& p : {door.p1, door.p2}) {
+            seed = jps::hash_combine(seed, jps::hash_combine(hasher(p.x), hasher(p.y)));
+        }
+    }
+    return seed;
+}
+
+void writeRings(BinaryWriter& writer, const Rings& rings)
+{
+    writer.Write(static_cast<uint64_t>(rings.size()));
+    for(const auto& ring : rings) {
+        writer.Write(ring);
+    }
+}
+
+Rings readRings(BinaryReader& reader)
+{
+    const auto count = reader.Read<uint64_t>();
+    Rings rings{};
+    for(uint64_t index = 0; index < count; ++index) {
+        rings.push_back(reader.ReadVector<Point>());
+    }
+    return rings;
+}
+
+void writeHeader(BinaryWriter& writer)
+{
+    const std::string_view version{JPSCORE_VERSION};
+    writer.Write(FILE_MAGIC);
+    writer.Write(FILE_FORMAT_VERSION);
+    writer.Write(std::vector<char>(std::begin(version), std::end(version)));
+}
+
+bool readHeader(BinaryReader& reader)
+{
+    const std::string_view version{JPSCORE_VERSION};
+    return reader.Read<uint32_t>() == FILE_MAGIC &&
+           reader.Read<uint32_t>() == FILE_FORMAT_VERSION &&
+           reader.ReadVector<char>() == std::vector<char>(std::begin(version), std::end(version));
+}
+
+/// Reads 'path' with 'read', returns nothing if the file does not exist, was written by another
+/// version or 'read' fails.
+template <typename T>
+std::optional<T> readFile(
+    const std::filesystem::path& path,
+    const std::function<std::optional<T>(BinaryReader&)>& read)
+{
+    std::ifstream in(path, std::ios::binary);
+    if(!in) {
+        return std::nullopt;
+    }
+    try {
+        BinaryReader reader(in);
+        if(!readHeader(reader)) {
+            LOG_DEBUG("Ignoring geometry cache file {} of another version", path.string());
+            return std::nullopt;
+        }
+        return read(reader);
+    } catch(const std::exception& ex) {
+        LOG_WARNING("Ignoring damaged geometry cache file {}: {}", path.string(), ex.what());
+    }
+    return std::nullopt;
+}
+
+/// Writes 'path' with 'write'. The file is written under a temporary name and renamed afterwards,
+/// so processes reading the cache concurrently never see a partially written file.
+void writeFile(const std::filesystem::path& path, const std::function<void(BinaryWriter&)>& write)
+{
+    try {
+        std::filesystem::create_directories(path.parent_path());
+        auto temporary = path;
+        temporary += fmt::format(".{:08x}.tmp", std::random_device{}());
+        {
+            std::ofstream out(temporary, std::ios::binary);
+            BinaryWriter writer(out);
+            writeHeader(writer);
+            write(writer);
+            if(!out) {
+                std::filesystem::remove(temporary);
+                throw std::runtime_error("could not write file");
+            }
+        }
+        std::filesystem::rename(temporary, path);
+    } catch(const std::exception& ex) {
+        LOG_WARNING("Could not store geometry cache file {}: {}", path.string(), ex.what());
+    }
+}
+} // namespace
+
+GeometryCache& GeometryCache::Instance()
+{
+    static GeometryCache cache;
+    return cache;
+}
+
+GeometryCache::Entry GeometryCache::Get(
+    const CollisionGeometry& geometry,
+    double wallDistanceFieldResolution,
+    RoutingBackend routingBackend)
+{
+    const auto& accessibleArea = geometry.Polygon();
+    const auto& doors = geometry.Doors();
+    const auto hash = std::hash<PolyWithHoles>{}(accessibleArea);
+
+    std::unique_lock lock(_mutex);
+    removeExpiredSlots();
+    std::shared_ptr<const CachedGeometry> cached{};
+    Building building{};
+    const auto [begin, end] = _slots.equal_range(hash);
+    for(auto iter = begin; iter != end && !cached && !building.valid(); ++iter) {
+        const auto& slot = iter->second;
+        if(slot.wallDistanceFieldResolution == wallDistanceFieldResolution &&
+           slot.routingBackend == routingBackend && slot.accessibleArea == accessibleArea &&
+           slot.doors == doors) {
+            cached = slot.cached.lock();
+            building = slot.building;
+        }
+    }
+    if(!cached && building.valid()) {
+        // Another request is building this entry, wait for it without blocking other entries
+        lock.unlock();
+        cached = building.get();
+        lock.lock();
+    } else if(!cached) {
+        std::promise<std::shared_ptr<const CachedGeometry>> promise{};
+        Slot pending{
+            accessibleArea,
+            doors,
+            wallDistanceFieldResolution,
+            routingBackend,
+            {},
+            promise.get_future().share()};
+        // Rehashing invalidates iterators but not references to the slots
+        auto& slot = _slots.emplace(hash, std::move(pending))->second;
+        const auto directory = _directory;
+        lock.unlock();
+        try {
+            auto built = std::make_shared<CachedGeometry>(CachedGeometry{
+                geometry, loadRoutingEngine(directory, accessibleArea, doors, routingBackend)});
+            // Door states belong to the simulations, shared entries start with all doors open
+            for(size_t door = 0; door < doors.size(); ++door) {
+                built->geometry.SetDoorClosed(door, false);
+            }
+            if(wallDistanceFieldResolution > 0) {
+                built->geometry.BuildWallDistanceField(wallDistanceFieldResolution);
+            }
+            cached = built;
+        } catch(...) {
+            promise.set_exception(std::current_exception());
+            lock.lock();
+            const auto [first, last] = _slots.equal_range(hash);
+            _slots.erase(std::find_if(first, last, [&slot](const auto& candidate) {
+                return &candidate.second == &slot;
+            }));
+            throw;
+        }
+        lock.lock();
+        // Slots being built are never removed, 'slot' is still valid
+        slot.cached = cached;
+        slot.building = {};
+        promise.set_value(cached);
+    }
+    retain(cached);
+    // Both pointers share ownership of the cached entry
+    return Entry{
+        std::shared_ptr<const CollisionGeometry>(cached, &cached->geometry),
+        std::shared_ptr<const RoutingEngine>(cached, cached->routingEngine.get())};
+}
+
+CollisionGeometry GeometryCache::LoadGeometry(
+    const std::vector<Poly>& accessibleAreas,
+    const std::vector<Poly>& exclusions,
+    const std::vector<LineSegment>& doors,
+    const std::function<CollisionGeometry()>& build)
+{
+    const auto directory = Directory();
+    if(directory.empty()) {
+        return build();
+    }
+    const auto areaRings = rings(accessibleAreas);
+    const auto exclusionRings = rings(exclusions);
+    const auto hash = hashDoors(doors, hashRings(exclusionRings, hashRings(areaRings, 0)));
+    const auto path = directory / fmt::format("geometry-{:016x}.bin", hash);
+
+    auto loaded = readFile<CollisionGeometry>(
+        path, [&](BinaryReader& reader) -> std::optional<CollisionGeometry> {
+            if(readRings(reader) != areaRings || readRings(reader) != exclusionRings ||
+               reader.ReadVector<LineSegment>() != doors) {
+                return std::nullopt;
+            }
+            return CollisionGeometry::Read(reader);
+        });
+    if(loaded) {
+        return std::move(*loaded);
+    }
+    auto geometry = build();
+    writeFile(path, [&](BinaryWriter& writer) {
+        writeRings(writer, areaRings);
+        writeRings(writer, exclusionRings);
+        writer.Write(doors);
+        geometry.Write(writer);
+    });
+    return geometry;
+}
+
+std::unique_ptr<const RoutingEngine> GeometryCache::loadRoutingEngine(
+    const std::filesystem::path& directory,
+    const PolyWithHoles& accessibleArea,
+    const std::vector<LineSegment>& doors,
+    RoutingBackend routingBackend)
+{
+    if(directory.empty()) {
+        return std::make_unique<RoutingEngine>(accessibleArea, routingBackend, doors);
+    }
+    const auto areaRings = rings(accessibleArea);
+    const auto hash = hashDoors(doors, hashRings(areaRings, static_cast<size_t>(routingBackend)));
+    const auto path = directory / fmt::format("routing-{:016x}.bin", hash);
+
+    using EnginePtr = std::unique_ptr<RoutingEngine>;
+    auto loaded = readFile<EnginePtr>(path, [&](BinaryReader& reader) -> std::optional<EnginePtr> {
+        if(readRings(reader) != areaRings || reader.ReadVector<LineSegment>() != doors) {
+            return std::nullopt;
+        }
+        auto engine = RoutingEngine::Read(reader);
+        if(engine->Backend() != routingBackend) {
+            return std::nullopt;
+        }
+        return engine;
+    });
+    if(loaded) {
+        return std::move(*loaded);
+    }
+    auto engine = std::make_unique<RoutingEngine>(accessibleArea, routingBackend, doors);
+    writeFile(path, [&](BinaryWriter& writer) {
+        writeRings(writer, areaRings);
+        writer.Write(doors);
+        engine->Write(writer);
+    });
+    return engine;
+}
+
+void GeometryCache::SetDirectory(std::filesystem::path directory)
+{
+    std::lock_guard lock(_mutex);
+    _directory = std::move(directory);
+}
+
+std::filesystem::path GeometryCache::Directory()
+{
+    std::lock_guard lock(_mutex);
+    return _directory;
+}
+
+size_t GeometryCache::Size()
+{
+    std::lock_guard lock(_mutex);
+    removeExpiredSlots();
+    return _slots.size();
+}
+
+void GeometryCache::Clear()
+{
+    std::lock_guard lock(_mutex);
+    _retained.clear();
+    removeExpiredSlots();
+}
+
+void GeometryCache::retain(const std::shared_ptr<const CachedGeometry>& cached)
+{
+    if(const auto iter = std::find(std::begin(_retained), std::end(_retained), cached);
+       iter != std::end(_retained)) {
+        _retained.erase(iter);
+    }
+    _retained.push_front(cached);
+    if(_retained.size() > RETAINED_ENTRIES) {
+        _retained.pop_back();
+    }
+}
+
+void GeometryCache::removeExpiredSlots()
+{
+    for(auto iter = std::begin(_slots); iter != std::end(_slots);) {
+        if(iter->second.cached.expired() && !iter->second.building.valid()) {
+            iter = _slots.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "CfgCgal.hpp"
+#include "CollisionGeometry.hpp"
+#include "LineSegment.hpp"
+#include "RoutingEngine.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/// Process wide cache of collision geometries and routing engines.
+///
+/// Building a RoutingEngine triangulates the accessible area and builds the navigation mesh,
+/// which dominates the setup of a simulation. Simulations of the same accessible area with the
+/// same options share one immutable CollisionGeometry and RoutingEngine handed out by this cache.
+/// Entries are looked up by content, i.e. the accessible area polygon, not by the ID of the
+/// geometry.
+///
+/// Entries live as long as a simulation uses them. Additionally the most recently requested
+/// entries are retained so that consecutive simulations of the same geometry do not rebuild it.
+///
+/// If a directory is set, built geometries and routing engines are also stored there and loaded
+/// by later processes instead of being built again. Files carry the inputs they were built from
+/// and are ignored if these differ, if they are damaged or were written by another version.
+class GeometryCache
+{
+public:
+    /// Number of most recently requested entries kept alive without any user
+    static constexpr size_t RETAINED_ENTRIES = 4;
+
+    struct Entry {
+        std::shared_ptr<const CollisionGeometry> geometry{};
+        std::shared_ptr<const RoutingEngine> routingEngine{};
+    };
+
+private:
+    struct CachedGeometry {
+        CollisionGeometry geometry;
+        std::unique_ptr<const RoutingEngine> routingEngine;
+    };
+
+    using Building = std::shared_future<std::shared_ptr<const CachedGeometry>>;
+
+    struct Slot {
+        PolyWithHoles accessibleArea{};
+        std::vector<LineSegment> doors{};
+        double wallDistanceFieldResolution{};
+        RoutingBackend routingBackend{};
+        std::weak_ptr<const CachedGeometry> cached{};
+        // Valid while the entry is built, requests for the same entry wait for it
+        Building building{};
+    };
+
+    std::mutex _mutex{};
+    // Slots by hash of the accessible area
+    std::unordered_multimap<size_t, Slot> _slots{};
+    // Most recently requested entries, the front is the most recent one
+    std::deque<std::shared_ptr<const CachedGeometry>> _retained{};
+    // Directory of the on-disk cache, empty if disabled
+    std::filesystem::path _directory{};
+
+public:
+    static GeometryCache& Instance();
+
+    /// Returns the shared geometry and routing engine for the accessible area and doors of
+    /// 'geometry', building them if they are not cached. The returned geometry is a copy of
+    /// 'geometry' or of an earlier geometry with the same accessible area and doors and has its
+    /// wall distance field built. All doors of the returned entry are open.
+    /// Entries are built without holding the lock of the cache, so requests for other entries do
+    /// not wait for the build. Concurrent requests for the same entry wait for the request that
+    /// builds it, hence an entry is built at most once.
+    /// @param wallDistanceFieldResolution see 'CollisionGeometry::BuildWallDistanceField', 0 to not
+    /// build a field
+    /// @param routingBackend backend of the routing engine
+    Entry
+    Get(const CollisionGeometry& geometry,
+        double wallDistanceFieldResolution,
+        RoutingBackend routingBackend);
+
+    /// Loads the geometry built from 'accessibleAreas', 'exclusions' and 'doors' from the on-disk
+    /// cache.
+    /// If it is not stored there, it is built with 'build' and stored. Without a directory this
+    /// only calls 'build'.
+    CollisionGeometry LoadGeometry(
+        const std::vector<Poly>& accessibleAreas,
+        const std::vector<Poly>& exclusions,
+        const std::vector<LineSegment>& doors,
+        const std::function<CollisionGeometry()>& build);
+
+    /// Sets the directory of the on-disk cache, an empty path disables it. The directory is
+    /// created on first use.
+    void SetDirectory(std::filesystem::path directory);
+    std::filesystem::path Directory();
+
+    /// Number of entries that are currently alive.
+    size_t Size();
+
+    /// Drops all retained entries. Entries still used by simulations stay alive.
+    void Clear();
+
+private:
+    GeometryCache() = default;
+    ~GeometryCache() = default;
+    GeometryCache(const GeometryCache& other) = delete;
+    GeometryCache& operator=(const GeometryCache& other) = delete;
+    GeometryCache(GeometryCache&& other) = delete;
+    GeometryCache& operator=(GeometryCache&& other) = delete;
+
+    void retain(const std::shared_ptr<const CachedGeometry>& cached);
+    void removeExpiredSlots();
+    /// Loads the routing engine for 'accessibleArea' and 'doors' from the on-disk cache in
+    /// 'directory' or builds and stores it. An empty 'directory' only builds the engine.
+    static std::unique_ptr<const RoutingEngine> loadRoutingEngine(
+        const std::filesystem::path& directory,
+        const PolyWithHoles& accessibleArea,
+        const std::vector<LineSegment>& doors,
+        RoutingBackend routingBackend);
+};
@@ -0,0 +1,250 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "LineSegmentGrid.hpp"
+
+#include "SimulationError.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace
+{
+// True if 'segment' crosses the horizontal line through 'p' to the left of 'p'. Endpoints on the
+// line count as below it.
+bool crossesLeftOf(const LineSegment& segment, Point p)
+{
+    if((segment.p1.y > p.y) == (segment.p2.y > p.y)) {
+        return false;
+    }
+    const auto& lower = segment.p1.y < segment.p2.y ? segment.p1 : segment.p2;
+    const auto& upper = segment.p1.y < segment.p2.y ? segment.p2 : segment.p1;
+    return (upper - lower).CrossProduct(p - lower) < 0;
+}
+} // namespace
+
+LineSegmentGrid::LineSegmentGrid(const std::vector<LineSegment>& segments, double cellSize)
+    : _segments(segments), _cellSize(cellSize)
+{
+    if(segments.empty()) {
+        return;
+    }
+    AABB bounds{};
+    for(const auto& segment : segments) {
+        for(const auto& p : {segment.p1, segment.p2}) {
+            bounds.xmin = std::min(bounds.xmin, p.x);
+            bounds.xmax = std::max(bounds.xmax, p.x);
+            bounds.ymin = std::min(bounds.ymin, p.y);
+            bounds.ymax = std::max(bounds.ymax, p.y);
+        }
+    }
+    const double width = bounds.xmax - bounds.xmin;
+    const double height = bounds.ymax - bounds.ymin;
+    while(std::ceil(width / _cellSize) * std::ceil(height / _cellSize) > MAX_CELL_COUNT) {
+        _cellSize *= 2;
+    }
+    _origin = bounds.BottomLeft();
+    _columns = std::max(static_cast<int32_t>(std::ceil(width / _cellSize)), 1);
+    _rows = std::max(static_cast<int32_t>(std::ceil(height / _cellSize)), 1);
+    const size_t cellCount = static_cast<size_t>(_columns) * _rows;
+
+    // Collect (cell, segment) pairs and sort them into the cells with a counting sort.
+    std::vector<std::pair<uint32_t, uint32_t>> pairs{};
+    for(size_t index = 0; index < segments.size(); ++index) {
+        const auto& segment = segments[index];
+        CellRange range{};
+        cells(AABB(segment.p1, segment.p2), range);
+        for(int32_t x = range.xMin; x <= range.xMax; ++x) {
+            for(int32_t y = range.yMin; y <= range.yMax; ++y) {
+                if(CellBounds(x, y).Intersects(segment)) {
+                    pairs.emplace_back(
+                        static_cast<uint32_t>(static_cast<size_t>(x) * _rows + y),
+                        static_cast<uint32_t>(index));
+                }
+            }
+        }
+    }
+    _cellOffsets.assign(cellCount + 1, 0);
+    for(const auto& [cell, _] : pairs) {
+        ++_cellOffsets[cell + 1];
+    }
+    for(size_t cell = 0; cell < cellCount; ++cell) {
+        _cellOffsets[cell + 1] += _cellOffsets[cell];
+    }
+    std::vector<uint32_t> cursor(std::begin(_cellOffsets), std::prev(std::end(_cellOffsets)));
+    _segmentIndices.resize(pairs.size());
+    for(const auto& [cell, index] : pairs) {
+        _segmentIndices[cursor[cell]++] = index;
+    }
+
+    const size_t stride = static_cast<size_t>(_rows) + 1;
+    _occupiedCells.assign((static_cast<size_t>(_columns) + 1) * stride, 0);
+    for(size_t x = 0; x < static_cast<size_t>(_columns); ++x) {
+        for(size_t y = 0; y < static_cast<size_t>(_rows); ++y) {
+            const auto cell = x * _rows + y;
+            const uint32_t nonEmpty = _cellOffsets[cell] != _cellOffsets[cell + 1] ? 1 : 0;
+            _occupiedCells[(x + 1) * stride + y + 1] = nonEmpty +
+                                                       _occupiedCells[x * stride + y + 1] +
+                                                       _occupiedCells[(x + 1) * stride + y] -
+                                                       _occupiedCells[x * stride + y];
+        }
+    }
+
+    // Sweep each row from left to right along its center line, all crossings within the x range
+    // of a cell are stored in that cell.
+    _crossingParity.assign(cellCount, 0);
+    for(int32_t y = 0; y < _rows; ++y) {
+        const double height = _origin.y + (y + 0.5) * _cellSize;
+        bool odd = false;
+        for(int32_t x = 0; x < _columns; ++x) {
+            const auto cell = static_cast<size_t>(x) * _rows + y;
+            _crossingParity[cell] = odd ? 1 : 0;
+            const double left = _origin.x + x * _cellSize;
+            odd = odd != oddCrossings(cell, height, left, left + _cellSize);
+        }
+    }
+}
+
+void LineSegmentGrid::Write(BinaryWriter& writer) const
+{
+    writer.Write(_origin);
+    writer.Write(_cellSize);
+    writer.Write(_columns);
+    writer.Write(_rows);
+    writer.Write(_cellOffsets);
+    writer.Write(_segmentIndices);
+    writer.Write(_occupiedCells);
+    writer.Write(_crossingParity);
+}
+
+LineSegmentGrid LineSegmentGrid::Read(
+    BinaryReader& reader,
+    const std::vector<LineSegment>& segments)
+{
+    LineSegmentGrid grid{};
+    grid._segments = segments;
+    grid._origin = reader.Read<Point>();
+    grid._cellSize = reader.Read<double>();
+    grid._columns = reader.Read<int32_t>();
+    grid._rows = reader.Read<int32_t>();
+    grid._cellOffsets = reader.ReadVector<uint32_t>();
+    grid._segmentIndices = reader.ReadVector<uint32_t>();
+    grid._occupiedCells = reader.ReadVector<uint32_t>();
+    grid._crossingParity = reader.ReadVector<uint8_t>();
+    if(grid._segments.empty()) {
+        if(grid._columns != 0 || grid._rows != 0 || !grid._cellOffsets.empty() ||
+           !grid._segmentIndices.empty() || !grid._occupiedCells.empty() ||
+           !grid._crossingParity.empty()) {
+            throw SimulationError("Inconsistent line segment grid data");
+        }
+        return grid;
+    }
+    if(!std::isfinite(grid._cellSize) || grid._cellSize <= 0 || grid._columns < 1 ||
+       grid._rows < 1) {
+        throw SimulationError("Inconsistent line segment grid data");
+    }
+    const size_t cellCount = static_cast<size_t>(grid._columns) * grid._rows;
+    if(grid._cellOffsets.size() != cellCount + 1 || grid._crossingParity.size() != cellCount ||
+       grid._occupiedCells.size() !=
+           (static_cast<size_t>(grid._columns) + 1) * (static_cast<size_t>(grid._rows) + 1)) {
+        throw SimulationError("Inconsistent line segment grid data");
+    }
+    if(grid._cellOffsets.front() != 0 ||
+       !std::is_sorted(std::begin(grid._cellOffsets), std::end(grid._cellOffsets)) ||
+       grid._cellOffsets.back() != grid._segmentIndices.size()) {
+        throw SimulationError("Inconsistent line segment grid data");
+    }
+    for(const auto index : grid._segmentIndices) {
+        if(index >= grid._segments.size()) {
+            throw SimulationError("Inconsistent line segment grid data");
+        }
+    }
+    for(const auto count : grid._occupiedCells) {
+        if(count > cellCount) {
+            throw SimulationError("Inconsistent line segment grid data");
+        }
+    }
+    return grid;
+}
+
+bool LineSegmentGrid::OddCrossingsLeftOf(Point p) const
+{
+    // Horizontal rays above, below or left of the grid do not cross any segment.
+    if(_columns == 0 || p.y < _origin.y || p.y >= _origin.y + _rows * _cellSize ||
+       p.x < _origin.x) {
+        return false;
+    }
+    const auto column = std::min(
+        static_cast<int32_t>(std::floor((p.x - _origin.x) / _cellSize)), _columns - 1);
+    const auto row =
+        std::min(static_cast<int32_t>(std::floor((p.y - _origin.y) / _cellSize)), _rows - 1);
+
+    // Crossings in [left edge of cell x, to) are stored in cell x, walk left until the parity
+    // of an empty cell is known.
+    bool odd = false;
+    double to = p.x;
+    for(int32_t x = column; x >= 0; --x) {
+        const auto cell = static_cast<size_t>(x) * _rows + row;
+        if(_cellOffsets[cell] == _cellOffsets[cell + 1]) {
+            return odd != (_crossingParity[cell] != 0);
+        }
+        const double from = _origin.x + x * _cellSize;
+        odd = odd != oddCrossings(cell, p.y, from, to);
+        to = from;
+    }
+    return odd;
+}
+
+AABB LineSegmentGrid::CellBounds(int32_t x, int32_t y) const
+{
+    const double epsilon = _cellSize * 1e-9;
+    const Point bottomLeft{_origin.x + x * _cellSize, _origin.y + y * _cellSize};
+    return AABB(
+        Point{bottomLeft.x - epsilon, bottomLeft.y - epsilon},
+        Point{bottomLeft.x + _cellSize + epsilon, bottomLeft.y + _cellSize + epsilon});
+}
+
+bool LineSegmentGrid::cells(const AABB& bounds, CellRange& range) const
+{
+    if(_columns == 0) {
+        return false;
+    }
+    const double epsilon = _cellSize * 1e-9;
+    const double xMin = std::floor((bounds.xmin - epsilon - _origin.x) / _cellSize);
+    const double xMax = std::floor((bounds.xmax + epsilon - _origin.x) / _cellSize);
+    const double yMin = std::floor((bounds.ymin - epsilon - _origin.y) / _cellSize);
+    const double yMax = std::floor((bounds.ymax + epsilon - _origin.y) / _cellSize);
+    if(xMax < 0 || yMax < 0 || xMin >= _columns || yMin >= _rows) {
+        return false;
+    }
+    range.xMin = static_cast<int32_t>(std::max(xMin, 0.0));
+    range.xMax = static_cast<int32_t>(std::min(xMax, static_cast<double>(_columns - 1)));
+    range.yMin = static_cast<int32_t>(std::max(yMin, 0.0));
+    range.yMax = static_cast<int32_t>(std::min(yMax, static_cast<double>(_rows - 1)));
+    return true;
+}
+
+bool LineSegmentGrid::oddCrossings(size_t cell, double height, double from, double to) const
+{
+    bool odd = false;
+    for(auto index = _cellOffsets[cell]; index < _cellOffsets[cell + 1]; ++index) {
+        const auto& segment = _segments[_segmentIndices[index]];
+        // Crossing left of 'to' but not left of 'from'
+        const bool crosses =
+            crossesLeftOf(segment, {to, height}) != crossesLeftOf(segment, {from, height});
+        odd = odd != crosses;
+    }
+    return odd;
+}
+
+bool LineSegmentGrid::occupied(const CellRange& range) const
+{
+    const size_t stride = static_cast<size_t>(_rows) + 1;
+    const auto at = [this, stride](int32_t x, int32_t y) {
+        return _occupiedCells[static_cast<size_t>(x) * stride + y];
+    };
+    return at(range.xMax + 1, range.yMax + 1) - at(range.xMin, range.yMax + 1) -
+               at(range.xMax + 1, range.yMin) + at(range.xMin, range.yMin) >
+           0;
+}
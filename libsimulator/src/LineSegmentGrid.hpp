@@ -0,0 +1,114 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "AABB.hpp"
+#include "BinaryStream.hpp"
+#include "LineSegment.hpp"
+#include "Point.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Uniform grid over the bounding box of a set of line segments.
+///
+/// Each cell stores the indices of all segments passing through it (CSR layout). Additionally a
+/// summed area table over the non empty cells is kept, it answers whether any segment passes
+/// through a rectangle of cells in constant time. Queries for line of sight or distance hence
+/// only pay for exact tests in the vicinity of segments. For point in polygon tests each cell
+/// without segments knows how many segments lie to its left, modulo 2.
+class LineSegmentGrid
+{
+    // Upper bound for the number of cells, larger areas use larger cells.
+    static constexpr size_t MAX_CELL_COUNT = size_t{1} << 22;
+
+    std::vector<LineSegment> _segments{};
+    Point _origin{};
+    double _cellSize{1};
+    int32_t _columns{0};
+    int32_t _rows{0};
+    // Segments of cell (x, y) are _segmentIndices[_cellOffsets[c], _cellOffsets[c + 1]) with the
+    // linear cell index c = x * _rows + y.
+    std::vector<uint32_t> _cellOffsets{};
+    std::vector<uint32_t> _segmentIndices{};
+    // Number of non empty cells in [0, x) x [0, y) at index x * (_rows + 1) + y
+    std::vector<uint32_t> _occupiedCells{};
+    // Parity of the number of segments crossed by a horizontal ray from cell c to the left, only
+    // valid for empty cells, where it is the same for all points in the cell.
+    std::vector<uint8_t> _crossingParity{};
+
+public:
+    struct CellRange {
+        int32_t xMin;
+        int32_t xMax;
+        int32_t yMin;
+        int32_t yMax;
+    };
+
+    LineSegmentGrid() = default;
+    /// @param segments to store, queries report indices into this vector
+    /// @param cellSize edge length of the cells, may be enlarged for large areas
+    LineSegmentGrid(const std::vector<LineSegment>& segments, double cellSize);
+
+    /// Stores the grid without its segments, see 'Read'.
+    void Write(BinaryWriter& writer) const;
+    /// Restores a grid stored with 'Write'.
+    /// @param segments the segments the grid has been built from
+    static LineSegmentGrid Read(BinaryReader& reader, const std::vector<LineSegment>& segments);
+
+    /// Calls 'fn(index)' for each segment stored in a cell that overlaps 'bounds' and for which
+    /// 'cellFilter(const AABB& cellBounds)' returns true. Stops as soon as 'fn' returns true.
+    /// Segments passing through multiple cells may be reported multiple times.
+    /// @return true if 'fn' returned true for any segment
+    template <typename CellFilter, typename Fn>
+    bool AnyOf(const AABB& bounds, CellFilter&& cellFilter, Fn&& fn) const
+    {
+        CellRange range{};
+        if(!cells(bounds, range) || !occupied(range)) {
+            return false;
+        }
+        for(int32_t x = range.xMin; x <= range.xMax; ++x) {
+            for(int32_t y = range.yMin; y <= range.yMax; ++y) {
+                const auto cell = static_cast<size_t>(x) * _rows + y;
+                const auto first = _cellOffsets[cell];
+                const auto last = _cellOffsets[cell + 1];
+                if(first == last || !cellFilter(CellBounds(x, y))) {
+                    continue;
+                }
+                for(auto index = first; index < last; ++index) {
+                    if(fn(static_cast<size_t>(_segmentIndices[index]))) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    /// Checks in constant time if any segment passes through a cell overlapping 'bounds'.
+    bool AnyIn(const AABB& bounds) const
+    {
+        CellRange range{};
+        return cells(bounds, range) && occupied(range);
+    }
+
+    /// Parity of the number of segments crossed by the horizontal ray from 'p' to the left. An
+    /// endpoint on the ray counts as below it, so closed polylines passing through the ray at a
+    /// vertex are counted correctly. For points not on a segment of a set of closed polylines
+    /// this is the crossing number test. Only the cells between 'p' and the closest empty cell to
+    /// its left are inspected.
+    bool OddCrossingsLeftOf(Point p) const;
+
+    /// Bounds of cell (x, y), slightly enlarged so that segments touching the boundary of a cell
+    /// are stored in it despite rounding errors.
+    AABB CellBounds(int32_t x, int32_t y) const;
+
+private:
+    /// Computes the cells overlapping 'bounds', returns false if there are none.
+    bool cells(const AABB& bounds, CellRange& range) const;
+    bool occupied(const CellRange& range) const;
+    /// Parity of the number of segments of 'cell' crossing the horizontal line at 'height'
+    /// within [from, to).
+    bool oddCrossings(size_t cell, double height, double from, double to) const;
+};
@@ -2,6 +2,9 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #include "Mesh.hpp"
 
+#include "SimulationError.hpp"
+
+#include <glm/common.hpp>
 #include <glm/geometric.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -12,10 +15,12 @@
 #include <fmt/ranges.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <iterator>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <optional>
 #include <queue>
 #include <sstream>
@@ -80,7 +85,10 @@ Mesh::Mesh(const CDT& cdt)
         }
     }
 
+    polygonOfTriangle.resize(polygons.size());
+    std::iota(std::begin(polygonOfTriangle), std::end(polygonOfTriangle), 0);
     updateBoundingBoxes();
+    updateLocationGrid();
 };
 
 std::unique_ptr<Mesh> Mesh::Clone() const
@@ -88,16 +96,78 @@ std::unique_ptr<Mesh> Mesh::Clone() const
     return std::make_unique<Mesh>(*this);
 }
 
-void Mesh::MergeGreedy()
+void Mesh::Write(BinaryWriter& writer) const
+{
+    writer.Write(vertices);
+    writer.Write(static_cast<uint64_t>(polygons.size()));
+    for(const auto& polygon : polygons) {
+        writer.Write(polygon.vertices);
+        writer.Write(polygon.neighbors);
+    }
+    writer.Write(polygonOfTriangle);
+}
+
+std::unique_ptr<Mesh> Mesh::Read(BinaryReader& reader)
 {
-    mergeDeadEnds();
-    smartMerge(true);
+    std::unique_ptr<Mesh> mesh(new Mesh());
+    mesh->vertices = reader.ReadVector<glm::dvec2>();
+    const auto polygonCount = reader.Read<uint64_t>();
+    for(uint64_t index = 0; index < polygonCount; ++index) {
+        Polygon polygon{};
+        polygon.vertices = reader.ReadVector<size_t>();
+        polygon.neighbors = reader.ReadVector<size_t>();
+        if(polygon.vertices.size() != polygon.neighbors.size()) {
+            throw SimulationError("Inconsistent mesh data");
+        }
+        for(const auto vertex : polygon.vertices) {
+            if(vertex >= mesh->vertices.size()) {
+                throw SimulationError("Inconsistent mesh data");
+            }
+        }
+        for(const auto neighbor : polygon.neighbors) {
+            if(neighbor != Polygon::InvalidIndex && neighbor >= polygonCount) {
+                throw SimulationError("Inconsistent mesh data");
+            }
+        }
+        mesh->polygons.push_back(std::move(polygon));
+    }
+    mesh->polygonOfTriangle = reader.ReadVector<size_t>();
+    for(const auto polygon : mesh->polygonOfTriangle) {
+        if(polygon >= polygonCount) {
+            throw SimulationError("Inconsistent mesh data");
+        }
+    }
+    mesh->updateBoundingBoxes();
+    mesh->updateLocationGrid();
+    return mesh;
+}
+
+void Mesh::MergeGreedy(const std::vector<std::pair<size_t, size_t>>& fixedEdges)
+{
+    EdgeSet fixed{};
+    for(const auto& [from, to] : fixedEdges) {
+        fixed.emplace(std::min(from, to), std::max(from, to));
+    }
+    mergeDeadEnds(fixed);
+    smartMerge(true, fixed);
     trimEmptyPolygons();
     assert(isValid());
     updateBoundingBoxes();
+    updateLocationGrid();
 }
 
-void Mesh::mergeDeadEnds()
+bool Mesh::isFixedEdge(const EdgeSet& fixedEdges, size_t polygon_index, size_t edge) const
+{
+    if(fixedEdges.empty()) {
+        return false;
+    }
+    const auto& polygon = polygons[polygon_index].vertices;
+    const auto from = polygon[edge];
+    const auto to = polygon[(edge + 1) % polygon.size()];
+    return fixedEdges.count({std::min(from, to), std::max(from, to)}) != 0;
+}
+
+void Mesh::mergeDeadEnds(const EdgeSet& fixedEdges)
 {
     std::vector<bool> merged_polygons(polygons.size(), false);
     bool merged = false;
@@ -129,6 +199,9 @@ void Mesh::mergeDeadEnds()
                 std::find_if(std::begin(p.neighbors), std::end(p.neighbors), isValidNeighbor);
             assert(neighbor != std::end(p.neighbors));
             const auto valid_neighbor = std::distance(std::begin(p.neighbors), neighbor);
+            if(isFixedEdge(fixedEdges, index, valid_neighbor)) {
+                continue;
+            }
             merge_candidate = p.neighbors[valid_neighbor];
 
             merge_target = index;
@@ -141,6 +214,7 @@ void Mesh::mergeDeadEnds()
             polygons[merge_candidate].neighbors.clear();
             polygons[merge_candidate].vertices.clear();
             merged_polygons[merge_candidate] = true;
+            mergedInto(merge_candidate, merge_target);
             for(size_t index = 0; index < polygons.size(); ++index) {
                 if(merged_polygons[index]) {
                     continue;
@@ -176,7 +250,7 @@ double Mesh::polygonArea(const std::vector<size_t> indices) const
     return area;
 }
 
-void Mesh::smartMerge(bool keep_deadends = true)
+void Mesh::smartMerge(bool keep_deadends, const EdgeSet& fixedEdges)
 {
     constexpr double InvalidArea{std::numeric_limits<double>::lowest()};
 
@@ -219,7 +293,7 @@ void Mesh::smartMerge(bool keep_deadends = true)
         for(size_t i = 0; i < polygon.neighbors.size(); ++i) {
             const auto& neighbor = polygon.neighbors[i];
             if(neighbor == Polygon::InvalidIndex || neighbor == index ||
-               polygons[neighbor].neighbors.size() == 0) {
+               polygons[neighbor].neighbors.size() == 0 || isFixedEdge(fixedEdges, index, i)) {
                 continue;
             }
             const auto& valid_neighbor = i;
@@ -261,7 +335,8 @@ void Mesh::smartMerge(bool keep_deadends = true)
         for(size_t i = 0; i < polygon.neighbors.size(); ++i) {
             const auto& neighbor = polygon.neighbors[i];
             if(neighbor == Polygon::InvalidIndex || neighbor == node.source ||
-               polygons[neighbor].vertices.size() == 0) {
+               polygons[neighbor].vertices.size() == 0 ||
+               isFixedEdge(fixedEdges, node.source, i)) {
                 continue;
             }
             size_t mergeIndex = polygon.neighbors[i];
@@ -288,6 +363,7 @@ void Mesh::smartMerge(bool keep_deadends = true)
         bestMerge[mergePartner] = InvalidArea;
         polygons[mergePartner].neighbors.clear();
         polygons[mergePartner].vertices.clear();
+        mergedInto(mergePartner, node.source);
         for(size_t index = 0; index < polygons.size(); ++index) {
             auto& polygon = polygons[index];
             std::replace(
@@ -502,9 +578,21 @@ void Mesh::trimEmptyPolygons()
             }
         }
     }
+    for(auto& p : polygonOfTriangle) {
+        p = index_mapping.at(p);
+    }
     polygons = trimed_polygons;
 }
 
+void Mesh::mergedInto(size_t polygon_index, size_t target_index)
+{
+    for(auto& p : polygonOfTriangle) {
+        if(p == polygon_index) {
+            p = target_index;
+        }
+    }
+}
+
 void Mesh::updateBoundingBoxes()
 {
     boundingBoxes.clear();
@@ -532,17 +620,125 @@ void Mesh::updateBoundingBoxes()
         });
 }
 
-size_t Mesh::FindContainingPolygon(const glm::dvec2& p) const
+static double cross2D(glm::dvec2 a, glm::dvec2 b)
 {
+    return a.y * b.x - a.x * b.y;
+}
+
+void Mesh::updateLocationGrid()
+{
+    locationCellOffsets.clear();
+    locationCells.clear();
+    locationGridColumns = 0;
+    locationGridRows = 0;
+    if(polygons.empty()) {
+        return;
+    }
+
+    glm::dvec2 min{std::numeric_limits<double>::max()};
+    glm::dvec2 max{std::numeric_limits<double>::lowest()};
+    for(const auto& v : vertices) {
+        min = glm::min(min, v);
+        max = glm::max(max, v);
+    }
+    // Roughly one cell per polygon
+    const auto extent = max - min;
+    const auto area = std::max(extent.x, 1e-6) * std::max(extent.y, 1e-6);
+    locationGridCellSize = std::sqrt(area / static_cast<double>(polygons.size()));
+    locationGridOrigin = min;
+    locationGridColumns = static_cast<size_t>(extent.x / locationGridCellSize) + 1;
+    locationGridRows = static_cast<size_t>(extent.y / locationGridCellSize) + 1;
+
+    const auto cellRange = [this](const Polygon& polygon) {
+        glm::dvec2 pMin{std::numeric_limits<double>::max()};
+        glm::dvec2 pMax{std::numeric_limits<double>::lowest()};
+        for(const auto index : polygon.vertices) {
+            pMin = glm::min(pMin, vertices[index]);
+            pMax = glm::max(pMax, vertices[index]);
+        }
+        const auto first = (pMin - locationGridOrigin) / locationGridCellSize;
+        const auto last = (pMax - locationGridOrigin) / locationGridCellSize;
+        return std::array<size_t, 4>{
+            static_cast<size_t>(first.x),
+            std::min(static_cast<size_t>(last.x), locationGridColumns - 1),
+            static_cast<size_t>(first.y),
+            std::min(static_cast<size_t>(last.y), locationGridRows - 1)};
+    };
+
+    // Count polygons per cell, turn the counts into offsets, then fill the cells back to front
+    locationCellOffsets.assign(locationGridColumns * locationGridRows + 1, 0);
+    for(const auto& polygon : polygons) {
+        const auto [xFirst, xLast, yFirst, yLast] = cellRange(polygon);
+        for(size_t y = yFirst; y <= yLast; ++y) {
+            for(size_t x = xFirst; x <= xLast; ++x) {
+                ++locationCellOffsets[y * locationGridColumns + x + 1];
+            }
+        }
+    }
+    std::partial_sum(
+        std::begin(locationCellOffsets),
+        std::end(locationCellOffsets),
+        std::begin(locationCellOffsets));
+    locationCells.resize(locationCellOffsets.back());
+    auto fill = locationCellOffsets;
     for(size_t index = 0; index < polygons.size(); ++index) {
-        if(boundingBoxes[index].Inside({p.x, p.y}) && TriangleContains(index, p)) {
-            return index;
+        const auto [xFirst, xLast, yFirst, yLast] = cellRange(polygons[index]);
+        for(size_t y = yFirst; y <= yLast; ++y) {
+            for(size_t x = xFirst; x <= xLast; ++x) {
+                locationCells[fill[y * locationGridColumns + x]++] = index;
+            }
+        }
+    }
+}
+
+size_t Mesh::FindContainingPolygon(const glm::dvec2& p) const
+{
+    if(locationGridColumns == 0) {
+        return Polygon::InvalidIndex;
+    }
+    const auto cell = (p - locationGridOrigin) / locationGridCellSize;
+    if(!(cell.x >= 0 && cell.x < static_cast<double>(locationGridColumns) && cell.y >= 0 &&
+         cell.y < static_cast<double>(locationGridRows))) {
+        return Polygon::InvalidIndex;
+    }
+    const auto index =
+        static_cast<size_t>(cell.y) * locationGridColumns + static_cast<size_t>(cell.x);
+    for(size_t offset = locationCellOffsets[index]; offset < locationCellOffsets[index + 1];
+        ++offset) {
+        if(PolygonContains(locationCells[offset], p)) {
+            return locationCells[offset];
         }
     }
 
     return Polygon::InvalidIndex;
 }
 
+size_t Mesh::FindContainingPolygon(const glm::dvec2& p, size_t hint) const
+{
+    // Agents move little between queries, a short walk usually suffices. Long walks, walks that
+    // would leave the mesh and walks that run into a cycle are handed to the grid.
+    constexpr size_t maxWalkSteps = 16;
+    size_t current = hint;
+    for(size_t step = 0; step < maxWalkSteps && current < polygons.size(); ++step) {
+        const auto& polygon = polygons[current];
+        const auto count = polygon.vertices.size();
+        size_t next = current;
+        for(size_t index = 0; index < count; ++index) {
+            const auto a = vertices[polygon.vertices[index]];
+            const auto b = vertices[polygon.vertices[(index + 1) % count]];
+            if(cross2D(p - a, b - a) < 0) {
+                next = polygon.neighbors[index];
+                break;
+            }
+        }
+        if(next == current) {
+            return current;
+        }
+        current = next;
+    }
+    return FindContainingPolygon(p);
+}
+
 glm::dvec2 Mesh::Vertex(size_t index) const
 {
     return vertices.at(index);
@@ -656,11 +852,6 @@ std::stringstream Mesh::IntoLibPolyanyaMeshDescription() const
 }
 
 /// 2D pseudo cross product
-static double cross2D(glm::dvec2 a, glm::dvec2 b)
-{
-    return a.y * b.x - a.x * b.y;
-}
-
 bool Mesh::TriangleContains(const size_t polygonIndex, glm::dvec2 p) const
 {
     const auto& poly = polygons[polygonIndex];
@@ -680,3 +871,17 @@ bool Mesh::TriangleContains(const size_t polygonIndex, glm::dvec2 p) const
     }
     return true;
 }
+
+bool Mesh::PolygonContains(size_t polygonIndex, glm::dvec2 p) const
+{
+    const auto& poly = polygons[polygonIndex];
+    const auto count = poly.vertices.size();
+    for(size_t index = 0; index < count; ++index) {
+        const auto a = vertices[poly.vertices[index]];
+        const auto b = vertices[poly.vertices[(index + 1) % count]];
+        if(cross2D(p - a, b - a) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
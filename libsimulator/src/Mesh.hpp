@@ -3,6 +3,7 @@
 #pragma once
 
 #include "AABB.hpp"
+#include "BinaryStream.hpp"
 #include "CfgCgal.hpp"
 #include "Clonable.hpp"
 
@@ -10,7 +11,9 @@
 
 #include <limits>
 #include <memory>
+#include <set>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 class Mesh : public Clonable<Mesh>
@@ -32,6 +35,18 @@ private:
     /// All convex polygons in this Mesh in CCW orientation.
     std::vector<Polygon> polygons{};
     std::vector<AABB> boundingBoxes{};
+    /// Indexed by the triangles the mesh has been constructed from, index of the polygon
+    /// containing the triangle.
+    std::vector<size_t> polygonOfTriangle{};
+    /// Uniform grid over all polygons to locate points without a hint. Cell (x, y) lists the
+    /// polygons whose bounding box overlaps the cell in
+    /// locationCells[locationCellOffsets[c], locationCellOffsets[c + 1]) with c = y * columns + x.
+    glm::dvec2 locationGridOrigin{};
+    double locationGridCellSize{1};
+    size_t locationGridColumns{0};
+    size_t locationGridRows{0};
+    std::vector<size_t> locationCellOffsets{};
+    std::vector<size_t> locationCells{};
 
 public:
     explicit Mesh(const CDT& cdt);
@@ -41,11 +56,23 @@ public:
     Mesh(Mesh&& other) = default;
     Mesh& operator=(Mesh&& other) = default;
     std::unique_ptr<Mesh> Clone() const override;
-    void MergeGreedy();
+    /// Stores vertices, polygons and the triangle to polygon mapping, see 'Read'.
+    void Write(BinaryWriter& writer) const;
+    /// Restores a mesh stored with 'Write', the lookup structures are rebuilt.
+    static std::unique_ptr<Mesh> Read(BinaryReader& reader);
+    /// Merges adjacent polygons into larger convex polygons.
+    /// @param fixedEdges edges given by their two vertex indices that stay between two polygons
+    void MergeGreedy(const std::vector<std::pair<size_t, size_t>>& fixedEdges = {});
     std::vector<glm::vec2> FVertices() const;
     std::vector<uint16_t> TriangleIndices() const;
     std::vector<uint16_t> SegmentIndices() const;
+    /// Index of a polygon containing 'p', points on edges are inside.
+    /// @return Polygon::InvalidIndex if no polygon contains 'p'
     size_t FindContainingPolygon(const glm::dvec2& p) const;
+    /// Like 'FindContainingPolygon(p)' but walks from polygon 'hint' towards 'p' first. This is
+    /// cheap if 'p' is in or close to 'hint', e.g. the polygon an agent was located in during the
+    /// last iteration. An invalid 'hint' falls back to the grid lookup.
+    size_t FindContainingPolygon(const glm::dvec2& p, size_t hint) const;
     glm::dvec2 Vertex(size_t index) const;
     size_t CountVertices() const { return vertices.size(); }
     size_t CountPolygons() const { return polygons.size(); }
@@ -53,10 +80,24 @@ public:
     const Mesh::Polygon& Polygons(size_t index) const { return polygons.at(index); }
     const AABB& AxisAlignedBoundingBox(size_t index) const { return boundingBoxes.at(index); }
     bool TriangleContains(const size_t, glm::dvec2 p) const;
+    bool PolygonContains(size_t polygonIndex, glm::dvec2 p) const;
+    /// Index of the polygon containing a triangle of the CDT this mesh has been constructed
+    /// from. Triangles are numbered in iteration order of the faces inside the domain. Before
+    /// merging this is the identity.
+    size_t PolygonOfTriangle(size_t triangleIndex) const
+    {
+        return polygonOfTriangle.at(triangleIndex);
+    }
 
 private:
-    void mergeDeadEnds();
-    void smartMerge(bool keep_deadends);
+    /// Edges as pairs of vertex indices, the smaller index first
+    using EdgeSet = std::set<std::pair<size_t, size_t>>;
+
+    Mesh() = default;
+    void mergeDeadEnds(const EdgeSet& fixedEdges);
+    void smartMerge(bool keep_deadends, const EdgeSet& fixedEdges);
+    /// True if edge 'edge' of polygon 'polygon_index' is in 'fixedEdges'
+    bool isFixedEdge(const EdgeSet& fixedEdges, size_t polygon_index, size_t edge) const;
     bool isValid() const;
     bool polygonIsConvex(const std::vector<size_t>& indices) const;
     bool tryMerge(size_t polygon_a_index, size_t polygon_b_index, size_t first_common_vertex_in_a);
@@ -66,5 +107,7 @@ private:
     mergedPolygon(size_t polygon_a_index, size_t polygon_b_index, size_t first_common_vertex_in_a);
     double polygonArea(const std::vector<size_t> indices) const;
     void trimEmptyPolygons();
+    void mergedInto(size_t polygon_index, size_t target_index);
     void updateBoundingBoxes();
+    void updateLocationGrid();
 };
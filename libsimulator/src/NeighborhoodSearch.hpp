@@ -2,12 +2,16 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #pragma once
 
+#include "AABB.hpp"
 #include "HashCombine.hpp"
 #include "IteratorPair.hpp"
 #include "Point.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <unordered_map>
 #include <vector>
 
@@ -56,14 +60,88 @@ struct std::hash<Grid2DIndex> {
     }
 };
 
+/// Data structures available to store the grid of a 'NeighborhoodSearch'.
+enum class NeighborhoodSearchBackend {
+    /// Unbounded sparse grid, cells are stored in a hash map.
+    HashGrid,
+    /// Dense grid bounded by the geometry, all cells are stored in one contiguous array (CSR
+    /// layout). Values are reordered in memory so that values of the same cell are adjacent.
+    DenseGrid
+};
+
+/// Grid based search for values close to a position.
+///
+/// The search does not store copies of the values. Cells hold the position of each value at the
+/// time it was added together with its index into the storage passed to 'Update' / 'AddAgent'.
+/// Queries filter on these positions and hand out references into that storage, hence the storage
+/// has to outlive the search and must not be reordered or shrunk until the next call to 'Update'.
+///
+/// Optionally the search maintains Verlet neighbor lists, see 'EnableNeighborLists'.
 template <typename Value>
 class NeighborhoodSearch
 {
-    using Grid = std::unordered_map<Grid2DIndex, std::vector<Value>>;
+public:
+    /// Returns true if no obstacle is within 'distance' of the line segment 'from'-'to'.
+    using ClearanceFunction = std::function<bool(Point from, Point to, double distance)>;
+
+private:
+    struct Entry {
+        Point pos;
+        size_t index;
+    };
+    struct NeighborListEntry {
+        size_t index;
+        // Line of sight to the neighbor is unobstructed as long as the list is valid
+        bool lineOfSight;
+    };
+    using Grid = std::unordered_map<Grid2DIndex, std::vector<Entry>>;
+
+    static constexpr size_t NO_ENTRY = std::numeric_limits<size_t>::max();
+    // Upper bound for the number of cells of the dense grid, larger areas use larger cells.
+    static constexpr size_t MAX_DENSE_CELL_COUNT = size_t{1} << 22;
+    // Each update visits all cells of the dense grid. The number of cells is limited to this
+    // multiple of the number of values, so that sparsely populated areas use larger cells instead
+    // of visiting mostly empty cells.
+    static constexpr size_t DENSE_CELLS_PER_VALUE = 8;
+    // Lower bound of the limit above, so that small crowds still get cells of '_cellSize'.
+    static constexpr size_t MIN_DENSE_CELL_LIMIT = size_t{1} << 12;
 
     double _cellSize;
+    NeighborhoodSearchBackend _backend;
+    const std::vector<Value>* _values{};
+
+    // HashGrid backend
     Grid _grid{};
 
+    // DenseGrid backend, cell (x, y) has the linear index x * _rows + y and its entries are stored
+    // in _entries[_cellOffsets[cell], _cellOffsets[cell + 1]).
+    Point _origin{};
+    double _width{};
+    double _height{};
+    double _denseCellSize{};
+    int32_t _columns{1};
+    int32_t _rows{1};
+    std::vector<Entry> _entries{};
+    std::vector<size_t> _cellOffsets{};
+    // Values added with 'AddAgent' after the last update, chained per cell.
+    std::vector<Entry> _added{};
+    std::vector<size_t> _addedNext{};
+    std::vector<size_t> _addedHead{};
+    // Scratch space reused between updates
+    std::vector<size_t> _cellOfValue{};
+    std::vector<size_t> _cellCursor{};
+    std::vector<Value> _reorderBuffer{};
+
+    // Verlet neighbor lists, the neighbors of value i are stored in
+    // _neighborListEntries[_neighborListOffsets[i], _neighborListOffsets[i + 1]).
+    double _neighborListCutoff{0};
+    double _neighborListSkin{0};
+    ClearanceFunction _clearance{};
+    bool _neighborListsValid{false};
+    std::vector<Point> _neighborListPositions{};
+    std::vector<size_t> _neighborListOffsets{};
+    std::vector<NeighborListEntry> _neighborListEntries{};
+
 private:
     Grid2DIndex getIndex(const Point& pos) const
     {
@@ -72,46 +150,124 @@ private:
         return Grid2DIndex{idx, idy};
     }
 
-public:
-    explicit NeighborhoodSearch(double cellSize) : _cellSize(cellSize){};
+    int32_t denseColumn(double x) const
+    {
+        const auto column = std::floor((x - _origin.x) / _denseCellSize);
+        return static_cast<int32_t>(std::clamp(column, 0.0, static_cast<double>(_columns - 1)));
+    }
 
-    void AddAgent(const Value& item)
+    int32_t denseRow(double y) const
     {
-        auto index = getIndex(item.pos);
-        auto& vec = _grid[index];
-        vec.push_back(item);
+        const auto row = std::floor((y - _origin.y) / _denseCellSize);
+        return static_cast<int32_t>(std::clamp(row, 0.0, static_cast<double>(_rows - 1)));
     }
 
-    void RemoveAgent(const Value& item)
+    size_t denseCell(const Point& pos) const
     {
-        for(auto& [_, agents] : _grid) {
-            const auto iter =
-                std::find_if(std::begin(agents), std::end(agents), [item](auto& agent) {
-                    return agent.id == item.id;
-                });
-            if(iter != std::end(agents)) {
-                agents.erase(iter);
-                return;
-            }
+        return static_cast<size_t>(denseColumn(pos.x)) * _rows + denseRow(pos.y);
+    }
+
+    /// Chooses the cell size of the dense grid for 'valueCount' values, starting at '_cellSize'
+    /// and doubling it until the number of cells is within the limits.
+    void fitDenseGrid(size_t valueCount)
+    {
+        const auto limit = std::clamp(
+            DENSE_CELLS_PER_VALUE * valueCount, MIN_DENSE_CELL_LIMIT, MAX_DENSE_CELL_COUNT);
+        _denseCellSize = _cellSize;
+        while(std::ceil(_width / _denseCellSize) * std::ceil(_height / _denseCellSize) >
+              static_cast<double>(limit)) {
+            _denseCellSize *= 2;
         }
-        throw SimulationError("Unknown agent id {}", item.id);
+        _columns = std::max(static_cast<int32_t>(std::ceil(_width / _denseCellSize)), 1);
+        _rows = std::max(static_cast<int32_t>(std::ceil(_height / _denseCellSize)), 1);
     }
 
-    void Update(const std::vector<Value>& items)
+    /// Counting sort of 'items' by cell, leaves the index of the first entry of each cell in
+    /// '_cellOffsets' and the next free slot per cell in '_cellCursor'.
+    void countCells(const std::vector<Value>& items)
     {
-        _grid.clear();
-        for(const auto& item : items) {
-            auto index = getIndex(item.pos);
-            auto& vec = _grid[index];
-            vec.push_back(item);
+        fitDenseGrid(items.size());
+        const size_t cellCount = static_cast<size_t>(_columns) * _rows;
+        _cellOfValue.resize(items.size());
+        _cellOffsets.assign(cellCount + 1, 0);
+        for(size_t index = 0; index < items.size(); ++index) {
+            const auto cell = denseCell(items[index].pos);
+            _cellOfValue[index] = cell;
+            ++_cellOffsets[cell + 1];
         }
+        for(size_t cell = 0; cell < cellCount; ++cell) {
+            _cellOffsets[cell + 1] += _cellOffsets[cell];
+        }
+        _cellCursor.assign(std::begin(_cellOffsets), std::prev(std::end(_cellOffsets)));
     }
 
-    std::vector<Value> GetNeighboringAgents(Point pos, double radius) const
+    void updateDense(const std::vector<Value>& items)
     {
-        std::vector<Value> result{};
-        result.reserve(128);
+        countCells(items);
+        _entries.resize(items.size());
+        for(size_t index = 0; index < items.size(); ++index) {
+            _entries[_cellCursor[_cellOfValue[index]]++] = Entry{items[index].pos, index};
+        }
+        _added.clear();
+        _addedNext.clear();
+        _addedHead.clear();
+    }
 
+    void updateHash(const std::vector<Value>& items)
+    {
+        // Keep the cells and only clear them, this avoids reallocating them in every update.
+        for(auto& [_, entries] : _grid) {
+            entries.clear();
+        }
+        for(size_t index = 0; index < items.size(); ++index) {
+            const auto& item = items[index];
+            _grid[getIndex(item.pos)].push_back(Entry{item.pos, index});
+        }
+    }
+
+    /// Calls 'fn(size_t index)' for the index of every value within 'radius' of 'pos'.
+    template <typename Fn>
+    void visitDense(Point pos, double radius, Fn&& fn) const
+    {
+        if(_cellOffsets.empty()) {
+            return;
+        }
+        const auto radiusSquared = radius * radius;
+        const int32_t xMin = denseColumn(pos.x - radius);
+        const int32_t xMax = denseColumn(pos.x + radius);
+        const int32_t yMin = denseRow(pos.y - radius);
+        const int32_t yMax = denseRow(pos.y + radius);
+
+        for(int32_t x = xMin; x <= xMax; ++x) {
+            // Cells of one column are adjacent, hence the entries of all rows are one range
+            const size_t columnBegin = static_cast<size_t>(x) * _rows;
+            const auto first = _cellOffsets[columnBegin + yMin];
+            const auto last = _cellOffsets[columnBegin + yMax + 1];
+            for(size_t index = first; index < last; ++index) {
+                const auto& entry = _entries[index];
+                if(DistanceSquared(entry.pos, pos) <= radiusSquared) {
+                    fn(entry.index);
+                }
+            }
+            if(_addedHead.empty()) {
+                continue;
+            }
+            for(int32_t y = yMin; y <= yMax; ++y) {
+                for(size_t added = _addedHead[columnBegin + y]; added != NO_ENTRY;
+                    added = _addedNext[added]) {
+                    const auto& entry = _added[added];
+                    if(DistanceSquared(entry.pos, pos) <= radiusSquared) {
+                        fn(entry.index);
+                    }
+                }
+            }
+        }
+    }
+
+    /// Calls 'fn(size_t index)' for the index of every value within 'radius' of 'pos'.
+    template <typename Fn>
+    void visitHash(Point pos, double radius, Fn&& fn) const
+    {
         const auto posIdx = getIndex(pos);
         const auto offset = static_cast<int32_t>(std::ceil(radius / _cellSize));
         const int32_t xMin = posIdx.idx - offset;
@@ -125,14 +281,277 @@ public:
             for(int32_t y = yMin; y <= yMax; ++y) {
                 auto it = _grid.find({x, y});
                 if(it != _grid.cend()) {
-                    for(const auto& item : it->second) {
-                        if(DistanceSquared(item.pos, pos) <= radiusSquared) {
-                            result.emplace_back(item);
+                    for(const auto& entry : it->second) {
+                        if(DistanceSquared(entry.pos, pos) <= radiusSquared) {
+                            fn(entry.index);
                         }
                     }
                 }
             }
         }
+    }
+
+    bool neighborListsEnabled() const { return _neighborListSkin > 0; }
+
+    /// Lists stay valid as long as no value was added or removed and no value moved more than
+    /// half the skin since they were built. Two values moving towards each other by at most
+    /// skin / 2 each can not come closer than the cutoff without being listed.
+    bool neighborListsValid(const std::vector<Value>& items) const
+    {
+        if(!_neighborListsValid || items.size() != _neighborListPositions.size()) {
+            return false;
+        }
+        const auto maxDisplacement = _neighborListSkin / 2;
+        const auto maxDisplacementSquared = maxDisplacement * maxDisplacement;
+        for(size_t index = 0; index < items.size(); ++index) {
+            if(DistanceSquared(items[index].pos, _neighborListPositions[index]) >
+               maxDisplacementSquared) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void buildNeighborLists(const std::vector<Value>& items)
+    {
+        const auto radius = _neighborListCutoff + _neighborListSkin;
+        // While the list is valid both ends of the line of sight move by at most skin / 2, the
+        // moved segment thus stays within skin / 2 of the segment checked here.
+        const auto clearance = _neighborListSkin / 2;
+        _neighborListPositions.resize(items.size());
+        _neighborListOffsets.resize(items.size() + 1);
+        _neighborListEntries.clear();
+        _neighborListOffsets[0] = 0;
+        for(size_t index = 0; index < items.size(); ++index) {
+            const auto pos = items[index].pos;
+            _neighborListPositions[index] = pos;
+            ForEachNeighbor(pos, radius, [this, &items, index, pos, clearance](const Value& other) {
+                const auto neighbor = static_cast<size_t>(&other - items.data());
+                if(neighbor != index) {
+                    _neighborListEntries.push_back(
+                        NeighborListEntry{neighbor, _clearance(pos, other.pos, clearance)});
+                }
+            });
+            _neighborListOffsets[index + 1] = _neighborListEntries.size();
+        }
+        _neighborListsValid = true;
+    }
+
+    void updateNeighborLists(const std::vector<Value>& items)
+    {
+        if(neighborListsEnabled() && !neighborListsValid(items)) {
+            buildNeighborLists(items);
+        }
+    }
+
+public:
+    explicit NeighborhoodSearch(
+        double cellSize,
+        NeighborhoodSearchBackend backend = NeighborhoodSearchBackend::HashGrid)
+        : _cellSize(cellSize), _backend(backend), _denseCellSize(cellSize){};
+
+    NeighborhoodSearchBackend Backend() const { return _backend; }
+
+    /// Enables Verlet neighbor lists used by 'ForEachNeighborOf'.
+    /// Each value gets a list of all values within 'cutoff' + 'skin'. The lists are reused in
+    /// 'Update' until any value moved more than 'skin' / 2 or values were added or removed. For
+    /// each listed neighbor the line of sight is checked once with 'clearance' when the lists
+    /// are built. A 'skin' of 0 disables the lists.
+    void EnableNeighborLists(double cutoff, double skin, ClearanceFunction clearance)
+    {
+        _neighborListCutoff = cutoff;
+        _neighborListSkin = skin;
+        _clearance = std::move(clearance);
+        InvalidateNeighborLists();
+    }
+
+    /// Forces a rebuild of the neighbor lists in the next 'Update', e.g. after the obstacles
+    /// checked by the clearance function changed.
+    void InvalidateNeighborLists() { _neighborListsValid = false; }
+
+    /// Sets the area covered by the dense grid, values outside of it are stored in the closest
+    /// cell. Has no effect for the hash grid backend.
+    /// The cells are at least as large as the cell size of the search and grow if the area is
+    /// large compared to the number of values, see 'DENSE_CELLS_PER_VALUE'.
+    void SetBounds(const AABB& bounds)
+    {
+        InvalidateNeighborLists();
+        _origin = Point{bounds.xmin, bounds.ymin};
+        _width = std::max(bounds.xmax - bounds.xmin, 0.0);
+        _height = std::max(bounds.ymax - bounds.ymin, 0.0);
+        _cellOffsets.clear();
+        _addedHead.clear();
+        if(_backend == NeighborhoodSearchBackend::DenseGrid && _values != nullptr) {
+            updateDense(*_values);
+        }
+    }
+
+    /// Adds the value at 'index' in 'values' without rebuilding the search.
+    /// 'values' has to be the storage passed to the last call of 'Update' (if any).
+    void AddAgent(const std::vector<Value>& values, size_t index)
+    {
+        _values = &values;
+        InvalidateNeighborLists();
+        const auto& item = values[index];
+        if(_backend == NeighborhoodSearchBackend::HashGrid) {
+            _grid[getIndex(item.pos)].push_back(Entry{item.pos, index});
+            return;
+        }
+        if(_cellOffsets.empty()) {
+            // Values added before the first update use the grid for the current number of values
+            fitDenseGrid(values.size());
+            _cellOffsets.assign(static_cast<size_t>(_columns) * _rows + 1, 0);
+        }
+        if(_addedHead.empty()) {
+            _addedHead.assign(static_cast<size_t>(_columns) * _rows, NO_ENTRY);
+        }
+        const auto cell = denseCell(item.pos);
+        _added.push_back(Entry{item.pos, index});
+        _addedNext.push_back(_addedHead[cell]);
+        _addedHead[cell] = _added.size() - 1;
+    }
+
+    void Update(const std::vector<Value>& items)
+    {
+        _values = &items;
+        if(_backend == NeighborhoodSearchBackend::HashGrid) {
+            updateHash(items);
+        } else {
+            updateDense(items);
+        }
+        updateNeighborLists(items);
+    }
+
+    /// Same as 'Update', but with the dense grid backend 'items' are first reordered by cell, so
+    /// that values of the same cell are adjacent in memory. The relative order of values within a
+    /// cell is kept. With neighbor lists enabled values are only reordered when the lists have to
+    /// be rebuilt anyway, as they refer to values by index.
+    /// @return true if 'items' has been reordered, see 'ReorderedIndices'
+    bool UpdateAndReorder(std::vector<Value>& items)
+    {
+        if(_backend == NeighborhoodSearchBackend::HashGrid ||
+           (neighborListsEnabled() && neighborListsValid(items))) {
+            Update(items);
+            return false;
+        }
+        _values = &items;
+        countCells(items);
+        _reorderBuffer.clear();
+        _reorderBuffer.reserve(items.size());
+        // '_cellOfValue' is reused to hold the position of each value after reordering.
+        for(size_t index = 0; index < items.size(); ++index) {
+            _cellOfValue[index] = _cellCursor[_cellOfValue[index]]++;
+        }
+        _entries.resize(items.size());
+        for(size_t index = 0; index < items.size(); ++index) {
+            _entries[_cellOfValue[index]] = Entry{items[index].pos, index};
+        }
+        for(auto& entry : _entries) {
+            _reorderBuffer.push_back(std::move(items[entry.index]));
+            entry.index = _reorderBuffer.size() - 1;
+        }
+        items.swap(_reorderBuffer);
+        _reorderBuffer.clear();
+        _added.clear();
+        _addedNext.clear();
+        _addedHead.clear();
+        updateNeighborLists(items);
+        return true;
+    }
+
+    /// New index of each value by its index before the last reordering by 'UpdateAndReorder'.
+    /// Valid until the next update.
+    const std::vector<size_t>& ReorderedIndices() const { return _cellOfValue; }
+
+    /// Calls 'fn(const Value&)' for every value within 'radius' of 'pos'.
+    template <typename Fn>
+    void ForEachNeighbor(Point pos, double radius, Fn&& fn) const
+    {
+        ForEachNeighborIndex(pos, radius, [this, &fn](size_t index) { fn((*_values)[index]); });
+    }
+
+    /// Calls 'fn(size_t index)' with the index into the storage of every value within 'radius' of
+    /// 'pos'.
+    template <typename Fn>
+    void ForEachNeighborIndex(Point pos, double radius, Fn&& fn) const
+    {
+        if(_backend == NeighborhoodSearchBackend::HashGrid) {
+            visitHash(pos, radius, fn);
+        } else {
+            visitDense(pos, radius, fn);
+        }
+    }
+
+    /// Like 'ForEachNeighborOf' for the value at 'index', but calls
+    /// 'fn(size_t neighbor, bool lineOfSight)' with indices into the storage instead of references.
+    /// 'positions' holds the current position of each value of the storage passed to the last
+    /// update by index, distances are filtered on these.
+    template <typename Fn>
+    void ForEachNeighborIndexOf(
+        size_t index,
+        const std::vector<Point>& positions,
+        double radius,
+        Fn&& fn) const
+    {
+        const auto pos = positions[index];
+        if(!_neighborListsValid || radius > _neighborListCutoff ||
+           _neighborListPositions.size() != positions.size()) {
+            ForEachNeighborIndex(pos, radius, [&fn](size_t neighbor) { fn(neighbor, false); });
+            return;
+        }
+        const auto radiusSquared = radius * radius;
+        for(size_t entry = _neighborListOffsets[index]; entry < _neighborListOffsets[index + 1];
+            ++entry) {
+            const auto& [neighbor, lineOfSight] = _neighborListEntries[entry];
+            if(DistanceSquared(positions[neighbor], pos) <= radiusSquared) {
+                fn(neighbor, lineOfSight);
+            }
+        }
+    }
+
+    /// Calls 'fn(const Value& neighbor, bool lineOfSight)' for every value within 'radius' of
+    /// 'value'. 'value' itself may or may not be visited.
+    /// If 'value' is part of the storage and the neighbor lists are valid and cover 'radius' its
+    /// list is used. 'lineOfSight' is true if the line of sight to 'neighbor' is known to be
+    /// unobstructed, otherwise the caller has to check it. Distances are filtered on the current
+    /// positions of the values.
+    template <typename Fn>
+    void ForEachNeighborOf(const Value& value, double radius, Fn&& fn) const
+    {
+        const bool inStorage = _values != nullptr && !_values->empty() &&
+                               std::less_equal<>{}(_values->data(), &value) &&
+                               std::less<>{}(&value, _values->data() + _values->size());
+        if(!inStorage || !_neighborListsValid || radius > _neighborListCutoff ||
+           _neighborListPositions.size() != _values->size()) {
+            ForEachNeighbor(
+                value.pos, radius, [&fn](const Value& neighbor) { fn(neighbor, false); });
+            return;
+        }
+        const auto index = static_cast<size_t>(&value - _values->data());
+        const auto radiusSquared = radius * radius;
+        for(size_t entry = _neighborListOffsets[index]; entry < _neighborListOffsets[index + 1];
+            ++entry) {
+            const auto& [neighborIndex, lineOfSight] = _neighborListEntries[entry];
+            const auto& neighbor = (*_values)[neighborIndex];
+            if(DistanceSquared(neighbor.pos, value.pos) <= radiusSquared) {
+                fn(neighbor, lineOfSight);
+            }
+        }
+    }
+
+    /// Replaces the content of 'result' with pointers to all values within 'radius' of 'pos'.
+    /// Reusing 'result' between queries avoids allocations.
+    void GetNeighboringAgents(Point pos, double radius, std::vector<const Value*>& result) const
+    {
+        result.clear();
+        ForEachNeighbor(pos, radius, [&result](const Value& value) { result.push_back(&value); });
+    }
+
+    /// Returns copies of all values within 'radius' of 'pos'.
+    std::vector<Value> GetNeighboringAgents(Point pos, double radius) const
+    {
+        std::vector<Value> result{};
+        ForEachNeighbor(pos, radius, [&result](const Value& value) { result.push_back(value); });
         return result;
     }
 };
@@ -2,22 +2,35 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #pragma once
 
+#include "AgentStore.hpp"
+#include "CollisionFreeSpeedModel.hpp"
+#include "CollisionFreeSpeedModelV2.hpp"
+#include "GeneralizedCentrifugalForceModel.hpp"
 #include "GenericAgent.hpp"
-#include "IteratorPair.hpp"
 #include "NeighborhoodSearch.hpp"
 #include "OperationalModel.hpp"
 #include "OperationalModelType.hpp"
 #include "SimulationError.hpp"
+#include "SocialForceModel.hpp"
+#include "ThreadPool.hpp"
+#include "WorkerScratch.hpp"
 
-#include <boost/iterator/zip_iterator.hpp>
+#include <Unreachable.hpp>
 
-#include <iterator>
 #include <memory>
+#include <tuple>
 #include <vector>
 
 class OperationalDecisionSystem
 {
     std::unique_ptr<OperationalModel> _model{};
+    // Updates of the last iteration per model, kept so that iterations reuse the memory
+    std::tuple<
+        std::vector<CollisionFreeSpeedModel::Update>,
+        std::vector<GeneralizedCentrifugalForceModel::Update>,
+        std::vector<CollisionFreeSpeedModelV2::Update>,
+        std::vector<SocialForceModel::Update>>
+        _updates{};
 
 public:
     OperationalDecisionSystem(std::unique_ptr<OperationalModel>&& model) : _model(std::move(model))
@@ -31,33 +44,59 @@ public:
 
     OperationalModelType ModelType() const { return _model->Type(); }
 
+    double NeighborhoodRadius() const { return _model->NeighborhoodRadius(); }
+
+    /// @param scratch one slot per worker of 'threadPool'
     void
     Run(double dT,
         double /*t_in_sec*/,
         const NeighborhoodSearch<GenericAgent>& neighborhoodSearch,
         const CollisionGeometry& geometry,
-        std::vector<GenericAgent>& agents) const
+        AgentStore& agents,
+        ThreadPool& threadPool,
+        std::vector<WorkerScratch>& scratch)
     {
-        std::vector<std::optional<OperationalModelUpdate>> updates{};
-        updates.reserve(agents.size());
-
-        std::transform(
-            std::begin(agents),
-            std::end(agents),
-            std::back_inserter(updates),
-            [this, &dT, &geometry, &neighborhoodSearch](const auto& agent) {
-                return _model->ComputeNewPosition(dT, agent, geometry, neighborhoodSearch);
-            });
-
-        std::for_each(
-            boost::make_zip_iterator(boost::make_tuple(std::begin(agents), std::begin(updates))),
-            boost::make_zip_iterator(boost::make_tuple(std::end(agents), std::end(updates))),
-            [this](auto tup) {
-                auto& [agent, update] = tup;
-                if(update) {
-                    _model->ApplyUpdate(*update, agent);
-                }
-            });
+        // All agents of a simulation use the model of the simulation, so the model is resolved
+        // once per iteration instead of once per agent.
+        switch(_model->Type()) {
+            case OperationalModelType::COLLISION_FREE_SPEED:
+                run(static_cast<const CollisionFreeSpeedModel&>(*_model),
+                    dT,
+                    neighborhoodSearch,
+                    geometry,
+                    agents,
+                    threadPool,
+                    scratch);
+                return;
+            case OperationalModelType::GENERALIZED_CENTRIFUGAL_FORCE:
+                run(static_cast<const GeneralizedCentrifugalForceModel&>(*_model),
+                    dT,
+                    neighborhoodSearch,
+                    geometry,
+                    agents,
+                    threadPool,
+                    scratch);
+                return;
+            case OperationalModelType::COLLISION_FREE_SPEED_V2:
+                run(static_cast<const CollisionFreeSpeedModelV2&>(*_model),
+                    dT,
+                    neighborhoodSearch,
+                    geometry,
+                    agents,
+                    threadPool,
+                    scratch);
+                return;
+            case OperationalModelType::SOCIAL_FORCE:
+                run(static_cast<const SocialForceModel&>(*_model),
+                    dT,
+                    neighborhoodSearch,
+                    geometry,
+                    agents,
+                    threadPool,
+                    scratch);
+                return;
+        }
+        UNREACHABLE();
     }
 
     void ValidateAgent(
@@ -67,4 +106,42 @@ public:
     {
         _model->CheckModelConstraint(agent, neighborhoodSearch, geometry);
     }
+
+private:
+    /// Computes and applies the updates of all agents with the concrete 'Model', without virtual
+    /// calls.
+    template <typename Model>
+    void
+    run(const Model& model,
+        double dT,
+        const NeighborhoodSearch<GenericAgent>& neighborhoodSearch,
+        const CollisionGeometry& geometry,
+        AgentStore& agents,
+        ThreadPool& threadPool,
+        std::vector<WorkerScratch>& scratch)
+    {
+        auto& updates = std::get<std::vector<typename Model::Update>>(_updates);
+        updates.resize(agents.Size());
+        // An agent has fewer neighbors than there are agents, so no worker has to grow its
+        // buffer while computing the updates.
+        for(auto& slot : scratch) {
+            slot.neighbors.reserve(agents.Size());
+        }
+
+        // Computing the new positions only reads the store, each update is written to its own
+        // slot and applied afterwards, hence the result does not depend on the number of threads.
+        threadPool.ParallelForWorkers(
+            agents.Size(),
+            [&model, dT, &geometry, &neighborhoodSearch, &agents, &updates, &scratch](
+                size_t worker, size_t begin, size_t end) {
+                for(size_t index = begin; index < end; ++index) {
+                    updates[index] = model.ComputeUpdate(
+                        dT, index, agents, geometry, neighborhoodSearch, scratch[worker]);
+                }
+            });
+
+        for(size_t index = 0; index < agents.Size(); ++index) {
+            model.Apply(updates[index], index, agents);
+        }
+    }
 };
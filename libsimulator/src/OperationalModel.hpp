@@ -6,7 +6,6 @@
 #include "CollisionGeometry.hpp"
 #include "GeneralizedCentrifugalForceModelData.hpp"
 #include "OperationalModelType.hpp"
-#include "OperationalModelUpdate.hpp"
 #include "Point.hpp"
 #include "SimulationError.hpp"
 #include "UniqueID.hpp"
@@ -84,13 +83,8 @@ public:
     virtual ~OperationalModel() = default;
 
     virtual OperationalModelType Type() const = 0;
-    virtual OperationalModelUpdate ComputeNewPosition(
-        double dT,
-        const GenericAgent& ped,
-        const CollisionGeometry& geometry,
-        const NeighborhoodSearch<GenericAgent>& neighborhoodSearch) const = 0;
-
-    virtual void ApplyUpdate(const OperationalModelUpdate& update, GenericAgent& agent) const = 0;
+    /// Radius in which the model considers neighboring agents.
+    virtual double NeighborhoodRadius() const = 0;
     virtual void CheckModelConstraint(
         const GenericAgent& agent,
         const NeighborhoodSearch<GenericAgent>& neighborhoodSearch,
@@ -0,0 +1,419 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "PolyanyaSearch.hpp"
+
+#include "SimulationError.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+constexpr size_t NO_ROOT = std::numeric_limits<size_t>::max();
+constexpr size_t NO_PARENT = std::numeric_limits<size_t>::max();
+// Tolerance when comparing the length of a path to a root with the shortest one known
+constexpr double ROOT_EPSILON = 1e-8;
+
+using SearchNode = PolyanyaSearch::Scratch::Node;
+
+/// > 0 if 'p' is counter clockwise of the ray from 'origin' through 'direction'
+double side(Point origin, Point direction, Point p)
+{
+    return (direction - origin).CrossProduct(p - origin);
+}
+
+/// Point between 'a' and 'b' on the ray that 'a' and 'b' are on different sides of
+Point intersection(Point a, Point b, double sideA, double sideB)
+{
+    return a + (b - a) * (sideA / (sideA - sideB));
+}
+
+/// Lower bound of the length of a path from 'root' through the interval to 'goal'
+double heuristic(Point root, Point left, Point right, Point goal)
+{
+    if(side(root, right, left) <= 0) {
+        return Distance(root, goal);
+    }
+    // A path to a goal on the same side of the interval as the root still has to pass the
+    // interval, mirror the goal to the other side.
+    const auto direction = right - left;
+    if(direction.CrossProduct(goal - left) < 0) {
+        const auto foot =
+            left + direction * ((goal - left).ScalarProduct(direction) / direction.NormSquare());
+        goal = foot * 2 - goal;
+    }
+    if(side(root, right, goal) < 0) {
+        return Distance(root, right) + Distance(right, goal);
+    }
+    if(side(root, left, goal) > 0) {
+        return Distance(root, left) + Distance(left, goal);
+    }
+    return Distance(root, goal);
+}
+} // namespace
+
+PolyanyaSearch::PolyanyaSearch(const Mesh& mesh)
+{
+    const auto vertexCount = mesh.CountVertices();
+    const auto polygonCount = mesh.CountPolygons();
+    _vertices.reserve(vertexCount);
+    for(size_t index = 0; index < vertexCount; ++index) {
+        const auto v = mesh.Vertex(index);
+        _vertices.emplace_back(v.x, v.y);
+    }
+
+    _edgeOffsets.reserve(polygonCount + 1);
+    _edgeOffsets.emplace_back(0);
+    for(size_t index = 0; index < polygonCount; ++index) {
+        const auto& polygon = mesh.Polygons(index);
+        for(size_t edge = 0; edge < polygon.vertices.size(); ++edge) {
+            const auto neighbor = polygon.neighbors[edge];
+            _edgeVertices.emplace_back(polygon.vertices[edge]);
+            _edgeNeighbors.emplace_back(
+                neighbor == index || neighbor >= polygonCount ? NO_INDEX : neighbor);
+        }
+        _edgeOffsets.emplace_back(_edgeVertices.size());
+    }
+
+    const auto edgeEnd = [this](size_t polygon, size_t edge) {
+        const auto next = edge + 1 == _edgeOffsets[polygon + 1] ? _edgeOffsets[polygon] : edge + 1;
+        return _edgeVertices[next];
+    };
+    const auto key = [vertexCount](size_t from, size_t to) { return from * vertexCount + to; };
+
+    std::unordered_map<size_t, size_t> edgeByVertices{};
+    edgeByVertices.reserve(_edgeVertices.size());
+    for(size_t polygon = 0; polygon < polygonCount; ++polygon) {
+        for(size_t edge = _edgeOffsets[polygon]; edge < _edgeOffsets[polygon + 1]; ++edge) {
+            edgeByVertices.emplace(key(_edgeVertices[edge], edgeEnd(polygon, edge)), edge);
+        }
+    }
+
+    _oppositeEdges.assign(_edgeVertices.size(), NO_INDEX);
+    _neighborCounts.assign(polygonCount, 0);
+    _corners.assign(vertexCount, 0);
+    for(size_t polygon = 0; polygon < polygonCount; ++polygon) {
+        for(size_t edge = _edgeOffsets[polygon]; edge < _edgeOffsets[polygon + 1]; ++edge) {
+            const auto from = _edgeVertices[edge];
+            const auto to = edgeEnd(polygon, edge);
+            if(_edgeNeighbors[edge] != NO_INDEX) {
+                const auto iter = edgeByVertices.find(key(to, from));
+                if(iter != std::end(edgeByVertices)) {
+                    _oppositeEdges[edge] = iter->second;
+                    ++_neighborCounts[polygon];
+                    continue;
+                }
+                _edgeNeighbors[edge] = NO_INDEX;
+            }
+            _corners[from] = 1;
+            _corners[to] = 1;
+        }
+    }
+    _blockedEdges.assign(_edgeVertices.size(), 0);
+    _blockedCorners.assign(vertexCount, 0);
+}
+
+void PolyanyaSearch::SetEdgeBlocked(size_t polygon, size_t from, size_t to, bool blocked)
+{
+    const auto count = edgeCount(polygon);
+    for(size_t index = 0; index < count; ++index) {
+        const auto edge = _edgeOffsets[polygon] + index;
+        const auto end = _edgeVertices[_edgeOffsets[polygon] + (index + 1) % count];
+        if(_edgeVertices[edge] != from || end != to) {
+            continue;
+        }
+        if((_blockedEdges[edge] != 0) == blocked) {
+            return;
+        }
+        _blockedEdges[edge] = blocked ? 1 : 0;
+        if(const auto opposite = _oppositeEdges[edge]; opposite != NO_INDEX) {
+            _blockedEdges[opposite] = _blockedEdges[edge];
+        }
+        for(const auto vertex : {from, to}) {
+            _blockedCorners[vertex] = blocked ? _blockedCorners[vertex] + 1
+                                              : _blockedCorners[vertex] - 1;
+        }
+        return;
+    }
+    throw SimulationError("Polygon {} has no edge from vertex {} to {}", polygon, from, to);
+}
+
+bool PolyanyaSearch::ShortestPath(
+    Point from,
+    size_t fromPolygon,
+    Point to,
+    size_t toPolygon,
+    std::vector<Point>& path,
+    Scratch& scratch,
+    bool passBlockedEdges) const
+{
+    path.clear();
+    if(fromPolygon == toPolygon) {
+        path.emplace_back(from);
+        path.emplace_back(to);
+        return true;
+    }
+
+    scratch.begin(_vertices.size(), _edgeOffsets.size() - 1);
+    auto& nodes = scratch.nodes;
+    scratch.startFanIn[fromPolygon] = scratch.generation;
+
+    const auto rootPoint = [this, from](size_t root) {
+        return root == NO_ROOT ? from : _vertices[root];
+    };
+
+    // Root level pruning, only the shortest path to a root is followed
+    const auto reachRoot = [&scratch](size_t root, double g) {
+        if(root == NO_ROOT) {
+            return true;
+        }
+        auto& distance = scratch.rootDistances[root];
+        if(scratch.rootReachedIn[root] != scratch.generation) {
+            scratch.rootReachedIn[root] = scratch.generation;
+            distance = g;
+            return true;
+        }
+        if(distance + ROOT_EPSILON < g) {
+            return false;
+        }
+        distance = std::min(distance, g);
+        return true;
+    };
+
+    const auto push = [&](const SearchNode& node) {
+        if(!reachRoot(node.root, node.g)) {
+            return;
+        }
+        const auto root = rootPoint(node.root);
+        const double h = node.polygon == NO_INDEX ? Distance(root, to)
+                                                  : heuristic(root, node.left, node.right, to);
+        nodes.emplace_back(node);
+        scratch.open.emplace_back(node.g + h, nodes.size() - 1);
+        std::push_heap(std::begin(scratch.open), std::end(scratch.open), std::greater<>{});
+    };
+
+    const auto pushInterval =
+        [&](size_t parent, size_t root, double g, size_t edge, Point right, Point left) {
+            if(right == left) {
+                return;
+            }
+            const auto neighbor = _edgeNeighbors[edge];
+            if(neighbor == NO_INDEX || (_blockedEdges[edge] != 0 && !passBlockedEdges)) {
+                return;
+            }
+            // Dead ends can only lead to the destination
+            if(_neighborCounts[neighbor] == 1 && neighbor != toPolygon) {
+                return;
+            }
+            push(SearchNode{left, right, root, neighbor, _oppositeEdges[edge], g, parent});
+        };
+
+    const auto pushDestination = [&](size_t parent, size_t root, double g) {
+        push(SearchNode{to, to, root, NO_INDEX, NO_INDEX, g, parent});
+    };
+
+    for(size_t index = 0; index < edgeCount(fromPolygon); ++index) {
+        pushInterval(
+            NO_PARENT,
+            NO_ROOT,
+            0,
+            _edgeOffsets[fromPolygon] + index,
+            vertex(fromPolygon, index),
+            vertex(fromPolygon, index + 1));
+    }
+
+    while(!scratch.open.empty()) {
+        std::pop_heap(std::begin(scratch.open), std::end(scratch.open), std::greater<>{});
+        const auto current = scratch.open.back().second;
+        scratch.open.pop_back();
+        // Copy, 'nodes' may grow while successors are generated
+        const auto node = nodes[current];
+
+        if(node.root != NO_ROOT &&
+           scratch.rootDistances[node.root] + ROOT_EPSILON < node.g) {
+            continue;
+        }
+
+        if(node.polygon == NO_INDEX) {
+            path.emplace_back(to);
+            size_t lastRoot = NO_ROOT;
+            for(size_t index = current; index != NO_PARENT; index = nodes[index].parent) {
+                if(const auto root = nodes[index].root; root != lastRoot && root != NO_ROOT) {
+                    path.emplace_back(_vertices[root]);
+                    lastRoot = root;
+                }
+            }
+            path.emplace_back(from);
+            std::reverse(std::begin(path), std::end(path));
+            return true;
+        }
+
+        const auto polygon = node.polygon;
+        const auto count = edgeCount(polygon);
+        const auto entry = node.edge - _edgeOffsets[polygon];
+        const auto root = rootPoint(node.root);
+        // The remaining edges of the polygon from right to left as seen from the root. Edge m
+        // runs from far vertex m to far vertex m + 1.
+        const auto farVertexIndex = [&](size_t m) {
+            return _edgeVertices[_edgeOffsets[polygon] + (entry + 1 + m) % count];
+        };
+        const auto farVertex = [&](size_t m) { return _vertices[farVertexIndex(m)]; };
+        const auto farEdge = [&](size_t m) {
+            return _edgeOffsets[polygon] + (entry + 1 + m) % count;
+        };
+
+        if(side(root, node.right, node.left) <= 0) {
+            // The root lies on the line of the interval. If the root is not on the interval, it
+            // is seen edge-on and paths pass its end closest to the root, this becomes the root.
+            // The whole polygon is visible from a root on the interval.
+            auto collinearRoot = node.root;
+            auto collinearRootPoint = root;
+            double g = node.g;
+            if((node.left - root).ScalarProduct(node.right - root) > 0) {
+                const bool rightIsCloser =
+                    (node.right - root).NormSquare() < (node.left - root).NormSquare();
+                const size_t m = rightIsCloser ? 0 : count - 1;
+                collinearRootPoint = rightIsCloser ? node.right : node.left;
+                if(collinearRootPoint != farVertex(m)) {
+                    continue;
+                }
+                collinearRoot = farVertexIndex(m);
+                g += Distance(root, collinearRootPoint);
+                if(!reachRoot(collinearRoot, g)) {
+                    continue;
+                }
+            }
+            if(polygon == toPolygon) {
+                pushDestination(current, collinearRoot, g);
+            }
+            for(size_t m = 0; m + 1 < count; ++m) {
+                const auto neighbor = _edgeNeighbors[farEdge(m)];
+                const bool aroundStart =
+                    collinearRoot == NO_ROOT && neighbor != NO_INDEX &&
+                    (farVertex(m) == collinearRootPoint || farVertex(m + 1) == collinearRootPoint);
+                if(aroundStart) {
+                    // The start is a vertex of the mesh, polygons around it can be entered over
+                    // edges in both directions. Enter each only once.
+                    if(scratch.startFanIn[neighbor] == scratch.generation) {
+                        continue;
+                    }
+                    scratch.startFanIn[neighbor] = scratch.generation;
+                }
+                pushInterval(current, collinearRoot, g, farEdge(m), farVertex(m), farVertex(m + 1));
+            }
+            continue;
+        }
+
+        // Find the edges the rays from the root through the ends of the interval leave the
+        // polygon on. The far vertices are sorted by angle as seen from the root.
+        size_t rightEdge = 0;
+        while(rightEdge + 2 < count && side(root, node.right, farVertex(rightEdge + 1)) <= 0) {
+            ++rightEdge;
+        }
+        size_t leftEdge = rightEdge;
+        while(leftEdge + 2 < count && side(root, node.left, farVertex(leftEdge + 1)) < 0) {
+            ++leftEdge;
+        }
+        Point rightExit{};
+        {
+            const double sideA = side(root, node.right, farVertex(rightEdge));
+            const double sideB = side(root, node.right, farVertex(rightEdge + 1));
+            rightExit = sideA >= 0 ? farVertex(rightEdge)
+                        : sideB <= 0
+                            ? farVertex(rightEdge + 1)
+                            : intersection(
+                                  farVertex(rightEdge), farVertex(rightEdge + 1), sideA, sideB);
+        }
+        Point leftExit{};
+        {
+            const double sideA = side(root, node.left, farVertex(leftEdge));
+            const double sideB = side(root, node.left, farVertex(leftEdge + 1));
+            leftExit = sideA >= 0 ? farVertex(leftEdge)
+                       : sideB <= 0
+                           ? farVertex(leftEdge + 1)
+                           : intersection(
+                                 farVertex(leftEdge), farVertex(leftEdge + 1), sideA, sideB);
+        }
+
+        const auto isCorner = [this, passBlockedEdges](size_t vertex) {
+            return _corners[vertex] != 0 || (!passBlockedEdges && _blockedCorners[vertex] != 0);
+        };
+        const bool turnRight = node.right == farVertex(0) && isCorner(farVertexIndex(0));
+        const bool turnLeft =
+            node.left == farVertex(count - 1) && isCorner(farVertexIndex(count - 1));
+
+        if(polygon == toPolygon) {
+            if(side(root, node.right, to) < 0) {
+                if(turnRight) {
+                    pushDestination(
+                        current, farVertexIndex(0), node.g + Distance(root, farVertex(0)));
+                }
+            } else if(side(root, node.left, to) > 0) {
+                if(turnLeft) {
+                    pushDestination(
+                        current,
+                        farVertexIndex(count - 1),
+                        node.g + Distance(root, farVertex(count - 1)));
+                }
+            } else {
+                pushDestination(current, node.root, node.g);
+            }
+        }
+
+        // Observable successors, the root stays the same
+        const auto direction = farVertex(rightEdge + 1) - farVertex(rightEdge);
+        const bool emptyCone =
+            leftEdge == rightEdge && (leftExit - rightExit).ScalarProduct(direction) <= 0;
+        for(size_t m = rightEdge; m <= leftEdge && !emptyCone; ++m) {
+            pushInterval(
+                current,
+                node.root,
+                node.g,
+                farEdge(m),
+                m == rightEdge ? rightExit : farVertex(m),
+                m == leftEdge ? leftExit : farVertex(m + 1));
+        }
+
+        // Non observable successors, the path turns at a corner at the end of the interval
+        if(turnRight) {
+            const auto corner = farVertexIndex(0);
+            const double g = node.g + Distance(root, farVertex(0));
+            for(size_t m = 0; m <= rightEdge; ++m) {
+                pushInterval(
+                    current,
+                    corner,
+                    g,
+                    farEdge(m),
+                    farVertex(m),
+                    m == rightEdge ? rightExit : farVertex(m + 1));
+            }
+        }
+        if(turnLeft) {
+            const auto corner = farVertexIndex(count - 1);
+            const double g = node.g + Distance(root, farVertex(count - 1));
+            for(size_t m = leftEdge; m + 1 < count; ++m) {
+                pushInterval(
+                    current,
+                    corner,
+                    g,
+                    farEdge(m),
+                    m == leftEdge ? leftExit : farVertex(m),
+                    farVertex(m + 1));
+            }
+        }
+    }
+    return false;
+}
+
+Point PolyanyaSearch::vertex(size_t polygon, size_t index) const
+{
+    const auto count = edgeCount(polygon);
+    return _vertices[_edgeVertices[_edgeOffsets[polygon] + index % count]];
+}
+
+size_t PolyanyaSearch::edgeCount(size_t polygon) const
+{
+    return _edgeOffsets[polygon + 1] - _edgeOffsets[polygon];
+}
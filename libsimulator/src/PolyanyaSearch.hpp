@@ -0,0 +1,123 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "Mesh.hpp"
+#include "Point.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/// Any-angle shortest paths over a mesh of convex polygons, see "Compromise-free Pathfinding on a
+/// Navigation Mesh" (Cui, Harabor, Grastien, 2017).
+///
+/// Search nodes are intervals on polygon edges together with the last turning point of the path
+/// leading to them (the root). All points of an interval are visible from its root. Expanding a
+/// node projects the interval through the polygon behind it, paths may only turn at vertices
+/// touching the boundary of the mesh. The first path to the destination taken from the open list
+/// is the shortest, no funnel pass is needed.
+///
+/// Searches do not modify the instance and may run concurrently.
+class PolyanyaSearch
+{
+    static constexpr size_t NO_INDEX = std::numeric_limits<size_t>::max();
+
+public:
+    /// Memory used by a search, consecutive searches with the same instance reuse it. Searches
+    /// running concurrently need separate instances.
+    struct Scratch {
+        struct Node {
+            // Interval as seen from the root looking into 'polygon'
+            Point left{};
+            Point right{};
+            // Vertex the path last turned at, NO_INDEX for the start of the search
+            size_t root{NO_INDEX};
+            // Polygon behind the interval, the destination is represented by nodes without a
+            // polygon
+            size_t polygon{};
+            // Edge of 'polygon' containing the interval
+            size_t edge{};
+            // Length of the path to the root
+            double g{};
+            size_t parent{NO_INDEX};
+        };
+
+        std::vector<Node> nodes{};
+        // Binary min-heap of (f-value, index into 'nodes')
+        std::vector<std::pair<double, size_t>> open{};
+        // Per vertex, length of the shortest known path to the vertex as root. Only valid if
+        // 'rootReachedIn' of the vertex equals 'generation'.
+        std::vector<double> rootDistances{};
+        std::vector<uint32_t> rootReachedIn{};
+        // Per polygon, equals 'generation' if the polygon has been entered around the start
+        std::vector<uint32_t> startFanIn{};
+        uint32_t generation{0};
+
+        void begin(size_t vertexCount, size_t polygonCount)
+        {
+            nodes.clear();
+            open.clear();
+            ++generation;
+            if(rootReachedIn.size() != vertexCount || startFanIn.size() != polygonCount ||
+               generation == 0) {
+                rootDistances.resize(vertexCount);
+                rootReachedIn.assign(vertexCount, 0);
+                startFanIn.assign(polygonCount, 0);
+                generation = 1;
+            }
+        }
+    };
+
+private:
+    std::vector<Point> _vertices{};
+    // Per vertex, 1 if the vertex touches the boundary of the mesh, only there paths can turn.
+    std::vector<uint8_t> _corners{};
+    // Edges of polygon p are [_edgeOffsets[p], _edgeOffsets[p + 1]), counter clockwise. Edge i
+    // runs from _edgeVertices[i] to the start of the next edge of the polygon.
+    std::vector<size_t> _edgeOffsets{};
+    std::vector<size_t> _edgeVertices{};
+    // Per edge, polygon on the other side or NO_INDEX
+    std::vector<size_t> _edgeNeighbors{};
+    // Per edge, the same edge as seen from the polygon on the other side
+    std::vector<size_t> _oppositeEdges{};
+    // Per polygon, number of edges with a neighbor
+    std::vector<uint32_t> _neighborCounts{};
+    // Per edge, 1 if the edge is blocked, i.e. acts like a boundary edge
+    std::vector<uint8_t> _blockedEdges{};
+    // Per vertex, number of blocked edges touching it, paths can turn at such vertices
+    std::vector<uint32_t> _blockedCorners{};
+
+public:
+    /// Copies all required data, 'mesh' is not referenced afterwards.
+    explicit PolyanyaSearch(const Mesh& mesh);
+    ~PolyanyaSearch() = default;
+    PolyanyaSearch(const PolyanyaSearch& other) = default;
+    PolyanyaSearch& operator=(const PolyanyaSearch& other) = default;
+    PolyanyaSearch(PolyanyaSearch&& other) = default;
+    PolyanyaSearch& operator=(PolyanyaSearch&& other) = default;
+
+    /// Computes the shortest path from 'from' in polygon 'fromPolygon' to 'to' in polygon
+    /// 'toPolygon'.
+    /// @param path receives 'from', all corners the path turns at and 'to'
+    /// @param scratch memory of the search, see 'Scratch'
+    /// @param passBlockedEdges if true, blocked edges are passed like any other edge
+    /// @return false if there is no path, 'path' is empty then
+    bool ShortestPath(
+        Point from,
+        size_t fromPolygon,
+        Point to,
+        size_t toPolygon,
+        std::vector<Point>& path,
+        Scratch& scratch,
+        bool passBlockedEdges = false) const;
+
+    /// Blocks or unblocks the edge from vertex 'from' to vertex 'to' of 'polygon' in both
+    /// directions. Paths do not cross blocked edges but may turn at their vertices.
+    void SetEdgeBlocked(size_t polygon, size_t from, size_t to, bool blocked);
+
+private:
+    Point vertex(size_t polygon, size_t index) const;
+    size_t edgeCount(size_t polygon) const;
+};
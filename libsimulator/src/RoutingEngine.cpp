@@ -24,10 +24,20 @@
 #include <CGAL/draw_triangulation_2.h>
 #include <CGAL/mark_domain_in_triangulation.h>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <functional>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <queue>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -37,7 +47,11 @@ RoutingEngine::RoutingEngine()
 {
 }
 
-RoutingEngine::RoutingEngine(const PolyWithHoles& poly)
+RoutingEngine::RoutingEngine(
+    const PolyWithHoles& poly,
+    RoutingBackend backend,
+    const std::vector<LineSegment>& doors)
+    : backend(backend)
 {
     cdt.insert_constraint(
         poly.outer_boundary().vertices_begin(), poly.outer_boundary().vertices_end(), true);
@@ -45,7 +59,27 @@ RoutingEngine::RoutingEngine(const PolyWithHoles& poly)
         cdt.insert_constraint(p.vertices_begin(), p.vertices_end(), true);
     }
     CGAL::mark_domain_in_triangulation(cdt);
+    if(!doors.empty()) {
+        insertDoors(doors);
+    }
     mesh = std::make_unique<Mesh>(cdt);
+    indexFaces();
+    findDoorEdges(doors);
+    if(backend == RoutingBackend::Polyanya) {
+        // Door edges must stay polygon edges to be blocked in the merged mesh
+        std::vector<std::pair<size_t, size_t>> fixedEdges{};
+        for(const auto& edges : doorEdges) {
+            for(const auto& [face, edge] : edges) {
+                const auto& vertices = mesh->Polygons(face).vertices;
+                fixedEdges.emplace_back(vertices[(edge + 1) % 3], vertices[(edge + 2) % 3]);
+            }
+        }
+        mergedMesh = mesh->Clone();
+        mergedMesh->MergeGreedy(fixedEdges);
+        polyanya = std::make_unique<PolyanyaSearch>(*mergedMesh);
+    } else {
+        buildHierarchy();
+    }
 }
 
 std::unique_ptr<RoutingEngine> RoutingEngine::Clone() const
@@ -53,52 +87,250 @@ std::unique_ptr<RoutingEngine> RoutingEngine::Clone() const
     auto clone = std::make_unique<RoutingEngine>();
     clone->cdt = cdt;
     clone->mesh = mesh->Clone();
+    clone->indexFaces();
+    clone->backend = backend;
+    if(mergedMesh) {
+        clone->mergedMesh = mergedMesh->Clone();
+        clone->polyanya = std::make_unique<PolyanyaSearch>(*polyanya);
+    }
+    if(hierarchy) {
+        clone->hierarchy = std::make_unique<RoutingHierarchy>(*hierarchy);
+    }
+    clone->doorEdges = doorEdges;
+    clone->doorClosed = doorClosed;
+    clone->closedDoorCount = closedDoorCount;
+    clone->closedDoorsOnEdge = closedDoorsOnEdge;
     return clone;
 }
 
-Point RoutingEngine::ComputeWaypoint(Point currentPosition, Point destination)
+namespace
+{
+// Per face of the stored triangulation: bits 0-2 mark constrained edges, bit 3 the domain
+constexpr uint8_t IN_DOMAIN_FLAG = 1 << 3;
+} // namespace
+
+void RoutingEngine::Write(BinaryWriter& writer) const
+{
+    writer.Write(backend);
+    // CGAL's binary triangulation format cannot be read back, the combinatorial structure is
+    // stored directly. The infinite vertex has index 0.
+    const auto& tds = cdt.tds();
+    std::unordered_map<CDT::Vertex_handle, uint32_t> vertexIndices{};
+    std::vector<Point> points{};
+    vertexIndices.emplace(cdt.infinite_vertex(), 0);
+    for(const auto& vertex : cdt.finite_vertex_handles()) {
+        vertexIndices.emplace(vertex, static_cast<uint32_t>(points.size() + 1));
+        points.emplace_back(vertex->point().x(), vertex->point().y());
+    }
+    std::unordered_map<CDT::Face_handle, uint32_t> allFaceIndices{};
+    for(const auto& face : cdt.all_face_handles()) {
+        allFaceIndices.emplace(face, static_cast<uint32_t>(allFaceIndices.size()));
+    }
+    std::vector<std::array<uint32_t, 6>> faceData{};
+    std::vector<uint8_t> faceFlags{};
+    faceData.reserve(allFaceIndices.size());
+    faceFlags.reserve(allFaceIndices.size());
+    for(const auto& face : cdt.all_face_handles()) {
+        std::array<uint32_t, 6> data{};
+        uint8_t flags = face->get_in_domain() ? IN_DOMAIN_FLAG : 0;
+        for(int index = 0; index < 3; ++index) {
+            data[index] = vertexIndices.at(face->vertex(index));
+            data[index + 3] = allFaceIndices.at(face->neighbor(index));
+            flags |= face->is_constrained(index) ? (1 << index) : 0;
+        }
+        faceData.push_back(data);
+        faceFlags.push_back(flags);
+    }
+    writer.Write(static_cast<int32_t>(tds.dimension()));
+    writer.Write(points);
+    writer.Write(faceData);
+    writer.Write(faceFlags);
+    mesh->Write(writer);
+    if(mergedMesh) {
+        mergedMesh->Write(writer);
+    }
+    writer.Write(static_cast<uint64_t>(doorEdges.size()));
+    for(const auto& edges : doorEdges) {
+        writer.Write(edges);
+    }
+    writer.Write(doorClosed);
+}
+
+std::unique_ptr<RoutingEngine> RoutingEngine::Read(BinaryReader& reader)
 {
-    return ComputeAllWaypoints(currentPosition, destination)[1];
+    auto engine = std::make_unique<RoutingEngine>();
+    engine->backend = reader.Read<RoutingBackend>();
+    if(engine->backend != RoutingBackend::Triangulation &&
+       engine->backend != RoutingBackend::Polyanya) {
+        throw SimulationError("Unknown routing backend in routing engine data");
+    }
+    const auto dimension = reader.Read<int32_t>();
+    const auto points = reader.ReadVector<Point>();
+    const auto faceData = reader.ReadVector<std::array<uint32_t, 6>>();
+    const auto faceFlags = reader.ReadVector<uint8_t>();
+    if(dimension != 2 || faceFlags.size() != faceData.size()) {
+        throw SimulationError("Inconsistent triangulation data");
+    }
+
+    auto& tds = engine->cdt.tds();
+    tds.clear();
+    tds.set_dimension(dimension);
+    std::vector<CDT::Vertex_handle> vertices{};
+    vertices.reserve(points.size() + 1);
+    vertices.push_back(tds.create_vertex());
+    engine->cdt.set_infinite_vertex(vertices.front());
+    for(const auto& p : points) {
+        vertices.push_back(tds.create_vertex());
+        vertices.back()->set_point({p.x, p.y});
+    }
+    std::vector<CDT::Face_handle> faces{};
+    faces.reserve(faceData.size());
+    for(size_t index = 0; index < faceData.size(); ++index) {
+        faces.push_back(tds.create_face());
+    }
+    for(size_t index = 0; index < faceData.size(); ++index) {
+        const auto& data = faceData[index];
+        auto& face = faces[index];
+        for(int corner = 0; corner < 3; ++corner) {
+            if(data[corner] >= vertices.size() || data[corner + 3] >= faces.size()) {
+                throw SimulationError("Inconsistent triangulation data");
+            }
+            face->set_vertex(corner, vertices[data[corner]]);
+            vertices[data[corner]]->set_face(face);
+            face->set_neighbor(corner, faces[data[corner + 3]]);
+            face->set_constraint(corner, (faceFlags[index] & (1 << corner)) != 0);
+        }
+        face->set_in_domain((faceFlags[index] & IN_DOMAIN_FLAG) != 0);
+    }
+    engine->mesh = Mesh::Read(reader);
+    engine->indexFaces();
+    // Faces are identified by their index in the mesh, the triangulation has to list them in the
+    // same order as when the mesh was built
+    const auto& mesh = *engine->mesh;
+    if(engine->faces.size() != mesh.CountPolygons()) {
+        throw SimulationError("Triangulation and mesh do not match");
+    }
+    for(size_t index = 0; index < engine->faces.size(); ++index) {
+        const auto& polygon = mesh.Polygons(index);
+        if(polygon.vertices.size() != 3) {
+            throw SimulationError("Triangulation and mesh do not match");
+        }
+        for(int corner = 0; corner < 3; ++corner) {
+            const auto& p = engine->faces[index]->vertex(corner)->point();
+            const auto v = mesh.Vertex(polygon.vertices[corner]);
+            if(p.x() != v.x || p.y() != v.y) {
+                throw SimulationError("Triangulation and mesh do not match");
+            }
+        }
+    }
+    if(engine->backend == RoutingBackend::Polyanya) {
+        engine->mergedMesh = Mesh::Read(reader);
+        engine->polyanya = std::make_unique<PolyanyaSearch>(*engine->mergedMesh);
+    } else {
+        engine->buildHierarchy();
+    }
+
+    const auto doorCount = reader.Read<uint64_t>();
+    for(uint64_t door = 0; door < doorCount; ++door) {
+        auto edges = reader.ReadVector<std::array<uint64_t, 2>>();
+        for(const auto& [face, edge] : edges) {
+            if(face >= engine->faces.size() || edge >= 3 ||
+               engine->faceNeighbors[face][edge] == NO_FACE) {
+                throw SimulationError("Inconsistent door data");
+            }
+        }
+        engine->doorEdges.push_back(std::move(edges));
+    }
+    const auto closed = reader.ReadVector<uint8_t>();
+    if(closed.size() != doorCount) {
+        throw SimulationError("Inconsistent door data");
+    }
+    engine->doorClosed.assign(doorCount, 0);
+    engine->closedDoorsOnEdge.assign(engine->faces.size(), {0, 0, 0});
+    for(size_t door = 0; door < closed.size(); ++door) {
+        engine->SetDoorClosed(door, closed[door] != 0);
+    }
+    return engine;
 }
 
+namespace
+{
+constexpr size_t NO_PARENT = std::numeric_limits<size_t>::max();
+
 struct SearchState {
     double g_value{};
     double h_value{};
-    CDT::Face_handle id{};
-    SearchState* parent{};
+    size_t face{};
+    size_t parent{NO_PARENT};
 
     double f_value() const { return g_value + h_value; }
-    bool parents_contain(CDT::Face_handle ancestor_id) const
+};
+
+/// Memory used by a single search. Every thread owns one instance, this keeps concurrent queries
+/// independent of each other and lets consecutive queries on a thread reuse allocated memory.
+struct SearchScratch {
+    // All states created during the search, states reference each other by index.
+    std::vector<SearchState> states{};
+    // Binary min-heap of (f-value, index into 'states'). A state whose g-value is lowered is
+    // pushed again, outdated entries are skipped when they are popped.
+    std::vector<std::pair<double, size_t>> open_states{};
+    // Indexed by face, a face has been reached / closed in the current search if the stored
+    // generation equals 'generation'. This avoids clearing per face data between searches.
+    std::vector<uint32_t> reached_in{};
+    std::vector<uint32_t> closed_in{};
+    // Indexed by face, index into 'states', only valid for reached faces
+    std::vector<size_t> state_of_face{};
+    uint32_t generation{0};
+    std::vector<CDT::Face_handle> path{};
+    // Indexed by region of the routing hierarchy, the search may only enter faces of regions
+    // whose stored generation equals 'generation'.
+    std::vector<uint32_t> region_allowed_in{};
+    std::vector<size_t> regions{};
+
+    void begin(size_t face_count)
     {
-        const SearchState* pivot = this;
-        while(pivot != nullptr) {
-            if(pivot->id == ancestor_id) {
-                return true;
-            }
-            pivot = pivot->parent;
+        states.clear();
+        open_states.clear();
+        path.clear();
+        ++generation;
+        if(reached_in.size() != face_count || generation == 0) {
+            reached_in.assign(face_count, 0);
+            closed_in.assign(face_count, 0);
+            state_of_face.resize(face_count);
+            region_allowed_in.assign(region_allowed_in.size(), 0);
+            generation = 1;
         }
-        return false;
     }
-    std::vector<CDT::Face_handle> path() const
+
+    void push(size_t state)
+    {
+        open_states.emplace_back(states[state].f_value(), state);
+        std::push_heap(std::begin(open_states), std::end(open_states), std::greater<>{});
+    }
+
+    std::pair<double, size_t> pop()
     {
-        std::vector<CDT::Face_handle> p{};
-        p.reserve(16);
-        const SearchState* pivot = this;
-        while(pivot != nullptr) {
-            p.emplace_back(pivot->id);
-            pivot = pivot->parent;
+        std::pop_heap(std::begin(open_states), std::end(open_states), std::greater<>{});
+        const auto top = open_states.back();
+        open_states.pop_back();
+        return top;
+    }
+
+    const std::vector<CDT::Face_handle>&
+    path_to(size_t state, const std::vector<CDT::Face_handle>& faces)
+    {
+        path.clear();
+        for(size_t pivot = state; pivot != NO_PARENT; pivot = states[pivot].parent) {
+            path.emplace_back(faces[states[pivot].face]);
         }
-        std::reverse(std::begin(p), std::end(p));
-        return p;
+        std::reverse(std::begin(path), std::end(path));
+        return path;
     }
 };
 
-bool CompareSearchStatesGt(
-    const std::shared_ptr<SearchState>& a,
-    const std::shared_ptr<SearchState>& b)
-{
-    return a->f_value() > b->f_value();
-}
+thread_local SearchScratch searchScratch{};
+// Used by the waypoint queries that are not given a scratch
+thread_local RoutingEngine::Scratch queryScratch{};
 
 double length_of_path(const std::vector<Point>& path)
 {
@@ -108,49 +340,180 @@ double length_of_path(const std::vector<Point>& path)
     }
     return segment_sum;
 }
+} // namespace
 
-std::vector<Point> RoutingEngine::ComputeAllWaypoints(Point currentPosition, Point destination)
+namespace
+{
+/// Simple stupid funnel algorithm, calls 'emit' for every corner of the shortest path through the
+/// faces in 'path' and finally for 'to'. Stops as soon as 'emit' returns false.
+template <typename Emit>
+void funnel(
+    const CDT& cdt,
+    Point from,
+    Point to,
+    const std::vector<CDT::Face_handle>& path,
+    Emit&& emit)
+{
+    // TODO(kkratz): Remove the 0.2m edge width adjustment and replace this with p[roper
+    // arc-paths from the "Efficient Triangulation-Based Pathfinding" publication
+    const size_t portalCount = path.size();
+
+    // This is the actual simple stupid funnel algorithm
+    auto apex = from;
+    auto portal_left = from;
+    auto portal_right = from;
+
+    size_t index_apex{0};
+    size_t index_left{0};
+    size_t index_right{0};
+
+    const auto get_edge = [&cdt](const auto& a, const auto& b) {
+        for(int idx = 0; idx < 3; ++idx) {
+            if(a->neighbor(idx) == b) {
+                const auto s = cdt.segment(a, idx);
+                const auto src = s.source();
+                const auto tgt = s.target();
+                return LineSegment{
+                    {CGAL::to_double(src.x()), CGAL::to_double(src.y())},
+                    {CGAL::to_double(tgt.x()), CGAL::to_double(tgt.y())}};
+            }
+        }
+        throw SimulationError("Internal Error");
+    };
+
+    for(size_t index_portal = 1; index_portal <= portalCount; ++index_portal) {
+        const auto portal = index_portal < portalCount
+                                ? get_edge(path[index_portal - 1], path[index_portal])
+                                : LineSegment(to, to);
+
+        const auto line_segment_left = portal.p2;
+        const auto line_segment_right = portal.p1;
+        const auto line_segment_direction = (line_segment_right - line_segment_left).Normalized();
+        const auto candidate_left = line_segment_left + (line_segment_direction * 0.2);
+        const auto candidate_right = line_segment_right - (line_segment_direction * 0.2);
+
+        if(triarea2d(apex, portal_right, candidate_right) <= 0.0) {
+            if(apex == portal_right || triarea2d(apex, portal_left, candidate_right) > 0.0) {
+                portal_right = candidate_right;
+                index_right = index_portal;
+            } else {
+                if(!emit(portal_left)) {
+                    return;
+                }
+                apex = portal_left;
+                index_apex = index_left;
+                portal_left = apex;
+                portal_right = apex;
+                index_left = index_apex;
+                index_right = index_apex;
+                index_portal = index_apex;
+                continue;
+            }
+        }
+        if(triarea2d(apex, portal_left, candidate_left) >= 0.0) {
+            if(apex == portal_left || triarea2d(apex, portal_right, candidate_left) < 0.0) {
+                portal_left = candidate_left;
+                index_left = index_portal;
+            } else {
+                if(!emit(portal_right)) {
+                    return;
+                }
+                apex = portal_right;
+                index_apex = index_right;
+                portal_left = apex;
+                portal_right = apex;
+                index_left = index_apex;
+                index_right = index_apex;
+                index_portal = index_apex;
+                continue;
+            }
+        }
+    }
+    emit(to);
+}
+} // namespace
+
+std::vector<Point>
+RoutingEngine::ComputeAllWaypoints(Point currentPosition, Point destination) const
+{
+    if(backend == RoutingBackend::Polyanya) {
+        std::vector<Point> path{};
+        polyanyaPath(
+            currentPosition, LocateFace(currentPosition), destination, path, queryScratch.polyanya);
+        return path;
+    }
+    auto path = searchPath(currentPosition, destination, false);
+    if(path.empty() && closedDoorCount > 0) {
+        // Lead through closed doors rather than nowhere, agents wait there until they open
+        path = searchPath(currentPosition, destination, true);
+    }
+    return path;
+}
+
+std::vector<Point>
+RoutingEngine::searchPath(Point currentPosition, Point destination, bool passClosedDoors) const
 {
     const auto from_pos = CDT::Point{currentPosition.x, currentPosition.y};
     const auto to_pos = CDT::Point{destination.x, destination.y};
-    const auto from = find_face(from_pos);
-    const auto to = find_face(to_pos);
+    const auto from = LocateFace(currentPosition);
+    const auto to = LocateFace(destination);
 
     if(from == to) {
         return std::vector<Point>{currentPosition, destination};
     }
 
-    using SearchStatePtr = std::shared_ptr<SearchState>;
+    auto& scratch = searchScratch;
+    scratch.begin(faces.size());
+    auto& states = scratch.states;
 
-    std::vector<SearchStatePtr> open_states{};
-    open_states.emplace_back(
-        new SearchState{0.0, Distance(currentPosition, destination), from, nullptr});
+    // The hierarchy does not pass closed doors
+    const bool restricted = hierarchy && !passClosedDoors &&
+                            hierarchy->RegionOf(from) != hierarchy->RegionOf(to);
+    if(restricted) {
+        if(!hierarchy->Corridor(currentPosition, from, destination, to, scratch.regions)) {
+            return {};
+        }
+        if(scratch.region_allowed_in.size() != hierarchy->CountRegions()) {
+            scratch.region_allowed_in.assign(hierarchy->CountRegions(), 0);
+        }
+        for(const auto region : scratch.regions) {
+            scratch.region_allowed_in[region] = scratch.generation;
+        }
+    }
 
-    std::map<CDT::Face_handle, SearchStatePtr> closed_states{};
+    states.emplace_back(SearchState{0.0, Distance(currentPosition, destination), from, NO_PARENT});
+    scratch.reached_in[from] = scratch.generation;
+    scratch.state_of_face[from] = 0;
+    scratch.push(0);
 
     std::vector<Point> path{};
     double path_length = std::numeric_limits<double>::infinity();
 
-    while(!open_states.empty()) {
-        std::make_heap(std::rbegin(open_states), std::rend(open_states), CompareSearchStatesGt);
-        auto current_state = open_states.back();
-        open_states.pop_back();
-        closed_states.insert(std::make_pair(current_state->id, current_state));
+    while(!scratch.open_states.empty()) {
+        const auto [f_value, current_index] = scratch.pop();
+        // Copy, 'states' may grow while successors are generated
+        const auto current_state = states[current_index];
+        if(scratch.closed_in[current_state.face] == scratch.generation ||
+           f_value > current_state.f_value()) {
+            // Outdated heap entry
+            continue;
+        }
+        scratch.closed_in[current_state.face] = scratch.generation;
 
-        if(current_state->id == to) {
+        if(current_state.face == to) {
             // Unlike in A* this is only a first candidate solution
             // Now compute the actual path length via funnel algorithm
             // store path and length if this variant is the shortest found so far
-            const auto vertex_ids = current_state->path();
-            const auto found_path = straightenPath(currentPosition, destination, vertex_ids);
+            const auto& vertex_ids = scratch.path_to(current_index, faces);
+            auto found_path = straightenPath(currentPosition, destination, vertex_ids);
             const double found_path_length = length_of_path(found_path);
             if(found_path_length < path_length) {
-                path = found_path;
+                path = std::move(found_path);
                 path_length = found_path_length;
             }
         }
 
-        if(current_state->f_value() >= path_length) {
+        if(current_state.f_value() >= path_length) {
             // This search nodes f-value already excedes our paths length, and since the f-value is
             // underestimation of the path length the excat path cannot be shorter than what we have
             return path;
@@ -158,22 +521,25 @@ std::vector<Point> RoutingEngine::ComputeAllWaypoints(Point currentPosition, Poi
 
         // Generate successors
         for(int idx = 0; idx < 3; ++idx) {
-            const auto target = current_state->id->neighbor(idx);
-            if(!target->get_in_domain()) {
+            const auto target = faceNeighbors[current_state.face][idx];
+            if(target == NO_FACE) {
                 // Not a neighboring triangle.
                 continue;
             }
-            // Do not add search nodes for nodes already in the ancestor list of this path
-            if(current_state->parents_contain(target)) {
+            if(!passClosedDoors && isBlocked(current_state.face, idx)) {
                 continue;
             }
-
-            // Skip successors for nodes already in the closed list
-            if(closed_states.contains(target)) {
+            // Skip successors for nodes already in the closed list, this includes all ancestors
+            // of the current node.
+            if(scratch.closed_in[target] == scratch.generation) {
+                continue;
+            }
+            if(restricted &&
+               scratch.region_allowed_in[hierarchy->RegionOf(target)] != scratch.generation) {
                 continue;
             }
 
-            const auto edge = cdt.segment(target, idx);
+            const auto edge = cdt.segment(faces[current_state.face], idx);
 
             // For all remaining nodes compute g/h values
             // The h-value is the distance between the goal and the closts point on the edge
@@ -197,44 +563,28 @@ std::vector<Point> RoutingEngine::ComputeAllWaypoints(Point currentPosition, Poi
             // by these edges. Thus, if the entry edges of the triangles corresponding to s′ and
             // s form an angle θ, this estimate is calculated as g(s) + rθ. NOTE: Right now this
             // is always g(s) + zero as we asume point size agents (for now)
-            const double g_value_2 = current_state->g_value + 0;
+            const double g_value_2 = current_state.g_value + 0;
 
             //  Another lower bound value for g(s′) is g(s)+(h(s)−h(s′)), or the parent state’s
             //  g-value plus the difference between its h-value and that of the child state.
             //  This is an underes- timate because the Euclidean distance metric used for the
             //  heuristic is consistent.
-            const double g_value_3 = current_state->g_value + current_state->h_value - h_value;
+            const double g_value_3 = current_state.g_value + current_state.h_value - h_value;
 
             const double g_value = std::max(g_value_1, std::max(g_value_2, g_value_3));
 
-            // NOTE(kkratz): Clang16 seems to be confused with capturing a structured binding
-            // and emits a warnign when capturing 'target' directly As of C++20 this SHOULD(TM)
-            // be valid code but see:
-            // https://stackoverflow.com/questions/46114214/lambda-implicit-capture-fails-with-variable-declared-from-structured-binding
-            auto t2 = target;
-
-            // TODO(kkratz): replace this find on unsorted vector with something with a better
-            // runtime
-            if(auto iter = std::find_if(
-                   std::begin(open_states),
-                   std::end(open_states),
-                   [t2](const auto& s) { return s->id == t2; });
-               iter != std::end(open_states)) {
-                if(auto& s = *iter; s->g_value > g_value) {
-                    s->g_value = g_value;
-                    s->parent = current_state.get();
-                }
-
-            } else if(auto iter = closed_states.find(target); iter != std::end(closed_states)) {
-                if(auto& [_, s] = *iter; s->g_value > g_value) {
-                    s->g_value = g_value;
-                    s->parent = current_state.get();
-                    open_states.push_back(s);
-                    closed_states.erase(s->id);
+            if(scratch.reached_in[target] == scratch.generation) {
+                const auto state_index = scratch.state_of_face[target];
+                if(auto& s = states[state_index]; s.g_value > g_value) {
+                    s.g_value = g_value;
+                    s.parent = current_index;
+                    scratch.push(state_index);
                 }
             } else {
-                open_states.emplace_back(
-                    new SearchState{g_value, h_value, target, current_state.get()});
+                scratch.reached_in[target] = scratch.generation;
+                scratch.state_of_face[target] = states.size();
+                states.emplace_back(SearchState{g_value, h_value, target, current_index});
+                scratch.push(states.size() - 1);
             }
         }
     }
@@ -242,10 +592,118 @@ std::vector<Point> RoutingEngine::ComputeAllWaypoints(Point currentPosition, Poi
     return path;
 }
 
+Point RoutingEngine::ComputeWaypoint(Point currentPosition, Point destination) const
+{
+    size_t currentFace = NO_FACE;
+    return ComputeWaypoint(currentPosition, destination, currentFace);
+}
+
+Point RoutingEngine::ComputeWaypoint(Point currentPosition, Point destination, size_t& currentFace)
+    const
+{
+    return ComputeWaypoint(currentPosition, destination, currentFace, queryScratch);
+}
+
+Point RoutingEngine::ComputeWaypoint(
+    Point currentPosition,
+    Point destination,
+    size_t& currentFace,
+    Scratch& scratch) const
+{
+    currentFace = LocateFace(currentPosition, currentFace);
+    if(backend == RoutingBackend::Polyanya) {
+        auto& path = scratch.path;
+        if(!polyanyaPath(currentPosition, currentFace, destination, path, scratch.polyanya)) {
+            throwNoPath(currentPosition, destination);
+        }
+        return path[1];
+    }
+
+    auto& corridor = scratch.corridor;
+    corridorTo(currentPosition, currentFace, destination, corridor);
+    if(corridor.size() == 1) {
+        return destination;
+    }
+    return firstWaypoint(currentPosition, destination, corridor);
+}
+
+void RoutingEngine::ComputeWaypoints(
+    Point currentPosition,
+    Point destination,
+    size_t& currentFace,
+    std::vector<Point>& waypoints) const
+{
+    ComputeWaypoints(currentPosition, destination, currentFace, waypoints, queryScratch);
+}
+
+void RoutingEngine::ComputeWaypoints(
+    Point currentPosition,
+    Point destination,
+    size_t& currentFace,
+    std::vector<Point>& waypoints,
+    Scratch& scratch) const
+{
+    currentFace = LocateFace(currentPosition, currentFace);
+    waypoints.clear();
+    if(backend == RoutingBackend::Polyanya) {
+        auto& path = scratch.path;
+        if(!polyanyaPath(currentPosition, currentFace, destination, path, scratch.polyanya)) {
+            throwNoPath(currentPosition, destination);
+        }
+        waypoints.insert(std::end(waypoints), std::next(std::begin(path)), std::end(path));
+        return;
+    }
+
+    auto& corridor = scratch.corridor;
+    corridorTo(currentPosition, currentFace, destination, corridor);
+    if(corridor.size() == 1) {
+        waypoints.emplace_back(destination);
+        return;
+    }
+    funnel(cdt, currentPosition, destination, corridor, [&waypoints](Point waypoint) {
+        waypoints.emplace_back(waypoint);
+        return true;
+    });
+}
+
+void RoutingEngine::ReserveScratch(Scratch& scratch) const
+{
+    // A corridor passes each face at most once, a path turns at each vertex at most once
+    scratch.corridor.reserve(faces.size());
+    if(backend == RoutingBackend::Polyanya) {
+        scratch.path.reserve(mergedMesh->CountVertices() + 2);
+    }
+}
+
+void RoutingEngine::corridorTo(
+    Point from,
+    size_t fromFace,
+    Point destination,
+    std::vector<CDT::Face_handle>& corridor) const
+{
+    corridor.clear();
+    withNavigationField(destination, [this, from, fromFace, destination, &corridor](
+                                         const NavigationField& field) {
+        size_t face = fromFace;
+        for(; face != field.destinationFace; face = field.next[face]) {
+            if(field.next[face] == NO_FACE) {
+                throwNoPath(from, destination);
+            }
+            corridor.emplace_back(faces[face]);
+        }
+        corridor.emplace_back(faces[face]);
+    });
+}
+
+void RoutingEngine::throwNoPath(Point from, Point to)
+{
+    throw SimulationError("No path from ({}, {}) to ({}, {})", from.x, from.y, to.x, to.y);
+}
+
 bool RoutingEngine::IsRoutable(Point p) const
 {
     try {
-        find_face({p.x, p.y});
+        LocateFace(p);
     } catch(const SimulationError&) {
         return false;
     }
@@ -256,100 +714,420 @@ void RoutingEngine::Update()
 {
 }
 
-CDT::Face_handle RoutingEngine::find_face(K::Point_2 p) const
+void RoutingEngine::ClearNavigationFields()
 {
-    const auto face = cdt.locate(p);
-    if(face == nullptr || cdt.is_infinite(face) || !face->get_in_domain()) {
-        throw SimulationError(
-            "Point ({}, {}) is outside of accessible area",
-            CGAL::to_double(p.x()),
-            CGAL::to_double(p.y()));
+    std::unique_lock lock(navigationFields->mutex);
+    navigationFields->fields.clear();
+}
+
+size_t RoutingEngine::CountNavigationFields() const
+{
+    std::shared_lock lock(navigationFields->mutex);
+    return navigationFields->fields.size();
+}
+
+void RoutingEngine::PrecomputeNavigationFields(
+    const std::vector<Point>& destinations,
+    ThreadPool& threadPool) const
+{
+    if(backend != RoutingBackend::Triangulation) {
+        return;
+    }
+    auto& cache = *navigationFields;
+    std::vector<Point> missing{};
+    {
+        std::shared_lock lock(cache.mutex);
+        std::copy_if(
+            std::begin(destinations),
+            std::end(destinations),
+            std::back_inserter(missing),
+            [&cache](const auto& destination) {
+                const auto iter = cache.fields.find(destination);
+                return iter == std::end(cache.fields) || !iter->second.pinned;
+            });
+    }
+    std::sort(std::begin(missing), std::end(missing));
+    missing.erase(std::unique(std::begin(missing), std::end(missing)), std::end(missing));
+
+    std::vector<NavigationField> built(missing.size());
+    threadPool.ParallelFor(missing.size(), [this, &missing, &built](size_t begin, size_t end) {
+        for(size_t index = begin; index < end; ++index) {
+            built[index] = buildNavigationField(missing[index]);
+        }
+    });
+    std::unique_lock lock(cache.mutex);
+    for(size_t index = 0; index < missing.size(); ++index) {
+        auto& slot = cache.fields[missing[index]];
+        slot.pinned = true;
+        // A field built on demand meanwhile is kept, one still being built is completed by the
+        // query building it
+        if(!slot.field && !slot.building.valid()) {
+            slot.field = std::make_unique<const NavigationField>(std::move(built[index]));
+        }
     }
-    return face;
 }
 
-std::vector<Point>
-RoutingEngine::straightenPath(Point from, Point to, const std::vector<CDT::Face_handle>& path)
+void RoutingEngine::indexFaces()
 {
-    // TODO(kkratz): Remove the 0.2m edge width adjustment and replace this with p[roper
-    // arc-paths from the "Efficient Triangulation-Based Pathfinding" publication
-    const size_t portalCount = path.size();
+    faces.clear();
+    faceIndices.clear();
+    for(const auto& face : cdt.finite_face_handles()) {
+        if(face->get_in_domain()) {
+            faceIndices.emplace(face, faces.size());
+            faces.emplace_back(face);
+        }
+    }
+    faceNeighbors.clear();
+    faceNeighbors.reserve(faces.size());
+    for(const auto& face : faces) {
+        auto& neighbors = faceNeighbors.emplace_back();
+        for(int idx = 0; idx < 3; ++idx) {
+            const auto neighbor = face->neighbor(idx);
+            neighbors[idx] = neighbor->get_in_domain() ? faceIndices.at(neighbor) : NO_FACE;
+        }
+    }
+}
 
-    // This is the actual simple stupid funnel algorithm
-    auto apex = from;
-    auto portal_left = from;
-    auto portal_right = from;
+namespace
+{
+/// Tolerance when matching edges of the triangulation with doors
+constexpr double DOOR_EPSILON = 1e-6;
 
-    size_t index_apex{0};
-    size_t index_left{0};
-    size_t index_right{0};
+bool onDoor(const LineSegment& door, const CDT::Point& p)
+{
+    return door.DistTo({p.x(), p.y()}) < DOOR_EPSILON;
+}
+} // namespace
+
+void RoutingEngine::insertDoors(const std::vector<LineSegment>& doors)
+{
+    // Any face inside the domain stays inside when the doors split it
+    std::optional<CDT::Point> seed{};
+    for(const auto& face : cdt.finite_face_handles()) {
+        if(face->get_in_domain()) {
+            seed = CGAL::centroid(
+                face->vertex(0)->point(), face->vertex(1)->point(), face->vertex(2)->point());
+            break;
+        }
+    }
+    for(const auto& door : doors) {
+        cdt.insert_constraint(CDT::Point{door.p1.x, door.p1.y}, CDT::Point{door.p2.x, door.p2.y});
+    }
+    if(!seed) {
+        return;
+    }
+
+    const auto isDoorEdge = [this, &doors](CDT::Face_handle face, int idx) {
+        const auto segment = cdt.segment(face, idx);
+        return std::any_of(std::begin(doors), std::end(doors), [&segment](const auto& door) {
+            return onDoor(door, segment.source()) && onDoor(door, segment.target());
+        });
+    };
 
-    const auto get_edge = [this](const auto& a, const auto& b) {
+    // Like 'mark_domain_in_triangulation' but the domain extends across doors
+    for(const auto& face : cdt.all_face_handles()) {
+        face->set_in_domain(false);
+    }
+    std::vector<CDT::Face_handle> queue{cdt.locate(*seed)};
+    queue.front()->set_in_domain(true);
+    while(!queue.empty()) {
+        const auto face = queue.back();
+        queue.pop_back();
         for(int idx = 0; idx < 3; ++idx) {
-            if(a->neighbor(idx) == b) {
-                const auto s = cdt.segment(a, idx);
-                const auto src = s.source();
-                const auto tgt = s.target();
-                return LineSegment{
-                    {CGAL::to_double(src.x()), CGAL::to_double(src.y())},
-                    {CGAL::to_double(tgt.x()), CGAL::to_double(tgt.y())}};
+            const auto neighbor = face->neighbor(idx);
+            if(cdt.is_infinite(neighbor) || neighbor->get_in_domain() ||
+               (face->is_constrained(idx) && !isDoorEdge(face, idx))) {
+                continue;
             }
+            neighbor->set_in_domain(true);
+            queue.push_back(neighbor);
         }
-        throw SimulationError("Internal Error");
-    };
+    }
+}
 
-    std::vector<Point> waypoints{from};
-    // This is an over estimation but IMO preferable to repeadted allocations.
-    // Ideally we replace this with something w.o. allocations
-    waypoints.reserve(path.size() + 1);
-    for(size_t index_portal = 1; index_portal <= portalCount; ++index_portal) {
-        const auto face_from = path[index_portal - 1];
-        const auto face_to = path[index_portal];
-        if(face_from->neighbor(0) == face_to) {
+void RoutingEngine::findDoorEdges(const std::vector<LineSegment>& doors)
+{
+    doorEdges.assign(doors.size(), {});
+    doorClosed.assign(doors.size(), 0);
+    closedDoorCount = 0;
+    closedDoorsOnEdge.assign(faces.size(), {0, 0, 0});
+    if(doors.empty()) {
+        return;
+    }
+    for(size_t index = 0; index < faces.size(); ++index) {
+        const auto& face = faces[index];
+        for(int idx = 0; idx < 3; ++idx) {
+            const auto neighbor = faceNeighbors[index][idx];
+            // Each edge is listed from the side of the face with the lower index
+            if(neighbor == NO_FACE || neighbor < index || !face->is_constrained(idx)) {
+                continue;
+            }
+            const auto segment = cdt.segment(face, idx);
+            for(size_t door = 0; door < doors.size(); ++door) {
+                if(onDoor(doors[door], segment.source()) && onDoor(doors[door], segment.target())) {
+                    doorEdges[door].push_back({index, static_cast<uint64_t>(idx)});
+                }
+            }
         }
+    }
+}
 
-        const auto portal =
-            index_portal < portalCount ? get_edge(face_from, face_to) : LineSegment(to, to);
+void RoutingEngine::SetDoorClosed(size_t door, bool closed)
+{
+    if(IsDoorClosed(door) == closed) {
+        return;
+    }
+    doorClosed[door] = closed ? 1 : 0;
+    closedDoorCount = closed ? closedDoorCount + 1 : closedDoorCount - 1;
 
-        const auto line_segment_left = portal.p2;
-        const auto line_segment_right = portal.p1;
-        const auto line_segment_direction = (line_segment_right - line_segment_left).Normalized();
-        const auto candidate_left = line_segment_left + (line_segment_direction * 0.2);
-        const auto candidate_right = line_segment_right - (line_segment_direction * 0.2);
+    // Edges that change between blocked and passable, overlapping doors share edges
+    std::vector<std::pair<size_t, size_t>> changed{};
+    for(const auto& [face, edge] : doorEdges[door]) {
+        const auto neighbor = faceNeighbors[face][edge];
+        const auto& back = faceNeighbors[neighbor];
+        const auto backEdge =
+            std::distance(std::begin(back), std::find(std::begin(back), std::end(back), face));
+        auto& count = closedDoorsOnEdge[face][edge];
+        count = closed ? count + 1 : count - 1;
+        closedDoorsOnEdge[neighbor][backEdge] = count;
+        if(count == (closed ? 1 : 0)) {
+            changed.emplace_back(face, edge);
+        }
+    }
 
-        if(triarea2d(apex, portal_right, candidate_right) <= 0.0) {
-            if(apex == portal_right || triarea2d(apex, portal_left, candidate_right) > 0.0) {
-                portal_right = candidate_right;
-                index_right = index_portal;
-            } else {
-                waypoints.emplace_back(portal_left);
-                apex = portal_left;
-                index_apex = index_left;
-                portal_left = apex;
-                portal_right = apex;
-                index_left = index_apex;
-                index_right = index_apex;
-                index_portal = index_apex;
+    if(hierarchy) {
+        hierarchy->SetEdgesBlocked(changed, closed);
+    }
+    if(polyanya) {
+        for(const auto& [face, edge] : changed) {
+            const auto& vertices = mesh->Polygons(face).vertices;
+            polyanya->SetEdgeBlocked(
+                mergedMesh->PolygonOfTriangle(face),
+                vertices[(edge + 1) % 3],
+                vertices[(edge + 2) % 3],
+                closed);
+        }
+    }
+    ClearNavigationFields();
+}
+
+bool RoutingEngine::IsDoorClosed(size_t door) const
+{
+    if(door >= doorEdges.size()) {
+        throw SimulationError(
+            "Unknown door {}, the routing engine has {} doors", door, doorEdges.size());
+    }
+    return doorClosed[door] != 0;
+}
+
+void RoutingEngine::buildHierarchy()
+{
+    std::vector<std::array<Point, 3>> edgeMidpoints{};
+    edgeMidpoints.reserve(faces.size());
+    for(const auto& face : faces) {
+        auto& midpoints = edgeMidpoints.emplace_back();
+        for(int idx = 0; idx < 3; ++idx) {
+            const auto edge = cdt.segment(face, idx);
+            midpoints[idx] = Point{
+                (edge.source().x() + edge.target().x()) / 2,
+                (edge.source().y() + edge.target().y()) / 2};
+        }
+    }
+    hierarchy = std::make_unique<RoutingHierarchy>(
+        faceNeighbors, std::move(edgeMidpoints), HIERARCHY_REGION_SIZE);
+}
+
+bool RoutingEngine::polyanyaPath(
+    Point from,
+    size_t fromFace,
+    Point to,
+    std::vector<Point>& path,
+    PolyanyaSearch::Scratch& scratch) const
+{
+    const auto fromPolygon = mergedMesh->PolygonOfTriangle(fromFace);
+    const auto toPolygon = mergedMesh->PolygonOfTriangle(LocateFace(to));
+    if(polyanya->ShortestPath(from, fromPolygon, to, toPolygon, path, scratch)) {
+        return true;
+    }
+    // Lead through closed doors rather than nowhere, agents wait there until they open
+    return closedDoorCount > 0 &&
+           polyanya->ShortestPath(from, fromPolygon, to, toPolygon, path, scratch, true);
+}
+
+size_t RoutingEngine::LocateFace(Point p, size_t hint) const
+{
+    // The faces of the unmerged mesh are the faces in 'faces' in the same order
+    const auto face = mesh->FindContainingPolygon({p.x, p.y}, hint);
+    if(face == Mesh::Polygon::InvalidIndex) {
+        throw SimulationError("Point ({}, {}) is outside of accessible area", p.x, p.y);
+    }
+    return face;
+}
+
+template <typename Fn>
+void RoutingEngine::withNavigationField(Point destination, Fn&& fn) const
+{
+    auto& cache = *navigationFields;
+    while(true) {
+        std::shared_future<void> building{};
+        {
+            // Fields are only evicted with the exclusive lock, 'fn' reads the field while the
+            // shared lock is held
+            std::shared_lock lock(cache.mutex);
+            if(const auto iter = cache.fields.find(destination); iter != std::end(cache.fields)) {
+                const auto& slot = iter->second;
+                if(slot.field) {
+                    const auto now = cache.clock.load(std::memory_order_relaxed);
+                    // Only write if it changed to not contend on the slot in every query
+                    if(slot.lastUse.load(std::memory_order_relaxed) != now) {
+                        slot.lastUse.store(now, std::memory_order_relaxed);
+                    }
+                    fn(*slot.field);
+                    return;
+                }
+                building = slot.building;
+            }
+        }
+        if(building.valid()) {
+            // Another query builds this field, rethrows if building failed
+            building.get();
+            continue;
+        }
+
+        std::promise<void> promise{};
+        {
+            std::unique_lock lock(cache.mutex);
+            const auto [iter, inserted] = cache.fields.try_emplace(destination);
+            if(!inserted) {
+                // Built or started by another query meanwhile
                 continue;
             }
+            iter->second.building = promise.get_future().share();
         }
-        if(triarea2d(apex, portal_left, candidate_left) >= 0.0) {
-            if(apex == portal_left || triarea2d(apex, portal_right, candidate_left) < 0.0) {
-                portal_left = candidate_left;
-                index_left = index_portal;
-            } else {
-                waypoints.emplace_back(portal_right);
-                apex = portal_right;
-                index_apex = index_right;
-                portal_left = apex;
-                portal_right = apex;
-                index_left = index_apex;
-                index_right = index_apex;
-                index_portal = index_apex;
+        std::unique_ptr<const NavigationField> field{};
+        try {
+            field = std::make_unique<const NavigationField>(buildNavigationField(destination));
+        } catch(...) {
+            promise.set_exception(std::current_exception());
+            std::unique_lock lock(cache.mutex);
+            cache.fields.erase(destination);
+            throw;
+        }
+        {
+            std::unique_lock lock(cache.mutex);
+            const auto maxFields = std::clamp(
+                CACHED_NAVIGATION_FIELD_FACES / std::max(faces.size(), size_t{1}),
+                MIN_CACHED_NAVIGATION_FIELDS,
+                MAX_CACHED_NAVIGATION_FIELDS);
+            evictNavigationFields(maxFields);
+            auto& slot = cache.fields.at(destination);
+            slot.field = std::move(field);
+            slot.building = {};
+            slot.lastUse.store(
+                cache.clock.fetch_add(1, std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        }
+        promise.set_value();
+    }
+}
+
+void RoutingEngine::evictNavigationFields(size_t maxFields) const
+{
+    auto& fields = navigationFields->fields;
+    const auto evictable = [](const auto& entry) {
+        return !entry.second.pinned && entry.second.field != nullptr;
+    };
+    auto count =
+        static_cast<size_t>(std::count_if(std::begin(fields), std::end(fields), evictable));
+    while(count >= maxFields) {
+        auto oldest = std::end(fields);
+        for(auto iter = std::begin(fields); iter != std::end(fields); ++iter) {
+            if(evictable(*iter) &&
+               (oldest == std::end(fields) ||
+                iter->second.lastUse.load(std::memory_order_relaxed) <
+                    oldest->second.lastUse.load(std::memory_order_relaxed))) {
+                oldest = iter;
+            }
+        }
+        fields.erase(oldest);
+        --count;
+    }
+}
+
+RoutingEngine::NavigationField RoutingEngine::buildNavigationField(Point destination) const
+{
+    NavigationField field{};
+    field.destinationFace = LocateFace(destination);
+    field.next.resize(faces.size(), NO_FACE);
+
+    // Dijkstra starting at the destination. The distance to a face is measured along the midpoints
+    // of the edges over which the faces on the way have been entered. Paths crossing fewer closed
+    // doors are preferred over shorter paths, faces only reachable through closed doors still
+    // lead towards them.
+    using Cost = std::pair<uint32_t, double>;
+    std::vector<Cost> costs(
+        faces.size(),
+        {std::numeric_limits<uint32_t>::max(), std::numeric_limits<double>::infinity()});
+    std::vector<Point> entryPoints(faces.size());
+    using QueueEntry = std::pair<Cost, size_t>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<>> queue{};
+
+    costs[field.destinationFace] = {0, 0};
+    entryPoints[field.destinationFace] = destination;
+    queue.emplace(costs[field.destinationFace], field.destinationFace);
+
+    while(!queue.empty()) {
+        const auto [cost, current] = queue.top();
+        queue.pop();
+        if(cost > costs[current]) {
+            continue;
+        }
+        const auto& face = faces[current];
+        for(int idx = 0; idx < 3; ++idx) {
+            const size_t neighborIndex = faceNeighbors[current][idx];
+            if(neighborIndex == NO_FACE) {
                 continue;
             }
+            const auto edge = cdt.segment(face, idx);
+            const Point midpoint{
+                (edge.source().x() + edge.target().x()) / 2,
+                (edge.source().y() + edge.target().y()) / 2};
+            const Cost candidate{
+                cost.first + (isBlocked(current, idx) ? 1 : 0),
+                cost.second + Distance(entryPoints[current], midpoint)};
+            if(candidate < costs[neighborIndex]) {
+                costs[neighborIndex] = candidate;
+                entryPoints[neighborIndex] = midpoint;
+                field.next[neighborIndex] = current;
+                queue.emplace(candidate, neighborIndex);
+            }
         }
     }
-    waypoints.emplace_back(to);
+    return field;
+}
+
+std::vector<Point>
+RoutingEngine::straightenPath(Point from, Point to, const std::vector<CDT::Face_handle>& path)
+    const
+{
+    std::vector<Point> waypoints{from};
+    // This is an over estimation but IMO preferable to repeadted allocations.
+    // Ideally we replace this with something w.o. allocations
+    waypoints.reserve(path.size() + 1);
+    funnel(cdt, from, to, path, [&waypoints](Point waypoint) {
+        waypoints.emplace_back(waypoint);
+        return true;
+    });
     return waypoints;
 }
+
+Point RoutingEngine::firstWaypoint(Point from, Point to, const std::vector<CDT::Face_handle>& path)
+    const
+{
+    Point waypoint{to};
+    funnel(cdt, from, to, path, [&waypoint](Point p) {
+        waypoint = p;
+        return false;
+    });
+    return waypoint;
+}
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "AABB.hpp"
+#include "BinaryStream.hpp"
 #include "CfgCgal.hpp"
 #include "Clonable.hpp"
 #include "Graph.hpp"
@@ -10,21 +11,125 @@
 #include "LineSegment.hpp"
 #include "Mesh.hpp"
 #include "Point.hpp"
+#include "PolyanyaSearch.hpp"
+#include "RoutingHierarchy.hpp"
+#include "ThreadPool.hpp"
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <map>
 #include <memory>
+#include <shared_mutex>
+#include <unordered_map>
 #include <vector>
 
 using LocationID = size_t;
 using Location = std::variant<Point, LocationID>;
 
+/// Path search used by the RoutingEngine.
+enum class RoutingBackend {
+    /// Search over the triangles of the CDT, paths are straightened with a funnel pass. Next
+    /// waypoints are looked up in navigation fields cached per destination.
+    Triangulation,
+    /// Polyanya any-angle search over the merged convex polygons of the mesh. Paths are optimal
+    /// and turn exactly at the corners of the geometry. Every query runs a search.
+    Polyanya
+};
+
 class RoutingEngine : public Clonable<RoutingEngine>
 {
+public:
+    /// Marks an unknown face in face hints, see 'ComputeWaypoint'.
+    static constexpr size_t NO_FACE = std::numeric_limits<size_t>::max();
+
+    /// Memory used by a waypoint query, consecutive queries with the same instance reuse it.
+    /// Queries running concurrently need separate instances, see 'ComputeWaypoint'.
+    struct Scratch {
+        /// Faces along the navigation field towards the destination
+        std::vector<CDT::Face_handle> corridor{};
+        /// Path found with RoutingBackend::Polyanya
+        std::vector<Point> path{};
+        PolyanyaSearch::Scratch polyanya{};
+    };
+
+private:
+    /// Number of faces per region of the routing hierarchy
+    static constexpr size_t HIERARCHY_REGION_SIZE = 64;
+
+    /// Shortest path tree over all faces of the accessible area towards a single destination.
+    struct NavigationField {
+        size_t destinationFace{NO_FACE};
+        /// Indexed by face, index of the next face on the way to the destination.
+        std::vector<size_t> next{};
+    };
+
+    /// Upper bound of the number of navigation fields built on demand that are kept, see
+    /// 'NavigationFieldCache'.
+    static constexpr size_t MAX_CACHED_NAVIGATION_FIELDS = 256;
+    static constexpr size_t MIN_CACHED_NAVIGATION_FIELDS = 16;
+    /// Upper bound of the number of faces of all navigation fields built on demand.
+    static constexpr size_t CACHED_NAVIGATION_FIELD_FACES = size_t{1} << 24;
+
+    struct NavigationFieldSlot {
+        /// Empty while the field is built
+        std::unique_ptr<const NavigationField> field{};
+        /// Valid while the field is built, queries for the destination wait for it
+        std::shared_future<void> building{};
+        /// Precomputed fields are never evicted
+        bool pinned{false};
+        /// Value of 'NavigationFieldCache::clock' when the field was used last, updated by
+        /// queries holding the shared lock
+        mutable std::atomic<uint64_t> lastUse{0};
+    };
+
+    /// Navigation fields by destination shared by all threads.
+    ///
+    /// Precomputed fields are kept until the cache is cleared. Fields of other destinations are
+    /// built on first use, when there are more of them than the cache holds the least recently
+    /// used one is evicted. Destinations that change with every query therefore do not let the
+    /// cache grow. Fields are built without holding the lock, so queries towards other
+    /// destinations are not blocked.
+    struct NavigationFieldCache {
+        std::shared_mutex mutex{};
+        std::map<Point, NavigationFieldSlot> fields{};
+        /// Advanced whenever a field is built on demand, approximates the order of use
+        std::atomic<uint64_t> clock{0};
+    };
+
     CDT cdt{};
     std::unique_ptr<Mesh> mesh{};
+    // All faces inside the accessible area
+    std::vector<CDT::Face_handle> faces{};
+    std::unordered_map<CDT::Face_handle, size_t> faceIndices{};
+    // Indexed by face, index of the neighbor across edge i or NO_FACE if it is not accessible
+    std::vector<std::array<size_t, 3>> faceNeighbors{};
+    std::unique_ptr<NavigationFieldCache> navigationFields{
+        std::make_unique<NavigationFieldCache>()};
+    RoutingBackend backend{RoutingBackend::Triangulation};
+    // Only used with RoutingBackend::Triangulation
+    std::unique_ptr<RoutingHierarchy> hierarchy{};
+    // Only used with RoutingBackend::Polyanya
+    std::unique_ptr<Mesh> mergedMesh{};
+    std::unique_ptr<PolyanyaSearch> polyanya{};
+    // Per door, the edges covering it as (face, edge) seen from one side
+    std::vector<std::vector<std::array<uint64_t, 2>>> doorEdges{};
+    std::vector<uint8_t> doorClosed{};
+    size_t closedDoorCount{0};
+    // Indexed by face and edge, number of closed doors covering the edge. Searches do not cross
+    // edges covered by a closed door unless there is no other path.
+    std::vector<std::array<uint16_t, 3>> closedDoorsOnEdge{};
 
 public:
     RoutingEngine();
-    explicit RoutingEngine(const PolyWithHoles& poly);
+    /// @param doors segments inside 'poly' that can be closed later, see 'SetDoorClosed'. The
+    /// triangulation is built with edges along the doors.
+    explicit RoutingEngine(
+        const PolyWithHoles& poly,
+        RoutingBackend backend = RoutingBackend::Triangulation,
+        const std::vector<LineSegment>& doors = {});
     ~RoutingEngine() override = default;
 
     RoutingEngine(const RoutingEngine& other) = delete;
@@ -34,15 +139,119 @@ public:
     RoutingEngine& operator=(RoutingEngine&& other) = default;
 
     std::unique_ptr<RoutingEngine> Clone() const override;
-    Point ComputeWaypoint(Point currentPosition, Point destination);
-    std::vector<Point> ComputeAllWaypoints(Point currentPosition, Point destination);
+    /// Stores the triangulation and the navigation meshes, see 'Read'. Cached navigation fields
+    /// are not stored.
+    void Write(BinaryWriter& writer) const;
+    /// Restores an engine stored with 'Write'. The triangulation and meshes are read as they
+    /// are, only the face index and the routing hierarchy are rebuilt.
+    static std::unique_ptr<RoutingEngine> Read(BinaryReader& reader);
+    /// Computes the next waypoint on the path from 'currentPosition' to 'destination'.
+    /// With RoutingBackend::Triangulation paths are looked up in a navigation field that is built
+    /// once per destination.
+    /// Routing queries do not modify the engine and may be issued concurrently.
+    Point ComputeWaypoint(Point currentPosition, Point destination) const;
+    /// Like 'ComputeWaypoint(currentPosition, destination)', 'currentFace' is the face
+    /// 'currentPosition' has been located in by the previous query of the same agent and receives
+    /// the face it is located in now. Locating a point starts with a walk from this face, pass
+    /// NO_FACE if it is unknown.
+    /// Queries without a 'scratch' argument use memory owned by the calling thread.
+    Point ComputeWaypoint(Point currentPosition, Point destination, size_t& currentFace) const;
+    Point ComputeWaypoint(
+        Point currentPosition,
+        Point destination,
+        size_t& currentFace,
+        Scratch& scratch) const;
+    /// Computes all waypoints after 'currentPosition' on the path to 'destination', the last one is
+    /// 'destination'. Uses the same paths as 'ComputeWaypoint', 'waypoints[0]' is its result.
+    /// @param currentFace see 'ComputeWaypoint'
+    /// @param waypoints receives the waypoints, its memory is reused
+    void ComputeWaypoints(
+        Point currentPosition,
+        Point destination,
+        size_t& currentFace,
+        std::vector<Point>& waypoints) const;
+    void ComputeWaypoints(
+        Point currentPosition,
+        Point destination,
+        size_t& currentFace,
+        std::vector<Point>& waypoints,
+        Scratch& scratch) const;
+    /// Reserves the memory of 'scratch' for the longest corridor and path of this engine. Queries
+    /// with 'scratch' then only allocate if a Polyanya search visits more nodes than any search
+    /// with it before.
+    void ReserveScratch(Scratch& scratch) const;
+    /// Computes all waypoints from 'currentPosition' to 'destination' with a dedicated search.
+    /// The search works on face indices and reuses per thread buffers, only the waypoint lists
+    /// of candidate paths are allocated. If the positions are in different regions of the
+    /// routing hierarchy only the faces of the regions on the path found in the hierarchy are
+    /// searched.
+    /// @return all waypoints including 'currentPosition' and 'destination' or an empty list if
+    /// there is no path
+    std::vector<Point> ComputeAllWaypoints(Point currentPosition, Point destination) const;
     bool IsRoutable(Point p) const;
+    /// Index of the face containing 'p', starting with a walk from face 'hint' if it is known.
+    /// Throws if 'p' is outside of the accessible area.
+    size_t LocateFace(Point p, size_t hint = NO_FACE) const;
     void Update();
+    /// Drops all cached navigation fields.
+    /// Must not be called while routing queries are issued.
+    void ClearNavigationFields();
+    /// Number of cached navigation fields, precomputed or built on demand.
+    size_t CountNavigationFields() const;
+    /// Builds the navigation fields for 'destinations' that are not cached yet on the threads of
+    /// 'threadPool', so that later queries towards them only look up the next face. These fields
+    /// are kept until the cache is cleared. Does nothing with RoutingBackend::Polyanya, which
+    /// searches on every query.
+    void PrecomputeNavigationFields(const std::vector<Point>& destinations, ThreadPool& threadPool)
+        const;
+    /// Opens or closes door 'door'. Paths avoid closed doors, if a destination can only be
+    /// reached through closed doors paths still lead through them. Only the routing data around
+    /// the door is updated, cached navigation fields are dropped.
+    /// Must not be called while routing queries are issued.
+    void SetDoorClosed(size_t door, bool closed);
+    bool IsDoorClosed(size_t door) const;
+    size_t CountDoors() const { return doorEdges.size(); }
 
     const Mesh* MeshData() const { return mesh.get(); };
+    RoutingBackend Backend() const { return backend; }
 
 private:
-    CDT::Face_handle find_face(K::Point_2) const;
+    void indexFaces();
+    void buildHierarchy();
+    /// Inserts the doors as constraints and marks the faces inside the domain again, doors do not
+    /// separate the domain like the boundary does.
+    void insertDoors(const std::vector<LineSegment>& doors);
+    /// Collects the edges covering each door, requires indexed faces.
+    void findDoorEdges(const std::vector<LineSegment>& doors);
+    bool isBlocked(size_t face, int edge) const { return closedDoorsOnEdge[face][edge] != 0; }
+    /// Search of 'ComputeAllWaypoints' with RoutingBackend::Triangulation.
+    /// @param passClosedDoors if true, edges covered by closed doors are passed
+    std::vector<Point>
+    searchPath(Point currentPosition, Point destination, bool passClosedDoors) const;
+    /// Runs the Polyanya search, see 'PolyanyaSearch::ShortestPath'.
+    bool polyanyaPath(
+        Point from,
+        size_t fromFace,
+        Point to,
+        std::vector<Point>& path,
+        PolyanyaSearch::Scratch& scratch) const;
+    /// Collects the faces along the navigation field from 'fromFace' to the face of
+    /// 'destination' in 'corridor'.
+    void corridorTo(
+        Point from,
+        size_t fromFace,
+        Point destination,
+        std::vector<CDT::Face_handle>& corridor) const;
+    [[noreturn]] static void throwNoPath(Point from, Point to);
+    /// Calls 'fn(const NavigationField&)' with the field towards 'destination', building it if
+    /// it is not cached. The field is only valid during the call.
+    template <typename Fn>
+    void withNavigationField(Point destination, Fn&& fn) const;
+    /// Evicts the least recently used fields that were built on demand until at most
+    /// 'maxFields' - 1 of them are left. Requires the exclusive lock of the cache.
+    void evictNavigationFields(size_t maxFields) const;
+    NavigationField buildNavigationField(Point destination) const;
     std::vector<Point>
-    straightenPath(Point from, Point to, const std::vector<CDT::Face_handle>& path);
+    straightenPath(Point from, Point to, const std::vector<CDT::Face_handle>& path) const;
+    Point firstWaypoint(Point from, Point to, const std::vector<CDT::Face_handle>& path) const;
 };
@@ -0,0 +1,389 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "RoutingHierarchy.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+using QueueEntry = std::pair<double, size_t>;
+
+void push(std::vector<QueueEntry>& heap, double priority, size_t index)
+{
+    heap.emplace_back(priority, index);
+    std::push_heap(std::begin(heap), std::end(heap), std::greater<>{});
+}
+
+QueueEntry pop(std::vector<QueueEntry>& heap)
+{
+    std::pop_heap(std::begin(heap), std::end(heap), std::greater<>{});
+    const auto top = heap.back();
+    heap.pop_back();
+    return top;
+}
+
+/// Memory of the searches of a single thread. Per face / portal data is valid if the stored
+/// generation equals the current one, this avoids clearing it between searches.
+struct HierarchyScratch {
+    // Dijkstra over the faces of a region
+    std::vector<uint32_t> faceReachedIn{};
+    std::vector<double> faceDistances{};
+    std::vector<Point> entryPoints{};
+    std::vector<QueueEntry> faceQueue{};
+    uint32_t faceGeneration{0};
+    // A* over the portals
+    std::vector<uint32_t> portalReachedIn{};
+    std::vector<uint32_t> portalClosedIn{};
+    std::vector<double> portalDistances{};
+    std::vector<size_t> parents{};
+    std::vector<double> startDistances{};
+    std::vector<double> goalDistances{};
+    std::vector<QueueEntry> portalQueue{};
+    uint32_t portalGeneration{0};
+
+    void beginFaces(size_t faceCount)
+    {
+        faceQueue.clear();
+        ++faceGeneration;
+        if(faceReachedIn.size() != faceCount || faceGeneration == 0) {
+            faceReachedIn.assign(faceCount, 0);
+            faceDistances.resize(faceCount);
+            entryPoints.resize(faceCount);
+            faceGeneration = 1;
+        }
+    }
+
+    void beginPortals(size_t portalCount)
+    {
+        portalQueue.clear();
+        ++portalGeneration;
+        if(portalReachedIn.size() != portalCount || portalGeneration == 0) {
+            portalReachedIn.assign(portalCount, 0);
+            portalClosedIn.assign(portalCount, 0);
+            portalDistances.resize(portalCount);
+            parents.resize(portalCount);
+            portalGeneration = 1;
+        }
+    }
+};
+
+thread_local HierarchyScratch hierarchyScratch{};
+} // namespace
+
+RoutingHierarchy::RoutingHierarchy(
+    std::vector<std::array<size_t, 3>> faceNeighbors,
+    std::vector<std::array<Point, 3>> edgeMidpoints,
+    size_t regionSize)
+    : _faceNeighbors(std::move(faceNeighbors))
+    , _edgeMidpoints(std::move(edgeMidpoints))
+    , _blockedEdges(_faceNeighbors.size(), 0)
+{
+    growRegions(std::max<size_t>(regionSize, 1));
+    findPortals();
+    computePortalDistances();
+}
+
+bool RoutingHierarchy::Corridor(
+    Point from,
+    size_t fromFace,
+    Point to,
+    size_t toFace,
+    std::vector<size_t>& regions) const
+{
+    regions.clear();
+    const auto fromRegion = _regionOfFace[fromFace];
+    const auto toRegion = _regionOfFace[toFace];
+    if(fromRegion == toRegion) {
+        regions.emplace_back(fromRegion);
+        return true;
+    }
+
+    auto& scratch = hierarchyScratch;
+    // Start and goal are connected to the portals of their regions, 'goalDistances' is measured
+    // from 'to' to the portals which is the same as from the portals to 'to'.
+    auto& startDistances = scratch.startDistances;
+    auto& goalDistances = scratch.goalDistances;
+    distancesToPortals(from, fromFace, startDistances);
+    distancesToPortals(to, toFace, goalDistances);
+    scratch.beginPortals(_portals.size());
+    const auto generation = scratch.portalGeneration;
+
+    // A* over the portals, the goal is the extra node 'goal'
+    const auto goal = _portals.size();
+    double goalDistance = INF;
+    size_t goalParent = NO_INDEX;
+    const auto relax = [&scratch, generation, to, this](
+                           size_t portal, double distance, size_t parent) {
+        if(scratch.portalReachedIn[portal] == generation &&
+           scratch.portalDistances[portal] <= distance) {
+            return;
+        }
+        scratch.portalReachedIn[portal] = generation;
+        scratch.portalDistances[portal] = distance;
+        scratch.parents[portal] = parent;
+        push(scratch.portalQueue, distance + Distance(_portals[portal].midpoint, to), portal);
+    };
+
+    for(size_t slot = 0; slot < startDistances.size(); ++slot) {
+        if(startDistances[slot] < INF) {
+            relax(
+                _regionPortals[_regionPortalOffsets[fromRegion] + slot],
+                startDistances[slot],
+                NO_INDEX);
+        }
+    }
+
+    while(!scratch.portalQueue.empty()) {
+        const auto [priority, current] = pop(scratch.portalQueue);
+        if(current == goal) {
+            break;
+        }
+        if(scratch.portalClosedIn[current] == generation) {
+            continue;
+        }
+        scratch.portalClosedIn[current] = generation;
+        const auto distance = scratch.portalDistances[current];
+        const auto& portal = _portals[current];
+        for(size_t side = 0; side < 2; ++side) {
+            const auto region = portal.regions[side];
+            const auto first = _regionPortalOffsets[region];
+            const auto count = _regionPortalOffsets[region + 1] - first;
+            const auto* row = &_distances[_distanceOffsets[region] + portal.slots[side] * count];
+            for(size_t slot = 0; slot < count; ++slot) {
+                const auto next = _regionPortals[first + slot];
+                if(row[slot] < INF && scratch.portalClosedIn[next] != generation) {
+                    relax(next, distance + row[slot], current);
+                }
+            }
+            if(region == toRegion && goalDistances[portal.slots[side]] < INF) {
+                const auto candidate = distance + goalDistances[portal.slots[side]];
+                if(candidate < goalDistance) {
+                    goalDistance = candidate;
+                    goalParent = current;
+                    push(scratch.portalQueue, candidate, goal);
+                }
+            }
+        }
+    }
+    if(goalParent == NO_INDEX) {
+        return false;
+    }
+
+    regions.emplace_back(fromRegion);
+    regions.emplace_back(toRegion);
+    for(auto portal = goalParent; portal != NO_INDEX; portal = scratch.parents[portal]) {
+        regions.emplace_back(_portals[portal].regions[0]);
+        regions.emplace_back(_portals[portal].regions[1]);
+    }
+    std::sort(std::begin(regions), std::end(regions));
+    regions.erase(std::unique(std::begin(regions), std::end(regions)), std::end(regions));
+    return true;
+}
+
+void RoutingHierarchy::SetEdgesBlocked(
+    const std::vector<std::pair<size_t, size_t>>& edges,
+    bool blocked)
+{
+    std::vector<size_t> regions{};
+    const auto setBlocked = [this, blocked, &regions](size_t face, size_t edge) {
+        const auto bit = static_cast<uint8_t>(1u << edge);
+        _blockedEdges[face] = blocked ? _blockedEdges[face] | bit : _blockedEdges[face] & ~bit;
+        regions.emplace_back(_regionOfFace[face]);
+    };
+    for(const auto& [face, edge] : edges) {
+        setBlocked(face, edge);
+        if(const auto neighbor = _faceNeighbors[face][edge]; neighbor != NO_INDEX) {
+            const auto& back = _faceNeighbors[neighbor];
+            setBlocked(
+                neighbor,
+                std::distance(std::begin(back), std::find(std::begin(back), std::end(back), face)));
+        }
+    }
+    std::sort(std::begin(regions), std::end(regions));
+    regions.erase(std::unique(std::begin(regions), std::end(regions)), std::end(regions));
+    for(const auto region : regions) {
+        computeRegionDistances(region);
+    }
+}
+
+void RoutingHierarchy::growRegions(size_t regionSize)
+{
+    // Breadth first growth keeps regions compact
+    _regionOfFace.assign(_faceNeighbors.size(), NO_INDEX);
+    size_t regionCount = 0;
+    std::vector<size_t> queue{};
+    for(size_t seed = 0; seed < _faceNeighbors.size(); ++seed) {
+        if(_regionOfFace[seed] != NO_INDEX) {
+            continue;
+        }
+        const auto region = regionCount++;
+        queue.clear();
+        queue.emplace_back(seed);
+        _regionOfFace[seed] = region;
+        for(size_t head = 0; head < queue.size(); ++head) {
+            for(const auto neighbor : _faceNeighbors[queue[head]]) {
+                if(neighbor != NO_INDEX && _regionOfFace[neighbor] == NO_INDEX &&
+                   queue.size() < regionSize) {
+                    _regionOfFace[neighbor] = region;
+                    queue.emplace_back(neighbor);
+                }
+            }
+        }
+    }
+    _regionPortalOffsets.assign(regionCount + 1, 0);
+}
+
+void RoutingHierarchy::findPortals()
+{
+    _portalOfEdge.assign(_faceNeighbors.size(), {NO_INDEX, NO_INDEX, NO_INDEX});
+    for(size_t face = 0; face < _faceNeighbors.size(); ++face) {
+        for(size_t edge = 0; edge < 3; ++edge) {
+            const auto neighbor = _faceNeighbors[face][edge];
+            if(neighbor == NO_INDEX || neighbor < face ||
+               _regionOfFace[neighbor] == _regionOfFace[face]) {
+                continue;
+            }
+            const auto& back = _faceNeighbors[neighbor];
+            const auto backEdge = std::distance(
+                std::begin(back), std::find(std::begin(back), std::end(back), face));
+            _portalOfEdge[face][edge] = _portals.size();
+            _portalOfEdge[neighbor][backEdge] = _portals.size();
+            _portals.push_back(
+                {_edgeMidpoints[face][edge],
+                 {_regionOfFace[face], _regionOfFace[neighbor]},
+                 {NO_INDEX, NO_INDEX}});
+        }
+    }
+
+    // Sort the portals by region, a portal is listed by both of its regions
+    for(const auto& portal : _portals) {
+        ++_regionPortalOffsets[portal.regions[0] + 1];
+        ++_regionPortalOffsets[portal.regions[1] + 1];
+    }
+    std::partial_sum(
+        std::begin(_regionPortalOffsets),
+        std::end(_regionPortalOffsets),
+        std::begin(_regionPortalOffsets));
+    _regionPortals.resize(_regionPortalOffsets.back());
+    std::vector<size_t> counts(CountRegions(), 0);
+    for(size_t index = 0; index < _portals.size(); ++index) {
+        auto& portal = _portals[index];
+        for(size_t side = 0; side < 2; ++side) {
+            const auto region = portal.regions[side];
+            portal.slots[side] = counts[region]++;
+            _regionPortals[_regionPortalOffsets[region] + portal.slots[side]] = index;
+        }
+    }
+}
+
+void RoutingHierarchy::computePortalDistances()
+{
+    _distanceOffsets.resize(CountRegions());
+    size_t size = 0;
+    for(size_t region = 0; region < CountRegions(); ++region) {
+        const auto count = _regionPortalOffsets[region + 1] - _regionPortalOffsets[region];
+        _distanceOffsets[region] = size;
+        size += count * count;
+    }
+    _distances.assign(size, INF);
+
+    // Faces on the region side of each portal
+    _portalFaces.assign(_portals.size(), {NO_INDEX, NO_INDEX});
+    for(size_t face = 0; face < _faceNeighbors.size(); ++face) {
+        for(const auto portal : _portalOfEdge[face]) {
+            if(portal != NO_INDEX) {
+                const auto side = _portals[portal].regions[0] == _regionOfFace[face] ? 0 : 1;
+                _portalFaces[portal][side] = face;
+            }
+        }
+    }
+
+    for(size_t region = 0; region < CountRegions(); ++region) {
+        computeRegionDistances(region);
+    }
+}
+
+void RoutingHierarchy::computeRegionDistances(size_t region)
+{
+    std::vector<double> distances{};
+    const auto first = _regionPortalOffsets[region];
+    const auto count = _regionPortalOffsets[region + 1] - first;
+    for(size_t slot = 0; slot < count; ++slot) {
+        const auto portal = _regionPortals[first + slot];
+        const auto side = _portals[portal].regions[0] == region ? 0 : 1;
+        const auto face = _portalFaces[portal][side];
+        const auto& portals = _portalOfEdge[face];
+        const auto edge = std::distance(
+            std::begin(portals), std::find(std::begin(portals), std::end(portals), portal));
+        if((_blockedEdges[face] & (1u << edge)) != 0) {
+            // Blocked portals cannot be passed, they are not connected to the other portals
+            distances.assign(count, INF);
+        } else {
+            distancesToPortals(_portals[portal].midpoint, face, distances);
+        }
+        std::copy(
+            std::begin(distances),
+            std::end(distances),
+            std::begin(_distances) + _distanceOffsets[region] + slot * count);
+    }
+}
+
+void RoutingHierarchy::distancesToPortals(
+    Point start,
+    size_t startFace,
+    std::vector<double>& distances) const
+{
+    const auto region = _regionOfFace[startFace];
+    const auto first = _regionPortalOffsets[region];
+    distances.assign(_regionPortalOffsets[region + 1] - first, INF);
+
+    // Dijkstra like in the navigation fields of the RoutingEngine
+    auto& scratch = hierarchyScratch;
+    scratch.beginFaces(_faceNeighbors.size());
+    const auto generation = scratch.faceGeneration;
+    auto& queue = scratch.faceQueue;
+    scratch.faceReachedIn[startFace] = generation;
+    scratch.faceDistances[startFace] = 0;
+    scratch.entryPoints[startFace] = start;
+    push(queue, 0, startFace);
+
+    while(!queue.empty()) {
+        const auto [distance, face] = pop(queue);
+        if(distance > scratch.faceDistances[face]) {
+            continue;
+        }
+        for(size_t edge = 0; edge < 3; ++edge) {
+            if((_blockedEdges[face] & (1u << edge)) != 0) {
+                continue;
+            }
+            const auto candidate =
+                distance + Distance(scratch.entryPoints[face], _edgeMidpoints[face][edge]);
+            if(const auto portal = _portalOfEdge[face][edge]; portal != NO_INDEX) {
+                const auto& p = _portals[portal];
+                auto& known = distances[p.regions[0] == region ? p.slots[0] : p.slots[1]];
+                known = std::min(known, candidate);
+                continue;
+            }
+            const auto neighbor = _faceNeighbors[face][edge];
+            if(neighbor == NO_INDEX) {
+                continue;
+            }
+            if(scratch.faceReachedIn[neighbor] != generation ||
+               candidate < scratch.faceDistances[neighbor]) {
+                scratch.faceReachedIn[neighbor] = generation;
+                scratch.faceDistances[neighbor] = candidate;
+                scratch.entryPoints[neighbor] = _edgeMidpoints[face][edge];
+                push(queue, candidate, neighbor);
+            }
+        }
+    }
+}
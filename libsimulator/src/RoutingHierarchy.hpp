@@ -0,0 +1,96 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "Point.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/// Abstraction of the faces of a navigation mesh for long distance queries, see "Near Optimal
+/// Hierarchical Path-Finding" (Botea, Müller, Schaeffer, 2004).
+///
+/// Faces are grouped into regions of connected faces. Edges between faces of different regions
+/// are portals, the distances between all portals of a region are precomputed. A query searches
+/// the graph of portals instead of the faces and yields the regions an approximately shortest
+/// path passes. The exact path is then searched among the faces of these regions only.
+///
+/// Distances are measured along the midpoints of the edges a path crosses, like in the navigation
+/// fields of the RoutingEngine. Queries do not modify the instance and may run concurrently.
+class RoutingHierarchy
+{
+public:
+    static constexpr size_t NO_INDEX = std::numeric_limits<size_t>::max();
+
+private:
+    struct Portal {
+        Point midpoint{};
+        /// Regions on both sides of the portal
+        std::array<size_t, 2> regions{};
+        /// Index of the portal in the portal list of regions[0] / regions[1]
+        std::array<size_t, 2> slots{};
+    };
+
+    std::vector<std::array<size_t, 3>> _faceNeighbors{};
+    std::vector<std::array<Point, 3>> _edgeMidpoints{};
+    std::vector<size_t> _regionOfFace{};
+    // Per face, bit i is set if edge i is blocked
+    std::vector<uint8_t> _blockedEdges{};
+    // Per face and edge, the portal on this edge or NO_INDEX
+    std::vector<std::array<size_t, 3>> _portalOfEdge{};
+    std::vector<Portal> _portals{};
+    // Per portal, the faces on both sides in the order of Portal::regions
+    std::vector<std::array<size_t, 2>> _portalFaces{};
+    // Portals of region r are _regionPortals[_regionPortalOffsets[r], _regionPortalOffsets[r + 1])
+    std::vector<size_t> _regionPortalOffsets{};
+    std::vector<size_t> _regionPortals{};
+    // Distances between the n portals of region r as n x n matrix starting at _distanceOffsets[r]
+    std::vector<size_t> _distanceOffsets{};
+    std::vector<double> _distances{};
+
+public:
+    /// @param faceNeighbors per face, index of the neighbor across edge i or NO_INDEX
+    /// @param edgeMidpoints per face, midpoint of edge i
+    /// @param regionSize number of faces a region grows to
+    RoutingHierarchy(
+        std::vector<std::array<size_t, 3>> faceNeighbors,
+        std::vector<std::array<Point, 3>> edgeMidpoints,
+        size_t regionSize);
+    ~RoutingHierarchy() = default;
+    RoutingHierarchy(const RoutingHierarchy& other) = default;
+    RoutingHierarchy& operator=(const RoutingHierarchy& other) = default;
+    RoutingHierarchy(RoutingHierarchy&& other) = default;
+    RoutingHierarchy& operator=(RoutingHierarchy&& other) = default;
+
+    size_t RegionOf(size_t face) const { return _regionOfFace[face]; }
+    size_t CountRegions() const { return _regionPortalOffsets.size() - 1; }
+
+    /// Computes the regions the path from 'from' in face 'fromFace' to 'to' in face 'toFace'
+    /// passes on the graph of portals.
+    /// @param regions receives the regions, each region at most once
+    /// @return false if there is no path, 'regions' is empty then
+    bool Corridor(
+        Point from,
+        size_t fromFace,
+        Point to,
+        size_t toFace,
+        std::vector<size_t>& regions) const;
+
+    /// Blocks or unblocks the given edges, both as (face, edge) pair, in both directions. Paths do
+    /// not cross blocked edges. Only the portal distances of the affected regions are recomputed.
+    void SetEdgesBlocked(const std::vector<std::pair<size_t, size_t>>& edges, bool blocked);
+
+private:
+    void growRegions(size_t regionSize);
+    void findPortals();
+    void computePortalDistances();
+    void computeRegionDistances(size_t region);
+    /// Distances from 'start' in face 'startFace' to all portals of the region of 'startFace',
+    /// paths do not leave this region.
+    /// @param distances receives the distances indexed by slot, infinity if not reachable
+    void distancesToPortals(Point start, size_t startFace, std::vector<double>& distances) const;
+};
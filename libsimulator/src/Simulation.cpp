@@ -1,33 +1,54 @@
 // Copyright © 2012-2024 Forschungszentrum Jülich GmbH
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #include "Simulation.hpp"
+#include "AABB.hpp"
 #include "CollisionGeometry.hpp"
 #include "GenericAgent.hpp"
 #include "GeometrySwitchError.hpp"
 #include "IteratorPair.hpp"
+#include "LineSegment.hpp"
 #include "OperationalModel.hpp"
 #include "Stage.hpp"
 #include "Visitor.hpp"
 
+#include <iterator>
 #include <memory>
 #include <variant>
 
 Simulation::Simulation(
     std::unique_ptr<OperationalModel>&& operationalModel,
     std::unique_ptr<CollisionGeometry>&& geometry,
-    double dT)
-    : _clock(dT), _operationalDecisionSystem(std::move(operationalModel))
-{
-    const auto p = geometry->Polygon();
-    const auto& [tup, res] = geometries.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(geometry->Id()),
-        std::forward_as_tuple(std::move(geometry), std::make_unique<RoutingEngine>(p)));
-    if(!res) {
-        throw SimulationError("Internal error");
+    double dT,
+    const SimulationOptions& options)
+    : _clock(dT)
+    , _tacticalDecisionSystem(options.routingRefreshInterval)
+    , _operationalDecisionSystem(std::move(operationalModel))
+    , _neighborhoodSearch(2.2, options.neighborhoodSearchBackend)
+    , _threadPool(options.threadCount)
+    , _workerScratch(_threadPool.ThreadCount())
+    , _wallDistanceFieldResolution(options.wallDistanceFieldResolution)
+    , _routingBackend(options.routingBackend)
+    , _precomputeRoutingTables(options.precomputeRoutingTables)
+{
+    if(options.neighborListSkin < 0) {
+        throw SimulationError(
+            "Neighbor list skin needs to be >= 0, got {}", options.neighborListSkin);
+    }
+    if(options.wallDistanceFieldResolution < 0) {
+        throw SimulationError(
+            "Wall distance field resolution needs to be >= 0, got {}",
+            options.wallDistanceFieldResolution);
+    }
+    useGeometry(*geometry);
+    _neighborhoodSearch.SetBounds(AABB(std::get<0>(_geometry->AccessibleArea())));
+    if(options.neighborListSkin > 0) {
+        _neighborhoodSearch.EnableNeighborLists(
+            _operationalDecisionSystem.NeighborhoodRadius(),
+            options.neighborListSkin,
+            [this](Point from, Point to, double distance) {
+                return _geometry->HasClearance(LineSegment(from, to), distance);
+            });
     }
-    _geometry = std::get<0>(tup->second).get();
-    _routingEngine = std::get<1>(tup->second).get();
 }
 const SimulationClock& Simulation::Clock() const
 {
@@ -48,16 +69,31 @@ void Simulation::Iterate()
 {
     // LOG_DEBUG("Iteration {} / Time {}s", _clock.Iteration(), _clock.ElapsedTime());
     auto t = _perfStats.TraceIterate();
-    _agentRemovalSystem.Run(_agents, _removedAgentsInLastIteration, _stageManager);
-    _neighborhoodSearch.Update(_agents);
+    _agentRemovalSystem.Run(
+        _agents, _agentStore, _removedAgentsInLastIteration, _stageManager, _agentSlots);
+    if(_neighborhoodSearch.UpdateAndReorder(_agents)) {
+        _agentStore.Reorder(_neighborhoodSearch.ReorderedIndices());
+        _agentSlots.Reindex(_agents);
+    }
 
     _stageSystem.Run(_stageManager, _neighborhoodSearch, *_geometry);
     _stategicalDecisionSystem.Run(_journeys, _agents, _stageManager);
-    _tacticalDecisionSystem.Run(*_routingEngine, _agents);
+    _tacticalDecisionSystem.Run(
+        *_routingEngine,
+        _agents,
+        std::begin(_agentStore.Destinations()),
+        _threadPool,
+        _workerScratch);
     {
         auto t2 = _perfStats.TraceOperationalDecisionSystemRun();
         _operationalDecisionSystem.Run(
-            _clock.dT(), _clock.ElapsedTime(), _neighborhoodSearch, *_geometry, _agents);
+            _clock.dT(),
+            _clock.ElapsedTime(),
+            _neighborhoodSearch,
+            *_geometry,
+            _agentStore,
+            _threadPool,
+            _workerScratch);
     }
     _clock.Advance();
 }
@@ -132,6 +168,7 @@ Journey::ID Simulation::AddJourney(const std::map<BaseStage::ID, TransitionDescr
         });
 
     auto journey = std::make_unique<Journey>(std::move(nodes));
+    precomputeRoutingTables({journey.get()});
     const auto id = journey->Id();
     _journeys.emplace(id, std::move(journey));
     return id;
@@ -193,43 +230,75 @@ GenericAgent::ID Simulation::AddAgent(GenericAgent&& agent)
     }
     _stageManager.HandleNewAgent(agent.stageId);
     _agents.emplace_back(std::move(agent));
-    _neighborhoodSearch.AddAgent(_agents.back());
+    _agentStore.PushBack();
+    _agentSlots.Insert(_agents.back().id, _agents.size() - 1);
+    _neighborhoodSearch.AddAgent(_agents, _agents.size() - 1);
 
     auto v = IteratorPair(std::prev(std::end(_agents)), std::end(_agents));
     _stategicalDecisionSystem.Run(_journeys, v, _stageManager);
-    _tacticalDecisionSystem.Run(*_routingEngine, v);
+    _tacticalDecisionSystem.Run(
+        *_routingEngine,
+        v,
+        std::prev(std::end(_agentStore.Destinations())),
+        _threadPool,
+        _workerScratch);
     return _agents.back().id.getID();
 }
 
 void Simulation::MarkAgentForRemoval(GenericAgent::ID id)
 {
-    const auto iter = std::find_if(
-        std::begin(_agents), std::end(_agents), [id](auto& agent) { return agent.id == id; });
-    if(iter == std::end(_agents)) {
+    if(_agentSlots.IndexOf(id) == AgentSlotMap::NO_INDEX) {
         throw SimulationError("Unknown agent id {}", id);
     }
 
     _removedAgentsInLastIteration.push_back(id);
 }
 
+void Simulation::MarkAgentsForRemoval(const std::vector<GenericAgent::ID>& ids)
+{
+    for(const auto& id : ids) {
+        if(_agentSlots.IndexOf(id) == AgentSlotMap::NO_INDEX) {
+            throw SimulationError("Unknown agent id {}", id);
+        }
+    }
+    _removedAgentsInLastIteration.insert(
+        std::end(_removedAgentsInLastIteration), std::begin(ids), std::end(ids));
+}
+
 const GenericAgent& Simulation::Agent(GenericAgent::ID id) const
 {
-    const auto iter =
-        std::find_if(_agents.begin(), _agents.end(), [id](auto& ped) { return id == ped.id; });
-    if(iter == _agents.end()) {
+    const auto index = _agentSlots.IndexOf(id);
+    if(index == AgentSlotMap::NO_INDEX) {
         throw SimulationError("Trying to access unknown Agent {}", id);
     }
-    return *iter;
+    return _agents[index];
 }
 
 GenericAgent& Simulation::Agent(GenericAgent::ID id)
 {
-    const auto iter =
-        std::find_if(_agents.begin(), _agents.end(), [id](auto& ped) { return id == ped.id; });
-    if(iter == _agents.end()) {
+    const auto index = _agentSlots.IndexOf(id);
+    if(index == AgentSlotMap::NO_INDEX) {
         throw SimulationError("Trying to access unknown Agent {}", id);
     }
-    return *iter;
+    return _agents[index];
+}
+
+AgentSlotMap::Handle Simulation::AgentHandle(GenericAgent::ID id) const
+{
+    const auto handle = _agentSlots.HandleOf(id);
+    if(handle == AgentSlotMap::INVALID_HANDLE) {
+        throw SimulationError("Trying to access unknown Agent {}", id);
+    }
+    return handle;
+}
+
+GenericAgent& Simulation::AgentByHandle(AgentSlotMap::Handle handle)
+{
+    const auto index = _agentSlots.IndexOfHandle(handle);
+    if(index == AgentSlotMap::NO_INDEX) {
+        throw SimulationError("Invalid or expired agent handle {}", handle);
+    }
+    return _agents[index];
 }
 
 const std::vector<GenericAgent::ID>& Simulation::RemovedAgents() const
@@ -283,15 +352,9 @@ void Simulation::SwitchAgentJourney(
 
 std::vector<GenericAgent::ID> Simulation::AgentsInRange(Point p, double distance)
 {
-    const auto neighbors = _neighborhoodSearch.GetNeighboringAgents(p, distance);
-
     std::vector<GenericAgent::ID> neighborIds{};
-    neighborIds.reserve(neighbors.size());
-    std::transform(
-        std::begin(neighbors),
-        std::end(neighbors),
-        std::back_inserter(neighborIds),
-        [](const auto& agent) { return agent.id; });
+    _neighborhoodSearch.ForEachNeighbor(
+        p, distance, [&neighborIds](const auto& agent) { neighborIds.push_back(agent.id); });
     return neighborIds;
 }
 
@@ -303,15 +366,12 @@ std::vector<GenericAgent::ID> Simulation::AgentsInPolygon(const std::vector<Poin
     }
     const auto [p, dist] = poly.ContainingCircle();
 
-    const auto candidates = _neighborhoodSearch.GetNeighboringAgents(p, dist);
     std::vector<GenericAgent::ID> result{};
-    result.reserve(candidates.size());
-    std::for_each(
-        std::begin(candidates), std::end(candidates), [&result, &poly](const auto& agent) {
-            if(poly.IsInside(agent.pos)) {
-                result.push_back(agent.id);
-            }
-        });
+    _neighborhoodSearch.ForEachNeighbor(p, dist, [&result, &poly](const auto& agent) {
+        if(poly.IsInside(agent.pos)) {
+            result.push_back(agent.id);
+        }
+    });
     return result;
 }
 
@@ -332,36 +392,98 @@ CollisionGeometry Simulation::Geo() const
 void Simulation::SwitchGeometry(std::unique_ptr<CollisionGeometry>&& geometry)
 {
     ValidateGeometry(geometry);
-    if(const auto& iter = geometries.find(geometry->Id()); iter != std::end(geometries)) {
-        _geometry = std::get<0>(iter->second).get();
-        _routingEngine = std::get<1>(iter->second).get();
-    } else {
-        const auto p = geometry->Polygon();
-        const auto& [tup, res] = geometries.emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple(geometry->Id()),
-            std::forward_as_tuple(std::move(geometry), std::make_unique<RoutingEngine>(p)));
-        if(!res) {
-            throw SimulationError("Internal error");
+    // Face hints and cached paths refer to the mesh of the previous geometry
+    for(auto& agent : _agents) {
+        agent.routingFace = RoutingEngine::NO_FACE;
+        agent.waypoints.clear();
+    }
+    useGeometry(*geometry);
+    _neighborhoodSearch.SetBounds(AABB(std::get<0>(_geometry->AccessibleArea())));
+    precomputeAllRoutingTables();
+}
+
+void Simulation::SetDoorClosed(size_t door, bool closed)
+{
+    if(door >= _geometry->Doors().size()) {
+        throw SimulationError(
+            "Unknown door {}, the geometry has {} doors", door, _geometry->Doors().size());
+    }
+    if(IsDoorClosed(door) == closed) {
+        return;
+    }
+    if(!_geometryWithDoors) {
+        _geometryWithDoors = std::make_unique<CollisionGeometry>(*_geometry);
+        _routingEngineWithDoors = _routingEngine->Clone();
+        _geometry = _geometryWithDoors.get();
+        _routingEngine = _routingEngineWithDoors.get();
+    }
+    _geometryWithDoors->SetDoorClosed(door, closed);
+    _routingEngineWithDoors->SetDoorClosed(door, closed);
+    // Neighbor lists are filtered by the walls between agents
+    _neighborhoodSearch.InvalidateNeighborLists();
+    for(auto& agent : _agents) {
+        agent.waypoints.clear();
+    }
+    precomputeAllRoutingTables();
+}
+
+bool Simulation::IsDoorClosed(size_t door) const
+{
+    return _geometry->IsDoorClosed(door);
+}
+
+void Simulation::useGeometry(const CollisionGeometry& geometry)
+{
+    _geometryWithDoors.reset();
+    _routingEngineWithDoors.reset();
+    auto iter = geometries.find(geometry.Id());
+    if(iter == std::end(geometries)) {
+        auto entry = GeometryCache::Instance().Get(
+            geometry, _wallDistanceFieldResolution, _routingBackend);
+        iter = geometries.emplace(geometry.Id(), std::move(entry)).first;
+    }
+    _geometry = iter->second.geometry.get();
+    _routingEngine = iter->second.routingEngine.get();
+}
+
+void Simulation::precomputeRoutingTables(const std::vector<const Journey*>& journeys)
+{
+    if(!_precomputeRoutingTables) {
+        return;
+    }
+    std::vector<Point> targets{};
+    for(const auto* journey : journeys) {
+        for(const auto& [_, node] : journey->Stages()) {
+            const auto stageTargets = node.stage->Targets();
+            targets.insert(std::end(targets), std::begin(stageTargets), std::end(stageTargets));
         }
-        _geometry = std::get<0>(tup->second).get();
-        _routingEngine = std::get<1>(tup->second).get();
     }
+    _routingEngine->PrecomputeNavigationFields(targets, _threadPool);
+}
+
+void Simulation::precomputeAllRoutingTables()
+{
+    std::vector<const Journey*> journeys{};
+    journeys.reserve(_journeys.size());
+    for(const auto& [_, journey] : _journeys) {
+        journeys.push_back(journey.get());
+    }
+    precomputeRoutingTables(journeys);
 }
 
 void Simulation::ValidateGeometry(const std::unique_ptr<CollisionGeometry>& geometry) const
 {
-    std::vector<GenericAgent::ID> faultyAgents;
-    for(const auto& agent : _agents) {
-        if(const auto find_iter = std::find(
-               std::begin(_removedAgentsInLastIteration),
-               std::end(_removedAgentsInLastIteration),
-               agent.id);
-           find_iter != std::end(_removedAgentsInLastIteration)) {
-            continue;
+    std::vector<bool> removed(_agents.size(), false);
+    for(const auto& id : _removedAgentsInLastIteration) {
+        if(const auto index = _agentSlots.IndexOf(id); index != AgentSlotMap::NO_INDEX) {
+            removed[index] = true;
         }
+    }
 
-        if(!geometry->InsideGeometry(agent.pos)) {
+    std::vector<GenericAgent::ID> faultyAgents;
+    for(size_t index = 0; index < _agents.size(); ++index) {
+        const auto& agent = _agents[index];
+        if(!removed[index] && !geometry->InsideGeometry(agent.pos)) {
             faultyAgents.push_back(agent.id);
         }
     }
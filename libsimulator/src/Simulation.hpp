@@ -3,7 +3,10 @@
 #pragma once
 
 #include "AgentRemovalSystem.hpp"
+#include "AgentSlotMap.hpp"
+#include "AgentStore.hpp"
 #include "GenericAgent.hpp"
+#include "GeometryCache.hpp"
 #include "Journey.hpp"
 #include "NeighborhoodSearch.hpp"
 #include "OperationalDecisionSystem.hpp"
@@ -11,13 +14,16 @@
 #include "OperationalModelType.hpp"
 #include "Point.hpp"
 #include "SimulationClock.hpp"
+#include "SimulationOptions.hpp"
 #include "Stage.hpp"
 #include "StageDescription.hpp"
 #include "StageManager.hpp"
 #include "StageSystem.hpp"
 #include "StrategicalDesicionSystem.hpp"
 #include "TacticalDecisionSystem.hpp"
+#include "ThreadPool.hpp"
 #include "Tracing.hpp"
+#include "WorkerScratch.hpp"
 
 #include <boost/iterator/zip_iterator.hpp>
 
@@ -29,28 +35,42 @@ class Simulation
 {
     SimulationClock _clock;
     StrategicalDecisionSystem _stategicalDecisionSystem{};
-    TacticalDecisionSystem _tacticalDecisionSystem{};
+    TacticalDecisionSystem _tacticalDecisionSystem;
     OperationalDecisionSystem _operationalDecisionSystem;
     AgentRemovalSystem<GenericAgent> _agentRemovalSystem{};
     StageManager _stageManager{};
     StageSystem _stageSystem{};
-    NeighborhoodSearch<GenericAgent> _neighborhoodSearch{2.2};
-    std::unordered_map<
-        CollisionGeometry::ID,
-        std::tuple<std::unique_ptr<CollisionGeometry>, std::unique_ptr<RoutingEngine>>>
-        geometries{};
-    RoutingEngine* _routingEngine;
-    CollisionGeometry* _geometry;
+    NeighborhoodSearch<GenericAgent> _neighborhoodSearch;
+    // Geometries this simulation has used by the ID they were passed with, shared with other
+    // simulations through the GeometryCache
+    std::unordered_map<CollisionGeometry::ID, GeometryCache::Entry> geometries{};
+    const RoutingEngine* _routingEngine;
+    const CollisionGeometry* _geometry;
+    // Private copies of the active geometry and routing engine, made when a door is opened or
+    // closed for the first time. The shared entries always have all doors open.
+    std::unique_ptr<CollisionGeometry> _geometryWithDoors{};
+    std::unique_ptr<RoutingEngine> _routingEngineWithDoors{};
     std::vector<GenericAgent> _agents;
+    // Columns of the agent state read by the operational models, one row per agent in '_agents'
+    AgentStore _agentStore{_agents};
+    // Index of each agent in '_agents' by ID and handle
+    AgentSlotMap _agentSlots{};
     std::vector<GenericAgent::ID> _removedAgentsInLastIteration;
     std::unordered_map<Journey::ID, std::unique_ptr<Journey>> _journeys;
     PerfStats _perfStats{};
+    ThreadPool _threadPool;
+    // Memory reused across iterations, one slot per worker of '_threadPool'
+    std::vector<WorkerScratch> _workerScratch;
+    double _wallDistanceFieldResolution;
+    RoutingBackend _routingBackend;
+    bool _precomputeRoutingTables;
 
 public:
     Simulation(
         std::unique_ptr<OperationalModel>&& operationalModel,
         std::unique_ptr<CollisionGeometry>&& geometry,
-        double dT);
+        double dT,
+        const SimulationOptions& options = {});
     Simulation(const Simulation& other) = delete;
     Simulation& operator=(const Simulation& other) = delete;
     Simulation(Simulation&& other) = delete;
@@ -63,6 +83,8 @@ public:
     Journey::ID AddJourney(const std::map<BaseStage::ID, TransitionDescription>& stages);
     BaseStage::ID AddStage(const StageDescription stageDescription);
     void MarkAgentForRemoval(GenericAgent::ID id);
+    /// Marks all agents in 'ids' for removal, none are marked if any ID is unknown.
+    void MarkAgentsForRemoval(const std::vector<GenericAgent::ID>& ids);
     const std::vector<GenericAgent::ID>& RemovedAgents() const;
     size_t AgentCount() const;
     double ElapsedTime() const;
@@ -77,12 +99,28 @@ public:
     GenericAgent::ID AddAgent(GenericAgent&& agent);
     const GenericAgent& Agent(GenericAgent::ID id) const;
     GenericAgent& Agent(GenericAgent::ID id);
+    /// Handle of the agent 'id', see 'AgentSlotMap'. Handles are looked up without hashing and
+    /// stay valid until the agent is removed.
+    AgentSlotMap::Handle AgentHandle(GenericAgent::ID id) const;
+    GenericAgent& AgentByHandle(AgentSlotMap::Handle handle);
     std::vector<GenericAgent>& Agents();
     OperationalModelType ModelType() const;
     StageProxy Stage(BaseStage::ID stageId);
     CollisionGeometry Geo() const;
+    /// Doors of the new geometry are open.
     void SwitchGeometry(std::unique_ptr<CollisionGeometry>&& geometry);
+    /// Opens or closes door 'door' of the active geometry. A closed door is a wall for the
+    /// operational models and paths avoid it. Agents that can only reach their target through
+    /// closed doors walk up to them and wait. Cached paths of all agents are recomputed.
+    void SetDoorClosed(size_t door, bool closed);
+    bool IsDoorClosed(size_t door) const;
 
 private:
+    /// Makes the cached geometry and routing engine for 'geometry' the active ones.
+    void useGeometry(const CollisionGeometry& geometry);
+    /// Builds the routing data of the active routing engine towards all targets of the stages in
+    /// 'journeys' if 'SimulationOptions::precomputeRoutingTables' is set.
+    void precomputeRoutingTables(const std::vector<const Journey*>& journeys);
+    void precomputeAllRoutingTables();
     void ValidateGeometry(const std::unique_ptr<CollisionGeometry>& geometry) const;
 };
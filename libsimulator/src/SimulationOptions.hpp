@@ -0,0 +1,29 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "NeighborhoodSearch.hpp"
+#include "RoutingEngine.hpp"
+
+#include <cstddef>
+
+/// Settings that control how a simulation is computed, but not what is simulated.
+struct SimulationOptions {
+    /// Number of threads used to compute an iteration, 0 selects the number of hardware threads.
+    size_t threadCount{1};
+    /// Data structure used to find neighboring agents.
+    NeighborhoodSearchBackend neighborhoodSearchBackend{NeighborhoodSearchBackend::HashGrid};
+    /// Skin of the Verlet neighbor lists in meters, 0 disables neighbor lists.
+    double neighborListSkin{0};
+    /// Resolution of the wall distance field in meters, 0 computes wall interactions exactly.
+    double wallDistanceFieldResolution{0};
+    /// Path search used to route agents to their targets.
+    RoutingBackend routingBackend{RoutingBackend::Triangulation};
+    /// Maximum number of iterations agents follow their cached path before it is computed again,
+    /// 0 computes the next waypoint of every agent in every iteration.
+    size_t routingRefreshInterval{0};
+    /// Builds the routing data towards all targets of the stages of a journey when the journey is
+    /// added, instead of on first use during the iterations. The data is built again after doors
+    /// are opened or closed and after the geometry is switched.
+    bool precomputeRoutingTables{false};
+};
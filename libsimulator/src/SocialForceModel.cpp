@@ -11,6 +11,7 @@
 #include "OperationalModelType.hpp"
 #include "Simulation.hpp"
 #include "SocialForceModelData.hpp"
+#include "WorkerScratch.hpp"
 
 #include <Logger.hpp>
 #include <iostream>
@@ -24,39 +25,59 @@ OperationalModelType SocialForceModel::Type() const
     return OperationalModelType::SOCIAL_FORCE;
 }
 
+double SocialForceModel::NeighborhoodRadius() const
+{
+    return _cutOffRadius;
+}
+
 std::unique_ptr<OperationalModel> SocialForceModel::Clone() const
 {
     return std::make_unique<SocialForceModel>(*this);
 }
 
-OperationalModelUpdate SocialForceModel::ComputeNewPosition(
+SocialForceModel::Update SocialForceModel::ComputeUpdate(
     double dT,
-    const GenericAgent& ped,
+    size_t index,
+    const AgentStore& agents,
     const CollisionGeometry& geometry,
-    const NeighborhoodSearchType& neighborhoodSearch) const
+    const NeighborhoodSearchType& neighborhoodSearch,
+    WorkerScratch& /*scratch*/) const
 {
-    const auto& model = std::get<SocialForceModelData>(ped.model);
+    const auto ped = Agent::Of(agents, index);
+    const auto& model = ped.model;
     SocialForceModelUpdate update{};
     auto forces = DrivingForce(ped);
 
-    const auto neighborhood = neighborhoodSearch.GetNeighboringAgents(ped.pos, this->_cutOffRadius);
     Point F_rep;
-    for(const auto& neighbor : neighborhood) {
-        if(neighbor.id == ped.id) {
-            continue;
+    neighborhoodSearch.ForEachNeighborIndexOf(
+        index,
+        agents.Positions(),
+        this->_cutOffRadius,
+        [this, index, &agents, &ped, &F_rep](size_t neighbor, bool) {
+            if(neighbor == index) {
+                return;
+            }
+            F_rep += AgentForce(ped, Agent::Of(agents, neighbor));
+        });
+    forces += F_rep / model.mass;
+
+    // Far away from all walls only the closest wall contributes noticeably to the force.
+    Point obstacle_f{};
+    if(const auto wall = geometry.ApproximateWallDistance(ped.pos); wall) {
+        if(wall->direction != Point{}) {
+            const auto closest = ped.pos + wall->direction * wall->distance;
+            obstacle_f = ObstacleForce(ped, LineSegment(closest, closest));
         }
-        F_rep += AgentForce(ped, neighbor);
+    } else {
+        const auto& walls = geometry.LineSegmentsInApproxDistanceTo(ped.pos);
+        obstacle_f = std::accumulate(
+            walls.cbegin(),
+            walls.cend(),
+            Point(0, 0),
+            [this, &ped](const auto& acc, const auto& element) {
+                return acc + ObstacleForce(ped, element);
+            });
     }
-    forces += F_rep / model.mass;
-    const auto& walls = geometry.LineSegmentsInApproxDistanceTo(ped.pos);
-
-    const auto obstacle_f = std::accumulate(
-        walls.cbegin(),
-        walls.cend(),
-        Point(0, 0),
-        [this, &ped](const auto& acc, const auto& element) {
-            return acc + ObstacleForce(ped, element);
-        });
     forces += obstacle_f / model.mass;
 
     update.velocity = model.velocity + forces * dT;
@@ -65,13 +86,11 @@ OperationalModelUpdate SocialForceModel::ComputeNewPosition(
     return update;
 }
 
-void SocialForceModel::ApplyUpdate(const OperationalModelUpdate& update, GenericAgent& agent) const
+void SocialForceModel::Apply(const Update& upd, size_t index, AgentStore& agents) const
 {
-    auto& model = std::get<SocialForceModelData>(agent.model);
-    const auto& upd = std::get<SocialForceModelUpdate>(update);
-    agent.pos = upd.position;
-    model.velocity = upd.velocity;
-    agent.orientation = upd.velocity.Normalized();
+    agents.SetPosition(index, upd.position);
+    agents.Models<SocialForceModelData>()[index].velocity = upd.velocity;
+    agents.SetOrientation(index, upd.velocity.Normalized());
 }
 
 void SocialForceModel::CheckModelConstraint(
@@ -106,8 +125,7 @@ void SocialForceModel::CheckModelConstraint(
     const auto radius = model.radius;
     throwIfNegative(radius, "radius");
 
-    const auto neighbors = neighborhoodSearch.GetNeighboringAgents(agent.pos, 2);
-    for(const auto& neighbor : neighbors) {
+    neighborhoodSearch.ForEachNeighbor(agent.pos, 2, [&agent, &model](const auto& neighbor) {
         const auto distance = (agent.pos - neighbor.pos).Norm();
 
         if(model.radius >= distance) {
@@ -119,7 +137,7 @@ void SocialForceModel::CheckModelConstraint(
                 distance,
                 model.radius);
         }
-    }
+    });
     const auto maxRadius = model.radius / 2;
     const auto lineSegments = geometry.LineSegmentsInDistanceTo(maxRadius, agent.pos);
     if(std::begin(lineSegments) != std::end(lineSegments)) {
@@ -131,9 +149,9 @@ void SocialForceModel::CheckModelConstraint(
     }
 }
 
-Point SocialForceModel::DrivingForce(const GenericAgent& agent)
+Point SocialForceModel::DrivingForce(const Agent& agent)
 {
-    const auto& model = std::get<SocialForceModelData>(agent.model);
+    const auto& model = agent.model;
     const Point e0 = (agent.destination - agent.pos).Normalized();
     return (e0 * model.desiredSpeed - model.velocity) / model.reactionTime;
 };
@@ -142,10 +160,10 @@ double SocialForceModel::PushingForceLength(double A, double B, double r, double
     return A * exp((r - distance) / B);
 }
 
-Point SocialForceModel::AgentForce(const GenericAgent& ped1, const GenericAgent& ped2) const
+Point SocialForceModel::AgentForce(const Agent& ped1, const Agent& ped2) const
 {
-    const auto& model1 = std::get<SocialForceModelData>(ped1.model);
-    const auto& model2 = std::get<SocialForceModelData>(ped2.model);
+    const auto& model1 = ped1.model;
+    const auto& model2 = ped2.model;
 
     const double total_radius = model1.radius + model2.radius;
 
@@ -158,9 +176,9 @@ Point SocialForceModel::AgentForce(const GenericAgent& ped1, const GenericAgent&
         model2.velocity - model1.velocity);
 };
 
-Point SocialForceModel::ObstacleForce(const GenericAgent& agent, const LineSegment& segment) const
+Point SocialForceModel::ObstacleForce(const Agent& agent, const LineSegment& segment) const
 {
-    const auto& model = std::get<SocialForceModelData>(agent.model);
+    const auto& model = agent.model;
     const Point pt = segment.ShortestPoint(agent.pos);
     return ForceBetweenPoints(
         agent.pos, pt, model.obstacleScale, model.forceDistance, model.radius, model.velocity);
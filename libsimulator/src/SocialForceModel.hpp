@@ -2,18 +2,23 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #pragma once
 
+#include "AgentView.hpp"
 #include "CollisionFreeSpeedModelData.hpp"
 #include "CollisionGeometry.hpp"
 #include "NeighborhoodSearch.hpp"
 #include "OperationalModel.hpp"
+#include "SocialForceModelUpdate.hpp"
 #include "UniqueID.hpp"
 
 struct GenericAgent;
+struct WorkerScratch;
 
-class SocialForceModel : public OperationalModel
+class SocialForceModel final : public OperationalModel
 {
 public:
     using NeighborhoodSearchType = NeighborhoodSearch<GenericAgent>;
+    using Agent = AgentView<SocialForceModelData>;
+    using Update = SocialForceModelUpdate;
 
 private:
     double _cutOffRadius{2.5};
@@ -24,18 +29,25 @@ public:
     SocialForceModel(double bodyForce_, double friction_);
     ~SocialForceModel() override = default;
     OperationalModelType Type() const override;
-    OperationalModelUpdate ComputeNewPosition(
-        double dT,
-        const GenericAgent& ped,
-        const CollisionGeometry& geometry,
-        const NeighborhoodSearchType& neighborhoodSearch) const override;
-    void ApplyUpdate(const OperationalModelUpdate& update, GenericAgent& agent) const override;
+    double NeighborhoodRadius() const override;
     void CheckModelConstraint(
         const GenericAgent& agent,
         const NeighborhoodSearchType& neighborhoodSearch,
         const CollisionGeometry& geometry) const override;
     std::unique_ptr<OperationalModel> Clone() const override;
 
+    /// Computes the update of the agent at 'index', applied afterwards with 'Apply'. Called
+    /// without virtual dispatch by the kernel 'OperationalDecisionSystem' instantiates per model.
+    /// @param scratch memory of the worker computing the update, see 'WorkerScratch'
+    Update ComputeUpdate(
+        double dT,
+        size_t index,
+        const AgentStore& agents,
+        const CollisionGeometry& geometry,
+        const NeighborhoodSearchType& neighborhoodSearch,
+        WorkerScratch& scratch) const;
+    void Apply(const Update& update, size_t index, AgentStore& agents) const;
+
 private:
     /**
      * Driving force acting on pedestrian <agent>
@@ -43,21 +55,21 @@ private:
      *
      * @return vector with driving force of pedestrian
      */
-    static Point DrivingForce(const GenericAgent& agent);
+    static Point DrivingForce(const Agent& agent);
     /**
      *  Repulsive force acting on pedestrian <ped1> from pedestrian <ped2>
      * @param ped1 reference to Pedestrian 1 on whom the force acts on
      * @param ped2 reference to Pedestrian 2, from whom the force originates
      * @return vector with the repulsive force
      */
-    Point AgentForce(const GenericAgent& ped1, const GenericAgent& ped2) const;
+    Point AgentForce(const Agent& ped1, const Agent& ped2) const;
     /**
      *  Repulsive force acting on pedestrian <agent> from line segment <segment>
      * @param agent reference to the Pedestrian on whom the force acts on
      * @param segment reference to line segment, from which the force originates
      * @return vector with the repulsive force
      */
-    Point ObstacleForce(const GenericAgent& agent, const LineSegment& segment) const;
+    Point ObstacleForce(const Agent& agent, const LineSegment& segment) const;
     /**
      * calculates the pushing and friction forces acting between <pt1> and <pt2>
      * @param pt1 Point on which the forces act
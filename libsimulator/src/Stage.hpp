@@ -108,6 +108,8 @@ public:
     virtual ~BaseStage() = default;
     virtual bool IsCompleted(const GenericAgent& agent) = 0;
     virtual Point Target(const GenericAgent& agent) = 0;
+    /// All points 'Target' may return, empty if they are not known in advance.
+    virtual std::vector<Point> Targets() const = 0;
     virtual StageProxy Proxy(Simulation* simulation_) = 0;
     ID Id() const { return id; }
     size_t CountTargeting() const { return targeting; }
@@ -141,6 +143,7 @@ public:
     ~Waypoint() override = default;
     bool IsCompleted(const GenericAgent& agent) override;
     Point Target(const GenericAgent& agent) override;
+    std::vector<Point> Targets() const override { return {position}; }
     StageProxy Proxy(Simulation* simulation_) override;
     Point Position() const { return position; };
 };
@@ -156,6 +159,7 @@ public:
     ~Exit() override = default;
     bool IsCompleted(const GenericAgent& agent) override;
     Point Target(const GenericAgent& agent) override;
+    std::vector<Point> Targets() const override { return {area.Centroid()}; }
     StageProxy Proxy(Simulation* simulation_) override;
     Polygon Position() const { return area; };
 };
@@ -171,6 +175,7 @@ public:
     ~NotifiableWaitingSet() override = default;
     bool IsCompleted(const GenericAgent& agent) override;
     Point Target(const GenericAgent& agent) override;
+    std::vector<Point> Targets() const override { return slots; }
     StageProxy Proxy(Simulation* simulation_) override;
     void State(WaitingSetState s);
     WaitingSetState State() const;
@@ -196,40 +201,31 @@ void NotifiableWaitingSet::Update(
     for(size_t index = count_occupants; index < slots.size(); ++index) {
         const auto slot_pos = slots[index];
         const auto& boundary = geometry.LineSegmentsInApproxDistanceTo(slot_pos);
-        auto candidates = neighborhoodSearch.GetNeighboringAgents(slot_pos, 2);
-        candidates.erase(
-            std::remove_if(
-                std::begin(candidates),
-                std::end(candidates),
-                [&slot_pos, &boundary](const auto& neighbor) {
-                    const auto agent_to_neighbor = LineSegment(slot_pos, neighbor.pos);
-                    if(std::find_if(
-                           boundary.cbegin(),
-                           boundary.cend(),
-                           [&agent_to_neighbor](const auto& boundary_segment) {
-                               return intersects(agent_to_neighbor, boundary_segment);
-                           }) != boundary.end()) {
-                        return true;
-                    }
-
-                    return false;
-                }),
-            std::end(candidates));
+        const auto is_obstructed = [&slot_pos, &boundary](const auto& agent) {
+            const auto agent_to_neighbor = LineSegment(slot_pos, agent.pos);
+            return std::find_if(
+                       boundary.cbegin(),
+                       boundary.cend(),
+                       [&agent_to_neighbor](const auto& boundary_segment) {
+                           return intersects(agent_to_neighbor, boundary_segment);
+                       }) != boundary.end();
+        };
 
         GenericAgent::ID occupant = GenericAgent::ID::Invalid;
         double min_distance = std::numeric_limits<double>::max();
-        for(const auto& agent : candidates) {
-            if(agent.stageId == id) {
-                if(std::find(std::begin(occupants), std::end(occupants), agent.id) ==
-                   std::end(occupants)) {
-                    const auto distance = (agent.pos - slots[index]).Norm();
-                    if(distance < min_distance) {
-                        min_distance = distance;
-                        occupant = agent.id;
-                    }
+        neighborhoodSearch.ForEachNeighbor(slot_pos, 2, [&](const auto& agent) {
+            if(agent.stageId != id || is_obstructed(agent)) {
+                return;
+            }
+            if(std::find(std::begin(occupants), std::end(occupants), agent.id) ==
+               std::end(occupants)) {
+                const auto distance = (agent.pos - slots[index]).Norm();
+                if(distance < min_distance) {
+                    min_distance = distance;
+                    occupant = agent.id;
                 }
             }
-        }
+        });
         if(occupant != GenericAgent::ID::Invalid) {
             occupants.push_back(occupant);
         } else {
@@ -251,6 +247,7 @@ public:
     ~NotifiableQueue() override = default;
     bool IsCompleted(const GenericAgent& agent) override;
     Point Target(const GenericAgent& agent) override;
+    std::vector<Point> Targets() const override { return slots; }
     StageProxy Proxy(Simulation* simulation_) override;
     template <typename T>
     void Update(const NeighborhoodSearch<T>& neighborhoodSearch, const CollisionGeometry& geometry);
@@ -272,39 +269,29 @@ void NotifiableQueue::Update(
     for(size_t index = count_occupants; index < slots.size(); ++index) {
         const auto slot_pos = slots[index];
         const auto& boundary = geometry.LineSegmentsInApproxDistanceTo(slot_pos);
-        auto candidates = neighborhoodSearch.GetNeighboringAgents(slot_pos, 2);
-        candidates.erase(
-            std::remove_if(
-                std::begin(candidates),
-                std::end(candidates),
-                [&slot_pos, &boundary](const auto& neighbor) {
-                    const auto agent_to_neighbor = LineSegment(slot_pos, neighbor.pos);
-                    if(std::find_if(
-                           boundary.cbegin(),
-                           boundary.cend(),
-                           [&agent_to_neighbor](const auto& boundary_segment) {
-                               return intersects(agent_to_neighbor, boundary_segment);
-                           }) != boundary.end()) {
-                        return true;
-                    }
-
-                    return false;
-                }),
-            std::end(candidates));
+        const auto is_obstructed = [&slot_pos, &boundary](const auto& agent) {
+            const auto agent_to_neighbor = LineSegment(slot_pos, agent.pos);
+            return std::find_if(
+                       boundary.cbegin(),
+                       boundary.cend(),
+                       [&agent_to_neighbor](const auto& boundary_segment) {
+                           return intersects(agent_to_neighbor, boundary_segment);
+                       }) != boundary.end();
+        };
 
         GenericAgent::ID occupant = GenericAgent::ID::Invalid;
         double min_distance = std::numeric_limits<double>::max();
-        for(const auto& agent : candidates) {
+        neighborhoodSearch.ForEachNeighbor(slot_pos, 2, [&](const auto& agent) {
             if(agent.stageId != id || Contains(occupants, agent.id) ||
-               exitingThisUpdate.contains(agent.id)) {
-                continue;
+               exitingThisUpdate.contains(agent.id) || is_obstructed(agent)) {
+                return;
             }
             const auto distance = (agent.pos - slots[index]).Norm();
             if(distance < min_distance) {
                 min_distance = distance;
                 occupant = agent.id;
             }
-        }
+        });
         if(occupant != GenericAgent::ID::Invalid) {
             occupants.emplace_back(occupant);
         } else {
@@ -320,6 +307,7 @@ public:
     ~DirectSteering() override = default;
     bool IsCompleted(const GenericAgent&) override { return false; };
     Point Target(const GenericAgent& agent) override { return agent.target; };
+    std::vector<Point> Targets() const override { return {}; }
     StageProxy Proxy(Simulation* simulation) override
     {
         return DirectSteeringProxy(simulation, this);
@@ -3,24 +3,92 @@
 #pragma once
 
 #include "RoutingEngine.hpp"
+#include "ThreadPool.hpp"
+#include "WorkerScratch.hpp"
 
+#include <cstddef>
+#include <iterator>
 #include <vector>
 
 class TacticalDecisionSystem
 {
+    // Distance at which an agent has reached its next waypoint and heads for the one after it
+    static constexpr double waypointReachedDistance = 0.1;
+
+    size_t _refreshInterval{0};
+
 public:
     TacticalDecisionSystem() = default;
+    /// @param refreshInterval maximum number of iterations an agent follows its cached path, 0
+    /// computes the next waypoint of every agent in every iteration.
+    explicit TacticalDecisionSystem(size_t refreshInterval) : _refreshInterval(refreshInterval) {}
     ~TacticalDecisionSystem() = default;
     TacticalDecisionSystem(const TacticalDecisionSystem& other) = delete;
     TacticalDecisionSystem& operator=(const TacticalDecisionSystem& other) = delete;
     TacticalDecisionSystem(TacticalDecisionSystem&& other) = delete;
     TacticalDecisionSystem& operator=(TacticalDecisionSystem&& other) = delete;
 
-    void Run(RoutingEngine& routingEngine, auto&& agents) const
+    /// @param destinations receives the destination of each agent in 'agents', see 'AgentStore'
+    /// @param scratch one slot per worker of 'threadPool'
+    void Run(
+        const RoutingEngine& routingEngine,
+        auto&& agents,
+        auto destinations,
+        ThreadPool& threadPool,
+        std::vector<WorkerScratch>& scratch) const
+    {
+        for(auto& slot : scratch) {
+            routingEngine.ReserveScratch(slot.routing);
+        }
+        // Each agent only writes its own state and destination, agents can be routed concurrently.
+        const auto first = std::begin(agents);
+        const auto refreshInterval = _refreshInterval;
+        threadPool.ParallelForWorkers(
+            std::size(agents),
+            [&routingEngine, first, destinations, refreshInterval, &scratch](
+                size_t worker, size_t begin, size_t end) {
+                auto& routing = scratch[worker].routing;
+                for(size_t index = begin; index < end; ++index) {
+                    auto& agent = first[index];
+                    if(refreshInterval == 0) {
+                        destinations[index] = routingEngine.ComputeWaypoint(
+                            agent.pos, agent.target, agent.routingFace, routing);
+                    } else {
+                        destinations[index] =
+                            followPath(routingEngine, agent, refreshInterval, routing);
+                    }
+                }
+            });
+    }
+
+private:
+    /// The next waypoint only changes if the agent enters another face, reaches its waypoint or
+    /// gets a new target. Agents hence follow their cached path and only compute a new one on
+    /// these events or once it is 'refreshInterval' iterations old.
+    /// @return the next waypoint of the path
+    static Point followPath(
+        const RoutingEngine& routingEngine,
+        auto& agent,
+        size_t refreshInterval,
+        RoutingEngine::Scratch& scratch)
     {
-        for(auto& agent : agents) {
-            const auto dest = agent.target;
-            agent.destination = routingEngine.ComputeWaypoint(agent.pos, dest);
+        const auto previousFace = agent.routingFace;
+        agent.routingFace = routingEngine.LocateFace(agent.pos, previousFace);
+        if(agent.waypoints.empty() || agent.routingFace != previousFace ||
+           agent.target != agent.waypointsTarget || agent.waypointsAge >= refreshInterval) {
+            routingEngine.ComputeWaypoints(
+                agent.pos, agent.target, agent.routingFace, agent.waypoints, scratch);
+            agent.nextWaypoint = 0;
+            agent.waypointsTarget = agent.target;
+            agent.waypointsAge = 0;
+        } else {
+            ++agent.waypointsAge;
+            while(agent.nextWaypoint + 1 < agent.waypoints.size() &&
+                  Distance(agent.pos, agent.waypoints[agent.nextWaypoint]) <
+                      waypointReachedDistance) {
+                ++agent.nextWaypoint;
+            }
         }
+        return agent.waypoints[agent.nextWaypoint];
     }
 };
@@ -0,0 +1,104 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if(threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    _workers.reserve(threadCount - 1);
+    for(size_t worker = 1; worker < threadCount; ++worker) {
+        _workers.emplace_back([this, worker]() { workerLoop(worker); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(_mutex);
+        _shutdown = true;
+    }
+    _workAvailable.notify_all();
+    for(auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(size_t count, ChunkFunction function, void* context)
+{
+    // Use more chunks than threads so that uneven work per element is balanced out.
+    constexpr size_t chunksPerThread = 4;
+    const size_t chunkCount = std::min(count, ThreadCount() * chunksPerThread);
+    {
+        std::lock_guard lock(_mutex);
+        _function = function;
+        _context = context;
+        _count = count;
+        _chunkSize = (count + chunkCount - 1) / chunkCount;
+        _chunkCount = (count + _chunkSize - 1) / _chunkSize;
+        _nextChunk.store(0);
+        _error = nullptr;
+        _activeWorkers = _workers.size();
+        ++_generation;
+    }
+    _workAvailable.notify_all();
+
+    processChunks(0);
+
+    std::exception_ptr error{};
+    {
+        std::unique_lock lock(_mutex);
+        _workDone.wait(lock, [this]() { return _activeWorkers == 0; });
+        std::swap(error, _error);
+        _function = nullptr;
+        _context = nullptr;
+    }
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::processChunks(size_t worker)
+{
+    for(size_t chunk = _nextChunk.fetch_add(1); chunk < _chunkCount;
+        chunk = _nextChunk.fetch_add(1)) {
+        const size_t begin = chunk * _chunkSize;
+        const size_t end = std::min(begin + _chunkSize, _count);
+        try {
+            _function(_context, worker, begin, end);
+        } catch(...) {
+            std::lock_guard lock(_mutex);
+            if(!_error) {
+                _error = std::current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::workerLoop(size_t worker)
+{
+    uint64_t processedGeneration = 0;
+    while(true) {
+        {
+            std::unique_lock lock(_mutex);
+            _workAvailable.wait(lock, [this, processedGeneration]() {
+                return _shutdown || _generation != processedGeneration;
+            });
+            if(_shutdown) {
+                return;
+            }
+            processedGeneration = _generation;
+        }
+
+        processChunks(worker);
+
+        {
+            std::lock_guard lock(_mutex);
+            --_activeWorkers;
+        }
+        _workDone.notify_one();
+    }
+}
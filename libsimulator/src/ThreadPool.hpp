@@ -0,0 +1,89 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Fixed size pool of worker threads used to run data parallel loops.
+///
+/// The pool only supports one kind of work: splitting an index range [0, count) into chunks and
+/// running a function on each chunk. The calling thread participates in the work and 'ParallelFor'
+/// only returns once all chunks have been processed. Dispatching work does not allocate.
+///
+/// Threads are numbered as workers in [0, ThreadCount()), the calling thread is worker 0. Memory
+/// reused across loops can be kept per worker, see 'ParallelForWorkers'.
+class ThreadPool
+{
+    using ChunkFunction = void (*)(void* context, size_t worker, size_t begin, size_t end);
+
+    std::vector<std::thread> _workers{};
+    std::mutex _mutex{};
+    std::condition_variable _workAvailable{};
+    std::condition_variable _workDone{};
+    uint64_t _generation{0};
+    size_t _activeWorkers{0};
+    bool _shutdown{false};
+
+    // Description of the currently dispatched loop
+    ChunkFunction _function{};
+    void* _context{};
+    size_t _count{};
+    size_t _chunkSize{};
+    size_t _chunkCount{};
+    std::atomic<size_t> _nextChunk{};
+    std::exception_ptr _error{};
+
+public:
+    /// Creates a pool that runs loops on 'threadCount' threads including the calling thread.
+    /// @param threadCount number of threads to use, 0 selects the number of hardware threads.
+    explicit ThreadPool(size_t threadCount = 1);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+    ThreadPool(ThreadPool&& other) = delete;
+    ThreadPool& operator=(ThreadPool&& other) = delete;
+
+    /// Number of threads work is distributed on, including the calling thread.
+    size_t ThreadCount() const { return _workers.size() + 1; }
+
+    /// Calls 'fn(begin, end)' for disjoint chunks covering [0, count).
+    /// Chunks may be processed concurrently and in any order. The first exception thrown by 'fn'
+    /// is rethrown in the calling thread after all chunks have been processed.
+    template <typename Fn>
+    void ParallelFor(size_t count, Fn&& fn)
+    {
+        ParallelForWorkers(count, [&fn](size_t, size_t begin, size_t end) { fn(begin, end); });
+    }
+
+    /// Like 'ParallelFor' but calls 'fn(worker, begin, end)' with the index of the worker that
+    /// processes the chunk. Chunks of the same worker never run concurrently, so 'fn' may use
+    /// memory indexed by 'worker' without synchronization.
+    template <typename Fn>
+    void ParallelForWorkers(size_t count, Fn&& fn)
+    {
+        if(_workers.empty() || count < 2) {
+            fn(size_t{0}, size_t{0}, count);
+            return;
+        }
+        using FnType = std::remove_reference_t<Fn>;
+        run(count,
+            [](void* context, size_t worker, size_t begin, size_t end) {
+                (*static_cast<FnType*>(context))(worker, begin, end);
+            },
+            const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+    }
+
+private:
+    void run(size_t count, ChunkFunction function, void* context);
+    void processChunks(size_t worker);
+    void workerLoop(size_t worker);
+};
@@ -0,0 +1,97 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "WallDistanceField.hpp"
+
+#include "AABB.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+WallDistanceField::WallDistanceField(
+    const std::vector<LineSegment>& walls,
+    double resolution,
+    double maxDistance)
+    : _resolution(resolution), _maxDistance(maxDistance)
+{
+    if(walls.empty()) {
+        return;
+    }
+    AABB bounds{};
+    for(const auto& wall : walls) {
+        for(const auto& p : {wall.p1, wall.p2}) {
+            bounds.xmin = std::min(bounds.xmin, p.x);
+            bounds.xmax = std::max(bounds.xmax, p.x);
+            bounds.ymin = std::min(bounds.ymin, p.y);
+            bounds.ymax = std::max(bounds.ymax, p.y);
+        }
+    }
+    const double width = bounds.xmax - bounds.xmin;
+    const double height = bounds.ymax - bounds.ymin;
+    while((std::ceil(width / _resolution) + 1) * (std::ceil(height / _resolution) + 1) >
+          MAX_NODE_COUNT) {
+        _resolution *= 2;
+    }
+    _origin = bounds.BottomLeft();
+    _columns = static_cast<int32_t>(std::ceil(width / _resolution)) + 1;
+    _rows = static_cast<int32_t>(std::ceil(height / _resolution)) + 1;
+    _nodes.assign(
+        static_cast<size_t>(_columns) * _rows,
+        Node{static_cast<float>(_maxDistance), 0.0f, 0.0f});
+
+    // Each wall only updates the nodes within 'maxDistance' of its bounding box.
+    const auto node = [this](double value, double origin, int32_t count) {
+        const auto index = std::floor((value - origin) / _resolution);
+        return static_cast<int32_t>(std::clamp(index, 0.0, static_cast<double>(count - 1)));
+    };
+    for(const auto& wall : walls) {
+        const AABB wallBounds(wall.p1, wall.p2);
+        const int32_t xMin = node(wallBounds.xmin - _maxDistance, _origin.x, _columns);
+        const int32_t xMax = node(wallBounds.xmax + _maxDistance, _origin.x, _columns) + 1;
+        const int32_t yMin = node(wallBounds.ymin - _maxDistance, _origin.y, _rows);
+        const int32_t yMax = node(wallBounds.ymax + _maxDistance, _origin.y, _rows) + 1;
+        for(int32_t x = xMin; x <= std::min(xMax, _columns - 1); ++x) {
+            for(int32_t y = yMin; y <= std::min(yMax, _rows - 1); ++y) {
+                const Point pos{_origin.x + x * _resolution, _origin.y + y * _resolution};
+                const auto [distance, direction] =
+                    (wall.ShortestPoint(pos) - pos).NormAndNormalized();
+                auto& value = _nodes[static_cast<size_t>(x) * _rows + y];
+                if(distance < value.distance) {
+                    value = Node{
+                        static_cast<float>(distance),
+                        static_cast<float>(direction.x),
+                        static_cast<float>(direction.y)};
+                }
+            }
+        }
+    }
+}
+
+WallDistanceField::Sample WallDistanceField::Interpolate(Point p) const
+{
+    if(_nodes.empty()) {
+        return {_maxDistance, Point{}};
+    }
+    const auto coordinate = [this](double value, double origin, int32_t count) {
+        const auto scaled =
+            std::clamp((value - origin) / _resolution, 0.0, static_cast<double>(count - 1));
+        const auto index = std::min(static_cast<int32_t>(scaled), std::max(count - 2, 0));
+        return std::make_tuple(index, scaled - index);
+    };
+    const auto [x, fx] = coordinate(p.x, _origin.x, _columns);
+    const auto [y, fy] = coordinate(p.y, _origin.y, _rows);
+    const auto x1 = std::min(x + 1, _columns - 1);
+    const auto y1 = std::min(y + 1, _rows - 1);
+    const auto& n00 = _nodes[static_cast<size_t>(x) * _rows + y];
+    const auto& n01 = _nodes[static_cast<size_t>(x) * _rows + y1];
+    const auto& n10 = _nodes[static_cast<size_t>(x1) * _rows + y];
+    const auto& n11 = _nodes[static_cast<size_t>(x1) * _rows + y1];
+    const auto blend = [fx = fx, fy = fy](float v00, float v01, float v10, float v11) {
+        return (1 - fx) * ((1 - fy) * v00 + fy * v01) + fx * ((1 - fy) * v10 + fy * v11);
+    };
+    const auto distance = blend(n00.distance, n01.distance, n10.distance, n11.distance);
+    const Point direction{
+        blend(n00.directionX, n01.directionX, n10.directionX, n11.directionX),
+        blend(n00.directionY, n01.directionY, n10.directionY, n11.directionY)};
+    return {distance, direction.Normalized()};
+}
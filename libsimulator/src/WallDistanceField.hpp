@@ -0,0 +1,57 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "LineSegment.hpp"
+#include "Point.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Distance and direction to the closest wall sampled on a regular raster.
+///
+/// The raster covers the bounding box of the walls, values in between nodes are bilinearly
+/// interpolated. Only walls up to 'maxDistance' away from a node are considered, nodes further
+/// away from all walls report 'maxDistance' and no direction.
+class WallDistanceField
+{
+    // Upper bound for the number of nodes, larger areas use a coarser resolution.
+    static constexpr size_t MAX_NODE_COUNT = size_t{1} << 22;
+
+    struct Node {
+        float distance;
+        float directionX;
+        float directionY;
+    };
+
+    Point _origin{};
+    double _resolution{};
+    double _maxDistance{};
+    int32_t _columns{0};
+    int32_t _rows{0};
+    // Node (x, y) is located at _origin + (x, y) * _resolution and stored at x * _rows + y
+    std::vector<Node> _nodes{};
+
+public:
+    struct Sample {
+        /// Distance to the closest wall, at most 'maxDistance'
+        double distance;
+        /// Unit vector pointing towards the closest wall, zero if no wall is in range
+        Point direction;
+    };
+
+    /// @param walls to compute the distance to
+    /// @param resolution distance between raster nodes, may be enlarged for large areas
+    /// @param maxDistance up to which walls are considered
+    WallDistanceField(const std::vector<LineSegment>& walls, double resolution, double maxDistance);
+
+    /// Distance between raster nodes actually used.
+    double Resolution() const { return _resolution; }
+
+    /// Interpolated distance to the closest wall. As the distance to the walls changes at most
+    /// by the distance moved, the result differs from the exact distance by at most
+    /// 'Resolution()' * sqrt(2). The direction is only a good approximation away from points that
+    /// are equally close to multiple walls.
+    Sample Interpolate(Point p) const;
+};
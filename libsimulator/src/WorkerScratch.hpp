@@ -0,0 +1,18 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "RoutingEngine.hpp"
+
+#include <cstddef>
+#include <vector>
+
+/// Memory one worker of the simulation's ThreadPool reuses across iterations.
+/// The simulation keeps one slot per worker and work running on worker i only uses slot i, see
+/// 'ThreadPool::ParallelForWorkers'. Slots are reserved before each parallel loop, so their size
+/// does not depend on which chunks a worker happens to process.
+struct WorkerScratch {
+    /// Neighbors of the agent an operational model computes the update of
+    std::vector<size_t> neighbors{};
+    RoutingEngine::Scratch routing{};
+};
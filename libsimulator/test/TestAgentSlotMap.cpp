@@ -0,0 +1,71 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "AgentSlotMap.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+GenericAgent agentAt(Point pos)
+{
+    return GenericAgent(
+        GenericAgent::ID::Invalid, {}, {}, pos, {1, 0}, CollisionFreeSpeedModelData{});
+}
+} // namespace
+
+TEST(AgentSlotMap, FindsAgentsByIdAndHandle)
+{
+    AgentSlotMap slots{};
+    std::vector<GenericAgent> agents{agentAt({0, 0}), agentAt({1, 0})};
+    const auto first = slots.Insert(agents[0].id, 0);
+    const auto second = slots.Insert(agents[1].id, 1);
+    ASSERT_NE(first, AgentSlotMap::INVALID_HANDLE);
+    ASSERT_NE(first, second);
+
+    EXPECT_EQ(slots.IndexOf(agents[1].id), 1);
+    EXPECT_EQ(slots.IndexOfHandle(second), 1);
+    EXPECT_EQ(slots.HandleOf(agents[0].id), first);
+    EXPECT_EQ(slots.IndexOf(GenericAgent::ID{}), AgentSlotMap::NO_INDEX);
+    EXPECT_EQ(slots.HandleOf(GenericAgent::ID{}), AgentSlotMap::INVALID_HANDLE);
+    EXPECT_EQ(slots.IndexOfHandle(AgentSlotMap::INVALID_HANDLE), AgentSlotMap::NO_INDEX);
+}
+
+TEST(AgentSlotMap, IndicesFollowReorderedAgents)
+{
+    AgentSlotMap slots{};
+    std::vector<GenericAgent> agents{agentAt({0, 0}), agentAt({1, 0}), agentAt({2, 0})};
+    for(size_t index = 0; index < agents.size(); ++index) {
+        slots.Insert(agents[index].id, index);
+    }
+    const auto handle = slots.HandleOf(agents[2].id);
+    std::swap(agents[0], agents[2]);
+    slots.Reindex(agents);
+    EXPECT_EQ(slots.IndexOfHandle(handle), 0);
+    EXPECT_EQ(slots.IndexOf(agents[2].id), 2);
+
+    slots.Erase(agents[1].id);
+    agents.erase(std::begin(agents) + 1);
+    slots.Reindex(agents);
+    EXPECT_EQ(slots.Size(), 2);
+    EXPECT_EQ(slots.IndexOf(agents[1].id), 1);
+}
+
+TEST(AgentSlotMap, HandlesOfRemovedAgentsExpire)
+{
+    AgentSlotMap slots{};
+    const auto removed = agentAt({0, 0});
+    const auto handle = slots.Insert(removed.id, 0);
+    slots.Erase(removed.id);
+    slots.Erase(removed.id);
+    EXPECT_EQ(slots.IndexOfHandle(handle), AgentSlotMap::NO_INDEX);
+    EXPECT_EQ(slots.IndexOf(removed.id), AgentSlotMap::NO_INDEX);
+
+    // The slot is reused with a new generation
+    const auto added = agentAt({1, 0});
+    const auto reused = slots.Insert(added.id, 0);
+    EXPECT_NE(reused, handle);
+    EXPECT_EQ(slots.IndexOfHandle(reused), 0);
+    EXPECT_EQ(slots.IndexOfHandle(handle), AgentSlotMap::NO_INDEX);
+}
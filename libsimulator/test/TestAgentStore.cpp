@@ -0,0 +1,66 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "AgentStore.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+GenericAgent agentWithRadius(double radius)
+{
+    CollisionFreeSpeedModelData model{};
+    model.radius = radius;
+    return GenericAgent(GenericAgent::ID::Invalid, {}, {}, {radius, 0}, {1, 0}, model);
+}
+
+// Checks that every row of 'store' belongs to the record at the same index
+void expectRowsMatchRecords(const AgentStore& store, const std::vector<GenericAgent>& agents)
+{
+    ASSERT_EQ(store.Size(), agents.size());
+    for(size_t index = 0; index < agents.size(); ++index) {
+        EXPECT_EQ(store.Positions()[index], agents[index].pos);
+        EXPECT_EQ(store.Models<CollisionFreeSpeedModelData>()[index].radius, agents[index].pos.x);
+        EXPECT_EQ(store.IndexOf(agents[index]), index);
+    }
+}
+} // namespace
+
+TEST(AgentStore, RowsFollowTheRecords)
+{
+    std::vector<GenericAgent> agents{};
+    AgentStore store(agents);
+    for(double radius : {0.1, 0.2, 0.3, 0.4}) {
+        agents.push_back(agentWithRadius(radius));
+        store.PushBack();
+    }
+    expectRowsMatchRecords(store, agents);
+
+    // Reverse the records as the neighborhood search would reorder them
+    std::vector<GenericAgent> reversed(std::rbegin(agents), std::rend(agents));
+    agents.swap(reversed);
+    store.Reorder({3, 2, 1, 0});
+    expectRowsMatchRecords(store, agents);
+
+    std::vector<bool> removed{false, true, false, true};
+    agents.erase(std::begin(agents) + 3);
+    agents.erase(std::begin(agents) + 1);
+    store.Erase(removed, 1);
+    expectRowsMatchRecords(store, agents);
+}
+
+TEST(AgentStore, ModelStateIsHeldByTheStore)
+{
+    std::vector<GenericAgent> agents{agentWithRadius(0.2)};
+    AgentStore store(agents);
+    store.PushBack();
+    AgentStore::ModelOf<CollisionFreeSpeedModelData>(agents[0]).v0 = 2.5;
+    EXPECT_EQ(store.Models<CollisionFreeSpeedModelData>()[0].v0, 2.5);
+
+    store.SetPosition(0, {1, 1});
+    EXPECT_EQ(agents[0].pos, Point(1, 1));
+    EXPECT_EQ(store.Positions()[0], Point(1, 1));
+    EXPECT_EQ(store.Destinations()[0], agents[0].target);
+    EXPECT_THROW(AgentStore::ModelOf<SocialForceModelData>(agents[0]), std::bad_variant_access);
+}
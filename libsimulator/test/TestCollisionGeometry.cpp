@@ -1,13 +1,20 @@
 // Copyright © 2012-2024 Forschungszentrum Jülich GmbH
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #include "CollisionGeometry.hpp"
+#include "GeometricFunctions.hpp"
+#include "GeometryBuilder.hpp"
 #include "LineSegment.hpp"
+#include "SimulationError.hpp"
 
 #include "gtest/gtest.h"
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
 struct CellAdjacencyTestData {
     Cell c;
     Cell neighbor;
@@ -206,6 +213,16 @@ TEST_F(ApproximateDistanceSimpleRectangle, outsideInRange)
     }
 }
 
+TEST_F(ApproximateDistanceSimpleRectangle, HasClearance)
+{
+    ASSERT_TRUE(collisionGeometry.HasClearance({{1.5, 1.5}, {2.5, 2.}}, 0.4));
+    ASSERT_FALSE(collisionGeometry.HasClearance({{1.5, 1.5}, {2.5, 2.}}, 0.5));
+    ASSERT_TRUE(collisionGeometry.HasClearance({{2., 2.}, {2., 2.}}, 0.9));
+    ASSERT_FALSE(collisionGeometry.HasClearance({{2., 2.}, {2., 2.}}, 1.));
+    ASSERT_FALSE(collisionGeometry.HasClearance({{2., 2.}, {4., 2.}}, 0.1));
+    ASSERT_TRUE(collisionGeometry.HasClearance({{5., 5.}, {9., 5.}}, 1.5));
+}
+
 class LongDiagonalRectangle : public ::testing::Test
 {
 protected:
@@ -326,3 +343,235 @@ TEST_F(LongDiagonalRectangle, CellsWithTwoLSMiddle)
         ASSERT_EQ(actual, expected);
     }
 }
+
+TEST_F(LongDiagonalRectangle, IntersectsAnyMatchesExhaustiveTest)
+{
+    const std::vector<LineSegment> walls{
+        {{-11., -13.}, {5., 11.}},
+        {{5., 11.}, {6., 10.}},
+        {{6., 10.}, {-10., -14.}},
+        {{-10., -14.}, {-11., -13.}}};
+    for(double x = -12; x <= 7; x += 0.7) {
+        for(double y = -15; y <= 12; y += 0.9) {
+            for(const auto& offset : {Point{3, 0}, Point{-1, 2.5}, Point{0.3, -0.2}}) {
+                const LineSegment segment{{x, y}, Point{x, y} + offset};
+                const bool expected =
+                    std::any_of(std::begin(walls), std::end(walls), [&segment](const auto& wall) {
+                        return intersects(segment, wall);
+                    });
+                ASSERT_EQ(collisionGeometry.IntersectsAny(segment), expected);
+            }
+        }
+    }
+}
+
+TEST_F(LongDiagonalRectangle, LineSegmentsInDistanceToMatchesExhaustiveTest)
+{
+    const std::vector<LineSegment> walls{
+        {{-11., -13.}, {5., 11.}},
+        {{5., 11.}, {6., 10.}},
+        {{6., 10.}, {-10., -14.}},
+        {{-10., -14.}, {-11., -13.}}};
+    for(double x = -12; x <= 7; x += 0.7) {
+        for(double y = -15; y <= 12; y += 0.9) {
+            for(const double distance : {0.2, 1.0, 4.5}) {
+                std::vector<LineSegment> expected{};
+                std::copy_if(
+                    std::begin(walls),
+                    std::end(walls),
+                    std::back_inserter(expected),
+                    [x, y, distance](const auto& wall) {
+                        return wall.DistTo({x, y}) <= distance;
+                    });
+                const auto actual = collisionGeometry.LineSegmentsInDistanceTo(distance, {x, y});
+                ASSERT_EQ(actual, expected);
+            }
+        }
+    }
+}
+
+TEST(CollisionGeometry, ApproximateWallDistance)
+{
+    CollisionGeometry collisionGeometry(
+        constructPolyFromPoints({{0, 0}, {10, 0}, {10, 10}, {0, 10}}));
+    ASSERT_FALSE(collisionGeometry.ApproximateWallDistance({5, 5}).has_value());
+
+    const double resolution = 0.1;
+    const double maxError = resolution * std::sqrt(2.0);
+    collisionGeometry.BuildWallDistanceField(resolution);
+    for(double x = 0.05; x < 10; x += 0.3) {
+        for(double y = 0.05; y < 10; y += 0.3) {
+            const std::vector<std::tuple<double, Point>> walls{
+                {x, {-1, 0}}, {10 - x, {1, 0}}, {y, {0, -1}}, {10 - y, {0, 1}}};
+            auto sorted = walls;
+            std::sort(std::begin(sorted), std::end(sorted), [](const auto& a, const auto& b) {
+                return std::get<0>(a) < std::get<0>(b);
+            });
+            const auto [distance, direction] = sorted[0];
+            const auto wall = collisionGeometry.ApproximateWallDistance({x, y});
+            if(distance <= CollisionGeometry::EXACT_WALL_DISTANCE) {
+                ASSERT_FALSE(wall.has_value());
+                continue;
+            }
+            if(distance > CollisionGeometry::EXACT_WALL_DISTANCE + 2 * maxError) {
+                ASSERT_TRUE(wall.has_value());
+            }
+            if(!wall) {
+                continue;
+            }
+            const auto expected = std::min(distance, CollisionGeometry::MAX_WALL_DISTANCE);
+            ASSERT_NEAR(wall->distance, expected, maxError);
+            // The direction is only well defined if there is a unique closest wall in range
+            if(distance < CollisionGeometry::MAX_WALL_DISTANCE - maxError &&
+               std::get<0>(sorted[1]) - distance > 2 * resolution) {
+                ASSERT_GT(wall->direction.ScalarProduct(direction), 0.99);
+            }
+        }
+    }
+}
+
+TEST(CollisionGeometry, InsideGeometryMatchesPolygon)
+{
+    GeometryBuilder builder{};
+    builder.AddAccessibleArea({{0, 0}, {12, 1}, {13, 9}, {6, 6.5}, {1, 10}});
+    builder.AddAccessibleArea({{12, 1}, {20, 1}, {20, 3}, {12.25, 3}});
+    builder.ExcludeFromAccessibleArea({{2, 2}, {4, 2.5}, {3, 5}});
+    builder.ExcludeFromAccessibleArea({{7, 2}, {9, 2}, {9, 4}, {7, 4}});
+    const auto collisionGeometry = builder.Build();
+    const auto& polygon = collisionGeometry.Polygon();
+    // The lattice contains all vertices and many points on the boundary
+    for(double x = -1; x <= 21; x += 0.25) {
+        for(double y = -1; y <= 11; y += 0.25) {
+            const bool expected =
+                CGAL::oriented_side(K::Point_2(x, y), polygon) != CGAL::ON_NEGATIVE_SIDE;
+            ASSERT_EQ(collisionGeometry.InsideGeometry({x, y}), expected) << x << ", " << y;
+        }
+    }
+}
+
+TEST(CollisionGeometry, StoredGeometryAnswersSameQueries)
+{
+    GeometryBuilder builder{};
+    builder.AddAccessibleArea({{0, 0}, {12, 1}, {13, 9}, {6, 6.5}, {1, 10}});
+    builder.AddAccessibleArea({{12, 1}, {20, 1}, {20, 3}, {12.25, 3}});
+    builder.ExcludeFromAccessibleArea({{2, 2}, {4, 2.5}, {3, 5}});
+    const auto collisionGeometry = builder.Build();
+
+    std::stringstream stream{};
+    BinaryWriter writer(stream);
+    collisionGeometry.Write(writer);
+    BinaryReader reader(stream);
+    const auto restored = CollisionGeometry::Read(reader);
+
+    EXPECT_NE(restored.Id(), collisionGeometry.Id());
+    EXPECT_EQ(restored.Polygon(), collisionGeometry.Polygon());
+    EXPECT_EQ(restored.AccessibleArea(), collisionGeometry.AccessibleArea());
+    for(double x = -1; x <= 21; x += 0.5) {
+        for(double y = -1; y <= 11; y += 0.5) {
+            const Point p{x, y};
+            ASSERT_EQ(restored.InsideGeometry(p), collisionGeometry.InsideGeometry(p));
+            ASSERT_EQ(
+                restored.LineSegmentsInDistanceTo(1.5, p),
+                collisionGeometry.LineSegmentsInDistanceTo(1.5, p));
+            ASSERT_EQ(
+                restored.LineSegmentsInApproxDistanceTo(p),
+                collisionGeometry.LineSegmentsInApproxDistanceTo(p));
+            const LineSegment ls(p, {10, 5});
+            ASSERT_EQ(restored.IntersectsAny(ls), collisionGeometry.IntersectsAny(ls));
+        }
+    }
+}
+
+TEST(CollisionGeometry, ClosedDoorsAreWalls)
+{
+    GeometryBuilder builder{};
+    builder.AddAccessibleArea({{0, 0}, {20, 0}, {20, 10}, {0, 10}});
+    builder.ExcludeFromAccessibleArea({{8, 2}, {12, 2}, {12, 8}, {8, 8}});
+    builder.AddDoor({10, 0}, {10, 2});
+    auto geometry = builder.Build();
+    ASSERT_EQ(geometry.Doors().size(), 1);
+    ASSERT_FALSE(geometry.IsDoorClosed(0));
+
+    const LineSegment door({10, 0}, {10, 2});
+    const LineSegment crossing({9, 1}, {11, 1});
+    const Point nearDoor{10.2, 1};
+    const auto contains = [&door](const std::vector<LineSegment>& segments) {
+        return std::find(std::begin(segments), std::end(segments), door) != std::end(segments);
+    };
+    const auto open = geometry.LineSegmentsInDistanceTo(0.5, nearDoor);
+    EXPECT_FALSE(geometry.IntersectsAny(crossing));
+    EXPECT_TRUE(geometry.HasClearance(crossing, 0.5));
+    EXPECT_FALSE(contains(open));
+    EXPECT_FALSE(contains(geometry.LineSegmentsInApproxDistanceTo(nearDoor)));
+
+    geometry.SetDoorClosed(0, true);
+    EXPECT_TRUE(geometry.IsDoorClosed(0));
+    EXPECT_TRUE(geometry.IntersectsAny(crossing));
+    EXPECT_FALSE(geometry.HasClearance(crossing, 0.5));
+    EXPECT_TRUE(contains(geometry.LineSegmentsInDistanceTo(0.5, nearDoor)));
+    EXPECT_TRUE(contains(geometry.LineSegmentsInApproxDistanceTo(nearDoor)));
+    // The door only closes the passage, the area stays accessible
+    EXPECT_TRUE(geometry.InsideGeometry({9, 1}));
+    EXPECT_TRUE(geometry.InsideGeometry({11, 1}));
+
+    geometry.SetDoorClosed(0, false);
+    EXPECT_FALSE(geometry.IntersectsAny(crossing));
+    EXPECT_TRUE(geometry.HasClearance(crossing, 0.5));
+    EXPECT_EQ(geometry.LineSegmentsInDistanceTo(0.5, nearDoor), open);
+    EXPECT_FALSE(contains(geometry.LineSegmentsInApproxDistanceTo(nearDoor)));
+
+    EXPECT_THROW(geometry.SetDoorClosed(1, true), SimulationError);
+}
+
+TEST(CollisionGeometry, ClosedDoorsAreNotHiddenByWallDistanceField)
+{
+    GeometryBuilder builder{};
+    builder.AddAccessibleArea({{0, 0}, {20, 0}, {20, 20}, {0, 20}});
+    builder.AddDoor({10, 5}, {10, 15});
+    auto geometry = builder.Build();
+    geometry.BuildWallDistanceField(0.1);
+    const Point p{11, 10};
+    ASSERT_TRUE(geometry.ApproximateWallDistance(p).has_value());
+    geometry.SetDoorClosed(0, true);
+    EXPECT_FALSE(geometry.ApproximateWallDistance(p).has_value());
+    EXPECT_TRUE(geometry.ApproximateWallDistance({3, 10}).has_value());
+}
+
+TEST(CollisionGeometry, ClosedDoorsPassingMultipleCellsAreReportedOnce)
+{
+    GeometryBuilder builder{};
+    builder.AddAccessibleArea({{0, 0}, {40, 0}, {40, 10}, {0, 10}});
+    std::vector<LineSegment> doors{};
+    for(double x = 1; x < 9; ++x) {
+        doors.emplace_back(Point{x, 1}, Point{x, 9});
+        builder.AddDoor(doors.back().p1, doors.back().p2);
+    }
+    auto geometry = builder.Build();
+    for(size_t door = 0; door < doors.size(); ++door) {
+        geometry.SetDoorClosed(door, true);
+    }
+
+    const auto segments = geometry.LineSegmentsInDistanceTo(2, {5, 4});
+    for(const auto& door : doors) {
+        const auto expected = door.DistTo({5, 4}) <= 2 ? 1 : 0;
+        EXPECT_EQ(std::count(std::begin(segments), std::end(segments), door), expected);
+    }
+    EXPECT_TRUE(geometry.IntersectsAny(LineSegment({4.5, 4}, {5.5, 4})));
+}
+
+TEST(CollisionGeometry, DoorsMustLieInsideWithoutCrossingWalls)
+{
+    const auto build = [](Point from, Point to) {
+        GeometryBuilder builder{};
+        builder.AddAccessibleArea({{0, 0}, {20, 0}, {20, 10}, {0, 10}});
+        builder.ExcludeFromAccessibleArea({{8, 2}, {12, 2}, {12, 8}, {8, 8}});
+        builder.AddDoor(from, to);
+        return builder.Build();
+    };
+    EXPECT_NO_THROW(build({10, 8}, {10, 10}));
+    EXPECT_NO_THROW(build({2, 2}, {4, 4}));
+    EXPECT_THROW(build({6, 5}, {14, 5}), SimulationError);
+    EXPECT_THROW(build({10, 9}, {10, 12}), SimulationError);
+    EXPECT_THROW(build({10, 4}, {10, 6}), SimulationError);
+    EXPECT_THROW(build({2, 2}, {2, 2}), SimulationError);
+}
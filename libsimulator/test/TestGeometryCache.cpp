@@ -0,0 +1,242 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "GeometryCache.hpp"
+#include "GeometryBuilder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+CollisionGeometry rectangle(double width)
+{
+    GeometryBuilder builder{};
+    builder.AddAccessibleArea({{0, 0}, {width, 0}, {width, 10}, {0, 10}});
+    builder.ExcludeFromAccessibleArea({{2, 2}, {4, 2}, {4, 4}, {2, 4}});
+    return builder.Build();
+}
+
+Poly ring(const std::vector<K::Point_2>& points)
+{
+    return Poly{std::begin(points), std::end(points)};
+}
+
+std::vector<std::filesystem::path>
+filesIn(const std::filesystem::path& directory, const std::string& prefix = "")
+{
+    std::vector<std::filesystem::path> files{};
+    for(const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if(entry.path().filename().string().rfind(prefix, 0) == 0) {
+            files.push_back(entry.path());
+        }
+    }
+    return files;
+}
+} // namespace
+
+class GeometryCacheTest : public ::testing::Test
+{
+protected:
+    GeometryCache& cache{GeometryCache::Instance()};
+
+    void SetUp() override
+    {
+        cache.Clear();
+        ASSERT_EQ(cache.Size(), 0);
+    }
+    void TearDown() override { cache.Clear(); }
+};
+
+TEST_F(GeometryCacheTest, GeometriesWithSameContentShareEntries)
+{
+    const auto first = rectangle(20);
+    const auto second = rectangle(20);
+    ASSERT_NE(first.Id(), second.Id());
+
+    const auto a = cache.Get(first, 0, RoutingBackend::Triangulation);
+    const auto b = cache.Get(second, 0, RoutingBackend::Triangulation);
+    EXPECT_EQ(a.geometry, b.geometry);
+    EXPECT_EQ(a.routingEngine, b.routingEngine);
+    EXPECT_EQ(cache.Size(), 1);
+
+    const auto other = cache.Get(rectangle(30), 0, RoutingBackend::Triangulation);
+    EXPECT_NE(other.geometry, a.geometry);
+    EXPECT_NE(other.routingEngine, a.routingEngine);
+    EXPECT_EQ(cache.Size(), 2);
+}
+
+TEST_F(GeometryCacheTest, OptionsArePartOfTheKey)
+{
+    const auto geometry = rectangle(20);
+    const auto triangulation = cache.Get(geometry, 0, RoutingBackend::Triangulation);
+    const auto polyanya = cache.Get(geometry, 0, RoutingBackend::Polyanya);
+    const auto withField = cache.Get(geometry, 0.2, RoutingBackend::Triangulation);
+    EXPECT_NE(triangulation.routingEngine, polyanya.routingEngine);
+    EXPECT_NE(triangulation.geometry, withField.geometry);
+    EXPECT_FALSE(triangulation.geometry->ApproximateWallDistance({10, 8}).has_value());
+    EXPECT_TRUE(withField.geometry->ApproximateWallDistance({10, 8}).has_value());
+    EXPECT_EQ(cache.Size(), 3);
+}
+
+TEST_F(GeometryCacheTest, RecentlyUsedEntriesAreRetained)
+{
+    const auto* engine =
+        cache.Get(rectangle(20), 0, RoutingBackend::Triangulation).routingEngine.get();
+    EXPECT_EQ(cache.Size(), 1);
+    const auto again = cache.Get(rectangle(20), 0, RoutingBackend::Triangulation);
+    EXPECT_EQ(again.routingEngine.get(), engine);
+
+    for(size_t index = 0; index < GeometryCache::RETAINED_ENTRIES; ++index) {
+        cache.Get(rectangle(30 + index), 0, RoutingBackend::Triangulation);
+    }
+    // The first entry is still in use by 'again'
+    EXPECT_EQ(cache.Size(), GeometryCache::RETAINED_ENTRIES + 1);
+
+    cache.Clear();
+    EXPECT_EQ(cache.Size(), 1);
+}
+
+TEST_F(GeometryCacheTest, EntriesInUseAreNotReleased)
+{
+    std::vector<GeometryCache::Entry> used{};
+    for(size_t index = 0; index <= GeometryCache::RETAINED_ENTRIES; ++index) {
+        used.push_back(cache.Get(rectangle(20 + index), 0, RoutingBackend::Triangulation));
+    }
+    cache.Clear();
+    EXPECT_EQ(cache.Size(), used.size());
+    const auto again = cache.Get(rectangle(20), 0, RoutingBackend::Triangulation);
+    EXPECT_EQ(again.routingEngine, used.front().routingEngine);
+
+    used.clear();
+    EXPECT_EQ(cache.Size(), 1);
+}
+
+TEST_F(GeometryCacheTest, ConcurrentRequestsBuildEachEntryOnce)
+{
+    std::vector<GeometryCache::Entry> entries(8);
+    {
+        std::vector<std::thread> threads{};
+        for(size_t index = 0; index < entries.size(); ++index) {
+            threads.emplace_back([this, &entries, index]() {
+                // Two different entries requested by four threads each
+                entries[index] =
+                    cache.Get(rectangle(20 + 10 * (index % 2)), 0, RoutingBackend::Triangulation);
+            });
+        }
+        for(auto& thread : threads) {
+            thread.join();
+        }
+    }
+    EXPECT_EQ(cache.Size(), 2);
+    for(size_t index = 2; index < entries.size(); ++index) {
+        EXPECT_EQ(entries[index].routingEngine, entries[index % 2].routingEngine);
+        EXPECT_EQ(entries[index].geometry, entries[index % 2].geometry);
+    }
+    EXPECT_NE(entries[0].routingEngine, entries[1].routingEngine);
+}
+
+class GeometryCacheDirectoryTest : public GeometryCacheTest
+{
+protected:
+    std::filesystem::path directory{};
+    const std::vector<Poly> areas{ring({{0, 0}, {20, 0}, {20, 10}, {0, 10}})};
+    const std::vector<Poly> exclusions{ring({{2, 2}, {4, 2}, {4, 4}, {2, 4}})};
+
+    void SetUp() override
+    {
+        GeometryCacheTest::SetUp();
+        directory = std::filesystem::temp_directory_path() /
+                    ("jps-geometry-cache-test-" + std::to_string(std::random_device{}()));
+        cache.SetDirectory(directory);
+    }
+    void TearDown() override
+    {
+        cache.SetDirectory({});
+        std::filesystem::remove_all(directory);
+        GeometryCacheTest::TearDown();
+    }
+
+    CollisionGeometry loadWithoutBuilding()
+    {
+        return cache.LoadGeometry(areas, exclusions, {}, []() -> CollisionGeometry {
+            throw std::logic_error("geometry was built instead of loaded");
+        });
+    }
+};
+
+TEST_F(GeometryCacheDirectoryTest, BuiltGeometriesAreLoadedFromDirectory)
+{
+    size_t builds = 0;
+    const auto build = [&builds]() {
+        ++builds;
+        return rectangle(20);
+    };
+    const auto built = cache.LoadGeometry(areas, exclusions, {}, build);
+    EXPECT_EQ(builds, 1);
+    ASSERT_EQ(filesIn(directory).size(), 1);
+
+    const auto loaded = loadWithoutBuilding();
+    EXPECT_EQ(loaded.Polygon(), built.Polygon());
+    EXPECT_EQ(
+        loaded.LineSegmentsInDistanceTo(3, {3, 5}), built.LineSegmentsInDistanceTo(3, {3, 5}));
+
+    const std::vector<Poly> otherAreas{ring({{0, 0}, {30, 0}, {30, 10}, {0, 10}})};
+    cache.LoadGeometry(otherAreas, exclusions, {}, [&build]() { return build(); });
+    EXPECT_EQ(builds, 2);
+}
+
+TEST_F(GeometryCacheDirectoryTest, DamagedFilesAreReplaced)
+{
+    cache.LoadGeometry(areas, exclusions, {}, []() { return rectangle(20); });
+    const auto file = filesIn(directory).front();
+    std::filesystem::resize_file(file, std::filesystem::file_size(file) / 2);
+    EXPECT_THROW(loadWithoutBuilding(), std::logic_error);
+
+    size_t builds = 0;
+    cache.LoadGeometry(areas, exclusions, {}, [&builds]() {
+        ++builds;
+        return rectangle(20);
+    });
+    EXPECT_EQ(builds, 1);
+    EXPECT_NO_THROW(loadWithoutBuilding());
+}
+
+TEST_F(GeometryCacheDirectoryTest, RoutingEnginesAreLoadedFromDirectory)
+{
+    const Point from{1, 1};
+    const Point to{19, 9};
+    std::vector<Point> expected{};
+    {
+        const auto entry = cache.Get(rectangle(20), 0, RoutingBackend::Triangulation);
+        expected = entry.routingEngine->ComputeAllWaypoints(from, to);
+    }
+    cache.Clear();
+    ASSERT_EQ(cache.Size(), 0);
+    ASSERT_EQ(filesIn(directory, "routing-").size(), 1);
+
+    // Garbage behind the header and inputs makes loading fail, the engine is built again
+    const auto file = filesIn(directory, "routing-").front();
+    const auto size = std::filesystem::file_size(file);
+    {
+        std::fstream stream(file, std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekp(static_cast<std::streamoff>(size - 64));
+        stream << std::string(64, 'x');
+    }
+    for(int run = 0; run < 2; ++run) {
+        const auto entry = cache.Get(rectangle(20), 0, RoutingBackend::Triangulation);
+        EXPECT_EQ(entry.routingEngine->ComputeAllWaypoints(from, to), expected);
+        cache.Clear();
+    }
+    EXPECT_EQ(std::filesystem::file_size(file), size);
+
+    const auto polyanya = cache.Get(rectangle(20), 0, RoutingBackend::Polyanya);
+    EXPECT_EQ(polyanya.routingEngine->Backend(), RoutingBackend::Polyanya);
+    EXPECT_EQ(filesIn(directory, "routing-").size(), 2);
+}
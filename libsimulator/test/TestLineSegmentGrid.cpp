@@ -0,0 +1,161 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "LineSegmentGrid.hpp"
+
+#include "BinaryStream.hpp"
+#include "SimulationError.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+std::vector<LineSegment> zigZag()
+{
+    std::vector<LineSegment> segments{};
+    for(int index = 0; index < 20; ++index) {
+        segments.emplace_back(Point{index * 1.0, 0.0}, Point{index + 1.0, index % 2 ? 0.0 : 3.0});
+    }
+    segments.emplace_back(Point{0, 10}, Point{20, 10});
+    return segments;
+}
+
+// Reads a grid of two cells in a row, each holding the segment at index 0.
+LineSegmentGrid readTwoCellGrid(
+    std::vector<uint32_t> cellOffsets,
+    std::vector<uint32_t> segmentIndices,
+    std::vector<uint32_t> occupiedCells)
+{
+    std::stringstream stream{};
+    BinaryWriter writer(stream);
+    writer.Write(Point{0, 0});
+    writer.Write(1.0);
+    writer.Write(int32_t{2});
+    writer.Write(int32_t{1});
+    writer.Write(cellOffsets);
+    writer.Write(segmentIndices);
+    writer.Write(occupiedCells);
+    writer.Write(std::vector<uint8_t>{0, 0});
+    BinaryReader reader(stream);
+    return LineSegmentGrid::Read(reader, {{{0, 0}, {2, 1}}});
+}
+} // namespace
+
+TEST(LineSegmentGrid, EmptyGridContainsNothing)
+{
+    const LineSegmentGrid grid({}, 1);
+    ASSERT_FALSE(grid.AnyIn(AABB({0, 0}, {10, 10})));
+}
+
+TEST(LineSegmentGrid, AnyInDetectsOccupiedCells)
+{
+    const LineSegmentGrid grid(zigZag(), 0.5);
+    ASSERT_TRUE(grid.AnyIn(AABB({0, 0}, {1, 1})));
+    ASSERT_TRUE(grid.AnyIn(AABB({5, 9.8}, {5.1, 9.9})));
+    ASSERT_FALSE(grid.AnyIn(AABB({5, 4}, {15, 9})));
+    ASSERT_FALSE(grid.AnyIn(AABB({-5, -5}, {-1, -1})));
+    ASSERT_TRUE(grid.AnyIn(AABB({-5, -5}, {50, 50})));
+}
+
+TEST(LineSegmentGrid, ReportsAllSegmentsInBounds)
+{
+    const auto segments = zigZag();
+    const LineSegmentGrid grid(segments, 0.5);
+    const std::vector<AABB> queries{
+        AABB({0.2, 0.2}, {0.4, 0.4}), AABB({3, 2}, {7, 4}), AABB({0, 9}, {1, 12})};
+    for(const auto& bounds : queries) {
+        std::set<size_t> actual{};
+        grid.AnyOf(
+            bounds,
+            [](const AABB&) { return true; },
+            [&actual](size_t index) {
+                actual.insert(index);
+                return false;
+            });
+        for(size_t index = 0; index < segments.size(); ++index) {
+            if(bounds.Intersects(segments[index])) {
+                ASSERT_EQ(actual.count(index), 1);
+            }
+        }
+    }
+}
+
+TEST(LineSegmentGrid, StopsWhenFunctionReturnsTrue)
+{
+    const LineSegmentGrid grid(zigZag(), 0.5);
+    size_t calls = 0;
+    const auto found = grid.AnyOf(
+        AABB({0, 0}, {20, 10}),
+        [](const AABB&) { return true; },
+        [&calls](size_t) { return ++calls == 3; });
+    ASSERT_TRUE(found);
+    ASSERT_EQ(calls, 3);
+}
+
+TEST(LineSegmentGrid, OddCrossingsLeftOfClosedPolylines)
+{
+    // Square with a diamond shaped hole, the hole has vertices on the center lines of the cells.
+    const std::vector<LineSegment> segments{
+        {{0, 0}, {10, 0}},
+        {{10, 0}, {10, 10}},
+        {{10, 10}, {0, 10}},
+        {{0, 10}, {0, 0}},
+        {{5, 2.25}, {7.75, 5}},
+        {{7.75, 5}, {5, 7.75}},
+        {{5, 7.75}, {2.25, 5}},
+        {{2.25, 5}, {5, 2.25}}};
+    const LineSegmentGrid grid(segments, 0.5);
+    const auto inside = [](Point p) {
+        const bool inSquare = p.x > 0 && p.x < 10 && p.y > 0 && p.y < 10;
+        const bool inHole = std::abs(p.x - 5) + std::abs(p.y - 5) < 2.75;
+        return inSquare && !inHole;
+    };
+    for(double x = -1.1; x < 11; x += 0.3) {
+        for(double y = -1.05; y < 11; y += 0.25) {
+            if(std::abs(std::abs(x - 5) + std::abs(y - 5) - 2.75) < 1e-9) {
+                continue;
+            }
+            ASSERT_EQ(grid.OddCrossingsLeftOf({x, y}), inside({x, y})) << x << ", " << y;
+        }
+    }
+    // Rays passing exactly through vertices of the hole
+    ASSERT_TRUE(grid.OddCrossingsLeftOf({9, 5}));
+    ASSERT_TRUE(grid.OddCrossingsLeftOf({9, 2.25}));
+    ASSERT_TRUE(grid.OddCrossingsLeftOf({9, 7.75}));
+    ASSERT_FALSE(grid.OddCrossingsLeftOf({12, 5}));
+}
+
+TEST(LineSegmentGrid, StoredGridAnswersSameQueries)
+{
+    const auto segments = zigZag();
+    const LineSegmentGrid grid(segments, 0.5);
+    std::stringstream stream{};
+    BinaryWriter writer(stream);
+    grid.Write(writer);
+    BinaryReader reader(stream);
+    const auto stored = LineSegmentGrid::Read(reader, segments);
+    for(const auto& bounds :
+        {AABB({0, 0}, {1, 1}), AABB({5, 4}, {15, 9}), AABB({5, 9.8}, {5.1, 9.9})}) {
+        ASSERT_EQ(stored.AnyIn(bounds), grid.AnyIn(bounds));
+    }
+    for(double x = -1.1; x < 21; x += 0.7) {
+        ASSERT_EQ(stored.OddCrossingsLeftOf({x, 1.5}), grid.OddCrossingsLeftOf({x, 1.5}));
+    }
+}
+
+TEST(LineSegmentGrid, ReadingInconsistentDataThrows)
+{
+    ASSERT_NO_THROW(readTwoCellGrid({0, 1, 2}, {0, 0}, {0, 0, 0, 1, 0, 2}));
+    // Decreasing offsets
+    EXPECT_THROW(readTwoCellGrid({0, 2, 1}, {0}, {0, 0, 0, 1, 0, 2}), SimulationError);
+    // Offsets not ending at the number of indices
+    EXPECT_THROW(readTwoCellGrid({0, 1, 1}, {0, 0}, {0, 0, 0, 1, 0, 2}), SimulationError);
+    // Index of a segment that does not exist
+    EXPECT_THROW(readTwoCellGrid({0, 1, 2}, {0, 1}, {0, 0, 0, 1, 0, 2}), SimulationError);
+    // More occupied cells than cells
+    EXPECT_THROW(readTwoCellGrid({0, 1, 2}, {0, 0}, {0, 0, 0, 1, 0, 3}), SimulationError);
+}
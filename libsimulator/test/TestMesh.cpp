@@ -82,3 +82,57 @@ TEST_F(DoubleBottleNeckMesh, RegressionInContains)
         m->FindContainingPolygon({26.690912185191067, 4.94908998002494}),
         Mesh::Polygon::InvalidIndex);
 }
+
+TEST_F(DoubleBottleNeckMesh, MergedPolygonsContainTheirTriangles)
+{
+    const auto triangles = m->Clone();
+    m->MergeGreedy();
+    ASSERT_LT(m->CountPolygons(), triangles->CountPolygons());
+
+    for(size_t triangle = 0; triangle < triangles->CountPolygons(); ++triangle) {
+        glm::dvec2 centroid{};
+        for(const auto vertex : triangles->Polygons(triangle).vertices) {
+            centroid += triangles->Vertex(vertex) / 3.0;
+        }
+        const auto& polygon = m->Polygons(m->PolygonOfTriangle(triangle));
+        const auto count = polygon.vertices.size();
+        for(size_t index = 0; index < count; ++index) {
+            const auto a = m->Vertex(polygon.vertices[index]);
+            const auto b = m->Vertex(polygon.vertices[(index + 1) % count]);
+            const auto ab = b - a;
+            const auto ac = centroid - a;
+            EXPECT_GT(ab.x * ac.y - ab.y * ac.x, 0);
+        }
+    }
+}
+
+TEST_F(DoubleBottleNeckMesh, FindsMergedPolygons)
+{
+    m->MergeGreedy();
+    for(const glm::dvec2 p :
+        {glm::dvec2{5, 5}, glm::dvec2{12, 5}, glm::dvec2{20, 9}, glm::dvec2{28, 5}}) {
+        const auto polygon = m->FindContainingPolygon(p);
+        ASSERT_NE(polygon, Mesh::Polygon::InvalidIndex);
+        EXPECT_TRUE(m->PolygonContains(polygon, p));
+    }
+    EXPECT_EQ(m->FindContainingPolygon({12, 8}), Mesh::Polygon::InvalidIndex);
+    EXPECT_EQ(m->FindContainingPolygon({-1, 5}), Mesh::Polygon::InvalidIndex);
+}
+
+TEST_F(DoubleBottleNeckMesh, HintedLookupFindsPolygonFromAnyHint)
+{
+    for(const glm::dvec2 p :
+        {glm::dvec2{0, 0}, glm::dvec2{5, 5}, glm::dvec2{12, 5}, glm::dvec2{27, 5}}) {
+        const auto expected = m->FindContainingPolygon(p);
+        ASSERT_NE(expected, Mesh::Polygon::InvalidIndex);
+        for(size_t hint = 0; hint < m->CountPolygons(); ++hint) {
+            const auto polygon = m->FindContainingPolygon(p, hint);
+            ASSERT_NE(polygon, Mesh::Polygon::InvalidIndex);
+            EXPECT_TRUE(m->PolygonContains(polygon, p));
+        }
+        EXPECT_EQ(m->FindContainingPolygon(p, Mesh::Polygon::InvalidIndex), expected);
+    }
+    for(size_t hint = 0; hint < m->CountPolygons(); ++hint) {
+        EXPECT_EQ(m->FindContainingPolygon({12, 8}, hint), Mesh::Polygon::InvalidIndex);
+    }
+}
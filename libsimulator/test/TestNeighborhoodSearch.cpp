@@ -6,7 +6,9 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include <iterator>
+#include <map>
 #include <memory>
+#include <set>
 
 template <typename T>
 struct ValueWithPos {
@@ -123,3 +125,242 @@ TEST(NeighborhoodSearch, ReturnsValueExactlyDistanceAwayFromQueryPoint)
         [](const auto& v) { return v.val; });
     ASSERT_EQ(actual, expected);
 }
+
+TEST(NeighborhoodSearch, VisitsValuesInStorageWithoutCopies)
+{
+    NeighborhoodSearch<ValueWithPos<int>> neighborhood{3};
+    const std::vector<ValueWithPos<int>> agents{{{0, 0}, 1}, {{0.5, 0.5}, 2}, {{10, 10}, 3}};
+    neighborhood.Update(agents);
+
+    std::set<const ValueWithPos<int>*> actual{};
+    neighborhood.ForEachNeighbor(
+        {0, 0}, 1, [&actual](const auto& value) { actual.insert(&value); });
+    const auto expected = std::set<const ValueWithPos<int>*>{&agents[0], &agents[1]};
+    ASSERT_EQ(actual, expected);
+
+    std::vector<const ValueWithPos<int>*> pointers{};
+    neighborhood.GetNeighboringAgents({10, 10}, 1, pointers);
+    ASSERT_EQ(pointers.size(), 1);
+    ASSERT_EQ(pointers.front(), &agents[2]);
+}
+
+TEST(NeighborhoodSearch, AddedValuesCanBeFound)
+{
+    NeighborhoodSearch<ValueWithPos<int>> neighborhood{3};
+    std::vector<ValueWithPos<int>> agents{{{0, 0}, 1}};
+    neighborhood.Update(agents);
+    agents.push_back({{1, 1}, 2});
+    neighborhood.AddAgent(agents, agents.size() - 1);
+
+    std::set<int> actual{};
+    neighborhood.ForEachNeighbor(
+        {0, 0}, 2, [&actual](const auto& value) { actual.insert(value.val); });
+    ASSERT_EQ(actual, (std::set<int>{1, 2}));
+}
+
+TEST(NeighborhoodSearch, DenseGridFindsSameValuesAsHashGrid)
+{
+    std::vector<ValueWithPos<int>> agents{};
+    for(int index = 0; index < 400; ++index) {
+        // Deterministic pseudo random spread, including some values outside of the bounds
+        const double x = std::fmod(index * 7.31, 23.0) - 1.5;
+        const double y = std::fmod(index * 3.17, 17.0) - 1.0;
+        agents.push_back({{x, y}, index});
+    }
+    NeighborhoodSearch<ValueWithPos<int>> hash{2.2};
+    NeighborhoodSearch<ValueWithPos<int>> dense{2.2, NeighborhoodSearchBackend::DenseGrid};
+    dense.SetBounds(AABB(Point{0, 0}, Point{20, 15}));
+    hash.Update(agents);
+    dense.Update(agents);
+
+    for(const Point& pos : {Point{0, 0}, Point{5, 5}, Point{19.9, 14.9}, Point{-3, 20}}) {
+        for(double radius : {0.5, 2.2, 4.0}) {
+            std::set<int> expected{};
+            hash.ForEachNeighbor(
+                pos, radius, [&expected](const auto& value) { expected.insert(value.val); });
+            std::set<int> actual{};
+            dense.ForEachNeighbor(
+                pos, radius, [&actual](const auto& value) { actual.insert(value.val); });
+            ASSERT_EQ(actual, expected);
+        }
+    }
+}
+
+TEST(NeighborhoodSearch, DenseGridFindsValuesInSparselyPopulatedBounds)
+{
+    // Cells of size 1 would exceed any limit, the grid uses larger cells for few values
+    std::vector<ValueWithPos<int>> agents{
+        {{10, 10}, 0}, {{10.5, 10}, 1}, {{50000, 20000}, 2}, {{50001, 20000}, 3}, {{99999, 1}, 4}};
+    NeighborhoodSearch<ValueWithPos<int>> neighborhood{1, NeighborhoodSearchBackend::DenseGrid};
+    neighborhood.SetBounds(AABB(Point{0, 0}, Point{100000, 100000}));
+    neighborhood.Update(agents);
+
+    const auto neighborsOf = [&neighborhood](Point pos) {
+        std::set<int> actual{};
+        neighborhood.ForEachNeighbor(
+            pos, 1.5, [&actual](const auto& value) { actual.insert(value.val); });
+        return actual;
+    };
+    EXPECT_EQ(neighborsOf({10, 10}), (std::set<int>{0, 1}));
+    EXPECT_EQ(neighborsOf({50000.5, 20000}), (std::set<int>{2, 3}));
+    EXPECT_EQ(neighborsOf({99999, 0}), (std::set<int>{4}));
+    EXPECT_TRUE(neighborsOf({30000, 30000}).empty());
+}
+
+TEST(NeighborhoodSearch, DenseGridFindsAddedValues)
+{
+    NeighborhoodSearch<ValueWithPos<int>> neighborhood{3, NeighborhoodSearchBackend::DenseGrid};
+    neighborhood.SetBounds(AABB(Point{0, 0}, Point{10, 10}));
+    std::vector<ValueWithPos<int>> agents{{{1, 1}, 1}};
+    neighborhood.Update(agents);
+    agents.push_back({{2, 2}, 2});
+    neighborhood.AddAgent(agents, agents.size() - 1);
+    agents.push_back({{9, 9}, 3});
+    neighborhood.AddAgent(agents, agents.size() - 1);
+
+    std::set<int> actual{};
+    neighborhood.ForEachNeighbor(
+        {1, 1}, 2, [&actual](const auto& value) { actual.insert(value.val); });
+    ASSERT_EQ(actual, (std::set<int>{1, 2}));
+}
+
+TEST(NeighborhoodSearch, DenseGridReordersValuesByCell)
+{
+    NeighborhoodSearch<ValueWithPos<int>> neighborhood{1, NeighborhoodSearchBackend::DenseGrid};
+    neighborhood.SetBounds(AABB(Point{0, 0}, Point{10, 10}));
+    std::vector<ValueWithPos<int>> agents{
+        {{5.5, 5.5}, 0}, {{0.5, 0.5}, 1}, {{5.6, 5.6}, 2}, {{0.6, 0.6}, 3}, {{9.5, 0.5}, 4}};
+    neighborhood.UpdateAndReorder(agents);
+
+    std::vector<int> order{};
+    std::transform(
+        std::begin(agents), std::end(agents), std::back_inserter(order), [](const auto& v) {
+            return v.val;
+        });
+    ASSERT_EQ(order, (std::vector<int>{1, 3, 0, 2, 4}));
+    ASSERT_EQ(neighborhood.ReorderedIndices(), (std::vector<size_t>{2, 0, 3, 1, 4}));
+
+    std::set<int> actual{};
+    neighborhood.ForEachNeighbor(
+        {5.5, 5.5}, 0.5, [&actual](const auto& value) { actual.insert(value.val); });
+    ASSERT_EQ(actual, (std::set<int>{0, 2}));
+}
+
+TEST(NeighborhoodSearch, NeighborListsAreReusedUntilValuesMovedHalfTheSkin)
+{
+    size_t clearanceChecks = 0;
+    NeighborhoodSearch<ValueWithPos<int>> neighborhood{2};
+    neighborhood.EnableNeighborLists(1, 1, [&clearanceChecks](Point, Point, double distance) {
+        EXPECT_EQ(distance, 0.5);
+        ++clearanceChecks;
+        return true;
+    });
+    std::vector<ValueWithPos<int>> agents{{{0, 0}, 0}, {{1.8, 0}, 1}, {{5, 0}, 2}};
+    neighborhood.Update(agents);
+    ASSERT_EQ(clearanceChecks, 2);
+
+    const auto neighborsOf = [&](size_t index) {
+        std::set<int> result{};
+        neighborhood.ForEachNeighborOf(
+            agents[index], 1, [&result](const auto& value, bool lineOfSight) {
+                EXPECT_TRUE(lineOfSight);
+                result.insert(value.val);
+            });
+        return result;
+    };
+    ASSERT_EQ(neighborsOf(0), std::set<int>{});
+
+    agents[0].pos = {0.4, 0};
+    neighborhood.Update(agents);
+    ASSERT_EQ(clearanceChecks, 2);
+    ASSERT_EQ(neighborsOf(0), std::set<int>{});
+    ASSERT_EQ(neighborsOf(1), std::set<int>{});
+
+    agents[1].pos = {1.3, 0};
+    neighborhood.Update(agents);
+    ASSERT_EQ(clearanceChecks, 2);
+    ASSERT_EQ(neighborsOf(0), std::set<int>{1});
+    ASSERT_EQ(neighborsOf(1), std::set<int>{0});
+
+    agents[2].pos = {4.4, 0};
+    neighborhood.Update(agents);
+    ASSERT_EQ(clearanceChecks, 4);
+    ASSERT_EQ(neighborsOf(2), std::set<int>{});
+}
+
+TEST(NeighborhoodSearch, NeighborListsReportUnknownLineOfSight)
+{
+    NeighborhoodSearch<ValueWithPos<int>> neighborhood{2};
+    neighborhood.EnableNeighborLists(2, 0.5, [](Point from, Point to, double) {
+        return from.x + to.x < 1;
+    });
+    std::vector<ValueWithPos<int>> agents{{{0, 0}, 0}, {{0, 1}, 1}, {{1, 0}, 2}};
+    neighborhood.Update(agents);
+
+    std::map<int, bool> lineOfSight{};
+    neighborhood.ForEachNeighborOf(agents[0], 2, [&lineOfSight](const auto& value, bool clear) {
+        lineOfSight[value.val] = clear;
+    });
+    ASSERT_EQ(lineOfSight, (std::map<int, bool>{{1, true}, {2, false}}));
+
+    // Queries for values outside of the storage or beyond the cutoff use the grid
+    const ValueWithPos<int> outside{{0, 0}, 3};
+    std::set<int> actual{};
+    neighborhood.ForEachNeighborOf(outside, 2, [&actual](const auto& value, bool clear) {
+        EXPECT_FALSE(clear);
+        actual.insert(value.val);
+    });
+    ASSERT_EQ(actual, (std::set<int>{0, 1, 2}));
+}
+
+TEST(NeighborhoodSearch, AddedValuesInvalidateNeighborLists)
+{
+    NeighborhoodSearch<ValueWithPos<int>> neighborhood{2, NeighborhoodSearchBackend::DenseGrid};
+    neighborhood.SetBounds(AABB(Point{0, 0}, Point{10, 10}));
+    neighborhood.EnableNeighborLists(1, 1, [](Point, Point, double) { return true; });
+    std::vector<ValueWithPos<int>> agents{{{1, 1}, 0}};
+    neighborhood.UpdateAndReorder(agents);
+    agents.push_back({{1.5, 1}, 1});
+    neighborhood.AddAgent(agents, agents.size() - 1);
+
+    std::set<int> actual{};
+    neighborhood.ForEachNeighborOf(
+        agents[0], 1, [&actual](const auto& value, bool) { actual.insert(value.val); });
+    ASSERT_EQ(actual, (std::set<int>{0, 1}));
+
+    neighborhood.UpdateAndReorder(agents);
+    actual.clear();
+    neighborhood.ForEachNeighborOf(
+        agents[0], 1, [&actual](const auto& value, bool) { actual.insert(value.val); });
+    ASSERT_EQ(actual, (std::set<int>{1}));
+}
+
+TEST(NeighborhoodSearch, NeighborIndicesAreFilteredOnCurrentPositions)
+{
+    NeighborhoodSearch<ValueWithPos<int>> neighborhood{2};
+    neighborhood.EnableNeighborLists(2, 0.5, [](Point from, Point to, double) {
+        return from.x + to.x < 1;
+    });
+    std::vector<ValueWithPos<int>> agents{{{0, 0}, 0}, {{0, 1}, 1}, {{1, 0}, 2}};
+    neighborhood.Update(agents);
+    std::vector<Point> positions{{0, 0}, {0, 1}, {1, 0}};
+
+    std::map<size_t, bool> lineOfSight{};
+    neighborhood.ForEachNeighborIndexOf(
+        0, positions, 2, [&lineOfSight](size_t index, bool clear) { lineOfSight[index] = clear; });
+    ASSERT_EQ(lineOfSight, (std::map<size_t, bool>{{1, true}, {2, false}}));
+
+    positions[2] = {1.9, 1.9};
+    std::set<size_t> actual{};
+    neighborhood.ForEachNeighborIndexOf(
+        0, positions, 2, [&actual](size_t index, bool) { actual.insert(index); });
+    ASSERT_EQ(actual, (std::set<size_t>{1}));
+
+    // Without neighbor lists covering the radius the grid is searched
+    actual.clear();
+    neighborhood.ForEachNeighborIndexOf(0, positions, 3, [&actual](size_t index, bool clear) {
+        EXPECT_FALSE(clear);
+        actual.insert(index);
+    });
+    ASSERT_EQ(actual, (std::set<size_t>{0, 1, 2}));
+}
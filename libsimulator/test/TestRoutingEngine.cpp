@@ -0,0 +1,528 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "CfgCgal.hpp"
+#include "LineSegment.hpp"
+#include "RoutingEngine.hpp"
+#include "SimulationError.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+class UShapedRoutingEngine : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        // POLYGON ((0 0, 30 0, 30 20, 20 20, 20 5, 10 5, 10 20, 0 20, 0 0))
+        const std::vector<K::Point_2> points{
+            {0, 0}, {30, 0}, {30, 20}, {20, 20}, {20, 5}, {10, 5}, {10, 20}, {0, 20}};
+        engine = std::make_unique<RoutingEngine>(
+            PolyWithHoles(Poly{std::begin(points), std::end(points)}));
+    }
+
+protected:
+    std::unique_ptr<RoutingEngine> engine{};
+};
+
+TEST_F(UShapedRoutingEngine, WaypointInSameFaceIsDestination)
+{
+    const Point destination{5, 19};
+    ASSERT_EQ(engine->ComputeWaypoint({5, 19.5}, destination), destination);
+}
+
+TEST_F(UShapedRoutingEngine, WaypointMatchesFirstWaypointOfSearch)
+{
+    const Point destination{25, 18};
+    for(const Point& from : {Point{5, 18}, Point{2, 10}, Point{8, 3}, Point{15, 2}, Point{25, 2}}) {
+        const auto waypoints = engine->ComputeAllWaypoints(from, destination);
+        ASSERT_GE(waypoints.size(), 2);
+        const auto waypoint = engine->ComputeWaypoint(from, destination);
+        EXPECT_EQ(waypoint, waypoints[1]);
+    }
+}
+
+TEST_F(UShapedRoutingEngine, WaypointLeadsAroundObstacle)
+{
+    const auto waypoint = engine->ComputeWaypoint({5, 18}, {25, 18});
+    // First corner is at the inner corner (10, 5) of the left arm
+    EXPECT_GT(waypoint.x, 9);
+    EXPECT_LT(waypoint.x, 10);
+    EXPECT_GT(waypoint.y, 4);
+    EXPECT_LT(waypoint.y, 5);
+}
+
+TEST_F(UShapedRoutingEngine, ClearedNavigationFieldsAreRebuilt)
+{
+    const Point from{5, 18};
+    const Point destination{25, 18};
+    const auto before = engine->ComputeWaypoint(from, destination);
+    engine->ClearNavigationFields();
+    EXPECT_EQ(engine->ComputeWaypoint(from, destination), before);
+}
+
+TEST_F(UShapedRoutingEngine, PrecomputedNavigationFieldsGiveSameWaypoints)
+{
+    const std::vector<Point> destinations{{25, 18}, {5, 19}, {25, 18}, {15, 2}};
+    std::vector<Point> expected{};
+    for(const auto& destination : destinations) {
+        expected.push_back(engine->ComputeWaypoint({5, 18}, destination));
+    }
+    engine->ClearNavigationFields();
+
+    ThreadPool threadPool(2);
+    engine->PrecomputeNavigationFields(destinations, threadPool);
+    for(size_t index = 0; index < destinations.size(); ++index) {
+        EXPECT_EQ(engine->ComputeWaypoint({5, 18}, destinations[index]), expected[index]);
+    }
+}
+
+TEST_F(UShapedRoutingEngine, NavigationFieldsBuiltOnDemandAreEvicted)
+{
+    const Point from{5, 18};
+    const Point precomputed{25, 18};
+    ThreadPool threadPool(4);
+    engine->PrecomputeNavigationFields({precomputed}, threadPool);
+    const auto expected = engine->ComputeWaypoint(from, precomputed);
+
+    // A destination per query, e.g. targets following moving agents
+    std::vector<Point> destinations{};
+    for(size_t index = 0; index < 600; ++index) {
+        destinations.push_back({21 + 0.1 * (index % 80), 1 + 0.2 * (index / 80)});
+    }
+    std::vector<Point> serial{};
+    for(const auto& destination : destinations) {
+        serial.push_back(engine->ComputeWaypoint(from, destination));
+    }
+    EXPECT_EQ(engine->CountNavigationFields(), 257);
+
+    // Fields are built and evicted while other threads read them
+    engine->ClearNavigationFields();
+    std::vector<Point> parallel(destinations.size());
+    threadPool.ParallelFor(destinations.size(), [&](size_t begin, size_t end) {
+        for(size_t index = begin; index < end; ++index) {
+            parallel[index] = engine->ComputeWaypoint(from, destinations[index]);
+        }
+    });
+    EXPECT_EQ(parallel, serial);
+    EXPECT_LE(engine->CountNavigationFields(), 256);
+    EXPECT_EQ(engine->ComputeWaypoint(from, precomputed), expected);
+}
+
+TEST_F(UShapedRoutingEngine, StoredEngineComputesSamePaths)
+{
+    std::stringstream stream{};
+    BinaryWriter writer(stream);
+    engine->Write(writer);
+    BinaryReader reader(stream);
+    const auto restored = RoutingEngine::Read(reader);
+
+    ASSERT_EQ(restored->MeshData()->CountPolygons(), engine->MeshData()->CountPolygons());
+    const Point destination{25, 18};
+    for(const Point& from : {Point{5, 18}, Point{2, 10}, Point{8, 3}, Point{15, 2}, Point{25, 2}}) {
+        EXPECT_EQ(restored->LocateFace(from), engine->LocateFace(from));
+        EXPECT_EQ(
+            restored->ComputeWaypoint(from, destination),
+            engine->ComputeWaypoint(from, destination));
+        EXPECT_EQ(
+            restored->ComputeAllWaypoints(from, destination),
+            engine->ComputeAllWaypoints(from, destination));
+    }
+}
+
+TEST_F(UShapedRoutingEngine, ReadingTruncatedDataThrows)
+{
+    std::stringstream stream{};
+    BinaryWriter writer(stream);
+    engine->Write(writer);
+    auto data = stream.str();
+    data.resize(data.size() / 2);
+    std::stringstream truncated(data);
+    BinaryReader reader(truncated);
+    EXPECT_THROW(RoutingEngine::Read(reader), SimulationError);
+}
+
+TEST_F(UShapedRoutingEngine, ThrowsForDestinationOutsideOfAccessibleArea)
+{
+    EXPECT_THROW(engine->ComputeWaypoint({5, 18}, {15, 18}), SimulationError);
+}
+
+TEST_F(UShapedRoutingEngine, WaypointsStartWithNextWaypoint)
+{
+    const Point destination{25, 18};
+    std::vector<Point> waypoints{};
+    for(const Point& from : {Point{5, 18}, Point{8, 3}, Point{25, 2}, Point{25, 17}}) {
+        size_t face = RoutingEngine::NO_FACE;
+        engine->ComputeWaypoints(from, destination, face, waypoints);
+        ASSERT_FALSE(waypoints.empty());
+        EXPECT_EQ(waypoints.front(), engine->ComputeWaypoint(from, destination));
+        EXPECT_EQ(waypoints.back(), destination);
+    }
+}
+
+TEST_F(UShapedRoutingEngine, FaceHintsDoNotChangeWaypoints)
+{
+    const Point destination{25, 18};
+    size_t face = RoutingEngine::NO_FACE;
+    // Walk along the path, each query starts from the face found by the previous one
+    for(double y = 18; y > 2; y -= 0.5) {
+        const Point position{5, y};
+        EXPECT_EQ(
+            engine->ComputeWaypoint(position, destination, face),
+            engine->ComputeWaypoint(position, destination));
+        EXPECT_NE(face, RoutingEngine::NO_FACE);
+    }
+    // Hints far away from the position are only a detour
+    const Point position{25, 2};
+    EXPECT_EQ(
+        engine->ComputeWaypoint(position, destination, face),
+        engine->ComputeWaypoint(position, destination));
+}
+
+class UShapedPolyanyaRoutingEngine : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        // POLYGON ((0 0, 30 0, 30 20, 20 20, 20 5, 10 5, 10 20, 0 20, 0 0))
+        const std::vector<K::Point_2> points{
+            {0, 0}, {30, 0}, {30, 20}, {20, 20}, {20, 5}, {10, 5}, {10, 20}, {0, 20}};
+        engine = std::make_unique<RoutingEngine>(
+            PolyWithHoles(Poly{std::begin(points), std::end(points)}), RoutingBackend::Polyanya);
+    }
+
+protected:
+    std::unique_ptr<RoutingEngine> engine{};
+};
+
+TEST_F(UShapedPolyanyaRoutingEngine, PathTurnsAtCorners)
+{
+    const auto waypoints = engine->ComputeAllWaypoints({5, 18}, {25, 18});
+    const std::vector<Point> expected{{5, 18}, {10, 5}, {20, 5}, {25, 18}};
+    ASSERT_EQ(waypoints, expected);
+    ASSERT_EQ(engine->ComputeWaypoint({5, 18}, {25, 18}), Point(10, 5));
+}
+
+TEST_F(UShapedPolyanyaRoutingEngine, VisibleDestinationIsNextWaypoint)
+{
+    const Point destination{28, 1};
+    ASSERT_EQ(engine->ComputeWaypoint({1, 1}, destination), destination);
+    ASSERT_EQ(engine->ComputeAllWaypoints({1, 19}, destination).size(), 3);
+}
+
+TEST_F(UShapedPolyanyaRoutingEngine, WaypointsAreTheShortestPath)
+{
+    std::vector<Point> waypoints{};
+    size_t face = RoutingEngine::NO_FACE;
+    engine->ComputeWaypoints({5, 18}, {25, 18}, face, waypoints);
+    const std::vector<Point> expected{{10, 5}, {20, 5}, {25, 18}};
+    EXPECT_EQ(waypoints, expected);
+}
+
+TEST_F(UShapedPolyanyaRoutingEngine, CloneComputesSamePaths)
+{
+    const auto clone = engine->Clone();
+    ASSERT_EQ(
+        clone->ComputeAllWaypoints({5, 18}, {25, 18}),
+        engine->ComputeAllWaypoints({5, 18}, {25, 18}));
+}
+
+TEST_F(UShapedPolyanyaRoutingEngine, StoredEngineComputesSamePaths)
+{
+    std::stringstream stream{};
+    BinaryWriter writer(stream);
+    engine->Write(writer);
+    BinaryReader reader(stream);
+    const auto restored = RoutingEngine::Read(reader);
+
+    ASSERT_EQ(restored->Backend(), RoutingBackend::Polyanya);
+    ASSERT_EQ(
+        restored->ComputeAllWaypoints({5, 18}, {25, 18}),
+        engine->ComputeAllWaypoints({5, 18}, {25, 18}));
+}
+
+TEST_F(UShapedPolyanyaRoutingEngine, ThrowsForDestinationOutsideOfAccessibleArea)
+{
+    EXPECT_THROW(engine->ComputeWaypoint({5, 18}, {15, 18}), SimulationError);
+}
+
+namespace
+{
+double pathLength(const std::vector<Point>& path)
+{
+    double length = 0;
+    for(size_t index = 1; index < path.size(); ++index) {
+        length += Distance(path[index - 1], path[index]);
+    }
+    return length;
+}
+
+/// Shortest paths through the visibility graph of all vertices of a polygon
+class VisibilityGraph
+{
+    PolyWithHoles polygon;
+    std::vector<Point> vertices{};
+    std::vector<LineSegment> walls{};
+    // visible[a * vertices.size() + b]
+    std::vector<bool> visible{};
+
+public:
+    explicit VisibilityGraph(const PolyWithHoles& polygon) : polygon(polygon)
+    {
+        const auto addRing = [this](const Poly& ring) {
+            for(auto edge = ring.edges_begin(); edge != ring.edges_end(); ++edge) {
+                vertices.emplace_back(edge->source().x(), edge->source().y());
+                walls.emplace_back(
+                    Point{edge->source().x(), edge->source().y()},
+                    Point{edge->target().x(), edge->target().y()});
+            }
+        };
+        addRing(polygon.outer_boundary());
+        for(const auto& hole : polygon.holes()) {
+            addRing(hole);
+        }
+        for(const auto& a : vertices) {
+            for(const auto& b : vertices) {
+                visible.push_back(isVisible(a, b));
+            }
+        }
+    }
+
+    double ShortestPathLength(Point from, Point to) const
+    {
+        if(isVisible(from, to)) {
+            return Distance(from, to);
+        }
+        const auto count = vertices.size();
+        // Dijkstra over the vertices starting with all vertices visible from 'from'
+        std::vector<double> distances(count, std::numeric_limits<double>::infinity());
+        std::vector<bool> done(count, false);
+        for(size_t index = 0; index < count; ++index) {
+            if(isVisible(from, vertices[index])) {
+                distances[index] = Distance(from, vertices[index]);
+            }
+        }
+        double best = std::numeric_limits<double>::infinity();
+        for(size_t iteration = 0; iteration < count; ++iteration) {
+            size_t current = count;
+            for(size_t index = 0; index < count; ++index) {
+                if(!done[index] && (current == count || distances[index] < distances[current])) {
+                    current = index;
+                }
+            }
+            if(distances[current] == std::numeric_limits<double>::infinity()) {
+                break;
+            }
+            done[current] = true;
+            if(isVisible(vertices[current], to)) {
+                best = std::min(best, distances[current] + Distance(vertices[current], to));
+            }
+            for(size_t index = 0; index < count; ++index) {
+                if(!done[index] && visible[current * count + index]) {
+                    distances[index] = std::min(
+                        distances[index],
+                        distances[current] + Distance(vertices[current], vertices[index]));
+                }
+            }
+        }
+        return best;
+    }
+
+private:
+    bool isVisible(Point a, Point b) const
+    {
+        const auto side = [](Point o, Point p, Point q) { return (p - o).CrossProduct(q - o); };
+        for(const auto& wall : walls) {
+            if(side(a, b, wall.p1) * side(a, b, wall.p2) < 0 &&
+               side(wall.p1, wall.p2, a) * side(wall.p1, wall.p2, b) < 0) {
+                return false;
+            }
+        }
+        constexpr int samples = 16;
+        for(int sample = 1; sample < samples; ++sample) {
+            const auto p = a + (b - a) * (static_cast<double>(sample) / samples);
+            if(CGAL::oriented_side(K::Point_2(p.x, p.y), polygon) == CGAL::ON_NEGATIVE_SIDE) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+} // namespace
+
+TEST(PolyanyaRoutingEngine, PathsAreShortest)
+{
+    const std::vector<K::Point_2> outer{{0, 0}, {30, 0}, {30, 20}, {0, 20}};
+    const std::vector<std::vector<K::Point_2>> holes{
+        {{3, 3}, {8, 4}, {5, 9}},
+        {{11, 2}, {11, 16}, {13, 16}, {13, 2}},
+        {{20, 6}, {17, 10}, {20, 14}, {23, 10}},
+        {{24, 2}, {24, 4}, {28, 4}, {28, 2}}};
+    std::vector<Poly> holePolygons{};
+    for(const auto& hole : holes) {
+        holePolygons.emplace_back(std::begin(hole), std::end(hole));
+    }
+    const PolyWithHoles polygon(
+        Poly{std::begin(outer), std::end(outer)},
+        std::begin(holePolygons),
+        std::end(holePolygons));
+    const RoutingEngine engine(polygon, RoutingBackend::Polyanya);
+    const VisibilityGraph graph(polygon);
+
+    std::vector<Point> positions{};
+    for(double x = 0.5; x < 30; x += 2.25) {
+        for(double y = 0.5; y < 20; y += 1.75) {
+            if(engine.IsRoutable({x, y})) {
+                positions.emplace_back(x, y);
+            }
+        }
+    }
+    // Corner of an obstacle as start and destination
+    positions.emplace_back(13, 16);
+
+    for(size_t index = 0; index < positions.size(); ++index) {
+        const auto from = positions[index];
+        const auto to = positions[(index * 7 + positions.size() / 2) % positions.size()];
+        const auto path = engine.ComputeAllWaypoints(from, to);
+        ASSERT_GE(path.size(), 2);
+        EXPECT_EQ(path.front(), from);
+        EXPECT_EQ(path.back(), to);
+        EXPECT_NEAR(pathLength(path), graph.ShortestPathLength(from, to), 1e-6)
+            << fmt::format("{} -> {}", from, to);
+    }
+}
+
+TEST(HierarchicalRoutingEngine, PathsThroughStreetGridAreNearlyShortest)
+{
+    // 8 x 8 blocks separated by 2m wide streets, large enough for many hierarchy regions
+    const std::vector<K::Point_2> outer{{0, 0}, {82, 0}, {82, 82}, {0, 82}};
+    PolyWithHoles polygon(Poly{std::begin(outer), std::end(outer)});
+    for(int x = 0; x < 8; ++x) {
+        for(int y = 0; y < 8; ++y) {
+            const double left = 2 + x * 10;
+            const double bottom = 2 + y * 10;
+            const std::vector<K::Point_2> block{
+                {left, bottom}, {left, bottom + 8}, {left + 8, bottom + 8}, {left + 8, bottom}};
+            polygon.add_hole(Poly{std::begin(block), std::end(block)});
+        }
+    }
+    const RoutingEngine engine(polygon);
+    const RoutingEngine exact(polygon, RoutingBackend::Polyanya);
+
+    const auto length = [](const std::vector<Point>& path) {
+        double sum = 0;
+        for(size_t index = 1; index < path.size(); ++index) {
+            sum += Distance(path[index - 1], path[index]);
+        }
+        return sum;
+    };
+    for(const auto& [from, to] : std::vector<std::pair<Point, Point>>{
+            {{1, 1}, {81, 81}},
+            {{1, 81}, {81, 1}},
+            {{11, 5}, {71, 75}},
+            {{41, 1}, {41, 81}},
+            {{5, 31}, {81, 45}}}) {
+        const auto path = engine.ComputeAllWaypoints(from, to);
+        ASSERT_GE(path.size(), 2);
+        EXPECT_EQ(path.front(), from);
+        EXPECT_EQ(path.back(), to);
+        EXPECT_LE(length(path), 1.1 * length(exact.ComputeAllWaypoints(from, to)));
+    }
+}
+
+namespace
+{
+/// Rectangle with an obstacle in the middle, door 0 closes the passage below the obstacle and
+/// door 1 the passage above it.
+std::unique_ptr<RoutingEngine> engineWithDoors(RoutingBackend backend)
+{
+    const std::vector<K::Point_2> outer{{0, 0}, {20, 0}, {20, 10}, {0, 10}};
+    const std::vector<K::Point_2> obstacle{{8, 2}, {8, 8}, {12, 8}, {12, 2}};
+    PolyWithHoles polygon(Poly{std::begin(outer), std::end(outer)});
+    polygon.add_hole(Poly{std::begin(obstacle), std::end(obstacle)});
+    return std::make_unique<RoutingEngine>(
+        polygon,
+        backend,
+        std::vector<LineSegment>{LineSegment({10, 0}, {10, 2}), LineSegment({10, 8}, {10, 10})});
+}
+
+double highestWaypoint(const std::vector<Point>& path)
+{
+    return std::max_element(
+               std::begin(path),
+               std::end(path),
+               [](const auto& a, const auto& b) { return a.y < b.y; })
+        ->y;
+}
+} // namespace
+
+TEST(RoutingEngineWithDoors, PathsAvoidClosedDoors)
+{
+    const Point from{2, 1};
+    const Point to{18, 1};
+    for(const auto backend : {RoutingBackend::Triangulation, RoutingBackend::Polyanya}) {
+        const auto engine = engineWithDoors(backend);
+        ASSERT_EQ(engine->CountDoors(), 2);
+        const auto open = engine->ComputeAllWaypoints(from, to);
+        ASSERT_GE(open.size(), 2);
+        EXPECT_LT(highestWaypoint(open), 5);
+
+        engine->SetDoorClosed(0, true);
+        EXPECT_TRUE(engine->IsDoorClosed(0));
+        const auto detour = engine->ComputeAllWaypoints(from, to);
+        ASSERT_GE(detour.size(), 2);
+        EXPECT_EQ(detour.back(), to);
+        EXPECT_GT(highestWaypoint(detour), 7.5);
+        EXPECT_GT(engine->ComputeWaypoint(from, to).y, 5);
+
+        engine->SetDoorClosed(0, false);
+        EXPECT_EQ(engine->ComputeAllWaypoints(from, to), open);
+        EXPECT_LT(engine->ComputeWaypoint(from, to).y, 5);
+        EXPECT_THROW(engine->SetDoorClosed(2, true), SimulationError);
+    }
+}
+
+TEST(RoutingEngineWithDoors, PathsLeadThroughClosedDoorsIfThereIsNoOtherWay)
+{
+    const Point from{2, 1};
+    const Point to{18, 1};
+    for(const auto backend : {RoutingBackend::Triangulation, RoutingBackend::Polyanya}) {
+        const auto engine = engineWithDoors(backend);
+        const auto open = engine->ComputeAllWaypoints(from, to);
+        engine->SetDoorClosed(0, true);
+        engine->SetDoorClosed(1, true);
+        EXPECT_EQ(engine->ComputeAllWaypoints(from, to), open);
+        EXPECT_NO_THROW(engine->ComputeWaypoint(from, to));
+    }
+}
+
+TEST(RoutingEngineWithDoors, ClonedAndStoredEnginesKeepDoorStates)
+{
+    const Point from{2, 1};
+    const Point to{18, 1};
+    for(const auto backend : {RoutingBackend::Triangulation, RoutingBackend::Polyanya}) {
+        const auto engine = engineWithDoors(backend);
+        engine->SetDoorClosed(0, true);
+        const auto expected = engine->ComputeAllWaypoints(from, to);
+
+        const auto clone = engine->Clone();
+        EXPECT_TRUE(clone->IsDoorClosed(0));
+        EXPECT_EQ(clone->ComputeAllWaypoints(from, to), expected);
+
+        std::stringstream stream{};
+        BinaryWriter writer(stream);
+        engine->Write(writer);
+        BinaryReader reader(stream);
+        const auto restored = RoutingEngine::Read(reader);
+        EXPECT_TRUE(restored->IsDoorClosed(0));
+        EXPECT_FALSE(restored->IsDoorClosed(1));
+        EXPECT_EQ(restored->ComputeAllWaypoints(from, to), expected);
+
+        // Doors of the original engine are independent of the copies
+        engine->SetDoorClosed(0, false);
+        EXPECT_TRUE(clone->IsDoorClosed(0));
+    }
+}
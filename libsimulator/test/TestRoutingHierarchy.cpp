@@ -0,0 +1,76 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "RoutingHierarchy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+namespace
+{
+/// Chains of faces along the x-axis, face i of a chain spans [i, i + 1]. Edge 0 leads to the
+/// previous face, edge 1 to the next face and edge 2 is a wall.
+RoutingHierarchy chains(const std::vector<size_t>& lengths, size_t regionSize)
+{
+    std::vector<std::array<size_t, 3>> neighbors{};
+    std::vector<std::array<Point, 3>> midpoints{};
+    for(const auto length : lengths) {
+        const auto first = neighbors.size();
+        for(size_t index = 0; index < length; ++index) {
+            const auto face = first + index;
+            const auto x = static_cast<double>(index);
+            neighbors.push_back(
+                {index == 0 ? RoutingHierarchy::NO_INDEX : face - 1,
+                 index + 1 == length ? RoutingHierarchy::NO_INDEX : face + 1,
+                 RoutingHierarchy::NO_INDEX});
+            midpoints.push_back({Point{x, 0}, Point{x + 1, 0}, Point{x + 0.5, 1}});
+        }
+    }
+    return RoutingHierarchy(neighbors, midpoints, regionSize);
+}
+} // namespace
+
+TEST(RoutingHierarchy, GroupsConnectedFacesIntoRegions)
+{
+    const auto hierarchy = chains({12}, 4);
+    ASSERT_EQ(hierarchy.CountRegions(), 3);
+    for(size_t face = 0; face < 12; ++face) {
+        EXPECT_EQ(hierarchy.RegionOf(face), face / 4);
+    }
+}
+
+TEST(RoutingHierarchy, CorridorContainsAllRegionsOnThePath)
+{
+    const auto hierarchy = chains({12}, 4);
+    std::vector<size_t> regions{};
+    ASSERT_TRUE(hierarchy.Corridor({0.5, 0.5}, 0, {11.5, 0.5}, 11, regions));
+    EXPECT_EQ(regions, (std::vector<size_t>{0, 1, 2}));
+    ASSERT_TRUE(hierarchy.Corridor({4.5, 0.5}, 4, {11.5, 0.5}, 11, regions));
+    EXPECT_EQ(regions, (std::vector<size_t>{1, 2}));
+    ASSERT_TRUE(hierarchy.Corridor({4.5, 0.5}, 4, {6.5, 0.5}, 6, regions));
+    EXPECT_EQ(regions, (std::vector<size_t>{1}));
+}
+
+TEST(RoutingHierarchy, NoCorridorBetweenDisconnectedFaces)
+{
+    const auto hierarchy = chains({6, 6}, 4);
+    std::vector<size_t> regions{};
+    EXPECT_FALSE(hierarchy.Corridor({0.5, 0.5}, 0, {5.5, 0.5}, 11, regions));
+    EXPECT_TRUE(regions.empty());
+}
+
+TEST(RoutingHierarchy, CorridorsAvoidBlockedEdges)
+{
+    auto hierarchy = chains({12}, 4);
+    std::vector<size_t> regions{};
+    // Inside a region and on a portal between regions
+    for(const size_t face : {5, 3}) {
+        hierarchy.SetEdgesBlocked({{face, 1}}, true);
+        EXPECT_FALSE(hierarchy.Corridor({0.5, 0.5}, 0, {11.5, 0.5}, 11, regions));
+        EXPECT_FALSE(hierarchy.Corridor({11.5, 0.5}, 11, {0.5, 0.5}, 0, regions));
+        hierarchy.SetEdgesBlocked({{face, 1}}, false);
+        ASSERT_TRUE(hierarchy.Corridor({0.5, 0.5}, 0, {11.5, 0.5}, 11, regions));
+        EXPECT_EQ(regions, (std::vector<size_t>{0, 1, 2}));
+    }
+}
@@ -10,6 +10,7 @@
 class StagesTests : public ::testing::Test
 {
 public:
+    std::vector<GenericAgent> agents{};
     NeighborhoodSearch<GenericAgent> neighborhoodSearch{2};
     std::unique_ptr<CollisionGeometry> collisionGeometry{};
 
@@ -38,7 +39,8 @@ TEST_F(StagesTests, NotifiableWaitingSetTargetIsCorrect)
             waitingPoints[i],
             {},
             CollisionFreeSpeedModelData{});
-        neighborhoodSearch.AddAgent(agent);
+        agents.push_back(agent);
+        neighborhoodSearch.AddAgent(agents, agents.size() - 1);
 
         const auto& target = waitingSet.Target(agent);
         ASSERT_EQ(target, waitingPoints[i]);
@@ -55,7 +57,8 @@ TEST_F(StagesTests, NotifiableWaitingSetTargetIsCorrect)
             {},
             {},
             CollisionFreeSpeedModelData{});
-        neighborhoodSearch.AddAgent(agentToLastWaitingSetPos);
+        agents.push_back(agentToLastWaitingSetPos);
+        neighborhoodSearch.AddAgent(agents, agents.size() - 1);
         const auto& target = waitingSet.Target(agentToLastWaitingSetPos);
         ASSERT_EQ(target, waitingPoints.back());
     }
@@ -0,0 +1,81 @@
+// Copyright © 2012-2024 Forschungszentrum Jülich GmbH
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#include "ThreadPool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(ThreadPool, ZeroSelectsHardwareConcurrency)
+{
+    ThreadPool pool(0);
+    ASSERT_GE(pool.ThreadCount(), 1);
+}
+
+TEST(ThreadPool, ParallelForVisitsEachIndexOnce)
+{
+    for(size_t threadCount : {1, 2, 4}) {
+        ThreadPool pool(threadCount);
+        ASSERT_EQ(pool.ThreadCount(), threadCount);
+        for(size_t count : {0, 1, 2, 7, 1000}) {
+            std::vector<int> visited(count, 0);
+            pool.ParallelFor(count, [&visited](size_t begin, size_t end) {
+                for(size_t index = begin; index < end; ++index) {
+                    ++visited[index];
+                }
+            });
+            ASSERT_EQ(std::accumulate(visited.begin(), visited.end(), 0), count);
+            for(const auto& v : visited) {
+                ASSERT_EQ(v, 1);
+            }
+        }
+    }
+}
+
+TEST(ThreadPool, ParallelForRethrowsException)
+{
+    ThreadPool pool(4);
+    ASSERT_THROW(
+        pool.ParallelFor(
+            100,
+            [](size_t begin, size_t end) {
+                if(begin <= 50 && 50 < end) {
+                    throw std::runtime_error("failed");
+                }
+            }),
+        std::runtime_error);
+    // The pool is still usable after an exception
+    size_t sum{};
+    std::mutex mutex{};
+    pool.ParallelFor(100, [&](size_t begin, size_t end) {
+        std::lock_guard lock(mutex);
+        sum += end - begin;
+    });
+    ASSERT_EQ(sum, 100);
+}
+
+TEST(ThreadPool, ChunksOfOneWorkerDoNotOverlap)
+{
+    ThreadPool pool(4);
+    // Per worker, number of chunks currently processed and whether another one ever overlapped
+    std::vector<std::atomic<int>> active(pool.ThreadCount());
+    std::atomic<bool> overlapped{false};
+    std::atomic<size_t> sum{0};
+    pool.ParallelForWorkers(1000, [&](size_t worker, size_t begin, size_t end) {
+        ASSERT_LT(worker, pool.ThreadCount());
+        if(active[worker].fetch_add(1) != 0) {
+            overlapped = true;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        sum += end - begin;
+        active[worker].fetch_sub(1);
+    });
+    ASSERT_FALSE(overlapped);
+    ASSERT_EQ(sum, 1000);
+}
@@ -21,16 +21,21 @@ void init_geometry(py::module_& m)
                 const auto data = JPS_Geometry_GetBoundaryData(w.handle);
                 return intoTuple(data, data + len);
             })
-        .def("holes", [](const JPS_Geometry_Wrapper& w) {
-            const auto holeCount = JPS_Geometry_GetHoleCount(w.handle);
-            std::vector<std::vector<std::tuple<double, double>>> res{};
-            res.reserve(holeCount);
-            for(size_t index = 0; index < holeCount; ++index) {
-                const auto len = JPS_Geometry_GetHoleSize(w.handle, index, nullptr);
-                const auto data = JPS_Geometry_GetHoleData(w.handle, index, nullptr);
-                res.emplace_back(intoTuple(data, data + len));
-            }
-            return res;
+        .def(
+            "holes",
+            [](const JPS_Geometry_Wrapper& w) {
+                const auto holeCount = JPS_Geometry_GetHoleCount(w.handle);
+                std::vector<std::vector<std::tuple<double, double>>> res{};
+                res.reserve(holeCount);
+                for(size_t index = 0; index < holeCount; ++index) {
+                    const auto len = JPS_Geometry_GetHoleSize(w.handle, index, nullptr);
+                    const auto data = JPS_Geometry_GetHoleData(w.handle, index, nullptr);
+                    res.emplace_back(intoTuple(data, data + len));
+                }
+                return res;
+            })
+        .def("door_count", [](const JPS_Geometry_Wrapper& w) {
+            return JPS_Geometry_GetDoorCount(w.handle);
         });
     py::class_<JPS_GeometryBuilder_Wrapper>(m, "GeometryBuilder")
         .def(py::init([]() {
@@ -52,6 +57,14 @@ void init_geometry(py::module_& m)
                 JPS_GeometryBuilder_ExcludeFromAccessibleArea(w.handle, pts.data(), pts.size());
             },
             "Add areas where agents can not move (obstacles)")
+        .def(
+            "add_door",
+            [](const JPS_GeometryBuilder_Wrapper& w,
+               std::tuple<double, double> from,
+               std::tuple<double, double> to) {
+                JPS_GeometryBuilder_AddDoor(w.handle, intoJPS_Point(from), intoJPS_Point(to));
+            },
+            "Add a door that can be opened and closed during the simulation")
         .def(
             "build",
             [](const JPS_GeometryBuilder_Wrapper& w) {
@@ -65,4 +78,8 @@ void init_geometry(py::module_& m)
                 throw std::runtime_error{msg};
             },
             "Geometry builder");
+    m.def(
+        "set_geometry_cache_directory",
+        [](const std::string& directory) { JPS_GeometryCache_SetDirectory(directory.c_str()); },
+        "Set the directory built geometries are stored in, an empty string disables it");
 }
@@ -6,11 +6,14 @@
 #include <cstddef>
 #include <jupedsim/jupedsim.h>
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 #include <algorithm>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -43,6 +46,54 @@ void init_routing(py::module_& m)
                 JPS_Path_Free(waypoints);
                 return result;
             })
+        .def(
+            "compute_waypoint_batch",
+            [](const JPS_RoutingEngine_Wrapper& w,
+               py::array_t<double, py::array::c_style | py::array::forcecast> from,
+               py::array_t<double, py::array::c_style | py::array::forcecast> to,
+               size_t thread_count) {
+                const auto isPointArray = [](const auto& a) {
+                    return a.ndim() == 2 && a.shape(1) == 2;
+                };
+                if(!isPointArray(from) || !isPointArray(to) || from.shape(0) != to.shape(0)) {
+                    throw std::invalid_argument{
+                        "'frm' and 'to' need to be arrays of the same number of 2D points"};
+                }
+                const auto len = static_cast<size_t>(from.shape(0));
+                // JPS_Point consists of two doubles, a (n, 2) array can be passed as is
+                static_assert(sizeof(JPS_Point) == 2 * sizeof(double));
+                const auto* fromPoints = reinterpret_cast<const JPS_Point*>(from.data());
+                const auto* toPoints = reinterpret_cast<const JPS_Point*>(to.data());
+                JPS_ErrorMessage errorMsg{};
+                JPS_PathBatch batch{};
+                {
+                    py::gil_scoped_release release{};
+                    batch = JPS_RoutingEngine_ComputeWaypointBatch(
+                        w.handle, fromPoints, toPoints, len, thread_count, &errorMsg);
+                }
+                if(errorMsg) {
+                    auto msg = std::string(JPS_ErrorMessage_GetMessage(errorMsg));
+                    JPS_ErrorMessage_Free(errorMsg);
+                    throw std::runtime_error{msg};
+                }
+                // Both arrays share the buffers of the batch, it is freed with the last of them
+                auto owner = py::capsule(new JPS_PathBatch{batch}, [](void* ptr) {
+                    auto* data = static_cast<JPS_PathBatch*>(ptr);
+                    JPS_PathBatch_Free(*data);
+                    delete data;
+                });
+                const auto numPoints = static_cast<py::ssize_t>(batch.offsets[len]);
+                auto offsets = py::array_t<size_t>(
+                    {static_cast<py::ssize_t>(len + 1)}, batch.offsets, owner);
+                auto points = py::array_t<double>(
+                    {numPoints, py::ssize_t{2}},
+                    reinterpret_cast<const double*>(batch.points),
+                    owner);
+                return std::make_tuple(offsets, points);
+            },
+            py::arg("frm"),
+            py::arg("to"),
+            py::arg("thread_count"))
         .def(
             "is_routable",
             [](const JPS_RoutingEngine_Wrapper& w, std::tuple<double, double> p) {
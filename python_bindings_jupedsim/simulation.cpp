@@ -14,24 +14,56 @@ namespace py = pybind11;
 void init_simulation(py::module_& m)
 {
     py::class_<JPS_OperationalModel_Wrapper>(m, "OperationalModel");
+    py::enum_<JPS_NeighborhoodSearchBackend>(m, "NeighborhoodSearchBackend")
+        .value("HashGrid", JPS_NeighborhoodSearchBackend_HashGrid)
+        .value("DenseGrid", JPS_NeighborhoodSearchBackend_DenseGrid);
+    py::enum_<JPS_RoutingBackend>(m, "RoutingBackend")
+        .value("Triangulation", JPS_RoutingBackend_Triangulation)
+        .value("Polyanya", JPS_RoutingBackend_Polyanya);
     py::class_<JPS_Simulation_Wrapper>(m, "Simulation")
         .def(
-            py::init(
-                [](JPS_OperationalModel_Wrapper& model, JPS_Geometry_Wrapper& geometry, double dT) {
-                    JPS_ErrorMessage errorMsg{};
-                    auto result =
-                        JPS_Simulation_Create(model.handle, geometry.handle, dT, &errorMsg);
-                    if(result) {
-                        return std::make_unique<JPS_Simulation_Wrapper>(result);
-                    }
-                    auto msg = std::string(JPS_ErrorMessage_GetMessage(errorMsg));
-                    JPS_ErrorMessage_Free(errorMsg);
-                    throw std::runtime_error{msg};
-                }),
+            py::init([](JPS_OperationalModel_Wrapper& model,
+                        JPS_Geometry_Wrapper& geometry,
+                        double dT,
+                        size_t numThreads,
+                        JPS_NeighborhoodSearchBackend neighborhoodSearchBackend,
+                        double neighborListSkin,
+                        double wallDistanceFieldResolution,
+                        JPS_RoutingBackend routingBackend,
+                        size_t routingRefreshInterval,
+                        bool precomputeRoutingTables) {
+                auto options = JPS_SimulationOptions_Create();
+                JPS_SimulationOptions_SetThreadCount(options, numThreads);
+                JPS_SimulationOptions_SetNeighborhoodSearchBackend(
+                    options, neighborhoodSearchBackend);
+                JPS_SimulationOptions_SetNeighborListSkin(options, neighborListSkin);
+                JPS_SimulationOptions_SetWallDistanceFieldResolution(
+                    options, wallDistanceFieldResolution);
+                JPS_SimulationOptions_SetRoutingBackend(options, routingBackend);
+                JPS_SimulationOptions_SetRoutingRefreshInterval(options, routingRefreshInterval);
+                JPS_SimulationOptions_SetPrecomputeRoutingTables(options, precomputeRoutingTables);
+                JPS_ErrorMessage errorMsg{};
+                auto result =
+                    JPS_Simulation_Create(model.handle, geometry.handle, dT, options, &errorMsg);
+                JPS_SimulationOptions_Free(options);
+                if(result) {
+                    return std::make_unique<JPS_Simulation_Wrapper>(result);
+                }
+                auto msg = std::string(JPS_ErrorMessage_GetMessage(errorMsg));
+                JPS_ErrorMessage_Free(errorMsg);
+                throw std::runtime_error{msg};
+            }),
             py::kw_only(),
             py::arg("model"),
             py::arg("geometry"),
-            py::arg("dt"))
+            py::arg("dt"),
+            py::arg("num_threads") = 1,
+            py::arg("neighborhood_search_backend") = JPS_NeighborhoodSearchBackend_HashGrid,
+            py::arg("neighbor_list_skin") = 0.0,
+            py::arg("wall_distance_field_resolution") = 0.0,
+            py::arg("routing_backend") = JPS_RoutingBackend_Triangulation,
+            py::arg("routing_refresh_interval") = 0,
+            py::arg("precompute_routing_tables") = false)
         .def(
             "add_waypoint_stage",
             [](JPS_Simulation_Wrapper& w, std::tuple<double, double> position, double distance) {
@@ -182,6 +214,20 @@ void init_simulation(py::module_& m)
                 JPS_ErrorMessage_Free(errorMsg);
                 throw std::runtime_error{msg};
             })
+        .def(
+            "mark_agents_for_removal",
+            [](JPS_Simulation_Wrapper& simulation, const std::vector<JPS_AgentId>& ids) {
+                JPS_ErrorMessage errorMsg{};
+                auto result = JPS_Simulation_MarkAgentsForRemoval(
+                    simulation.handle, ids.data(), ids.size(), &errorMsg);
+                if(result) {
+                    return result;
+                }
+                auto msg = std::string(JPS_ErrorMessage_GetMessage(errorMsg));
+                JPS_ErrorMessage_Free(errorMsg);
+                throw std::runtime_error{msg};
+            },
+            py::arg("agent_ids"))
         .def(
             "removed_agents",
             [](const JPS_Simulation_Wrapper& simulation) {
@@ -260,6 +306,33 @@ void init_simulation(py::module_& m)
                 throw std::runtime_error{msg};
             },
             py::arg("agent_id"))
+        .def(
+            "agent_handle",
+            [](const JPS_Simulation_Wrapper& simulation, JPS_AgentId agentId) {
+                JPS_ErrorMessage errorMsg{};
+                auto result = JPS_Simulation_GetAgentHandle(simulation.handle, agentId, &errorMsg);
+                if(result) {
+                    return result;
+                }
+                auto msg = std::string(JPS_ErrorMessage_GetMessage(errorMsg));
+                JPS_ErrorMessage_Free(errorMsg);
+                throw std::runtime_error{msg};
+            },
+            py::arg("agent_id"))
+        .def(
+            "agent_by_handle",
+            [](const JPS_Simulation_Wrapper& simulation, JPS_AgentHandle agentHandle) {
+                JPS_ErrorMessage errorMsg{};
+                auto result =
+                    JPS_Simulation_GetAgentByHandle(simulation.handle, agentHandle, &errorMsg);
+                if(result) {
+                    return std::make_unique<JPS_Agent_Wrapper>(result);
+                }
+                auto msg = std::string(JPS_ErrorMessage_GetMessage(errorMsg));
+                JPS_ErrorMessage_Free(errorMsg);
+                throw std::runtime_error{msg};
+            },
+            py::arg("agent_handle"))
         .def(
             "agents_in_range",
             [](JPS_Simulation_Wrapper& w, std::tuple<double, double> pos, double distance) {
@@ -347,17 +420,32 @@ void init_simulation(py::module_& m)
             [](const JPS_Simulation_Wrapper& w) {
                 return std::make_unique<JPS_Geometry_Wrapper>(JPS_Simulation_GetGeometry(w.handle));
             })
-        .def("switch_geometry", [](JPS_Simulation_Wrapper& w, JPS_Geometry_Wrapper& geometry) {
-            JPS_ErrorMessage errorMsg{};
+        .def(
+            "switch_geometry",
+            [](JPS_Simulation_Wrapper& w, JPS_Geometry_Wrapper& geometry) {
+                JPS_ErrorMessage errorMsg{};
 
-            auto success =
-                JPS_Simulation_SwitchGeometry(w.handle, geometry.handle, nullptr, &errorMsg);
+                auto success =
+                    JPS_Simulation_SwitchGeometry(w.handle, geometry.handle, nullptr, &errorMsg);
 
-            if(!success) {
-                auto msg = std::string(JPS_ErrorMessage_GetMessage(errorMsg));
-                JPS_ErrorMessage_Free(errorMsg);
-                throw std::runtime_error{msg};
-            }
-            return success;
+                if(!success) {
+                    auto msg = std::string(JPS_ErrorMessage_GetMessage(errorMsg));
+                    JPS_ErrorMessage_Free(errorMsg);
+                    throw std::runtime_error{msg};
+                }
+                return success;
+            })
+        .def(
+            "set_door_closed",
+            [](JPS_Simulation_Wrapper& w, size_t door, bool closed) {
+                JPS_ErrorMessage errorMsg{};
+                if(!JPS_Simulation_SetDoorClosed(w.handle, door, closed, &errorMsg)) {
+                    auto msg = std::string(JPS_ErrorMessage_GetMessage(errorMsg));
+                    JPS_ErrorMessage_Free(errorMsg);
+                    throw std::runtime_error{msg};
+                }
+            })
+        .def("is_door_closed", [](const JPS_Simulation_Wrapper& w, size_t door) {
+            return JPS_Simulation_IsDoorClosed(w.handle, door);
         });
 }
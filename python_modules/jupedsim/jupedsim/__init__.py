@@ -22,6 +22,7 @@ from jupedsim.library import (
     get_build_info,
     set_debug_callback,
     set_error_callback,
+    set_geometry_cache_directory,
     set_info_callback,
     set_warning_callback,
 )
@@ -48,7 +49,11 @@ from jupedsim.models.social_force import (
 from jupedsim.recording import Recording, RecordingAgent, RecordingFrame
 from jupedsim.routing import RoutingEngine
 from jupedsim.serialization import TrajectoryWriter
-from jupedsim.simulation import Simulation
+from jupedsim.simulation import (
+    NeighborhoodSearchBackend,
+    RoutingBackend,
+    Simulation,
+)
 from jupedsim.sqlite_serialization import SqliteTrajectoryWriter
 from jupedsim.stages import (
     ExitStage,
@@ -88,11 +93,13 @@ __all__ = [
     "IncorrectParameterError",
     "JourneyDescription",
     "NegativeValueError",
+    "NeighborhoodSearchBackend",
     "NotifiableQueueStage",
     "OverlappingCirclesError",
     "Recording",
     "RecordingAgent",
     "RecordingFrame",
+    "RoutingBackend",
     "RoutingEngine",
     "Simulation",
     "SqliteTrajectoryWriter",
@@ -123,6 +130,7 @@ __all__ = [
     "get_build_info",
     "set_debug_callback",
     "set_error_callback",
+    "set_geometry_cache_directory",
     "set_info_callback",
     "set_warning_callback",
 ]
@@ -35,6 +35,15 @@ class Geometry:
         """
         return self._obj.holes()
 
+    def door_count(self) -> int:
+        """Number of doors that can be opened and closed in a simulation.
+
+        Returns:
+            Number of doors, doors are numbered from 0 in the order they
+            were passed to :func:`~jupedsim.geometry_utils.build_geometry`.
+        """
+        return self._obj.door_count()
+
     def as_wkt(self) -> str:
         """_summary_
 
@@ -7,6 +7,8 @@ import shapely
 import jupedsim.native as py_jps
 from jupedsim.geometry import Geometry
 
+Door = Tuple[Tuple[float, float], Tuple[float, float]]
+
 
 class GeometryError(Exception):
     """Class reflecting errors when creating JuPedSim geometry objects."""
@@ -20,7 +22,9 @@ class GeometryError(Exception):
         self.message = message
 
 
-def _geometry_from_wkt(wkt_input: str) -> Geometry:
+def _geometry_from_wkt(
+    wkt_input: str, *, doors: Optional[List[Door]] = None
+) -> Geometry:
     geometry_collection = None
     try:
         wkt_type = shapely.from_wkt(wkt_input)
@@ -42,7 +46,7 @@ def _geometry_from_wkt(wkt_input: str) -> Geometry:
             ) from exc
 
     polygons = _polygons_from_geometry_collection(geometry_collection)
-    return Geometry(_internal_build_geometry(polygons))
+    return Geometry(_internal_build_geometry(polygons, doors=doors))
 
 
 def _geometry_from_shapely(
@@ -52,18 +56,23 @@ def _geometry_from_shapely(
         | shapely.GeometryCollection
         | shapely.MultiPoint
     ),
+    *,
+    doors: Optional[List[Door]] = None,
 ) -> Geometry:
     polygons = _polygons_from_geometry_collection(
         shapely.GeometryCollection([geometry_input])
     )
-    return Geometry(_internal_build_geometry(polygons))
+    return Geometry(_internal_build_geometry(polygons, doors=doors))
 
 
 def _geometry_from_coordinates(
-    coordinates: List[Tuple], *, excluded_areas: Optional[List[Tuple]] = None
+    coordinates: List[Tuple],
+    *,
+    excluded_areas: Optional[List[Tuple]] = None,
+    doors: Optional[List[Door]] = None,
 ) -> Geometry:
     polygon = shapely.Polygon(coordinates, holes=excluded_areas)
-    return Geometry(_internal_build_geometry([polygon]))
+    return Geometry(_internal_build_geometry([polygon], doors=doors))
 
 
 def _polygons_from_geometry_collection(
@@ -108,6 +117,8 @@ def _polygons_from_geometry_collection(
 
 def _internal_build_geometry(
     polygons: List[shapely.Polygon],
+    *,
+    doors: Optional[List[Door]] = None,
 ) -> py_jps.Geometry:
     geo_builder = py_jps.GeometryBuilder()
 
@@ -115,6 +126,8 @@ def _internal_build_geometry(
         geo_builder.add_accessible_area(polygon.exterior.coords[:-1])
         for hole in polygon.interiors:
             geo_builder.exclude_from_accessible_area(hole.coords[:-1])
+    for start, end in doors or []:
+        geo_builder.add_door(start, end)
     return geo_builder.build()
 
 
@@ -154,17 +167,22 @@ def build_geometry(
         excluded_areas: describes exclusions
             from the walkable area. Only use this argument if `geometry` was
             provided as list[tuple[float, float]].
+        doors: list of doors given by their two end points. Doors can be
+            closed and opened during the simulation, see
+            :meth:`~jupedsim.simulation.Simulation.close_door`. A door must
+            lie inside the walkable area and must not cross walls.
     """
+    doors = kwargs.get("doors")
     if isinstance(geometry, str):
-        return _geometry_from_wkt(geometry)
+        return _geometry_from_wkt(geometry, doors=doors)
     elif (
         isinstance(geometry, shapely.GeometryCollection)
         or isinstance(geometry, shapely.Polygon)
         or isinstance(geometry, shapely.MultiPolygon)
         or isinstance(geometry, shapely.MultiPoint)
     ):
-        return _geometry_from_shapely(geometry)
+        return _geometry_from_shapely(geometry, doors=doors)
     else:
         return _geometry_from_coordinates(
-            geometry, excluded_areas=kwargs.get("excluded_areas")
+            geometry, excluded_areas=kwargs.get("excluded_areas"), doors=doors
         )
@@ -1,6 +1,7 @@
 # Copyright © 2012-2024 Forschungszentrum Jülich GmbH
 # SPDX-License-Identifier: LGPL-3.0-or-later
 
+import os
 from textwrap import dedent
 from typing import Callable
 
@@ -51,6 +52,26 @@ def set_error_callback(fn: Callable[[str], None]) -> None:
     py_jps.set_error_callback(fn)
 
 
+def set_geometry_cache_directory(directory: str | os.PathLike | None) -> None:
+    """
+    Set the directory built geometries are stored in.
+
+    Building the navigation structures of a large geometry takes a
+    noticeable part of the setup of a simulation. With a cache directory
+    they are stored once built and loaded by later simulations of the same
+    geometry, also across processes. Files written by another version of
+    jupedsim are ignored. The cache is disabled by default.
+
+    Arguments:
+        directory: directory to store built geometries in, it is created
+            if it does not exist. None disables the cache.
+
+    """
+    py_jps.set_geometry_cache_directory(
+        "" if directory is None else os.fspath(directory)
+    )
+
+
 class BuildInfo:
     def __init__(self) -> None:
         self.__obj = py_jps.get_build_info()
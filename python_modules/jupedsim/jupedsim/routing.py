@@ -3,6 +3,8 @@
 
 from typing import Any
 
+import numpy as np
+import numpy.typing as npt
 import shapely
 
 import jupedsim.native as py_jps
@@ -60,6 +62,40 @@ class RoutingEngine:
         """
         return self._obj.compute_waypoints(frm, to)
 
+    def compute_waypoint_batch(
+        self,
+        frm: npt.ArrayLike,
+        to: npt.ArrayLike,
+        thread_count: int = 0,
+    ) -> tuple[np.ndarray, np.ndarray]:
+        """Computes shortest paths between many pairs of points at once.
+
+        The pairs are processed in parallel without returning to Python in
+        between, use this instead of repeated calls to :meth:`compute_waypoints`
+        when paths for many pairs are needed.
+
+        Arguments:
+            frm: points from which to find the shortest paths, array of shape (n, 2)
+            to: points to which to find the shortest paths, array of shape (n, 2)
+            thread_count: number of threads to use, 0 uses one thread per core
+
+        Returns:
+            Tuple of offsets of shape (n + 1,) and points of shape (m, 2). The
+            path from 'frm[i]' to 'to[i]' including both points is
+            'points[offsets[i]:offsets[i + 1]]'. If no path exists between a
+            pair of points, its path is empty, i.e. 'offsets[i] == offsets[i + 1]'.
+            Both arrays refer to the memory of the computed paths without
+            copying it.
+
+        Raises:
+            RuntimeError: if any point is outside of the walkable area.
+        """
+        return self._obj.compute_waypoint_batch(
+            np.asarray(frm, dtype=np.float64).reshape(-1, 2),
+            np.asarray(to, dtype=np.float64).reshape(-1, 2),
+            thread_count,
+        )
+
     def is_routable(self, p: tuple[float, float]) -> bool:
         """Tests if the supplied point is inside the underlying geometry.
 
@@ -1,6 +1,7 @@
 # Copyright © 2012-2024 Forschungszentrum Jülich GmbH
 # SPDX-License-Identifier: LGPL-3.0-or-later
 
+from enum import Enum
 from typing import Any, Iterable
 
 import shapely
@@ -36,6 +37,34 @@ from jupedsim.stages import (
 )
 
 
+class NeighborhoodSearchBackend(Enum):
+    """Data structure used to find neighboring agents.
+
+    HASH_GRID stores an unbounded sparse grid in a hash map.
+
+    DENSE_GRID stores a grid covering the bounding box of the geometry in one
+    contiguous array. Agents are reordered in memory by grid cell, hence the
+    order in which agents are iterated is unspecified.
+    """
+
+    HASH_GRID = py_jps.NeighborhoodSearchBackend.HashGrid
+    DENSE_GRID = py_jps.NeighborhoodSearchBackend.DenseGrid
+
+
+class RoutingBackend(Enum):
+    """Path search used to route agents to their targets.
+
+    TRIANGULATION searches the channel of triangles with A* and computes the
+    shortest path inside this channel.
+
+    POLYANYA searches any-angle paths over the triangulation merged into
+    larger convex polygons and always finds the shortest path.
+    """
+
+    TRIANGULATION = py_jps.RoutingBackend.Triangulation
+    POLYANYA = py_jps.RoutingBackend.Polyanya
+
+
 class Simulation:
     """Defines a simulation of pedestrian movement over a continuous walkable area.
 
@@ -65,6 +94,15 @@ class Simulation:
         ),
         dt: float = 0.01,
         trajectory_writer: TrajectoryWriter | None = None,
+        num_threads: int = 1,
+        neighborhood_search_backend: NeighborhoodSearchBackend = (
+            NeighborhoodSearchBackend.HASH_GRID
+        ),
+        neighbor_list_skin: float = 0.0,
+        wall_distance_field_resolution: float = 0.0,
+        routing_backend: RoutingBackend = RoutingBackend.TRIANGULATION,
+        routing_refresh_interval: int = 0,
+        precompute_routing_tables: bool = False,
         **kwargs: Any,
     ) -> None:
         """Creates a Simulation.
@@ -93,11 +131,41 @@ class Simulation:
                 TrajectoryWriter interface. JuPedSim provides a writer that outputs trajectory data
                 in a sqlite database. If you want other formats such as CSV you need to provide
                 your own custom implementation.
+            num_threads: Number of threads used to compute an iteration.
+                Use 0 to use all available hardware threads. The results of
+                the simulation do not depend on the number of threads.
+            neighborhood_search_backend: Data structure used to find
+                neighboring agents, see :class:`NeighborhoodSearchBackend`.
+            neighbor_list_skin: Skin in meters of per agent Verlet neighbor
+                lists. Lists hold all agents within the interaction radius of
+                the model plus the skin and are reused, together with their
+                line of sight checks, until any agent moved more than half the
+                skin. Use 0 to disable neighbor lists.
+            wall_distance_field_resolution: Resolution in meters of a raster
+                storing distance and direction to the closest wall. Agents far
+                away from all walls are then only repelled by the closest wall,
+                agents close to walls still interact with each wall exactly.
+                Use 0 to disable the raster. Has no effect on the
+                :class:`GeneralizedCentrifugalForceModel`.
+            routing_backend: Path search used to route agents to their
+                targets.
+            routing_refresh_interval: Lets agents cache their path to the
+                next target. The path is only computed again when an agent
+                enters another face of the navigation mesh, gets a new target
+                or after this many iterations. Use 0 to compute the next
+                waypoint of every agent in every iteration.
+            precompute_routing_tables: Builds the routing data towards all
+                targets of the stages of a journey in parallel when the
+                journey is added, so that iterations only look up paths.
+                Takes longer to set up a simulation but speeds up the first
+                iterations. Has no effect with the Polyanya backend.
 
         Keyword Arguments:
             excluded_areas: describes exclusions
                 from the walkable area. Only use this argument if `geometry` was
                 provided as list[tuple[float, float]].
+            doors: list of doors given by their two end points, see
+                :meth:`close_door`.
         """
         if isinstance(model, CollisionFreeSpeedModel):
             model_builder = py_jps.CollisionFreeSpeedModelBuilder(
@@ -131,7 +199,16 @@ class Simulation:
             raise Exception("Unknown model type supplied")
         self._writer = trajectory_writer
         self._obj = py_jps.Simulation(
-            model=py_jps_model, geometry=build_geometry(geometry)._obj, dt=dt
+            model=py_jps_model,
+            geometry=build_geometry(geometry, **kwargs)._obj,
+            dt=dt,
+            num_threads=num_threads,
+            neighborhood_search_backend=neighborhood_search_backend.value,
+            neighbor_list_skin=neighbor_list_skin,
+            wall_distance_field_resolution=wall_distance_field_resolution,
+            routing_backend=routing_backend.value,
+            routing_refresh_interval=routing_refresh_interval,
+            precompute_routing_tables=precompute_routing_tables,
         )
 
     def add_waypoint_stage(
@@ -280,6 +357,22 @@ class Simulation:
 
         return self._obj.mark_agent_for_removal(agent_id)
 
+    def mark_agents_for_removal(self, agent_ids: Iterable[int]) -> bool:
+        """Marks several agents for removal.
+
+        Same as calling :func:`mark_agent_for_removal` for each agent, but
+        crosses into the native library only once. If any of the agents does
+        not exist, none of them is marked.
+
+        Arguments:
+            agent_ids: Ids of the agents marked for removal
+
+        Returns:
+            marking for removal was successful
+        """
+
+        return self._obj.mark_agents_for_removal(list(agent_ids))
+
     def removed_agents(self) -> list[int]:
         """All agents (given by Id) removed in the last iteration.
 
@@ -372,6 +465,31 @@ class Simulation:
         """
         return self._obj.agent(agent_id)
 
+    def agent_handle(self, agent_id) -> int:
+        """Handle of a specific agent in the simulation.
+
+        Accessing an agent by handle avoids the lookup by id. A handle stays
+        valid until the agent is removed and is never reused for other agents.
+
+        Arguments:
+            agent_id: Id of the agent
+
+        Returns:
+            Handle of the agent
+        """
+        return self._obj.agent_handle(agent_id)
+
+    def agent_by_handle(self, agent_handle: int) -> Agent:
+        """Access specific agent in the simulation by its handle.
+
+        Arguments:
+            agent_handle: Handle of the agent, see :func:`agent_handle`
+
+        Returns:
+            Agent instance
+        """
+        return self._obj.agent_by_handle(agent_handle)
+
     def agents_in_range(
         self, pos: tuple[float, float], distance: float
     ) -> list[Agent]:
@@ -461,15 +579,54 @@ class Simulation:
         """
         return Geometry(self._obj.get_geometry())
 
-    def switch_geometry(self, geometry: Geometry) -> None:
+    def switch_geometry(self, geometry: Geometry, **kwargs: Any) -> None:
         """Switch the geometry of the simulation.
 
         Exchanges the current geometry with the new one. Checks if all agents
-        and stages lie within the new geometry.
+        and stages lie within the new geometry. All doors of the new geometry
+        are open.
 
         Arguments:
             geometry: The new geometry to be used in the simulation.
 
+        Keyword Arguments:
+            doors: list of doors of the new geometry given by their two end
+                points, see :meth:`close_door`.
         """
-        internal_geometry = build_geometry(geometry)
+        internal_geometry = build_geometry(geometry, **kwargs)
         self._obj.switch_geometry(internal_geometry._obj)
+
+    def close_door(self, door: int) -> None:
+        """Close a door of the current geometry.
+
+        A closed door acts as a wall. Agents are routed around it, agents that
+        can only reach their target through closed doors walk up to them and
+        wait until they are opened. Only the routing data around the door is
+        updated, the geometry is not built again.
+
+        Arguments:
+            door: Index of the door in the list of doors the geometry was
+                built with.
+        """
+        self._obj.set_door_closed(door, True)
+
+    def open_door(self, door: int) -> None:
+        """Open a door of the current geometry, see :meth:`close_door`.
+
+        Arguments:
+            door: Index of the door in the list of doors the geometry was
+                built with.
+        """
+        self._obj.set_door_closed(door, False)
+
+    def is_door_closed(self, door: int) -> bool:
+        """Whether a door of the current geometry is closed.
+
+        Arguments:
+            door: Index of the door in the list of doors the geometry was
+                built with.
+
+        Returns:
+            True if the door is closed.
+        """
+        return self._obj.is_door_closed(door)
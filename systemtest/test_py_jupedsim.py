@@ -1,6 +1,9 @@
 # Copyright © 2012-2024 Forschungszentrum Jülich GmbH
 # SPDX-License-Identifier: LGPL-3.0-or-later
+import gc
+
 import jupedsim as jps
+import numpy as np
 import pytest
 import shapely
 
@@ -502,3 +505,43 @@ def test_agent_can_not_be_added_outside_geometry():
                 stage_id=exit_id,
             )
         )
+
+
+def test_waypoint_batch_matches_single_queries():
+    routing = jps.RoutingEngine(
+        shapely.Polygon(
+            [(0, 0), (20, 0), (20, 20), (0, 20)],
+            [[(5, 5), (15, 5), (15, 15), (5, 15)]],
+        )
+    )
+    frm = [(1, 1), (2, 18), (10, 2), (19, 10)]
+    to = [(19, 19), (18, 2), (10, 18), (1, 10)]
+
+    offsets, points = routing.compute_waypoint_batch(frm, to, thread_count=2)
+
+    assert offsets.shape == (len(frm) + 1,)
+    assert points.shape == (offsets[-1], 2)
+    for index, (start, destination) in enumerate(zip(frm, to)):
+        expected = routing.compute_waypoints(start, destination)
+        path = points[offsets[index] : offsets[index + 1]]
+        np.testing.assert_array_equal(path, np.array(expected))
+
+
+def test_waypoint_batch_arrays_outlive_routing_engine():
+    routing = jps.RoutingEngine([(0, 0), (10, 0), (10, 10), (0, 10)])
+    offsets, points = routing.compute_waypoint_batch([(1, 1)], [(9, 9)])
+    expected = points.copy()
+
+    # The arrays do not copy the paths, they own the buffers of the batch
+    assert not offsets.flags.owndata
+    assert not points.flags.owndata
+    del routing
+    del offsets
+    gc.collect()
+    np.testing.assert_array_equal(points, expected)
+
+
+def test_waypoint_batch_rejects_points_outside_of_geometry():
+    routing = jps.RoutingEngine([(0, 0), (10, 0), (10, 10), (0, 10)])
+    with pytest.raises(RuntimeError):
+        routing.compute_waypoint_batch([(1, 1), (20, 20)], [(9, 9), (5, 5)])